@@ -19,11 +19,21 @@
 */
 
 #include "dbs/dbs.h"
+#include "dbs/dbs_diff.h"
 #include "dbs/details/dbs_impl.h"
 #include "dbs/details/dbs_details.inl"
+#include "dbs/memory_resource.h"
 
 #include <boost/pool/pool.hpp>
-#include <boost/functional/hash.hpp>
+
+#include <stdexcept>
+#include <mutex>
+#include <cassert>
+
+#ifdef DBS_THREAD_SAFE
+    #include <atomic>
+    #include <thread>
+#endif
 
 namespace dbs_lib { namespace details
 {
@@ -60,127 +70,731 @@ struct symbolic_allocator
     }
 };
 
-template<class value_type>
-struct pod_type
-{    
-    char m_data[sizeof(value_type)];
+class malloc_memory_resource : public memory_resource
+{
+    public:
+        void* allocate(size_t bytes, size_t alignment) override
+        {
+            (void)alignment;
+            return symbolic_allocator<dbs_tag>::malloc(bytes);
+        };
+
+        void deallocate(void* ptr, size_t bytes, size_t alignment) override
+        {
+            (void)bytes;
+            (void)alignment;
+            symbolic_allocator<dbs_tag>::free(ptr);
+        };
 };
 
-struct allocator_pools
+// memory resource used by a pool, when the pool requests memory; must
+// be set before any pool operation, that can allocate or free memory
+static memory_resource* g_pool_resource = nullptr;
+
+// user allocator of boost::pool; size of memory block is stored before
+// the block, since memory_resource requires it
+struct resource_allocator
 {
-    using allocator_type    = details::symbolic_allocator<dbs_tag>;
-    using pool_type         = boost::pool<allocator_type>;
+    using size_type         = std::size_t;
+    using difference_type   = std::ptrdiff_t;
 
-    pool_type*  m_pools;
-    size_t*     m_elems;
+    static const size_t header_size = alignof(std::max_align_t);
 
-    allocator_pools();
-    ~allocator_pools();
+    static char* malloc(const size_type bytes)
+    { 
+        size_t size = bytes + header_size;
+        char* ptr   = static_cast<char*>(g_pool_resource->allocate(size, header_size));
+
+        *reinterpret_cast<size_t*>(ptr) = size;
+        return ptr + header_size;
+    }
+    static void free(char* const block)
+    { 
+        char* ptr   = block - header_size;
+        size_t size = *reinterpret_cast<size_t*>(ptr);
+
+        g_pool_resource->deallocate(ptr, size, header_size);
+    }
 };
 
-allocator_pools::allocator_pools()
+// pools of sets allocated from one memory resource
+struct pool_set
 {
+    using allocator_type    = details::symbolic_allocator<dbs_tag>;
+    using pool_type         = boost::pool<resource_allocator>;
+
     static const int block_bits = details::block::block_bits;
 
-    void* pool_ptr  = allocator_type::malloc((block_bits+1) * sizeof(pool_type));
-    void* elem_ptr  = allocator_type::malloc((block_bits+1)*sizeof(size_t));
+    pool_type*          m_pools;
+    size_t              m_elems[block_bits + 1];
+    size_t              m_total;
+
+    memory_resource*    m_resource;
+    bool                m_use_pools;
 
+    // number of installations of this memory resource
+    size_t              m_installed;
+
+    pool_set(memory_resource* res, bool use_pools);
+    ~pool_set();
+
+    dbs_set*            malloc(size_t elems);
+    void                free(dbs_set* ptr, size_t elems);
+
+    static size_t       set_bytes(size_t elems);
+};
+
+pool_set::pool_set(memory_resource* res, bool use_pools)
+    :m_total(0), m_resource(res), m_use_pools(use_pools), m_installed(0)
+{
+    void* pool_ptr  = allocator_type::malloc((block_bits+1) * sizeof(pool_type));
     m_pools         = reinterpret_cast<pool_type*>(pool_ptr);
-    m_elems         = reinterpret_cast<size_t*>(elem_ptr);
 
     for (size_t i = 1; i <= block_bits; ++i)
     {
-        new(m_pools + i) pool_type(i * sizeof(dbs) + sizeof(details::dbs_set));
+        new(m_pools + i) pool_type(set_bytes(i));
         m_elems[i]  = 0;
     };
 };
 
-allocator_pools::~allocator_pools()
+pool_set::~pool_set()
 {
-    static const int block_bits = details::block::block_bits;
+    g_pool_resource = m_resource;
 
     for (size_t i = 1; i <= block_bits; ++i)
     {
         assert(m_elems[i] == 0);
-        m_pools[i].purge_memory();
+        m_pools[i].~pool_type();
     };
 
     allocator_type::free(m_pools);
-    allocator_type::free(m_elems);
+};
+
+size_t pool_set::set_bytes(size_t elems)
+{
+    return elems * sizeof(dbs) + sizeof(details::dbs_set);
+};
+
+DBS_FORCE_INLINE
+dbs_set* pool_set::malloc(size_t elems)
+{
+    void* ptr;
+
+    if (m_use_pools == true)
+    {
+        g_pool_resource = m_resource;
+        ptr             = m_pools[elems].malloc();
+
+        if (!ptr)
+            allocator_type::report_bad_alloc();
+    }
+    else
+    {
+        ptr             = m_resource->allocate(set_bytes(elems), alignof(dbs_set));
+    };
+
+    ++m_elems[elems];
+    ++m_total;
+
+    return static_cast<details::dbs_set*>(ptr);
+};
+
+DBS_FORCE_INLINE
+void pool_set::free(dbs_set* ptr, size_t elems)
+{
+    --m_elems[elems];
+    --m_total;
+
+    if (m_use_pools == true)
+        m_pools[elems].free(ptr);
+    else
+        m_resource->deallocate(ptr, set_bytes(elems), alignof(dbs_set));
 };
 
 //------------------------------------------------------------
-//                      dbs_initializer
+//                      allocator_lock
 //------------------------------------------------------------
-static allocator_pools* apools = nullptr;
+#ifdef DBS_THREAD_SAFE
 
-// nifty counter
-static int g_counter = 0;
+// value read without locking
+template<class T>
+using shared_value  = std::atomic<T>;
 
-dbs_initializer::dbs_initializer()
+// lock protecting pools; critical sections are short, therefore a spin
+// lock is used
+class allocator_lock
 {
-    if (g_counter == 0)
-        apools = new allocator_pools();
+    private:
+        std::atomic_flag    m_flag = ATOMIC_FLAG_INIT;
+
+    public:
+        void lock()
+        {
+            while (m_flag.test_and_set(std::memory_order_acquire) == true)
+                std::this_thread::yield();
+        };
 
-    ++g_counter;
+        void unlock()
+        {
+            m_flag.clear(std::memory_order_release);
+        };
 };
 
-dbs_initializer::~dbs_initializer()
+#else
+
+template<class T>
+using shared_value  = T;
+
+class allocator_lock
 {
-    --g_counter;
+    public:
+        void lock()     {};
+        void unlock()   {};
+};
+
+#endif
+
+using lock_guard    = std::lock_guard<allocator_lock>;
+
+struct thread_cache;
 
-    if (g_counter == 0)   
+//------------------------------------------------------------
+//                      allocator_pools
+//------------------------------------------------------------
+struct allocator_pools
+{
+    using dead_queue        = std::vector<dead_set>;
+
+    static const size_t max_sets    = size_t(1) << dbs_set::tag_bits;
+
+    // all fields except shared values must be accessed with m_lock held
+    allocator_lock      m_lock;
+
+    // default memory resource
+    malloc_memory_resource  m_malloc_resource;
+
+    // pool sets indexed by tags; the first set uses default memory resource
+    pool_set*           m_sets[max_sets];
+
+    // sets waiting for release in the deferred reclamation mode
+    shared_value<reclamation_mode>  m_mode;
+    dead_queue          m_dead_queue;
+
+    // list of caches of all threads
+    thread_cache*       m_caches;
+
+    allocator_pools();
+
+    // the allocator is never destroyed
+    ~allocator_pools() = delete;
+
+    // return tag of pool set using given memory resource; pool set is
+    // created if necessary; installation count is increased
+    size_t              install(memory_resource* res, bool use_pools);
+
+    // decrease installation count of a pool set; unused set is removed
+    void                uninstall(size_t tag);
+
+    // remove pool set if it is not installed and does not own any set
+    void                remove_unused(size_t tag);
+
+    // return number of allocated sets
+    size_t              allocated() const;
+};
+
+allocator_pools::allocator_pools()
+    :m_mode(reclamation_mode::immediate), m_caches(nullptr)
+{
+    m_sets[0]       = new pool_set(&m_malloc_resource, true);
+    m_sets[0]->m_installed = 1;
+
+    for (size_t i = 1; i < max_sets; ++i)
+        m_sets[i]   = nullptr;
+};
+
+size_t allocator_pools::install(memory_resource* res, bool use_pools)
+{
+    size_t free_tag = 0;
+
+    for (size_t i = 0; i < max_sets; ++i)
     {
-        delete apools;
-        apools = nullptr;
+        pool_set* set   = m_sets[i];
+
+        if (set == nullptr)
+        {
+            if (free_tag == 0)
+                free_tag = i;
+
+            continue;
+        };
+
+        if (set->m_resource == res && set->m_use_pools == use_pools)
+        {
+            // the default pool set is never removed
+            if (i != 0)
+                ++set->m_installed;
+
+            return i;
+        };
     };
-}
 
-details::dbs_set* details::Allocator::create(size_t elems)
+    if (free_tag == 0)
+        throw std::length_error("dbs: too many memory resources");
+
+    m_sets[free_tag]    = new pool_set(res, use_pools);
+    m_sets[free_tag]->m_installed = 1;
+
+    return free_tag;
+};
+
+void allocator_pools::uninstall(size_t tag)
+{
+    if (tag == 0)
+        return;
+
+    --m_sets[tag]->m_installed;
+    remove_unused(tag);
+};
+
+void allocator_pools::remove_unused(size_t tag)
+{
+    pool_set* set   = m_sets[tag];
+
+    if (tag == 0 || set->m_installed > 0 || set->m_total > 0)
+        return;
+
+    delete set;
+    m_sets[tag]     = nullptr;
+};
+
+// defined regardless of DBS_REFCOUNT_STATS, so that clients counting
+// refcount operations can be linked with the library built without counting
+#ifdef DBS_THREAD_SAFE
+    std::atomic<size_t> g_refcount_ops(0);
+#else
+    size_t g_refcount_ops = 0;
+#endif
+
+// the allocator is created on first use, which is thread safe, and is never
+// destroyed; therefore bitsets can be created and destroyed in constructors
+// and destructors of static objects and by threads running at program exit;
+// memory is released by the operating system
+static allocator_pools& get_pools()
+{
+    static allocator_pools* pools = new allocator_pools();
+    return *pools;
+};
+
+//------------------------------------------------------------
+//                      current memory resource
+//------------------------------------------------------------
+// tag of pool set used for allocation of new sets by the current thread;
+// pool set with nonzero tag is installed on behalf of this thread
+static thread_local size_t  t_current_tag   = 0;
+
+// uninstalls pool set used by the current thread when the thread exits
+struct current_tag_owner
+{
+    ~current_tag_owner();
+};
+
+current_tag_owner::~current_tag_owner()
+{
+    size_t tag      = t_current_tag;
+    t_current_tag   = 0;
+
+    if (tag == 0)
+        return;
+
+    allocator_pools& pools  = get_pools();
+    lock_guard lock(pools.m_lock);
+
+    pools.uninstall(tag);
+};
+
+// use pool set with memory resource res in the current thread; return tag
+// of previous pool set, which is not uninstalled; allocator lock must be held
+static size_t install_current(allocator_pools& pools, memory_resource* res, bool use_pools)
+{
+    static thread_local current_tag_owner owner;
+    (void)owner;
+
+    size_t prev     = t_current_tag;
+    t_current_tag   = pools.install(res, use_pools);
+
+    return prev;
+};
+
+//------------------------------------------------------------
+//                      thread_cache
+//------------------------------------------------------------
+#ifdef DBS_THREAD_SAFE
+
+// cache of free sets owned by one thread; sets allocated from the default
+// pool set are taken from the cache and returned to it without locking;
+// sets are moved between the cache and pools in batches
+struct thread_cache
 {
-    ++apools->m_elems[elems];
-    return static_cast<details::dbs_set*>(apools->m_pools[elems].malloc());
+    static const int block_bits     = details::block::block_bits;
+
+    // maximum size in bytes of cached sets with given number of elements
+    static const size_t max_bytes   = 8192;
+
+    // lists of free sets indexed by number of elements; the first word of
+    // a free set points to the next set
+    void*               m_free[block_bits + 1];
+    size_t              m_count[block_bits + 1];
+
+    // number of cached sets; written by the owning thread only
+    std::atomic<size_t> m_cached;
+
+    // list of caches; protected by allocator lock
+    thread_cache*       m_prev;
+    thread_cache*       m_next;
+
+    thread_cache();
+
+    dbs_set*            malloc(size_t elems);
+    void                free(dbs_set* ptr, size_t elems);
+
+    // return all cached sets to the pool set; allocator lock must be held
+    void                flush();
+
+    void                push(void* ptr, size_t elems);
+    void*               pop(size_t elems);
+    void                add_cached(size_t n);
+    void                remove_cached(size_t n);
+
+    static size_t       max_count(size_t elems);
+};
+
+thread_cache::thread_cache()
+    :m_cached(0), m_prev(nullptr), m_next(nullptr)
+{
+    for (size_t i = 0; i <= block_bits; ++i)
+    {
+        m_free[i]   = nullptr;
+        m_count[i]  = 0;
+    };
+};
+
+DBS_FORCE_INLINE
+size_t thread_cache::max_count(size_t elems)
+{
+    return std::max<size_t>(max_bytes / pool_set::set_bytes(elems), 2);
+};
+
+DBS_FORCE_INLINE
+void thread_cache::add_cached(size_t n)
+{
+    m_cached.store(m_cached.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+};
+
+DBS_FORCE_INLINE
+void thread_cache::remove_cached(size_t n)
+{
+    m_cached.store(m_cached.load(std::memory_order_relaxed) - n, std::memory_order_relaxed);
+};
+
+DBS_FORCE_INLINE
+void thread_cache::push(void* ptr, size_t elems)
+{
+    *static_cast<void**>(ptr)   = m_free[elems];
+    m_free[elems]               = ptr;
+    ++m_count[elems];
+};
+
+DBS_FORCE_INLINE
+void* thread_cache::pop(size_t elems)
+{
+    void* ptr       = m_free[elems];
+    m_free[elems]   = *static_cast<void**>(ptr);
+    --m_count[elems];
+
+    return ptr;
+};
+
+DBS_FORCE_INLINE
+dbs_set* thread_cache::malloc(size_t elems)
+{
+    if (m_count[elems] == 0)
+    {
+        size_t n        = max_count(elems) / 2;
+        allocator_pools& pools  = get_pools();
+        pool_set* set   = pools.m_sets[0];
+
+        lock_guard lock(pools.m_lock);
+
+        for (size_t i = 0; i < n; ++i)
+        {
+            push(set->malloc(elems), elems);
+            add_cached(1);
+        };
+    }
+
+    remove_cached(1);
+    return static_cast<dbs_set*>(pop(elems));
+};
+
+DBS_FORCE_INLINE
+void thread_cache::free(dbs_set* ptr, size_t elems)
+{
+    if (m_count[elems] >= max_count(elems))
+    {
+        size_t n        = m_count[elems] / 2;
+        allocator_pools& pools  = get_pools();
+        pool_set* set   = pools.m_sets[0];
+
+        lock_guard lock(pools.m_lock);
+
+        for (size_t i = 0; i < n; ++i)
+            set->free(static_cast<dbs_set*>(pop(elems)), elems);
+
+        remove_cached(n);
+    };
+
+    push(ptr, elems);
+    add_cached(1);
+};
+
+void thread_cache::flush()
+{
+    pool_set* set   = get_pools().m_sets[0];
+
+    for (size_t i = 1; i <= block_bits; ++i)
+    {
+        while (m_count[i] > 0)
+            set->free(static_cast<dbs_set*>(pop(i)), i);
+    };
+
+    m_cached.store(0, std::memory_order_relaxed);
+};
+
+// cache of the current thread; null if the cache is not created yet or 
+// is already destroyed
+static thread_local thread_cache*   t_cache             = nullptr;
+static thread_local bool            t_cache_destroyed   = false;
+
+// owner of the cache of the current thread
+struct thread_cache_owner
+{
+    thread_cache_owner();
+    ~thread_cache_owner();
+};
+
+thread_cache_owner::thread_cache_owner()
+{
+    thread_cache* cache = new thread_cache();
+
+    allocator_pools& pools  = get_pools();
+    lock_guard lock(pools.m_lock);
+
+    cache->m_next       = pools.m_caches;
+
+    if (pools.m_caches != nullptr)
+        pools.m_caches->m_prev  = cache;
+
+    pools.m_caches      = cache;
+    t_cache             = cache;
+};
+
+thread_cache_owner::~thread_cache_owner()
+{
+    thread_cache* cache = t_cache;
+
+    t_cache             = nullptr;
+    t_cache_destroyed   = true;
+
+    {
+        allocator_pools& pools  = get_pools();
+        lock_guard lock(pools.m_lock);
+
+        cache->flush();
+
+        if (cache->m_prev != nullptr)
+            cache->m_prev->m_next   = cache->m_next;
+        else
+            pools.m_caches          = cache->m_next;
+
+        if (cache->m_next != nullptr)
+            cache->m_next->m_prev   = cache->m_prev;
+    };
+
+    delete cache;
+};
+
+static thread_cache* init_thread_cache()
+{
+    // sets released by destructors of thread local and static objects
+    // after destruction of the cache are returned directly to pools
+    if (t_cache_destroyed == true)
+        return nullptr;
+
+    static thread_local thread_cache_owner owner;
+    return t_cache;
+};
+
+DBS_FORCE_INLINE
+static thread_cache* get_thread_cache()
+{
+    if (t_cache != nullptr)
+        return t_cache;
+
+    return init_thread_cache();
+};
+
+size_t allocator_pools::allocated() const
+{
+    size_t count    = 0;
+
+    for (size_t i = 0; i < max_sets; ++i)
+    {
+        if (m_sets[i])
+            count   += m_sets[i]->m_total;
+    };
+
+    // cached sets are allocated from pools, but not used
+    for (thread_cache* cache = m_caches; cache != nullptr; cache = cache->m_next)
+        count       -= cache->m_cached.load(std::memory_order_relaxed);
+
+    return count;
+};
+
+#else
+
+size_t allocator_pools::allocated() const
+{
+    size_t count    = 0;
+
+    for (size_t i = 0; i < max_sets; ++i)
+    {
+        if (m_sets[i])
+            count   += m_sets[i]->m_total;
+    };
+
+    return count;
+};
+
+#endif
+
+//------------------------------------------------------------
+//                      Allocator
+//------------------------------------------------------------
+details::dbs_set* details::Allocator::create(size_t elems, size_t& tag)
+{
+    allocator_pools& pools  = get_pools();
+    tag                     = t_current_tag;
+
+    #ifdef DBS_THREAD_SAFE
+        if (tag == 0)
+        {
+            thread_cache* cache = get_thread_cache();
+
+            if (cache != nullptr)
+                return cache->malloc(elems);
+        };
+    #endif
+
+    lock_guard lock(pools.m_lock);
+    return pools.m_sets[tag]->malloc(elems);
+};
+
+size_t details::Allocator::current_tag()
+{
+    return t_current_tag;
+};
+
+size_t details::Allocator::exchange_tag(size_t tag)
+{
+    size_t prev     = t_current_tag;
+    t_current_tag   = tag;
+
+    return prev;
 };
 
 void details::Allocator::destroy(dbs_set* ptr, size_t elems)
 {
-    --apools->m_elems[elems];
-    apools->m_pools[elems].free(ptr);
+    allocator_pools& pools  = get_pools();
+    size_t tag              = ptr->get_tag();
+
+    #ifdef DBS_THREAD_SAFE
+        if (tag == 0)
+        {
+            thread_cache* cache = get_thread_cache();
+
+            if (cache != nullptr)
+            {
+                cache->free(ptr, elems);
+                return;
+            };
+        };
+    #endif
+
+    lock_guard lock(pools.m_lock);
+    pools.m_sets[tag]->free(ptr, elems);
+
+    if (tag != 0)
+        pools.remove_unused(tag);
 };
 
 //------------------------------------------------------------
-//                      dbs_impl
+//                      dbs_set
 //------------------------------------------------------------
-dbs_impl::dbs_impl()
-{};
+void dbs_set::destroy(size_t elems)
+{
+    allocator_pools& pools  = get_pools();
+
+    if (pools.m_mode == reclamation_mode::deferred)
+    {
+        lock_guard lock(pools.m_lock);
+        pools.m_dead_queue.push_back(dead_set{this, elems});
+        return;
+    };
 
-dbs_impl::dbs_impl(details::block::header_type h, size_t f, details::dbs_set* ptr)
-    :m_data(h,f,ptr)
-{};
+    // release subsets iteratively using explicit stack; subsets released
+    // by a set have lower level than this set, therefore at most block_bits
+    // items are added to the stack for every level
+    static const size_t max_dead    = block::block_bits * (block::max_level + 1);
 
-dbs_impl::dbs_impl(const dbs_impl& copy)
-    :m_data(copy.m_data)
-{};
+    dead_set dead[max_dead];
+    size_t n_dead   = 0;
 
-dbs_impl::dbs_impl(dbs_impl&& copy)
-    :m_data(std::move(copy.m_data))
-{};
+    this->release(elems, dead, n_dead);
 
-dbs_impl::~dbs_impl()
-{}
+    while (n_dead > 0)
+    {
+        --n_dead;
+        dead_set item   = dead[n_dead];
 
-dbs_impl& dbs_impl::operator=(const dbs_impl& copy)
-{
-    this->m_data = copy.m_data;
-    return *this;
+        item.m_set->release(item.m_size, dead, n_dead);
+    };
 };
 
-dbs_impl& dbs_impl::operator=(dbs_impl&& copy)
+void dbs_set::release(size_t elems, dead_set* dead, size_t& n_dead)
 {
-    this->m_data = std::move(copy.m_data);
-    return *this;
-}
+    // subsets are released here; destructors of dbs_impl are not called
+    for (size_t i = 0; i < elems; ++i)
+    {
+        const block& elem   = get_elem(i).get_data();
+
+        if (elem.get_level() == 0)
+            continue;
+
+        dbs_set* ptr        = elem.get_fsb_set();
+
+        if (ptr->decrease_refcount() == true)
+        {
+            dead[n_dead]    = dead_set{ptr, elem.m_header.get_size()};
+            ++n_dead;
+        };
+    };
+
+    Allocator::destroy(this, elems);
+};
 
+//------------------------------------------------------------
+//                      dbs_impl
+//------------------------------------------------------------
 dbs_impl::dbs_impl(size_t elem)
 {
     using block             = details::block;
@@ -315,6 +929,9 @@ dbs_impl dbs_impl::build_level(ushort_type level, size_t count, const size_t* el
         {
             ++k;
 
+            if (k == count)
+                break;
+
             cur_rem         = block::mod_pow2(block::div_pow2(elems[k], 
                                 capacity_bits), block_bits_log);
         };                     
@@ -400,6 +1017,37 @@ dbs_impl dbs_impl::set(size_t pos, bool& changed) const
     };
 };
 
+dbs_impl dbs_impl::set_owned(size_t pos, bool& changed)
+{
+    using block             = details::block;
+    size_t level            = m_data.get_level();
+
+    // children of shared nodes must be copied
+    if (level == 0 || m_data.get_fsb_set()->is_unique() == false)
+        return set(pos, changed);
+
+    size_t capacity_bits    = block_bits_log*level + 1;    
+    
+    size_t prev_lev_coord   = block::mod_pow2(pos, capacity_bits);
+    size_t this_lev_coord   = block::div_pow2(pos, capacity_bits);
+
+    if (this_lev_coord >= (size_t(1) << block_bits_log))
+    {
+        changed             = true;
+        return this->increase_level(pos);
+    };
+
+    size_t has_this_block   = (this->m_data.m_flags & block::bit_mask(this_lev_coord));
+
+    if (has_this_block == false)
+    {
+        changed             = true;
+        return this->insert_block_owned(this_lev_coord, prev_lev_coord);
+    };
+
+    return this->set_elem_owned(this_lev_coord, prev_lev_coord, changed);
+};
+
 dbs_impl dbs_impl::reset(size_t pos) const
 {
     bool changed;
@@ -603,6 +1251,75 @@ dbs_impl dbs_impl::set_elem(size_t this_level_coord, size_t prev_level_coord,
     return ret;
 };
 
+dbs_impl dbs_impl::insert_block_owned(size_t this_level_coord, size_t prev_level_coord)
+{    
+    using block             = details::block;
+    ushort_type old_size    = this->m_data.m_header.get_size();
+    ushort_type new_size    = old_size + 1;
+
+    block::header_type h(this->m_data.get_level(), new_size);
+
+    size_t old_flags        = this->m_data.m_flags;
+    size_t new_flags        = (old_flags | block::bit_mask(this_level_coord));
+
+    dbs_impl ret(h,new_flags, details::dbs_set::create(new_size));
+
+    size_t bits_before      = block::bits_before_pos(old_flags, this_level_coord);
+    size_t bits_before_count= block::count_bits(bits_before);
+
+    details::dbs_set* old_set   = this->m_data.get_fsb_set();
+
+    for (size_t i = 0; i < bits_before_count; ++i)
+        ret.m_data.get_fsb_set()->init(i, std::move(old_set->get_elem(i)));
+
+    {
+        dbs_impl new_dbs(prev_level_coord);    
+        ret.m_data.get_fsb_set()->init(bits_before_count,std::move(new_dbs));
+    };
+
+    for (size_t i = bits_before_count; i < old_size; ++i)
+        ret.m_data.get_fsb_set()->init(i + 1, std::move(old_set->get_elem(i)));
+
+    return ret;
+};
+
+dbs_impl dbs_impl::set_elem_owned(size_t this_level_coord, size_t prev_level_coord, 
+                                  bool& changed)
+{
+    using block                 = details::block;
+
+    ushort_type old_size        = this->m_data.m_header.get_size();
+    size_t old_flags            = this->m_data.m_flags;
+    
+    size_t bits_before          = block::bits_before_pos(old_flags, this_level_coord);
+    size_t bits_before_count    = block::count_bits(bits_before);
+
+    details::dbs_set* old_set   = this->m_data.get_fsb_set();
+    dbs_impl& old_dbs           = old_set->get_elem(bits_before_count);
+    dbs_impl new_dbs            = old_dbs.set_owned(prev_level_coord, changed);
+
+    if (changed == false)
+    {
+        // old_dbs could be moved to new_dbs
+        old_dbs                 = std::move(new_dbs);
+        return std::move(*this);
+    };
+
+    block::header_type h(this->m_data.get_level(), old_size);
+
+    dbs_impl ret(h, old_flags, details::dbs_set::create(old_size)); 
+
+    for (size_t i = 0; i < bits_before_count; ++i)
+        ret.m_data.get_fsb_set()->init(i, std::move(old_set->get_elem(i)));
+
+    ret.m_data.get_fsb_set()->init(bits_before_count,std::move(new_dbs));
+
+    for (size_t i = bits_before_count + 1; i < old_size; ++i)
+        ret.m_data.get_fsb_set()->init(i, std::move(old_set->get_elem(i)));
+
+    return ret;
+};
+
 dbs_impl dbs_impl::reset_elem(size_t this_level_coord, size_t prev_level_coord, bool& changed) const
 {
     using block                 = details::block;
@@ -716,28 +1433,6 @@ dbs_impl dbs_impl::flip_elem(size_t this_level_coord, size_t prev_level_coord) c
     };    
 };
 
-bool dbs_impl::any() const
-{
-    if (this->m_data.m_flags != 0)
-        return true;
-
-    if (this->m_data.get_level() == 0 && this->m_data.get_block_1() != 0)
-        return true;
-
-    return false;
-};
-
-bool dbs_impl::none() const
-{
-    if (this->m_data.m_flags != 0)
-        return false;
-
-    if (this->m_data.get_level() == 0 && this->m_data.get_block_1() != 0)
-        return false;
-
-    return true;
-};
-
 size_t dbs_impl::size() const
 {
     using block     = details::block;
@@ -760,189 +1455,380 @@ size_t dbs_impl::size() const
 
 size_t dbs_impl::hash_value_impl() const
 {
-    if (this->m_data.get_level() == 0)
+    // hashes of children are cached in tree nodes
+    return this->m_data.hash_value();
+};
+
+void dbs_impl::get_elements(std::vector<size_t>& elems) const
+{
+    size_t n        = this->size();
+    size_t old_size = elems.size();
+
+    elems.resize(old_size + n);
+    get_elements(0, elems.data() + old_size);
+};
+
+size_t dbs_impl::first() const
+{
+    if (this->none() == true)
+        return npos;
+
+    using block         = details::block;
+    size_t level        = m_data.get_level();    
+
+    using header_type   = block::header_type;
+
+    if (level == 0)
     {
-        size_t seed = this->m_data.get_block_0();
-        boost::hash_combine(seed, this->m_data.get_block_1());
-        return seed;
+        size_t block1   = this->m_data.get_block_0();
+        size_t block2   = this->m_data.get_block_1();
+
+        size_t pos_1    = (size_t)-1;
+        size_t pos_2    = (size_t)-1;
+        
+        if (block1)
+        {
+            pos_1       = header_type::least_significant_bit_pos(block1);
+            pos_1       = pos_1 * 2;
+        }
+        if (block2)
+        {
+            pos_2       = header_type::least_significant_bit_pos(block2);
+            pos_2       = pos_2 * 2 + 1;
+        };
+
+        return std::min(pos_1, pos_2);
     };
 
-    size_t seed = 0;
-    size_t elem = this->m_data.m_header.get_size();
+    size_t offset_bits  = block_bits_log*(level-1) + block_bits_log + 1;
+    size_t block_flags  = this->m_data.m_flags;
 
-    for (size_t i = 0; i < elem; ++i)
+    size_t pos          = header_type::least_significant_bit_pos(block_flags);
+    size_t offset       = (pos << offset_bits);
+
+    size_t val          = this->m_data.get_fsb_set()->get_elem(0).first();
+    return val + offset;
+};
+
+size_t dbs_impl::last() const
+{
+    if (this->none() == true)
+        return npos;
+
+    size_t level        = m_data.get_level();    
+    using block         = details::block;
+    using header_type   = block::header_type;
+
+    if (level == 0)
     {
-        size_t hash = this->m_data.get_fsb_set()->get_elem(i).hash_value_impl();
-        boost::hash_combine(seed, hash);
-    }
+        size_t block1   = this->m_data.get_block_0();
+        size_t block2   = this->m_data.get_block_1();
+
+        size_t pos_1    = 0;
+        size_t pos_2    = 0;
+        
+        if (block1)
+        {
+            pos_1       = header_type::most_significant_bit_pos(block1);
+            pos_1       = pos_1 * 2;
+        }
+
+        if (block2)
+        {
+            pos_2       = header_type::most_significant_bit_pos(block2);
+            pos_2       = pos_2 * 2 + 1;
+        };
+
+        return std::max(pos_1, pos_2);
+    };
+
+    size_t offset_bits  = block_bits_log*(level-1) + block_bits_log + 1;
+    size_t block_flags  = this->m_data.m_flags;
+    size_t size         = this->m_data.m_header.get_size();
+
+    size_t pos          = header_type::most_significant_bit_pos(block_flags);
+    size_t offset       = (pos << offset_bits);
+
+    size_t val          = this->m_data.get_fsb_set()->get_elem(size-1).last();
+    return val + offset;
+};
+
+size_t dbs_impl::next(size_t n) const
+{
+    if (n == npos)
+        return npos;
+
+    return find_next(n + 1);
+};
+
+size_t dbs_impl::prev(size_t n) const
+{
+    if (n == 0)
+        return npos;
+
+    return find_prev(n - 1);
+};
+
+size_t dbs_impl::next_unset(size_t n) const
+{
+    if (n == npos)
+        return npos;
+
+    return find_next_unset(n + 1);
+};
+
+size_t dbs_impl::prev_unset(size_t n) const
+{
+    if (n == 0)
+        return npos;
+
+    return find_prev_unset(n - 1);
+};
+
+size_t dbs_impl::find_next(size_t n) const
+{
+    using block         = details::block;
+
+    size_t level        = m_data.get_level();
+    size_t shift        = block_bits_log*level + 1;
+    size_t coord        = block::div_pow2(n, shift);
+
+    if (coord >= block_bits)
+        return npos;
+
+    if (level == 0)
+        return m_data.leaf_next(n);
+
+    size_t flags        = m_data.m_flags;
+    size_t offset       = coord << shift;
+
+    if (flags & block::bit_mask(coord))
+    {
+        size_t bits_before  = block::count_bits(block::bits_before_pos(flags, coord));
+        size_t val          = m_data.get_fsb_set()->get_elem(bits_before).find_next(n - offset);
+
+        if (val != npos)
+            return val + offset;
+
+        ++coord;
+    };
+
+    size_t pos          = block::next_bit_pos(flags, coord);
+
+    if (pos == block_bits)
+        return npos;
+
+    size_t bits_before  = block::count_bits(block::bits_before_pos(flags, pos));
+    size_t val          = m_data.get_fsb_set()->get_elem(bits_before).first();
+
+    return val + (pos << shift);
+};
+
+size_t dbs_impl::find_prev(size_t n) const
+{
+    using block         = details::block;
+
+    size_t level        = m_data.get_level();
+    size_t shift        = block_bits_log*level + 1;
+    size_t coord        = block::div_pow2(n, shift);
+
+    // all elements are less than n
+    if (coord >= block_bits)
+        return this->last();
+
+    if (level == 0)
+        return m_data.leaf_prev(n);
+
+    size_t flags        = m_data.m_flags;
+    size_t offset       = coord << shift;
+
+    if (flags & block::bit_mask(coord))
+    {
+        size_t bits_before  = block::count_bits(block::bits_before_pos(flags, coord));
+        size_t val          = m_data.get_fsb_set()->get_elem(bits_before).find_prev(n - offset);
+
+        if (val != npos)
+            return val + offset;
+    };
+
+    if (coord == 0)
+        return npos;
 
-    return seed;
-};
+    size_t pos          = block::prev_bit_pos(flags, coord - 1);
 
-void dbs_impl::get_elements(std::vector<size_t>& elems) const
-{
-    size_t n = this->size();
-    elems.reserve(n);
+    if (pos == npos)
+        return npos;
+
+    size_t bits_before  = block::count_bits(block::bits_before_pos(flags, pos));
+    size_t val          = m_data.get_fsb_set()->get_elem(bits_before).last();
 
-    return get_elements(0,elems);
+    return val + (pos << shift);
 };
 
-size_t dbs_impl::first() const
+size_t dbs_impl::find_next_unset(size_t n) const
 {
-    if (this->size() == 0)
-        return npos;
-
     using block         = details::block;
-    size_t level        = m_data.get_level();    
-
     using header_type   = block::header_type;
 
+    size_t level        = m_data.get_level();
+    size_t shift        = block_bits_log*level + 1;
+    size_t coord        = block::div_pow2(n, shift);
+
+    // values not covered by this node are not set
+    if (coord >= block_bits)
+        return n;
+
     if (level == 0)
     {
-        size_t block1   = this->m_data.get_block_0();
-        size_t block2   = this->m_data.get_block_1();
+        size_t lo, hi;
+        m_data.leaf_interleave(lo, hi);
 
-        size_t pos_1    = (size_t)-1;
-        size_t pos_2    = (size_t)-1;
-        
-        if (block1)
+        lo              = ~lo;
+        hi              = ~hi;
+
+        if (n < block_bits)
         {
-            pos_1       = header_type::least_significant_bit_pos(block1);
-            pos_1       = pos_1 * 2;
+            lo          = lo & (~size_t(0) << n);
+            
+            if (lo != 0)
+                return header_type::least_significant_bit_pos(lo);
         }
-        if (block2)
+        else
         {
-            pos_2       = header_type::least_significant_bit_pos(block2);
-            pos_2       = pos_2 * 2 + 1;
+            hi          = hi & (~size_t(0) << (n - block_bits));
         };
 
-        return std::min(pos_1, pos_2);
+        if (hi != 0)
+            return header_type::least_significant_bit_pos(hi) + block_bits;
+
+        // the first value after this node
+        return 2 * block_bits;
     };
 
-    size_t offset_bits  = block_bits_log*(level-1) + block_bits_log + 1;
-    size_t block_flags  = this->m_data.m_flags;
+    // number of child coordinates representable by size_t; lower than 
+    // block_bits only for the highest level
+    size_t capacity     = block_bits_log*level + block_bits_log + 1;
+    size_t n_coords     = (capacity > sizeof(size_t) * 8) 
+                        ? size_t(1) << (sizeof(size_t) * 8 - shift) : block_bits;
 
-    size_t pos          = header_type::least_significant_bit_pos(block_flags);
-    size_t offset       = (pos << offset_bits);
+    size_t flags        = m_data.m_flags;
+    size_t child_size   = size_t(1) << shift;
+    size_t child_pos    = block::mod_pow2(n, shift);
 
-    size_t val          = this->m_data.get_fsb_set()->get_elem(0).first();
-    return val + offset;
-};
+    for (; coord < n_coords; ++coord, child_pos = 0)
+    {
+        if ((flags & block::bit_mask(coord)) == 0)
+            return (coord << shift) + child_pos;
 
-dbs_impl::block_type& dbs_impl::get_data()
-{
-    return m_data;
-}
+        size_t bits_before  = block::count_bits(block::bits_before_pos(flags, coord));
+        size_t val          = m_data.get_fsb_set()->get_elem(bits_before)
+                                .find_next_unset(child_pos);
 
-const dbs_impl::block_type& dbs_impl::get_data() const
-{
-    return m_data;
-}
+        // val == child_size if all remaining values in this child are set
+        if (val < child_size)
+            return (coord << shift) + val;
+    };
 
-size_t dbs_impl::last() const
-{
-    if (this->size() == 0)
+    if (coord << shift == 0)
         return npos;
+    
+    return coord << shift;
+};
 
-    size_t level        = m_data.get_level();    
+size_t dbs_impl::find_prev_unset(size_t n) const
+{
     using block         = details::block;
     using header_type   = block::header_type;
 
+    size_t level        = m_data.get_level();
+    size_t shift        = block_bits_log*level + 1;
+    size_t coord        = block::div_pow2(n, shift);
+
+    // values not covered by this node are not set
+    if (coord >= block_bits)
+        return n;
+
     if (level == 0)
     {
-        size_t block1   = this->m_data.get_block_0();
-        size_t block2   = this->m_data.get_block_1();
+        size_t lo, hi;
+        m_data.leaf_interleave(lo, hi);
 
-        size_t pos_1    = 0;
-        size_t pos_2    = 0;
-        
-        if (block1)
+        lo              = ~lo;
+        hi              = ~hi;
+
+        if (n >= block_bits)
         {
-            pos_1       = header_type::most_significant_bit_pos(block1);
-            pos_1       = pos_1 * 2;
+            hi          = hi & (~size_t(0) >> (2 * block_bits - 1 - n));
+            
+            if (hi != 0)
+                return header_type::most_significant_bit_pos(hi) + block_bits;
         }
-
-        if (block2)
+        else
         {
-            pos_2       = header_type::most_significant_bit_pos(block2);
-            pos_2       = pos_2 * 2 + 1;
+            lo          = lo & (~size_t(0) >> (block_bits - 1 - n));
         };
 
-        return std::max(pos_1, pos_2);
+        if (lo != 0)
+            return header_type::most_significant_bit_pos(lo);
+
+        return npos;
     };
 
-    size_t offset_bits  = block_bits_log*(level-1) + block_bits_log + 1;
-    size_t block_flags  = this->m_data.m_flags;
-    size_t size         = this->m_data.m_header.get_size();
+    size_t flags        = m_data.m_flags;
+    size_t child_pos    = block::mod_pow2(n, shift);
 
-    size_t pos          = header_type::most_significant_bit_pos(block_flags);
-    size_t offset       = (pos << offset_bits);
+    for (;;)
+    {
+        if ((flags & block::bit_mask(coord)) == 0)
+            return (coord << shift) + child_pos;
 
-    size_t val          = this->m_data.get_fsb_set()->get_elem(size-1).first();
-    return val + offset;
+        size_t bits_before  = block::count_bits(block::bits_before_pos(flags, coord));
+        size_t val          = m_data.get_fsb_set()->get_elem(bits_before)
+                                .find_prev_unset(child_pos);
+
+        if (val != npos)
+            return (coord << shift) + val;
+
+        if (coord == 0)
+            return npos;
+
+        --coord;
+        child_pos           = (size_t(1) << shift) - 1;
+    };
 };
 
-void dbs_impl::get_elements(size_t offset, std::vector<size_t>& elems) const
+size_t* dbs_impl::get_elements(size_t offset, size_t* out) const
 {
+    using block         = details::block;
     size_t level        = m_data.get_level();    
 
     if (level == 0)
     {
-        size_t block1   = this->m_data.get_block_0();
-        size_t block2   = this->m_data.get_block_1();
-        size_t pos      = 0;
-
-        while(block1 && block2)
-        {
-            if (block1 % 2 == size_t(1))
-                elems.push_back(offset + (pos << 1));
-
-            if (block2 % 2 == size_t(1))
-                elems.push_back(offset + (pos << 1) + 1);
-
-            ++pos;            
-            block1      = block1 >> size_t(1);
-            block2      = block2 >> size_t(1);
-        };
-
-        while(block1)
-        {
-            if (block1 % 2 == size_t(1))
-                elems.push_back(offset + (pos << 1));
-
-            ++pos;            
-            block1      = block1 >> size_t(1);
-        };
-
-        while(block2)
-        {
-            if (block2 % 2 == size_t(1))
-                elems.push_back(offset + (pos << 1) + 1);
-
-            ++pos;            
-            block2      = block2 >> size_t(1);
-        };
+        size_t lo, hi;
+        this->m_data.leaf_interleave(lo, hi);
 
-        return;
+        out             = block::decode_bits(lo, offset, out);
+        out             = block::decode_bits(hi, offset + block_bits, out);
+        return out;
     };
 
+    using header_type   = block::header_type;
+
     size_t offset_bits  = block_bits_log*(level-1) + block_bits_log + 1;
-    size_t block        = this->m_data.m_flags;
-    size_t pos          = 0;
+    size_t flags        = this->m_data.m_flags;
     size_t k            = 0;
 
-    while(block)
+    while(flags)
     {
-        if (block % 2 == size_t(1))
-        {
-            this->m_data.get_fsb_set()->get_elem(k)
-                    .get_elements(offset + (pos << offset_bits), elems);
-            ++k;
-        };
-    
-        ++pos;            
-        block      = block >> size_t(1);
+        size_t pos      = header_type::least_significant_bit_pos(flags);
+        out             = this->m_data.get_fsb_set()->get_elem(k)
+                            .get_elements(offset + (pos << offset_bits), out);
+
+        ++k;
+        flags           = flags & (flags - 1);
     };
+
+    return out;
 };
 
 }}
@@ -973,7 +1859,7 @@ dbs::dbs(const dbs& copy)
     :details::dbs_impl(copy)
 {};
 
-dbs::dbs(dbs&& copy)
+dbs::dbs(dbs&& copy) noexcept
     :details::dbs_impl(std::move(copy))
 {};
  
@@ -981,7 +1867,7 @@ dbs::dbs(const details::dbs_impl& impl)
     :details::dbs_impl(impl)
 {};
 
-dbs::dbs(details::dbs_impl&& impl)
+dbs::dbs(details::dbs_impl&& impl) noexcept
     :details::dbs_impl(std::move(impl))
 {};
 
@@ -994,7 +1880,7 @@ dbs& dbs::operator=(const dbs& copy)
     return *this;
 };
 
-dbs& dbs::operator=(dbs&& copy)
+dbs& dbs::operator=(dbs&& copy) noexcept
 {
     details::dbs_impl::operator=(std::move(copy));
     return *this;
@@ -1015,11 +1901,21 @@ bool dbs::none() const
     return details::dbs_impl::none();
 };
 
-dbs dbs::set(size_t pos) const
+dbs dbs::set(size_t pos) const &
 {
     return dbs(details::dbs_impl::set(pos));
 };
 
+dbs dbs::set(size_t pos) &&
+{
+    bool changed;
+    dbs ret(details::dbs_impl::set_owned(pos, changed));
+
+    // this set can store nodes, whose children were moved
+    details::dbs_impl::operator=(details::dbs_impl());
+    return ret;
+};
+
 dbs dbs::reset(size_t pos) const
 {
     return dbs(details::dbs_impl::reset(pos));
@@ -1045,20 +1941,34 @@ size_t dbs::last() const
     return details::dbs_impl::last();
 };
 
-bool dbs::test_any(const dbs& other) const
+size_t dbs::next(size_t n) const
+{
+    return details::dbs_impl::next(n);
+};
+
+size_t dbs::prev(size_t n) const
+{
+    return details::dbs_impl::prev(n);
+};
+
+size_t dbs::next_unset(size_t n) const
 {
-    //TODO: optimize this
-    dbs link = *this & other;
+    return details::dbs_impl::next_unset(n);
+};
 
-    return link.any();
+size_t dbs::prev_unset(size_t n) const
+{
+    return details::dbs_impl::prev_unset(n);
 };
 
-bool dbs::test_all(const dbs& other) const
+bool dbs::test_any(const dbs& other) const
 {
-    //TODO: optimize this
-    dbs link = *this & other;
+    return (*this & other).any();
+};
 
-    return link == other;
+bool dbs::test_all(const dbs& other) const
+{
+    return (other - *this).none();
 };
 
 
@@ -1067,6 +1977,36 @@ void dbs::get_elements(std::vector<size_t>& elems) const
     return details::dbs_impl::get_elements(elems);
 };
 
+size_t dbs::get_elements(const_iterator& pos, size_t* buffer, size_t capacity) const
+{
+    return pos.read_elements(buffer, capacity);
+};
+
+dbs::const_iterator dbs::begin() const
+{
+    return const_iterator::make_begin(*this);
+};
+
+dbs::const_iterator dbs::end() const
+{
+    return const_iterator::make_end(*this);
+};
+
+dbs::const_reverse_iterator dbs::rbegin() const
+{
+    return const_reverse_iterator(end());
+};
+
+dbs::const_reverse_iterator dbs::rend() const
+{
+    return const_reverse_iterator(begin());
+};
+
+dbs::const_iterator dbs::lower_bound(size_t n) const
+{
+    return const_iterator::make_lower_bound(*this, n);
+};
+
 //-----------------------------------------------------------------------------------
 //                              OPERATORS
 //-----------------------------------------------------------------------------------
@@ -1076,44 +2016,38 @@ size_t hash_value(const dbs& x)
     return x.hash_value_impl();
 }
 
-dbs operator&(const dbs& x, const dbs& y)
+details::dbs_impl details::dbs_impl::and_impl(const dbs_impl& x, const dbs_impl& y)
 {
     using block_type    = details::block;
     using ushort_type   = details::block::ushort_type;
-    using dbs_impl      = details::dbs_impl;
 
     ushort_type level_1 = x.get_data().get_level();
     ushort_type level_2 = y.get_data().get_level();
-    ushort_type level   = std::min(level_1, level_2);
 
     const dbs_impl* xl  = &x;
     const dbs_impl* yl  = &y;
 
-    while(level_1 > level)
+    // descend along the first child of the higher node; the first child
+    // can have level lower by more than one
+    while(level_1 != level_2)
     {
-        size_t sel      = xl->get_data().m_flags & size_t(1);
+        const dbs_impl*& high   = (level_1 > level_2) ? xl : yl;
+        ushort_type& level_h    = (level_1 > level_2) ? level_1 : level_2;
+
+        size_t sel      = high->get_data().m_flags & size_t(1);
 
         if (sel == 0)
-            return dbs();
+            return dbs_impl();
 
-        xl              = &xl->get_data().get_fsb_set()->get_elem(0);
-        --level_1;
+        high            = &high->get_data().get_fsb_set()->get_elem(0);
+        level_h         = high->get_data().get_level();
     };
 
-    while(level_2 > level)
-    {
-        size_t sel      = yl->get_data().m_flags & size_t(1);
-
-        if (sel == 0)
-            return dbs();
-
-        yl              = &yl->get_data().get_fsb_set()->get_elem(0);
-        --level_2;
-    };    
+    ushort_type level   = level_1;
 
     if (level == 0)
     {
-        dbs ret;
+        dbs_impl ret;
         ret.get_data().get_block_0() = xl->get_data().get_block_0() 
                                         & yl->get_data().get_block_0();
         ret.get_data().get_block_1() = xl->get_data().get_block_1() 
@@ -1127,9 +2061,9 @@ dbs operator&(const dbs& x, const dbs& y)
     size_t ret_flags_est    = flags_1 & flags_2;
 
     if (ret_flags_est == 0)
-        return dbs();
+        return dbs_impl();
 
-    using pod_dbs   = details::pod_type<dbs>;
+    using pod_dbs   = details::pod_type<dbs_impl>;
     
     pod_dbs buf[block_type::block_bits];
     ushort_type ret_size    = 0;
@@ -1151,11 +2085,11 @@ dbs operator&(const dbs& x, const dbs& y)
                 const dbs_impl& e1  = xl->get_data().get_fsb_set()->get_elem(pos_flag_1);
                 const dbs_impl& e2  = yl->get_data().get_fsb_set()->get_elem(pos_flag_2);
 
-                dbs res         = dbs_lib::operator&(dbs(e1), dbs(e2));
+                dbs_impl res    = and_impl(e1, e2);
 
                 if (res.any() == true)
                 { 
-                    new (buf + ret_size) dbs(std::move(res));
+                    new (buf + ret_size) dbs_impl(std::move(res));
 
                     ret_flags   += cur_mask;
                     ++ret_size;
@@ -1178,11 +2112,11 @@ dbs operator&(const dbs& x, const dbs& y)
 
     //construct dbs
     if (ret_size == 0)
-        return dbs();
+        return dbs_impl();
 
     if (ret_flags == 1)
     {
-        dbs ret(reinterpret_cast<dbs&&>(buf[0]));
+        dbs_impl ret(reinterpret_cast<dbs_impl&&>(buf[0]));
         return ret;
     };
 
@@ -1192,12 +2126,12 @@ dbs operator&(const dbs& x, const dbs& y)
     dbs_impl ret(h, ret_flags, details::dbs_set::create(ret_size));
 
     for(ushort_type i = 0; i < ret_size; ++i)
-        ret.get_data().get_fsb_set()->init(i, reinterpret_cast<dbs&&>(buf[i]));
+        ret.get_data().get_fsb_set()->init(i, reinterpret_cast<dbs_impl&&>(buf[i]));
 
-    return dbs(ret);
+    return ret;
 };
 
-dbs operator|(const dbs& x, const dbs& y)
+details::dbs_impl details::dbs_impl::or_impl(const dbs_impl& x, const dbs_impl& y)
 {
     using block_type    = details::block;
     using ushort_type   = details::block::ushort_type;
@@ -1206,13 +2140,13 @@ dbs operator|(const dbs& x, const dbs& y)
     ushort_type level_2 = y.get_data().get_level();
 
     if (level_1 < level_2)
-        return dbs_lib::operator|(y,x);
+        return or_impl(y,x);
 
     ushort_type level   = std::max(level_1, level_2);
 
     if (level == 0)
     {
-        dbs ret;
+        dbs_impl ret;
         ret.get_data().get_block_0() = x.get_data().get_block_0() 
                                         | y.get_data().get_block_0();
         ret.get_data().get_block_1() = x.get_data().get_block_1() 
@@ -1225,7 +2159,6 @@ dbs operator|(const dbs& x, const dbs& y)
         return x;
 
     using block         = details::block;
-    using dbs_impl      = details::dbs_impl;
 
     if (level_1 > level_2)
     {
@@ -1233,8 +2166,7 @@ dbs operator|(const dbs& x, const dbs& y)
 
         if (has_zero)
         {
-            dbs elem_zero   = dbs(x.get_data().get_fsb_set()->get_elem(0))
-                            | dbs(y);
+            dbs_impl elem_zero  = or_impl(x.get_data().get_fsb_set()->get_elem(0), y);
 
             //construct dbs
             ushort_type ret_size    = x.get_data().m_header.get_size();
@@ -1251,7 +2183,7 @@ dbs operator|(const dbs& x, const dbs& y)
                             x.get_data().get_fsb_set()->get_elem(i));
             }
 
-            return dbs(ret);
+            return ret;
         }
         else
         {
@@ -1270,12 +2202,11 @@ dbs operator|(const dbs& x, const dbs& y)
                             x.get_data().get_fsb_set()->get_elem(i));
             }
 
-            return dbs(ret);
+            return ret;
         };
     }
 
-    using pod_dbs           = details::pod_type<dbs>;
-    using dbs_impl          = details::dbs_impl;
+    using pod_dbs           = details::pod_type<dbs_impl>;
     
     pod_dbs buf[block::block_bits];
 
@@ -1301,9 +2232,9 @@ dbs operator|(const dbs& x, const dbs& y)
                 const dbs_impl& e1  = x.get_data().get_fsb_set()->get_elem(pos_flag_1);
                 const dbs_impl& e2  = y.get_data().get_fsb_set()->get_elem(pos_flag_2);
 
-                dbs res         = dbs(e1) | dbs(e2);
+                dbs_impl res    = or_impl(e1, e2);
 
-                new (buf + ret_size) dbs(std::move(res));
+                new (buf + ret_size) dbs_impl(std::move(res));
 
                 ret_flags       += cur_mask;
 
@@ -1316,7 +2247,7 @@ dbs operator|(const dbs& x, const dbs& y)
             {
                 const dbs_impl& e1  = x.get_data().get_fsb_set()->get_elem(pos_flag_1);
 
-                new (buf + ret_size) dbs(e1);
+                new (buf + ret_size) dbs_impl(e1);
 
                 ret_flags       += cur_mask;
 
@@ -1328,7 +2259,7 @@ dbs operator|(const dbs& x, const dbs& y)
         {
             const dbs_impl& e2  = y.get_data().get_fsb_set()->get_elem(pos_flag_2);
 
-            new (buf + ret_size) dbs(e2);
+            new (buf + ret_size) dbs_impl(e2);
 
             ret_flags           += cur_mask;
 
@@ -1346,12 +2277,12 @@ dbs operator|(const dbs& x, const dbs& y)
     dbs_impl ret(h, ret_flags, details::dbs_set::create(ret_size));
 
     for(ushort_type i = 0; i < ret_size; ++i)
-        ret.get_data().get_fsb_set()->init(i, reinterpret_cast<dbs&&>(buf[i]));
+        ret.get_data().get_fsb_set()->init(i, reinterpret_cast<dbs_impl&&>(buf[i]));
 
-    return dbs(ret);
+    return ret;
 };
 
-dbs operator^(const dbs& x, const dbs& y)
+details::dbs_impl details::dbs_impl::xor_impl(const dbs_impl& x, const dbs_impl& y)
 {
     using block_type    = details::block;
     using ushort_type   = details::block::ushort_type;
@@ -1360,13 +2291,13 @@ dbs operator^(const dbs& x, const dbs& y)
     ushort_type level_2 = y.get_data().get_level();
 
     if (level_1 < level_2)
-        return dbs_lib::operator^(y,x);
+        return xor_impl(y,x);
 
     ushort_type level   = std::max(level_1, level_2);
 
     if (level == 0)
     {
-        dbs ret;
+        dbs_impl ret;
         ret.get_data().get_block_0() = x.get_data().get_block_0() 
                                         ^ y.get_data().get_block_0();
         ret.get_data().get_block_1() = x.get_data().get_block_1() 
@@ -1382,7 +2313,6 @@ dbs operator^(const dbs& x, const dbs& y)
         return x;
 
     using block             = details::block;
-    using dbs_impl          = details::dbs_impl;
 
     if (level_1 > level_2)
     {
@@ -1390,8 +2320,7 @@ dbs operator^(const dbs& x, const dbs& y)
 
         if (has_zero)
         {
-            dbs elem_zero   = dbs(x.get_data().get_fsb_set()->get_elem(0))
-                                ^ dbs(y);
+            dbs_impl elem_zero  = xor_impl(x.get_data().get_fsb_set()->get_elem(0), y);
 
             if (elem_zero.none() == true)
             {
@@ -1399,7 +2328,7 @@ dbs operator^(const dbs& x, const dbs& y)
                 ushort_type x_size  = x.get_data().m_header.get_size();
 
                 if (x_size == 1)
-                    return dbs();
+                    return dbs_impl();
 
                 size_t ret_flags    = x.get_data().m_flags & ~size_t(1);
 
@@ -1412,7 +2341,7 @@ dbs operator^(const dbs& x, const dbs& y)
                                 x.get_data().get_fsb_set()->get_elem(i));
                 }
 
-                return dbs(ret);
+                return ret;
             }
             else
             {
@@ -1431,7 +2360,7 @@ dbs operator^(const dbs& x, const dbs& y)
                                     x.get_data().get_fsb_set()->get_elem(i));
                 }
 
-                return dbs(ret);
+                return ret;
             };
         }
         else
@@ -1451,12 +2380,11 @@ dbs operator^(const dbs& x, const dbs& y)
                                 x.get_data().get_fsb_set()->get_elem(i));
             }
 
-            return dbs(ret);
+            return ret;
         };
     }
 
-    using pod_dbs           = details::pod_type<dbs>;
-    using dbs_impl          = details::dbs_impl;
+    using pod_dbs           = details::pod_type<dbs_impl>;
     
     pod_dbs buf[block::block_bits];
 
@@ -1482,11 +2410,11 @@ dbs operator^(const dbs& x, const dbs& y)
                 const dbs_impl& e1  = x.get_data().get_fsb_set()->get_elem(pos_flag_1);
                 const dbs_impl& e2  = y.get_data().get_fsb_set()->get_elem(pos_flag_2);
 
-                dbs res         = dbs(e1) ^ dbs(e2);
+                dbs_impl res    = xor_impl(e1, e2);
 
                 if (res.none() == false)
                 {
-                    new (buf + ret_size) dbs(std::move(res));
+                    new (buf + ret_size) dbs_impl(std::move(res));
 
                     ret_flags   += cur_mask;
                     ++ret_size;
@@ -1499,7 +2427,7 @@ dbs operator^(const dbs& x, const dbs& y)
             {
                 const dbs_impl& e1  = x.get_data().get_fsb_set()->get_elem(pos_flag_1);
 
-                new (buf + ret_size) dbs(e1);
+                new (buf + ret_size) dbs_impl(e1);
 
                 ret_flags       += cur_mask;
 
@@ -1511,7 +2439,7 @@ dbs operator^(const dbs& x, const dbs& y)
         {
             const dbs_impl& e2  = y.get_data().get_fsb_set()->get_elem(pos_flag_2);
 
-            new (buf + ret_size) dbs(e2);
+            new (buf + ret_size) dbs_impl(e2);
 
             ret_flags           += cur_mask;
 
@@ -1526,11 +2454,11 @@ dbs operator^(const dbs& x, const dbs& y)
 
     //construct dbs
     if (ret_size == 0)
-        return dbs();
+        return dbs_impl();
 
     if (ret_flags == 1)
     {
-        dbs ret(reinterpret_cast<dbs&&>(buf[0]));
+        dbs_impl ret(reinterpret_cast<dbs_impl&&>(buf[0]));
         return ret;
     };
 
@@ -1538,12 +2466,12 @@ dbs operator^(const dbs& x, const dbs& y)
     dbs_impl ret(h, ret_flags, details::dbs_set::create(ret_size));
 
     for(ushort_type i = 0; i < ret_size; ++i)
-        ret.get_data().get_fsb_set()->init(i, reinterpret_cast<dbs&&>(buf[i]));
+        ret.get_data().get_fsb_set()->init(i, reinterpret_cast<dbs_impl&&>(buf[i]));
 
-    return dbs(ret);
+    return ret;
 };
 
-order_type compare(const dbs& x, const dbs& y)
+int details::dbs_impl::compare_impl(const dbs_impl& x, const dbs_impl& y)
 {
     //lexicographic order
 
@@ -1551,10 +2479,10 @@ order_type compare(const dbs& x, const dbs& y)
     size_t level_2  = y.get_data().get_level();
 
     if (level_1 < level_2)
-        return order_type::less;
+        return -1;
 
     if (level_1 > level_2)
-        return order_type::greater;
+        return 1;
 
     if (level_1 == 0)
     {
@@ -1563,10 +2491,10 @@ order_type compare(const dbs& x, const dbs& y)
             size_t flags_2  = y.get_data().get_block_0();
 
             if (flags_1 < flags_2)
-                return order_type::less;
+                return -1;
     
             if (flags_1 > flags_2)
-                return order_type::greater;
+                return 1;
         };
 
         {
@@ -1574,90 +2502,258 @@ order_type compare(const dbs& x, const dbs& y)
             size_t flags_2  = y.get_data().get_block_1();
 
             if (flags_1 < flags_2)
-                return order_type::less;
+                return -1;
             
             if (flags_1 > flags_2)
-                return order_type::greater;
+                return 1;
         };
 
         //elements are equal
-        return order_type::equal;
+        return 0;
     };
 
     if (x.get_data().m_flags < y.get_data().m_flags)
-        return order_type::less;
+        return -1;
 
     if (x.get_data().m_flags > y.get_data().m_flags)
-        return order_type::greater;
+        return 1;
 
-    size_t size = x.get_data().m_header.get_size();
+    // shared subtrees are equal
+    if (x.get_data().get_fsb_set() == y.get_data().get_fsb_set())
+        return 0;
 
-    using dbs_impl  = details::dbs_impl;
+    size_t size = x.get_data().m_header.get_size();
 
     for (size_t i = 0; i < size; ++i)
     {
         const dbs_impl& elem_1  = x.get_data().get_fsb_set()->get_elem(i);
         const dbs_impl& elem_2  = y.get_data().get_fsb_set()->get_elem(i);
 
-        order_type ot       = dbs_lib::compare(dbs(elem_1), dbs(elem_2));
+        int ot              = compare_impl(elem_1, elem_2);
     
-        if (ot != order_type::equal)
+        if (ot != 0)
             return ot;
     };
 
-    return order_type::equal;
+    return 0;
+};
+
+order_type compare(const dbs& x, const dbs& y)
+{
+    int ot  = details::dbs_impl::compare_impl(x, y);
+
+    if (ot < 0)
+        return order_type::less;
+    else if (ot > 0)
+        return order_type::greater;
+    else
+        return order_type::equal;
+};
+
+order_type compare_elements(const dbs& x, const dbs& y)
+{
+    using header_type   = details::block::header_type;
+
+    // the lowest element stored in only one bitset; all lower elements are
+    // common
+    size_t elem         = 0;
+    bool in_x           = false;
+
+    bool equal          = for_each_change(x, y, [&](size_t offset, size_t added, size_t removed)
+    {
+        size_t pos      = header_type::least_significant_bit_pos(added | removed);
+
+        elem            = offset + pos;
+        in_x            = ((removed >> pos) & 1) != 0;
+        return false;
+    });
+
+    if (equal == true)
+        return order_type::equal;
+
+    // the bitset storing elem is less, unless the other bitset has no
+    // elements greater than elem, i.e. the other sequence is a prefix
+    const dbs& other    = in_x ? y : x;
+    bool other_greater  = other.any() == true && other.last() > elem;
+
+    return (in_x == other_greater) ? order_type::less : order_type::greater;
 };
 
 bool operator==(const dbs& x, const dbs& y)
 {
+    // hashes are cached in tree nodes; bitsets with different hashes are
+    // rejected in O(1)
+    if (x.hash_value_impl() != y.hash_value_impl())
+        return false;
+
     return compare(x,y) == order_type::equal;
 };
 
 bool operator!=(const dbs& x, const dbs& y)
 {
-    return compare(x,y) != order_type::equal;
+    return (x == y) == false;
 };
 
 bool operator<(const dbs& x, const dbs& y)
 {
-    return compare(x,y) == order_type::less;
+    return compare_elements(x,y) == order_type::less;
 };
 
 bool operator>(const dbs& x, const dbs& y)
 {
-    return compare(x,y) == order_type::greater;
+    return compare_elements(x,y) == order_type::greater;
 };
 
 bool operator<=(const dbs& x, const dbs& y)
 {
-    return compare(x,y) != order_type::greater;
+    return compare_elements(x,y) != order_type::greater;
 };
 
 bool operator>=(const dbs& x, const dbs& y)
 {
-    return compare(x,y) != order_type::less;
+    return compare_elements(x,y) != order_type::less;
+};
+
+#ifdef DBS_HAS_THREE_WAY_COMPARISON
+std::strong_ordering operator<=>(const dbs& x, const dbs& y)
+{
+    order_type ot   = compare_elements(x, y);
+
+    if (ot == order_type::less)
+        return std::strong_ordering::less;
+    else if (ot == order_type::greater)
+        return std::strong_ordering::greater;
+    else
+        return std::strong_ordering::equal;
 };
+#endif
 
 std::ostream& dbs_lib::operator<<(std::ostream& os, const dbs& x)
 {
-    std::vector<size_t> elems;
-    x.get_elements(elems);
+    write_text(os, x, text_format::list);
+    return os;
+};
+
+
+//-----------------------------------------------------------------------------------
+//                              MEMORY
+//-----------------------------------------------------------------------------------
+void set_reclamation_mode(reclamation_mode mode)
+{
+    details::get_pools().m_mode = mode;
+
+    if (mode == reclamation_mode::immediate)
+        reclaim();
+};
+
+reclamation_mode get_reclamation_mode()
+{
+    return details::get_pools().m_mode;
+};
+
+size_t reclaim(size_t max_nodes)
+{
+    using dead_set              = details::dead_set;
+    using block                 = details::block;
+
+    details::allocator_pools* pools = &details::get_pools();
+    details::allocator_pools::dead_queue& queue = pools->m_dead_queue;
 
-    if (elems.size() == 0)
+    size_t n_released           = 0;
+
+    while (n_released < max_nodes)
     {
-        os << "{}";
-        return os;
-    }
+        dead_set item;
 
-    os << "{";
-    os << elems[0];
+        {
+            details::lock_guard lock(pools->m_lock);
+
+            if (queue.empty() == true)
+                break;
 
-    for (size_t i = 1; i < elems.size(); ++i)
-        os << ", " << elems[i];
+            item                = queue.back();
+            queue.pop_back();
+        };
 
-    os << "}";
+        // sets released by this item are put on the queue, so that amount
+        // of work is bounded by max_nodes
+        dead_set dead[block::block_bits];
+        size_t n_dead           = 0;
 
-    return os;
+        item.m_set->release(item.m_size, dead, n_dead);
+
+        {
+            details::lock_guard lock(pools->m_lock);
+            queue.insert(queue.end(), dead, dead + n_dead);
+        };
+
+        ++n_released;
+    };
+
+    return n_released;
+};
+
+size_t reclamation_queue_size()
+{
+    details::lock_guard lock(details::get_pools().m_lock);
+    return details::get_pools().m_dead_queue.size();
+};
+
+size_t refcount_operations()
+{
+    return details::g_refcount_ops;
+};
+
+size_t allocated_nodes()
+{
+    details::lock_guard lock(details::get_pools().m_lock);
+    return details::get_pools().allocated();
+};
+
+memory_resource* malloc_resource()
+{
+    return &details::get_pools().m_malloc_resource;
+};
+
+memory_resource* get_memory_resource()
+{
+    details::allocator_pools* pools = &details::get_pools();
+    details::lock_guard lock(pools->m_lock);
+
+    return pools->m_sets[details::t_current_tag]->m_resource;
+};
+
+memory_resource* set_memory_resource(memory_resource* res, bool use_pools)
+{
+    details::allocator_pools* pools = &details::get_pools();
+    details::lock_guard lock(pools->m_lock);
+
+    size_t prev_tag         = details::install_current(*pools, res, use_pools);
+    memory_resource* prev   = pools->m_sets[prev_tag]->m_resource;
+
+    pools->uninstall(prev_tag);
+    return prev;
+};
+
+memory_resource_scope::memory_resource_scope(memory_resource* res, bool use_pools)
+{
+    details::allocator_pools* pools = &details::get_pools();
+    details::lock_guard lock(pools->m_lock);
+
+    m_previous              = details::install_current(*pools, res, use_pools);
+    m_tag                   = details::t_current_tag;
+};
+
+memory_resource_scope::~memory_resource_scope()
+{
+    details::allocator_pools* pools = &details::get_pools();
+    details::lock_guard lock(pools->m_lock);
+
+    // scopes of a thread must be destroyed in reverse order of creation
+    assert(details::t_current_tag == m_tag);
+
+    details::t_current_tag  = m_previous;
+    pools->uninstall(m_tag);
 };
 
 }
\ No newline at end of file
@@ -0,0 +1,246 @@
+/*
+*  This file is a part of DBS library.
+*
+*  Copyright (c) Pawe Kowal 2017 - 2021
+*
+*  This program is free software; you can redistribute it and/or modify
+*  it under the terms of the GNU General Public License as published by
+*  the Free Software Foundation; either version 2 of the License, or
+*  (at your option) any later version.
+*
+*  This program is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU General Public License for more details.
+*
+*  You should have received a copy of the GNU General Public License
+*  along with this program; if not, write to the Free Software
+*  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+*/
+
+#include "dbs/dbs_atom.h"
+#include "dbs/details/dbs_details.inl"
+
+#include <cassert>
+
+#ifdef DBS_THREAD_SAFE
+
+namespace dbs_lib { namespace details
+{
+
+//-----------------------------------------------------------------
+//                      atom_node
+//-----------------------------------------------------------------
+// node storing a value of dbs_atom
+struct atom_node
+{
+    dbs                     m_value;
+
+    // while the node is installed, readers are counted in the variable;
+    // readers releasing the node after it was replaced decrease this
+    // number, which can become negative, and retiring the node adds number
+    // of readers counted in the variable; the node is released by the 
+    // thread, that brings this number to 0
+    std::atomic<int64_t>    m_count;
+
+    explicit atom_node(const dbs& value)
+        :m_value(value), m_count(0)
+    {};
+};
+
+#ifdef DBS_TEST_HOOKS
+    void (*atom_hook)(atom_event)   = nullptr;
+
+    static void call_hook(atom_event ev)
+    {
+        if (atom_hook != nullptr)
+            atom_hook(ev);
+    };
+#else
+    static void call_hook(atom_event)
+    {};
+#endif
+
+// number of low bits of a word used for pointers
+static const int pointer_bits       = 48;
+static const uint64_t pointer_mask  = (uint64_t(1) << pointer_bits) - 1;
+
+// increment of number of readers stored in a word
+static const uint64_t reader_unit   = uint64_t(1) << pointer_bits;
+
+static atom_node* get_node(uint64_t word)
+{
+    return reinterpret_cast<atom_node*>(static_cast<uintptr_t>(word & pointer_mask));
+};
+
+static int64_t get_readers(uint64_t word)
+{
+    return static_cast<int64_t>(word >> pointer_bits);
+};
+
+static uint64_t make_word(atom_node* node)
+{
+    uint64_t word   = static_cast<uint64_t>(reinterpret_cast<uintptr_t>(node));
+    assert((word & ~pointer_mask) == 0);
+
+    return word;
+};
+
+// drop reference of a variable to a node, that was replaced; word is the
+// last value of the variable pointing to the node
+static void retire(uint64_t word)
+{
+    atom_node* node = get_node(word);
+    int64_t change  = get_readers(word);
+
+    if (node->m_count.fetch_add(change, std::memory_order_acq_rel) + change == 0)
+        delete node;
+};
+
+// return true if x and y are represented by the same tree
+static bool same_tree(const dbs& x, const dbs& y)
+{
+    const block& data_x = x.get_data();
+    const block& data_y = y.get_data();
+
+    return data_x.m_header.get_level() == data_y.m_header.get_level()
+        && data_x.m_header.get_size() == data_y.m_header.get_size()
+        && data_x.get_block_0() == data_y.get_block_0()
+        && data_x.get_block_1() == data_y.get_block_1();
+};
+
+}};
+
+namespace dbs_lib
+{
+
+//-----------------------------------------------------------------
+//                      dbs_atom
+//-----------------------------------------------------------------
+dbs_atom::dbs_atom()
+    :m_word(details::make_word(new details::atom_node(dbs())))
+{};
+
+dbs_atom::dbs_atom(const dbs& value)
+    :m_word(details::make_word(new details::atom_node(value)))
+{};
+
+dbs_atom::~dbs_atom()
+{
+    details::retire(m_word.load(std::memory_order_acquire));
+};
+
+details::atom_node* dbs_atom::acquire() const
+{
+    word_type word  = m_word.fetch_add(details::reader_unit, std::memory_order_acquire);
+    return details::get_node(word);
+};
+
+void dbs_atom::release(details::atom_node* node) const
+{
+    word_type word  = m_word.load(std::memory_order_relaxed);
+
+    // while the node is installed, readers are counted in the variable
+    while (details::get_node(word) == node)
+    {
+        if (m_word.compare_exchange_weak(word, word - details::reader_unit, 
+                        std::memory_order_release, std::memory_order_relaxed) == true)
+        {
+            return;
+        };
+    };
+
+    // the node was replaced; number of readers is added to the node when
+    // the node is retired
+    if (node->m_count.fetch_sub(1, std::memory_order_acq_rel) == 1)
+        delete node;
+};
+
+dbs_atom::word_type dbs_atom::install(const dbs& value)
+{
+    details::atom_node* node    = new details::atom_node(value);
+    return m_word.exchange(details::make_word(node), std::memory_order_acq_rel);
+};
+
+dbs dbs_atom::load() const
+{
+    details::atom_node* node    = acquire();
+    details::call_hook(details::atom_event::acquired);
+
+    dbs ret                     = node->m_value;
+    release(node);
+
+    return ret;
+};
+
+void dbs_atom::store(const dbs& value)
+{
+    word_type word  = install(value);
+    details::call_hook(details::atom_event::replaced);
+
+    details::retire(word);
+};
+
+dbs dbs_atom::exchange(const dbs& value)
+{
+    // the old node is referenced by this variable until retired
+    word_type word  = install(value);
+    details::call_hook(details::atom_event::replaced);
+
+    dbs ret         = details::get_node(word)->m_value;
+
+    details::retire(word);
+    return ret;
+};
+
+bool dbs_atom::compare_exchange(dbs& expected, const dbs& desired)
+{
+    details::atom_node* node    = nullptr;
+
+    for (;;)
+    {
+        details::atom_node* current = acquire();
+
+        if (details::same_tree(current->m_value, expected) == false)
+        {
+            expected    = current->m_value;
+            release(current);
+
+            delete node;
+            return false;
+        };
+
+        if (node == nullptr)
+            node        = new details::atom_node(desired);
+
+        word_type new_word  = details::make_word(node);
+        word_type word      = m_word.load(std::memory_order_relaxed);
+
+        while (details::get_node(word) == current)
+        {
+            if (m_word.compare_exchange_weak(word, new_word, std::memory_order_acq_rel,
+                                             std::memory_order_relaxed) == true)
+            {
+                details::call_hook(details::atom_event::replaced);
+
+                // readers of the old node include this thread
+                details::retire(word);
+                release(current);
+
+                return true;
+            };
+        };
+
+        // the value was replaced concurrently; compare with the new value
+        release(current);
+    };
+};
+
+bool dbs_atom::is_lock_free() const
+{
+    return m_word.is_lock_free();
+};
+
+}
+
+#endif
@@ -0,0 +1,213 @@
+/*
+*  This file is a part of DBS library.
+*
+*  Copyright (c) Pawe Kowal 2017 - 2021
+*
+*  This program is free software; you can redistribute it and/or modify
+*  it under the terms of the GNU General Public License as published by
+*  the Free Software Foundation; either version 2 of the License, or
+*  (at your option) any later version.
+*
+*  This program is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU General Public License for more details.
+*
+*  You should have received a copy of the GNU General Public License
+*  along with this program; if not, write to the Free Software
+*  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+*/
+
+#include "dbs/dbs_diff.h"
+#include "dbs/details/dbs_impl.h"
+#include "dbs/details/dbs_details.inl"
+
+namespace dbs_lib { namespace details
+{
+
+// children of a node being constructed
+class diff_children
+{
+    private:
+        using pod_dbs       = pod_type<dbs_impl>;
+        using ushort_type   = block::ushort_type;
+
+    private:
+        pod_dbs             m_buf[block::block_bits];
+        ushort_type         m_size;
+        size_t              m_flags;
+
+    public:
+        diff_children();
+        ~diff_children();
+
+        diff_children(const diff_children&) = delete;
+        diff_children& operator=(const diff_children&) = delete;
+
+        // add the child pos if it is not empty
+        void                add(size_t pos, dbs_impl&& child);
+
+        // return node at given level with added children; children are
+        // moved to the node
+        dbs_impl            make_node(size_t level);
+};
+
+diff_children::diff_children()
+    :m_size(0), m_flags(0)
+{};
+
+diff_children::~diff_children()
+{
+    for (ushort_type i = 0; i < m_size; ++i)
+        reinterpret_cast<dbs_impl&>(m_buf[i]).~dbs_impl();
+};
+
+void diff_children::add(size_t pos, dbs_impl&& child)
+{
+    if (child.none() == true)
+        return;
+
+    new (m_buf + m_size) dbs_impl(std::move(child));
+
+    m_flags         |= block::bit_mask(pos);
+    ++m_size;
+};
+
+dbs_impl diff_children::make_node(size_t level)
+{
+    if (m_size == 0)
+        return dbs_impl();
+
+    // node with only the child 0 is replaced by the child
+    if (m_flags == 1)
+        return dbs_impl(reinterpret_cast<dbs_impl&&>(m_buf[0]));
+
+    block::header_type h((ushort_type)level, m_size);
+    dbs_impl ret(h, m_flags, dbs_set::create(m_size));
+
+    for(ushort_type i = 0; i < m_size; ++i)
+        ret.get_data().get_fsb_set()->init(i, reinterpret_cast<dbs_impl&&>(m_buf[i]));
+
+    return ret;
+};
+
+// store in added elements of the subtree y, that are not in the subtree x,
+// and in removed elements of x, that are not in y; subtrees are at given
+// level; empty subtrees are represented by nullptr
+static void diff_nodes(size_t level, const dbs_impl* x, const dbs_impl* y,
+                       dbs_impl& added, dbs_impl& removed)
+{
+    using header_type   = block::header_type;
+
+    if (x == nullptr || y == nullptr)
+    {
+        // nonempty subtree is shared by the patch
+        if (x != nullptr)
+            removed     = *x;
+        else if (y != nullptr)
+            added       = *y;
+
+        return;
+    };
+
+    if (expr_same_node(x, y) == true)
+        return;
+
+    if (level == 0)
+    {
+        const block& data_x = x->get_data();
+        const block& data_y = y->get_data();
+
+        // bits of both words are stored in the same order in x and y
+        added.get_data().get_block_0()      = data_y.get_block_0() & ~data_x.get_block_0();
+        added.get_data().get_block_1()      = data_y.get_block_1() & ~data_x.get_block_1();
+        removed.get_data().get_block_0()    = data_x.get_block_0() & ~data_y.get_block_0();
+        removed.get_data().get_block_1()    = data_x.get_block_1() & ~data_y.get_block_1();
+        return;
+    };
+
+    size_t flags        = expr_node_flags(x, level) | expr_node_flags(y, level);
+
+    diff_children added_children;
+    diff_children removed_children;
+
+    while (flags != 0)
+    {
+        size_t pos      = header_type::least_significant_bit_pos(flags);
+        flags           = flags & (flags - 1);
+
+        dbs_impl child_added;
+        dbs_impl child_removed;
+
+        diff_nodes(level - 1, diff_child(x, level, pos), diff_child(y, level, pos),
+                   child_added, child_removed);
+
+        added_children.add(pos, std::move(child_added));
+        removed_children.add(pos, std::move(child_removed));
+    };
+
+    added               = added_children.make_node(level);
+    removed             = removed_children.make_node(level);
+};
+
+}};
+
+namespace dbs_lib
+{
+
+//-----------------------------------------------------------------
+//                      dbs_patch
+//-----------------------------------------------------------------
+dbs_patch::dbs_patch()
+{};
+
+dbs_patch::dbs_patch(const dbs& added, const dbs& removed)
+    :m_added(added), m_removed(removed)
+{};
+
+const dbs& dbs_patch::added() const
+{
+    return m_added;
+};
+
+const dbs& dbs_patch::removed() const
+{
+    return m_removed;
+};
+
+bool dbs_patch::empty() const
+{
+    return m_added.none() && m_removed.none();
+};
+
+dbs_patch dbs_patch::inverse() const
+{
+    return dbs_patch(m_removed, m_added);
+};
+
+//-----------------------------------------------------------------
+//                      functions
+//-----------------------------------------------------------------
+dbs_patch diff(const dbs& old_set, const dbs& new_set)
+{
+    const details::dbs_impl* x  = details::diff_root(old_set);
+    const details::dbs_impl* y  = details::diff_root(new_set);
+
+    size_t level_x  = x ? x->get_data().get_level() : 0;
+    size_t level_y  = y ? y->get_data().get_level() : 0;
+
+    details::dbs_impl added;
+    details::dbs_impl removed;
+
+    details::diff_nodes(std::max(level_x, level_y), x, y, added, removed);
+
+    return dbs_patch(dbs(std::move(added)), dbs(std::move(removed)));
+};
+
+dbs apply_patch(const dbs& x, const dbs_patch& patch)
+{
+    // the expression is evaluated in one traversal of all operands
+    return (x - patch.removed()) | patch.added();
+};
+
+}
@@ -0,0 +1,199 @@
+/*
+*  This file is a part of DBS library.
+*
+*  Copyright (c) Pawe Kowal 2017 - 2021
+*
+*  This program is free software; you can redistribute it and/or modify
+*  it under the terms of the GNU General Public License as published by
+*  the Free Software Foundation; either version 2 of the License, or
+*  (at your option) any later version.
+*
+*  This program is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU General Public License for more details.
+*
+*  You should have received a copy of the GNU General Public License
+*  along with this program; if not, write to the Free Software
+*  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+*/
+
+#include "dbs/dbs_history.h"
+#include "dbs/details/dbs_impl.h"
+#include "dbs/details/dbs_details.inl"
+
+#include <stdexcept>
+#include <unordered_map>
+
+namespace dbs_lib { namespace details
+{
+
+// number of nodes and bytes of a subtree, if subtrees are not shared
+struct subtree_memory
+{
+    size_t      m_nodes;
+    size_t      m_bytes;
+};
+
+using node_memory_map   = std::unordered_map<const dbs_set*, subtree_memory>;
+
+// return memory of the subtree rooted at x; memory of visited nodes is
+// stored in the map nodes, so that shared subtrees are visited once; memory
+// of nodes visited for the first time is added to shared
+static subtree_memory visit_memory(const dbs_impl& x, node_memory_map& nodes, 
+                                   subtree_memory& shared)
+{
+    const block& data   = x.get_data();
+
+    if (data.get_level() == 0)
+        return subtree_memory{0, 0};
+
+    const dbs_set* set  = data.get_fsb_set();
+    auto pos            = nodes.find(set);
+
+    if (pos != nodes.end())
+        return pos->second;
+
+    size_t size         = block::count_bits(data.m_flags);
+    subtree_memory ret  = {1, sizeof(dbs_set) + size * sizeof(dbs_impl)};
+
+    shared.m_nodes      += ret.m_nodes;
+    shared.m_bytes      += ret.m_bytes;
+
+    for (size_t i = 0; i < size; ++i)
+    {
+        subtree_memory child    = visit_memory(set->get_elem(i), nodes, shared);
+        ret.m_nodes     += child.m_nodes;
+        ret.m_bytes     += child.m_bytes;
+    };
+
+    nodes[set]          = ret;
+    return ret;
+};
+
+}};
+
+namespace dbs_lib
+{
+
+//-----------------------------------------------------------------
+//                      dbs_history
+//-----------------------------------------------------------------
+dbs_history::dbs_history(size_t max_versions)
+    :m_first(0), m_max_versions(max_versions)
+{};
+
+size_t dbs_history::commit(const dbs& value)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    m_versions.push_back(value);
+    size_t version  = m_first + m_versions.size() - 1;
+
+    apply_retention();
+    return version;
+};
+
+dbs dbs_history::get(size_t version) const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    if (version < m_first || version - m_first >= m_versions.size())
+        throw std::out_of_range("dbs_history: version is not stored");
+
+    return m_versions[version - m_first];
+};
+
+dbs dbs_history::current() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    if (m_versions.empty() == true)
+        return dbs();
+
+    return m_versions.back();
+};
+
+bool dbs_history::contains(size_t version) const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return version >= m_first && version - m_first < m_versions.size();
+};
+
+size_t dbs_history::first_version() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_first;
+};
+
+size_t dbs_history::next_version() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_first + m_versions.size();
+};
+
+size_t dbs_history::size() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_versions.size();
+};
+
+void dbs_history::set_max_versions(size_t max_versions)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    m_max_versions  = max_versions;
+    apply_retention();
+};
+
+size_t dbs_history::get_max_versions() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_max_versions;
+};
+
+void dbs_history::release_before(size_t version)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    while (m_first < version && m_versions.empty() == false)
+    {
+        m_versions.pop_front();
+        ++m_first;
+    };
+};
+
+void dbs_history::apply_retention()
+{
+    if (m_max_versions == 0)
+        return;
+
+    while (m_versions.size() > m_max_versions)
+    {
+        m_versions.pop_front();
+        ++m_first;
+    };
+};
+
+history_memory dbs_history::memory() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    details::node_memory_map nodes;
+    details::subtree_memory shared  = {0, 0};
+    history_memory ret              = {0, 0, 0, 0};
+
+    for (const dbs& version : m_versions)
+    {
+        details::subtree_memory mem = details::visit_memory(version, nodes, shared);
+        ret.m_unshared_nodes        += mem.m_nodes;
+        ret.m_unshared_bytes        += mem.m_bytes;
+    };
+
+    ret.m_nodes                     = shared.m_nodes;
+    ret.m_bytes                     = shared.m_bytes;
+
+    return ret;
+};
+
+}
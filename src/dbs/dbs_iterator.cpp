@@ -0,0 +1,400 @@
+/*
+*  This file is a part of DBS library.
+*
+*  Copyright (c) Pawe Kowal 2017 - 2021
+*
+*  This program is free software; you can redistribute it and/or modify
+*  it under the terms of the GNU General Public License as published by
+*  the Free Software Foundation; either version 2 of the License, or
+*  (at your option) any later version.
+*
+*  This program is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU General Public License for more details.
+*
+*  You should have received a copy of the GNU General Public License
+*  along with this program; if not, write to the Free Software
+*  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+*/
+
+#include "dbs/details/dbs_iterator.h"
+#include "dbs/details/dbs_impl.h"
+#include "dbs/details/dbs_details.inl"
+
+namespace dbs_lib { namespace details
+{
+
+namespace
+{
+
+using header_type           = block::header_type;
+static const int block_bits = block::block_bits;
+static const int bits_log   = block::block_bits_log;
+static const int size_bits  = sizeof(size_t) * 8;
+static const size_t npos    = size_t(-1);
+
+// shift of the coordinate of a child in a node at given level
+inline size_t child_shift(size_t level)
+{
+    return bits_log * level + 1;
+};
+
+// number of bits of values stored in a node at given level
+inline size_t node_bits(size_t level)
+{
+    return bits_log * level + bits_log + 1;
+};
+
+// first value of the range covered by a node at given level, that
+// contains the value val
+inline size_t node_base(size_t val, size_t level)
+{
+    size_t bits = node_bits(level);
+
+    if (bits >= size_bits)
+        return 0;
+
+    return val & (~size_t(0) << bits);
+};
+
+inline const dbs_impl& get_child(const block& data, size_t coord)
+{
+    size_t bits_before  = block::bits_before_pos(data.m_flags, coord);
+    size_t pos          = block::count_bits(bits_before);
+    return data.get_fsb_set()->get_elem(pos);
+};
+
+}
+
+//-----------------------------------------------------------------
+//                      dbs_iterator
+//-----------------------------------------------------------------
+dbs_iterator::dbs_iterator()
+    :m_root(nullptr), m_depth(0), m_value(npos)
+{};
+
+dbs_iterator::dbs_iterator(const dbs_impl& root)
+    :m_root(&root), m_depth(0), m_value(npos)
+{};
+
+dbs_iterator dbs_iterator::make_begin(const dbs_impl& root)
+{
+    dbs_iterator ret(root);
+
+    if (root.any() == true)
+        ret.push_first(&root, 0);
+
+    return ret;
+};
+
+dbs_iterator dbs_iterator::make_end(const dbs_impl& root)
+{
+    return dbs_iterator(root);
+};
+
+dbs_iterator dbs_iterator::make_lower_bound(const dbs_impl& root, size_t n)
+{
+    dbs_iterator ret(root);
+    ret.lower_bound(n);
+    return ret;
+};
+
+void dbs_iterator::set_end()
+{
+    m_depth = 0;
+    m_value = npos;
+};
+
+bool dbs_iterator::operator==(const dbs_iterator& other) const
+{
+    if (is_end() == true || other.is_end() == true)
+        return is_end() == other.is_end();
+
+    return m_value == other.m_value;
+};
+
+bool dbs_iterator::operator!=(const dbs_iterator& other) const
+{
+    return !(*this == other);
+};
+
+dbs_iterator& dbs_iterator::operator++()
+{
+    const block& leaf   = m_path[m_depth - 1]->get_data();
+    size_t local        = block::mod_pow2(m_value, bits_log + 1);
+
+    if (local + 1 < 2 * block_bits)
+    {
+        size_t pos      = leaf.leaf_next(local + 1);
+
+        if (pos != npos)
+        {
+            m_value     = m_value - local + pos;
+            return *this;
+        };
+    };
+
+    next_from(m_depth - 1, m_value);
+    return *this;
+};
+
+dbs_iterator dbs_iterator::operator++(int)
+{
+    dbs_iterator ret(*this);
+    ++*this;
+    return ret;
+};
+
+dbs_iterator& dbs_iterator::operator--()
+{
+    if (is_end() == true)
+    {
+        // decrementing end iterator gives the last element
+        if (m_root->any() == true)
+            push_last(m_root, 0);
+
+        return *this;
+    };
+
+    const block& leaf   = m_path[m_depth - 1]->get_data();
+    size_t local        = block::mod_pow2(m_value, bits_log + 1);
+
+    if (local > 0)
+    {
+        size_t pos      = leaf.leaf_prev(local - 1);
+
+        if (pos != npos)
+        {
+            m_value     = m_value - local + pos;
+            return *this;
+        };
+    };
+
+    if (prev_from(m_depth - 1, m_value) == false)
+        set_end();
+
+    return *this;
+};
+
+dbs_iterator dbs_iterator::operator--(int)
+{
+    dbs_iterator ret(*this);
+    --*this;
+    return ret;
+};
+
+size_t dbs_iterator::read_elements(size_t* buffer, size_t capacity)
+{
+    size_t n                = 0;
+
+    while (is_end() == false)
+    {
+        const block& leaf   = m_path[m_depth - 1]->get_data();
+        size_t local        = block::mod_pow2(m_value, bits_log + 1);
+        size_t base         = m_value - local;
+
+        size_t words[2];
+        leaf.leaf_interleave(words[0], words[1]);
+
+        // remove elements before the current one
+        if (local < block_bits)
+        {
+            words[0]        &= ~size_t(0) << local;
+        }
+        else
+        {
+            words[0]        = 0;
+            words[1]        &= ~size_t(0) << (local - block_bits);
+        };
+
+        for (size_t k = 0; k < 2; ++k)
+        {
+            size_t bits     = words[k];
+            size_t offset   = base + k * block_bits;
+
+            if (bits == 0)
+                continue;
+
+            // write elements directly if all of them fit into the buffer
+            if (block::count_bits(bits) <= capacity - n)
+            {
+                n           = block::decode_bits(bits, offset, buffer + n) - buffer;
+                continue;
+            };
+
+            while (n < capacity)
+            {
+                buffer[n++] = offset + header_type::least_significant_bit_pos(bits);
+                bits        = bits & (bits - 1);
+            };
+
+            m_value         = offset + header_type::least_significant_bit_pos(bits);
+            return n;
+        };
+
+        next_from(m_depth - 1, m_value);
+
+        if (n == capacity)
+            break;
+    };
+
+    return n;
+};
+
+void dbs_iterator::push_first(const dbs_impl* node, size_t base)
+{
+    for (;;)
+    {
+        m_path[m_depth++]   = node;
+        const block& data   = node->get_data();
+        size_t level        = data.get_level();
+
+        if (level == 0)
+        {
+            m_value         = base + data.leaf_next(0);
+            return;
+        };
+
+        size_t pos          = header_type::least_significant_bit_pos(data.m_flags);
+        base                += pos << child_shift(level);
+        node                = &data.get_fsb_set()->get_elem(0);
+    };
+};
+
+void dbs_iterator::push_last(const dbs_impl* node, size_t base)
+{
+    for (;;)
+    {
+        m_path[m_depth++]   = node;
+        const block& data   = node->get_data();
+        size_t level        = data.get_level();
+
+        if (level == 0)
+        {
+            m_value         = base + data.leaf_prev(2 * block_bits - 1);
+            return;
+        };
+
+        size_t pos          = header_type::most_significant_bit_pos(data.m_flags);
+        size_t size         = data.m_header.get_size();
+        base                += pos << child_shift(level);
+        node                = &data.get_fsb_set()->get_elem(size - 1);
+    };
+};
+
+void dbs_iterator::next_from(int depth, size_t value)
+{
+    // find the first nonempty child after the child containing value
+    // in nodes m_path[depth - 1], ..., m_path[0]
+    for (int i = depth - 1; i >= 0; --i)
+    {
+        const block& data   = m_path[i]->get_data();
+        size_t level        = data.get_level();
+        size_t shift        = child_shift(level);
+        size_t coord        = block::mod_pow2(value >> shift, bits_log);
+        size_t pos          = block::next_bit_pos(data.m_flags, coord + 1);
+
+        if (pos == block_bits)
+            continue;
+
+        m_depth             = i + 1;
+        size_t base         = node_base(value, level) + (pos << shift);
+
+        push_first(&get_child(data, pos), base);
+        return;
+    };
+
+    set_end();
+};
+
+bool dbs_iterator::prev_from(int depth, size_t value)
+{
+    // find the last nonempty child before the child containing value
+    // in nodes m_path[depth - 1], ..., m_path[0]
+    for (int i = depth - 1; i >= 0; --i)
+    {
+        const block& data   = m_path[i]->get_data();
+        size_t level        = data.get_level();
+        size_t shift        = child_shift(level);
+        size_t coord        = block::mod_pow2(value >> shift, bits_log);
+
+        if (coord == 0)
+            continue;
+
+        size_t pos          = block::prev_bit_pos(data.m_flags, coord - 1);
+
+        if (pos == npos)
+            continue;
+
+        m_depth             = i + 1;
+        size_t base         = node_base(value, level) + (pos << shift);
+
+        push_last(&get_child(data, pos), base);
+        return true;
+    };
+
+    return false;
+};
+
+void dbs_iterator::lower_bound(size_t n)
+{
+    const dbs_impl* node    = m_root;
+    size_t base             = 0;
+    size_t root_bits        = node_bits(node->get_data().get_level());
+
+    if (root_bits < size_bits && (n >> root_bits) != 0)
+        return set_end();
+
+    m_depth                 = 0;
+
+    for (;;)
+    {
+        m_path[m_depth++]   = node;
+        const block& data   = node->get_data();
+        size_t level        = data.get_level();
+        size_t offset       = n - base;
+
+        if (level == 0)
+        {
+            size_t pos      = data.leaf_next(offset);
+
+            if (pos != npos)
+            {
+                m_value     = base + pos;
+                return;
+            };
+
+            return next_from(m_depth - 1, n);
+        };
+
+        size_t shift        = child_shift(level);
+        size_t coord        = offset >> shift;
+
+        if (data.m_flags & block::bit_mask(coord))
+        {
+            const dbs_impl& child   = get_child(data, coord);
+            size_t child_base       = base + (coord << shift);
+            size_t child_bits       = node_bits(child.get_data().get_level());
+
+            // child at lower level covers only beginning of the range
+            if (((n - child_base) >> child_bits) == 0)
+            {
+                node        = &child;
+                base        = child_base;
+                continue;
+            };
+
+            ++coord;
+        };
+
+        size_t pos          = block::next_bit_pos(data.m_flags, coord);
+
+        if (pos < block_bits)
+            return push_first(&get_child(data, pos), base + (pos << shift));
+
+        return next_from(m_depth - 1, n);
+    };
+};
+
+}};
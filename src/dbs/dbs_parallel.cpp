@@ -0,0 +1,910 @@
+/*
+*  This file is a part of DBS library.
+*
+*  Copyright (c) Pawe Kowal 2017 - 2021
+*
+*  This program is free software; you can redistribute it and/or modify
+*  it under the terms of the GNU General Public License as published by
+*  the Free Software Foundation; either version 2 of the License, or
+*  (at your option) any later version.
+*
+*  This program is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU General Public License for more details.
+*
+*  You should have received a copy of the GNU General Public License
+*  along with this program; if not, write to the Free Software
+*  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+*/
+
+#include "dbs/dbs_parallel.h"
+#include "dbs/details/dbs_impl.h"
+#include "dbs/details/dbs_details.inl"
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <algorithm>
+#include <memory>
+
+namespace dbs_lib { namespace details
+{
+
+//-----------------------------------------------------------------
+//                      thread_pool
+//-----------------------------------------------------------------
+// fork-join pool of threads; tasks 0, ..., n-1 of a job are taken by 
+// worker threads and the calling thread
+class thread_pool
+{
+    private:
+        using job_type      = std::function<void (size_t)>;
+
+    private:
+        std::vector<std::thread>    m_threads;
+        size_t                      m_n_threads;
+
+        // mutex used for running one job at a time
+        std::mutex                  m_run_mutex;
+
+        std::mutex                  m_mutex;
+        std::condition_variable     m_job_cv;
+        std::condition_variable     m_done_cv;
+
+        const job_type*             m_job;
+        size_t                      m_n_tasks;
+
+        // memory resource of the thread running the job
+        size_t                      m_tag;
+        size_t                      m_generation;
+        size_t                      m_active;
+        bool                        m_stop;
+        std::atomic<size_t>         m_next_task;
+
+    public:
+        thread_pool();
+
+        // the pool is never destroyed; worker threads may be needed as long
+        // as there are static objects using the library
+        ~thread_pool() = delete;
+
+        static thread_pool& get();
+
+        void                set_threads(size_t n);
+        size_t              get_threads() const;
+
+        // call f(i) for i = 0, ..., n_tasks - 1 and wait for completion
+        void                run(size_t n_tasks, const job_type& f);
+
+    private:
+        void                worker_loop(size_t id);
+        void                run_tasks(const job_type& f, size_t n_tasks);
+        void                start_threads(size_t n);
+        void                stop_threads();
+
+        // set for threads executing parallel tasks
+        static bool&        in_parallel_task();
+};
+
+thread_pool::thread_pool()
+    : m_n_threads(1), m_job(nullptr), m_n_tasks(0), m_tag(0), m_generation(0), m_active(0)
+    , m_stop(false), m_next_task(0)
+{
+    set_threads(0);
+};
+
+thread_pool& thread_pool::get()
+{
+    static thread_pool* pool = new thread_pool();
+    return *pool;
+};
+
+bool& thread_pool::in_parallel_task()
+{
+    static thread_local bool in_task = false;
+    return in_task;
+};
+
+size_t thread_pool::get_threads() const
+{
+    return m_n_threads;
+};
+
+void thread_pool::set_threads(size_t n)
+{
+    if (n == 0)
+        n           = std::max<size_t>(std::thread::hardware_concurrency(), 1);
+
+    std::lock_guard<std::mutex> run_lock(m_run_mutex);
+
+    if (n == m_n_threads && m_threads.size() + 1 == n)
+        return;
+
+    stop_threads();
+    start_threads(n);
+};
+
+void thread_pool::start_threads(size_t n)
+{
+    m_n_threads     = n;
+
+    // the calling thread also executes tasks
+    for (size_t i = 1; i < n; ++i)
+        m_threads.push_back(std::thread(&thread_pool::worker_loop, this, m_generation));
+};
+
+void thread_pool::stop_threads()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop      = true;
+        ++m_generation;
+    };
+
+    m_job_cv.notify_all();
+
+    for (auto& th : m_threads)
+        th.join();
+
+    m_threads.clear();
+    m_stop          = false;
+};
+
+void thread_pool::worker_loop(size_t generation)
+{
+    in_parallel_task()  = true;
+    size_t seen         = generation;
+
+    for (;;)
+    {
+        const job_type* job;
+        size_t n_tasks;
+        size_t tag;
+
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_job_cv.wait(lock, [&]{ return m_generation != seen; });
+
+            if (m_stop == true)
+                return;
+
+            seen        = m_generation;
+            job         = m_job;
+            n_tasks     = m_n_tasks;
+            tag         = m_tag;
+
+            // the job is already finished
+            if (job == nullptr)
+                continue;
+
+            ++m_active;
+        };
+
+        // nodes are allocated from the memory resource of the calling thread,
+        // which is in use until the job is finished
+        size_t prev_tag = Allocator::exchange_tag(tag);
+        run_tasks(*job, n_tasks);
+        Allocator::exchange_tag(prev_tag);
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            --m_active;
+        };
+
+        m_done_cv.notify_all();
+    };
+};
+
+void thread_pool::run_tasks(const job_type& f, size_t n_tasks)
+{
+    for (;;)
+    {
+        size_t task = m_next_task.fetch_add(1);
+
+        if (task >= n_tasks)
+            return;
+
+        f(task);
+    };
+};
+
+void thread_pool::run(size_t n_tasks, const job_type& f)
+{
+    // nested parallel calls and calls made when the pool is busy are 
+    // executed sequentially
+    std::unique_lock<std::mutex> run_lock(m_run_mutex, std::defer_lock);
+
+    if (n_tasks <= 1 || in_parallel_task() == true || m_threads.empty() == true
+            || run_lock.try_lock() == false)
+    {
+        for (size_t i = 0; i < n_tasks; ++i)
+            f(i);
+
+        return;
+    };
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_job           = &f;
+        m_n_tasks       = n_tasks;
+        m_tag           = Allocator::current_tag();
+        m_next_task     = 0;
+        ++m_generation;
+    };
+
+    m_job_cv.notify_all();
+
+    in_parallel_task()  = true;
+    run_tasks(f, n_tasks);
+    in_parallel_task()  = false;
+
+    // wait until all workers, that took the job, are finished
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_done_cv.wait(lock, [&]{ return m_active == 0; });
+
+    // workers woken after this point must not access f
+    m_job               = nullptr;
+};
+
+//-----------------------------------------------------------------
+//                      subtrees
+//-----------------------------------------------------------------
+// subtree processed by one task
+struct subtree_task
+{
+    const dbs_impl*     m_node;
+    size_t              m_offset;
+};
+
+// split the tree rooted at root into at least min_tasks subtrees, if
+// possible; subtrees are ordered increasingly
+static void split_tree(const dbs_impl& root, size_t min_tasks, std::vector<subtree_task>& tasks)
+{
+    using header_type   = block::header_type;
+
+    tasks.clear();
+
+    if (root.none() == true)
+        return;
+
+    tasks.push_back(subtree_task{&root, 0});
+
+    std::vector<subtree_task> next;
+
+    while (tasks.size() < min_tasks)
+    {
+        next.clear();
+        bool expanded   = false;
+
+        for (const subtree_task& task : tasks)
+        {
+            const block& data   = task.m_node->get_data();
+            size_t level        = data.get_level();
+
+            if (level == 0)
+            {
+                next.push_back(task);
+                continue;
+            };
+
+            size_t shift        = block::block_bits_log * level + 1;
+            size_t flags        = data.m_flags;
+
+            for (size_t k = 0; flags != 0; ++k)
+            {
+                size_t pos      = header_type::least_significant_bit_pos(flags);
+                next.push_back(subtree_task{&data.get_fsb_set()->get_elem(k), 
+                                            task.m_offset + (pos << shift)});
+
+                flags           = flags & (flags - 1);
+            };
+
+            expanded            = true;
+        };
+
+        if (expanded == false)
+            break;
+
+        tasks.swap(next);
+    };
+};
+
+// number of subtrees per thread; more subtrees give better load balancing
+static const size_t tasks_per_thread    = 8;
+
+static size_t min_tasks()
+{
+    return thread_pool::get().get_threads() * tasks_per_thread;
+};
+
+void parallel_visit(const dbs_impl& root, const std::function<void (const dbs_impl&, size_t)>& f)
+{
+    std::vector<subtree_task> tasks;
+    split_tree(root, min_tasks(), tasks);
+
+    thread_pool::get().run(tasks.size(), [&](size_t i)
+    {
+        f(*tasks[i].m_node, tasks[i].m_offset);
+    });
+};
+
+//-----------------------------------------------------------------
+//                      set operators
+//-----------------------------------------------------------------
+// nodes of results are allocated concurrently, which requires thread safe
+// allocator
+#ifdef DBS_THREAD_SAFE
+
+using binary_function   = dbs_impl (*)(const dbs_impl&, const dbs_impl&);
+
+// operators with result of lower level are evaluated sequentially
+static const size_t parallel_min_level  = 3;
+
+// nodes of lower level are not split into subproblems
+static const size_t split_min_level     = 2;
+
+// subproblem of a binary operator; a task is either evaluated or split 
+// into subproblems for children of operands
+struct op_task
+{
+    // operands; null if an operand does not have this subtree
+    const dbs_impl*     m_x;
+    const dbs_impl*     m_y;
+
+    // position of the result in the parent node
+    size_t              m_pos;
+
+    // subproblems of a split task are stored at m_first, ..., 
+    // m_first + m_count - 1; m_level is the level of the result
+    size_t              m_first;
+    size_t              m_count;
+    size_t              m_level;
+
+    dbs_impl            m_result;
+
+    op_task(const dbs_impl* x, const dbs_impl* y, size_t pos)
+        :m_x(x), m_y(y), m_pos(pos), m_first(0), m_count(0), m_level(0)
+    {};
+};
+
+// split the task into subproblems for children of operands; return false
+// if the task is not split
+static bool split_task(std::vector<op_task>& tasks, size_t index, expr_code op)
+{
+    using header_type   = block::header_type;
+
+    const dbs_impl* x   = tasks[index].m_x;
+    const dbs_impl* y   = tasks[index].m_y;
+
+    if (x == nullptr || y == nullptr)
+        return false;
+
+    size_t level_x      = x->get_data().get_level();
+    size_t level_y      = y->get_data().get_level();
+
+    if (op == expr_code::op_and)
+    {
+        // only first children of the higher operand can intersect the lower
+        // operand
+        while (level_x != level_y)
+        {
+            const dbs_impl*& high   = (level_x > level_y) ? x : y;
+            size_t& level_h         = (level_x > level_y) ? level_x : level_y;
+
+            if ((high->get_data().m_flags & size_t(1)) == 0)
+            {
+                tasks[index].m_x    = nullptr;
+                tasks[index].m_y    = nullptr;
+                return false;
+            };
+
+            high        = &high->get_data().get_fsb_set()->get_elem(0);
+            level_h     = high->get_data().get_level();
+        };
+
+        tasks[index].m_x    = x;
+        tasks[index].m_y    = y;
+    }
+    else if (level_x < level_y)
+    {
+        // other operators are symmetric
+        std::swap(x, y);
+        std::swap(level_x, level_y);
+    };
+
+    if (level_x < split_min_level)
+        return false;
+
+    // the lower operand is a subtree of the first child
+    size_t flags_x      = x->get_data().m_flags;
+    size_t flags_y      = (level_x == level_y) ? y->get_data().m_flags : size_t(1);
+    size_t flags        = (op == expr_code::op_and) ? (flags_x & flags_y) : (flags_x | flags_y);
+
+    tasks[index].m_first    = tasks.size();
+    tasks[index].m_count    = header_type::count_bits(flags);
+    tasks[index].m_level    = level_x;
+
+    while (flags != 0)
+    {
+        size_t pos      = header_type::least_significant_bit_pos(flags);
+        size_t mask     = size_t(1) << pos;
+
+        const dbs_impl* child_x = nullptr;
+        const dbs_impl* child_y = nullptr;
+
+        if ((flags_x & mask) != 0)
+        {
+            size_t k    = header_type::count_bits(flags_x & (mask - 1));
+            child_x     = &x->get_data().get_fsb_set()->get_elem(k);
+        };
+
+        if ((flags_y & mask) != 0 && level_x == level_y)
+        {
+            size_t k    = header_type::count_bits(flags_y & (mask - 1));
+            child_y     = &y->get_data().get_fsb_set()->get_elem(k);
+        }
+        else if ((flags_y & mask) != 0)
+        {
+            child_y     = y;
+        };
+
+        tasks.push_back(op_task(child_x, child_y, pos));
+        flags           = flags & (flags - 1);
+    };
+
+    return true;
+};
+
+// evaluate a task, that is not split
+static void eval_task(op_task& task, binary_function f)
+{
+    if (task.m_x != nullptr && task.m_y != nullptr)
+        task.m_result   = f(*task.m_x, *task.m_y);
+    else if (task.m_x != nullptr)
+        task.m_result   = *task.m_x;
+    else if (task.m_y != nullptr)
+        task.m_result   = *task.m_y;
+};
+
+// build result of a split task from results of subproblems; the result is
+// in the canonical form
+static void assemble_task(op_task& task, op_task* children)
+{
+    size_t flags        = 0;
+    size_t size         = 0;
+
+    for (size_t i = 0; i < task.m_count; ++i)
+    {
+        if (children[i].m_result.any() == true)
+        {
+            flags       |= size_t(1) << children[i].m_pos;
+            ++size;
+        };
+    };
+
+    if (size == 0)
+    {
+        task.m_result   = dbs_impl();
+        return;
+    };
+
+    // a node with only the first child is replaced by the child
+    if (flags == 1)
+    {
+        task.m_result   = std::move(children[0].m_result);
+        return;
+    };
+
+    block::header_type h(block::ushort_type(task.m_level), block::ushort_type(size));
+    dbs_impl ret(h, flags, dbs_set::create(size));
+
+    size_t k            = 0;
+
+    for (size_t i = 0; i < task.m_count; ++i)
+    {
+        if (children[i].m_result.any() == true)
+        {
+            ret.get_data().get_fsb_set()->init(k, std::move(children[i].m_result));
+            ++k;
+        };
+    };
+
+    task.m_result       = std::move(ret);
+};
+
+static dbs_impl parallel_binary(const dbs_impl& x, const dbs_impl& y, expr_code op, 
+                                binary_function f)
+{
+    size_t level    = std::max(x.get_data().get_level(), y.get_data().get_level());
+    thread_pool& pool   = thread_pool::get();
+
+    if (level < parallel_min_level || pool.get_threads() == 1)
+        return f(x, y);
+
+    // split tasks breadth-first until there are enough subproblems
+    std::vector<op_task> tasks;
+    tasks.push_back(op_task(&x, &y, 0));
+
+    std::vector<size_t> work;
+    std::vector<size_t> frontier    = {0};
+    std::vector<size_t> next;
+
+    while (frontier.empty() == false && work.size() + frontier.size() < min_tasks())
+    {
+        next.clear();
+
+        for (size_t index : frontier)
+        {
+            if (split_task(tasks, index, op) == false)
+            {
+                work.push_back(index);
+                continue;
+            };
+
+            size_t first    = tasks[index].m_first;
+            size_t count    = tasks[index].m_count;
+
+            for (size_t i = first; i < first + count; ++i)
+                next.push_back(i);
+        };
+
+        frontier.swap(next);
+    };
+
+    work.insert(work.end(), frontier.begin(), frontier.end());
+
+    pool.run(work.size(), [&](size_t i)
+    {
+        eval_task(tasks[work[i]], f);
+    });
+
+    // children are stored after parents
+    for (size_t i = tasks.size(); i > 0; --i)
+    {
+        op_task& task   = tasks[i - 1];
+
+        if (task.m_count > 0)
+            assemble_task(task, tasks.data() + task.m_first);
+    };
+
+    return std::move(tasks[0].m_result);
+};
+
+#endif
+
+//-----------------------------------------------------------------
+//                      bulk construction
+//-----------------------------------------------------------------
+// smaller inputs are sorted and built sequentially
+static const size_t parallel_build_min_size = 1 << 14;
+
+// maximum number of buckets of the radix partition
+static const size_t max_build_buckets       = 4096;
+
+// elements x of the input with (x >> shift) == m_key
+struct build_piece
+{
+    size_t              m_key;
+
+    // number of different elements and the highest element
+    size_t              m_count;
+    size_t              m_last;
+
+    // elements reduced modulo 2^shift
+    dbs_impl            m_node;
+};
+
+// build the node of given level storing elements of n pieces sorted by keys;
+// pieces are subtrees at the level split_level, i.e. shift is equal to
+// block_bits_log * split_level + 1
+static dbs_impl stitch_pieces(size_t level, size_t split_level, build_piece* pieces, size_t n)
+{
+    size_t capacity_bits    = block::block_bits_log * level + 1;
+    size_t key_shift        = block::block_bits_log * (level - split_level);
+
+    size_t flags            = 0;
+    std::vector<dbs_impl> children;
+
+    for (size_t i = 0; i < n; )
+    {
+        size_t pos          = block::mod_pow2(pieces[i].m_key >> key_shift, block::block_bits_log);
+        size_t k            = i + 1;
+
+        while (k < n && block::mod_pow2(pieces[k].m_key >> key_shift, block::block_bits_log) == pos)
+            ++k;
+
+        size_t max_elem     = block::mod_pow2(pieces[k - 1].m_last, capacity_bits);
+        size_t child_level  = dbs_impl::get_level(max_elem);
+
+        // a child below the split level is stored in one piece
+        if (child_level < split_level)
+            children.push_back(std::move(pieces[i].m_node));
+        else
+            children.push_back(stitch_pieces(child_level, split_level, pieces + i, k - i));
+
+        flags               |= size_t(1) << pos;
+        i                   = k;
+    };
+
+    // a node with only the first child is replaced by the child
+    if (flags == 1)
+        return std::move(children[0]);
+
+    size_t size             = children.size();
+
+    block::header_type h(static_cast<block::ushort_type>(level), 
+                         static_cast<block::ushort_type>(size));
+    dbs_impl ret(h, flags, dbs_set::create(size));
+
+    for (size_t i = 0; i < size; ++i)
+        ret.get_data().get_fsb_set()->init(i, std::move(children[i]));
+
+    return ret;
+};
+
+// build a bitset from count elements in any order; elements are partitioned
+// by the top coordinate x >> shift into at most max_build_buckets buckets,
+// buckets are sorted and built concurrently and built subtrees are joined
+// by the upper levels of the tree
+static dbs_impl build_from_unsorted(size_t count, const size_t* elems)
+{
+    thread_pool& pool   = thread_pool::get();
+
+    if (count < parallel_build_min_size)
+    {
+        std::vector<size_t> sorted(elems, elems + count);
+        std::sort(sorted.begin(), sorted.end());
+        sorted.erase(std::unique(sorted.begin(), sorted.end()), sorted.end());
+
+        return dbs_impl(sorted.size(), sorted.data());
+    };
+
+    // the input is split into equal chunks, one for every thread
+    size_t n_chunks     = pool.get_threads();
+    size_t chunk_size   = (count + n_chunks - 1) / n_chunks;
+
+    auto chunk_first    = [&](size_t c) { return std::min(c * chunk_size, count); };
+
+    std::vector<size_t> chunk_max(n_chunks);
+
+    pool.run(n_chunks, [&](size_t c)
+    {
+        size_t max_elem = 0;
+
+        for (size_t i = chunk_first(c); i < chunk_first(c + 1); ++i)
+            max_elem    = std::max(max_elem, elems[i]);
+
+        chunk_max[c]    = max_elem;
+    });
+
+    size_t max_elem     = *std::max_element(chunk_max.begin(), chunk_max.end());
+    size_t level        = dbs_impl::get_level(max_elem);
+
+    if (level == 0)
+    {
+        // all elements are stored in one leaf
+        std::vector<size_t> chunk_bits(2 * n_chunks);
+
+        pool.run(n_chunks, [&](size_t c)
+        {
+            size_t bits[2]  = {0, 0};
+
+            for (size_t i = chunk_first(c); i < chunk_first(c + 1); ++i)
+                bits[elems[i] / block::block_bits] |= block::bit_mask(elems[i] % block::block_bits);
+
+            chunk_bits[2 * c]       = bits[0];
+            chunk_bits[2 * c + 1]   = bits[1];
+        });
+
+        size_t bits[2]  = {0, 0};
+
+        for (size_t c = 0; c < n_chunks; ++c)
+        {
+            bits[0]     |= chunk_bits[2 * c];
+            bits[1]     |= chunk_bits[2 * c + 1];
+        };
+
+        size_t leaf[2 * block::block_bits];
+        size_t* last    = block::decode_bits(bits[0], 0, leaf);
+        last            = block::decode_bits(bits[1], block::block_bits, last);
+
+        return dbs_impl(size_t(last - leaf), leaf);
+    };
+
+    // buckets are subtrees at the lowest level giving at most
+    // max_build_buckets buckets
+    size_t split_level  = 1;
+
+    while (split_level < level 
+           && (max_elem >> (block::block_bits_log * split_level + 1)) >= max_build_buckets)
+    {
+        ++split_level;
+    };
+
+    size_t shift        = block::block_bits_log * split_level + 1;
+    size_t n_buckets    = (max_elem >> shift) + 1;
+
+    // number of elements in every chunk and bucket; then converted to
+    // output positions
+    std::vector<size_t> positions(n_chunks * n_buckets);
+
+    pool.run(n_chunks, [&](size_t c)
+    {
+        size_t* counts  = positions.data() + c * n_buckets;
+
+        for (size_t i = chunk_first(c); i < chunk_first(c + 1); ++i)
+            ++counts[elems[i] >> shift];
+    });
+
+    std::vector<size_t> bucket_first(n_buckets + 1);
+    size_t pos          = 0;
+
+    for (size_t b = 0; b < n_buckets; ++b)
+    {
+        bucket_first[b] = pos;
+
+        for (size_t c = 0; c < n_chunks; ++c)
+        {
+            size_t& chunk_pos   = positions[c * n_buckets + b];
+            size_t chunk_count  = chunk_pos;
+
+            chunk_pos   = pos;
+            pos         += chunk_count;
+        };
+    };
+
+    bucket_first[n_buckets] = pos;
+
+    std::unique_ptr<size_t[]> buffer(new size_t[count]);
+    size_t* sorted      = buffer.get();
+
+    pool.run(n_chunks, [&](size_t c)
+    {
+        size_t* out_pos = positions.data() + c * n_buckets;
+
+        for (size_t i = chunk_first(c); i < chunk_first(c + 1); ++i)
+            sorted[out_pos[elems[i] >> shift]++] = elems[i];
+    });
+
+    std::vector<build_piece> pieces(n_buckets);
+
+    auto sort_bucket    = [&](size_t b)
+    {
+        size_t* first   = sorted + bucket_first[b];
+        size_t* last    = sorted + bucket_first[b + 1];
+
+        std::sort(first, last);
+        last            = std::unique(first, last);
+
+        pieces[b].m_key     = b;
+        pieces[b].m_count   = size_t(last - first);
+        pieces[b].m_last    = (last != first) ? last[-1] : 0;
+    };
+
+    auto build_bucket   = [&](size_t b)
+    {
+        if (pieces[b].m_count > 0)
+        {
+            pieces[b].m_node    = dbs_impl::build_dbs(pieces[b].m_count, 
+                                    sorted + bucket_first[b], shift);
+        };
+    };
+
+    #ifdef DBS_THREAD_SAFE
+        pool.run(n_buckets, [&](size_t b)
+        {
+            sort_bucket(b);
+            build_bucket(b);
+        });
+    #else
+        // nodes cannot be allocated concurrently
+        pool.run(n_buckets, sort_bucket);
+
+        for (size_t b = 0; b < n_buckets; ++b)
+            build_bucket(b);
+    #endif
+
+    buffer.reset();
+
+    auto is_empty       = [](const build_piece& piece) { return piece.m_count == 0; };
+    pieces.erase(std::remove_if(pieces.begin(), pieces.end(), is_empty), pieces.end());
+
+    return stitch_pieces(level, split_level, pieces.data(), pieces.size());
+};
+
+}};
+
+namespace dbs_lib
+{
+
+//-----------------------------------------------------------------
+//                      PARALLEL
+//-----------------------------------------------------------------
+void set_parallel_threads(size_t n)
+{
+    details::thread_pool::get().set_threads(n);
+};
+
+size_t get_parallel_threads()
+{
+    return details::thread_pool::get().get_threads();
+};
+
+size_t parallel_size(const dbs& x)
+{
+    std::vector<details::subtree_task> tasks;
+    details::split_tree(x, details::min_tasks(), tasks);
+
+    std::vector<size_t> sizes(tasks.size());
+
+    details::thread_pool::get().run(tasks.size(), [&](size_t i)
+    {
+        sizes[i]    = tasks[i].m_node->size();
+    });
+
+    size_t ret      = 0;
+
+    for (size_t size : sizes)
+        ret         += size;
+
+    return ret;
+};
+
+#ifdef DBS_THREAD_SAFE
+
+dbs parallel_and(const dbs& x, const dbs& y)
+{
+    using details::dbs_impl;
+    return dbs(details::parallel_binary(x, y, details::expr_code::op_and, &dbs_impl::and_impl));
+};
+
+dbs parallel_or(const dbs& x, const dbs& y)
+{
+    using details::dbs_impl;
+    return dbs(details::parallel_binary(x, y, details::expr_code::op_or, &dbs_impl::or_impl));
+};
+
+dbs parallel_xor(const dbs& x, const dbs& y)
+{
+    using details::dbs_impl;
+    return dbs(details::parallel_binary(x, y, details::expr_code::op_xor, &dbs_impl::xor_impl));
+};
+
+#endif
+
+dbs dbs::from_unsorted(size_t count, const size_t* elems)
+{
+    return dbs(details::build_from_unsorted(count, elems));
+};
+
+void parallel_get_elements(const dbs& x, std::vector<size_t>& elems)
+{
+    std::vector<details::subtree_task> tasks;
+    details::split_tree(x, details::min_tasks(), tasks);
+
+    // output position of every subtree
+    std::vector<size_t> offsets(tasks.size() + 1);
+    details::thread_pool& pool  = details::thread_pool::get();
+
+    pool.run(tasks.size(), [&](size_t i)
+    {
+        offsets[i + 1]  = tasks[i].m_node->size();
+    });
+
+    offsets[0]          = elems.size();
+
+    for (size_t i = 0; i < tasks.size(); ++i)
+        offsets[i + 1]  += offsets[i];
+
+    elems.resize(offsets.back());
+    size_t* out         = elems.data();
+
+    pool.run(tasks.size(), [&](size_t i)
+    {
+        tasks[i].m_node->get_elements(tasks[i].m_offset, out + offsets[i]);
+    });
+};
+
+}
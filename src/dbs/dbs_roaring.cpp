@@ -0,0 +1,659 @@
+/*
+*  This file is a part of DBS library.
+*
+*  Copyright (c) Pawe Kowal 2017 - 2021
+*
+*  This program is free software; you can redistribute it and/or modify
+*  it under the terms of the GNU General Public License as published by
+*  the Free Software Foundation; either version 2 of the License, or
+*  (at your option) any later version.
+*
+*  This program is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU General Public License for more details.
+*
+*  You should have received a copy of the GNU General Public License
+*  along with this program; if not, write to the Free Software
+*  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+*/
+
+#include "dbs/dbs_roaring.h"
+#include "dbs/dbs_serialize.h"
+#include "dbs/dbs_stream_builder.h"
+#include "dbs/details/dbs_impl.h"
+#include "dbs/details/dbs_details.inl"
+
+#include <stdexcept>
+#include <stdint.h>
+
+namespace dbs_lib { namespace details
+{
+
+// cookies at the beginning of a 32-bit Roaring image with and without
+// run containers
+static const uint32_t   roaring_cookie_no_runs      = 12346;
+static const uint32_t   roaring_cookie              = 12347;
+
+// offsets of containers are stored if an image has no run containers or
+// has at least this number of containers
+static const size_t     roaring_offset_threshold    = 4;
+
+static const size_t     container_bits      = 16;
+static const size_t     container_values    = size_t(1) << container_bits;
+static const size_t     container_words     = container_values / block::block_bits;
+static const size_t     bitmap_bytes        = container_values / 8;
+static const size_t     max_array_size      = 4096;
+
+enum class container_type
+{
+    array, bitmap, run
+};
+
+static void write_u16(std::vector<unsigned char>& out, size_t value)
+{
+    out.push_back(static_cast<unsigned char>(value));
+    out.push_back(static_cast<unsigned char>(value >> 8));
+};
+
+static void write_u32(std::vector<unsigned char>& out, uint64_t value)
+{
+    for (size_t i = 0; i < 4; ++i)
+        out.push_back(static_cast<unsigned char>(value >> (8 * i)));
+};
+
+//-----------------------------------------------------------------
+//                      roaring_writer
+//-----------------------------------------------------------------
+// writer of a 32-bit Roaring image; containers are encoded when all their
+// words are known, the image is written when all containers are known
+class roaring_writer
+{
+    private:
+        struct container_info
+        {
+            size_t          m_key;
+            size_t          m_card;
+            size_t          m_offset;
+            container_type  m_type;
+        };
+
+        // nonzero word of bits of the current container
+        struct container_word
+        {
+            size_t          m_index;
+            size_t          m_word;
+        };
+
+    private:
+        std::vector<unsigned char>&     m_buffer;
+        std::vector<container_info>     m_containers;
+        std::vector<unsigned char>      m_payload;
+        std::vector<container_word>     m_words;
+        size_t                          m_key;
+
+    public:
+        // images are appended to the buffer
+        explicit roaring_writer(std::vector<unsigned char>& buffer);
+
+        // add nonzero word of bits representing values offset + i; offset
+        // is less than 2^32 and is a multiple of block_bits; offsets must 
+        // be increasing
+        void                add_word(size_t offset, size_t word);
+
+        // write the image of added words and start a new image
+        void                finish();
+
+    private:
+        void                finish_container();
+        void                write_array();
+        void                write_bitmap();
+        void                write_runs(size_t n_runs);
+};
+
+roaring_writer::roaring_writer(std::vector<unsigned char>& buffer)
+    :m_buffer(buffer), m_key(0)
+{};
+
+void roaring_writer::add_word(size_t offset, size_t word)
+{
+    size_t key          = offset >> container_bits;
+
+    if (key != m_key && m_words.empty() == false)
+        finish_container();
+
+    m_key               = key;
+    m_words.push_back(container_word{(offset & (container_values - 1)) / block::block_bits, word});
+};
+
+void roaring_writer::finish_container()
+{
+    size_t card         = 0;
+    size_t n_runs       = 0;
+    size_t last_index   = size_t(-1);
+    size_t last_word    = 0;
+
+    // a run starts at a set bit, which is not preceded by a set bit
+    for (const container_word& w : m_words)
+    {
+        size_t carry    = (w.m_index == last_index + 1) ? last_word >> (block::block_bits - 1) : 0;
+
+        card            += block::count_bits(w.m_word);
+        n_runs          += block::count_bits(w.m_word & ~((w.m_word << 1) | carry));
+
+        last_index      = w.m_index;
+        last_word       = w.m_word;
+    };
+
+    size_t run_bytes    = 2 + 4 * n_runs;
+    size_t other_bytes  = (card <= max_array_size) ? 2 * card : bitmap_bytes;
+
+    container_info info;
+    info.m_key          = m_key;
+    info.m_card         = card;
+    info.m_offset       = m_payload.size();
+
+    if (run_bytes < other_bytes)
+    {
+        info.m_type     = container_type::run;
+        write_runs(n_runs);
+    }
+    else if (card <= max_array_size)
+    {
+        info.m_type     = container_type::array;
+        write_array();
+    }
+    else
+    {
+        info.m_type     = container_type::bitmap;
+        write_bitmap();
+    };
+
+    m_containers.push_back(info);
+    m_words.clear();
+};
+
+void roaring_writer::write_array()
+{
+    for (const container_word& w : m_words)
+    {
+        size_t offset   = w.m_index * block::block_bits;
+
+        for (size_t bits = w.m_word; bits != 0; bits &= bits - 1)
+            write_u16(m_payload, offset + block::header_type::least_significant_bit_pos(bits));
+    };
+};
+
+void roaring_writer::write_bitmap()
+{
+    // bitmap is stored as 64-bit words in little endian order, which is
+    // the same as bytes of words of any size in little endian order
+    size_t pos          = m_payload.size();
+    m_payload.resize(pos + bitmap_bytes, 0);
+
+    for (const container_word& w : m_words)
+    {
+        unsigned char* out  = m_payload.data() + pos + w.m_index * sizeof(size_t);
+
+        for (size_t i = 0; i < sizeof(size_t); ++i)
+            out[i]      = static_cast<unsigned char>(w.m_word >> (8 * i));
+    };
+};
+
+void roaring_writer::write_runs(size_t n_runs)
+{
+    using header_type   = block::header_type;
+
+    write_u16(m_payload, n_runs);
+
+    // the current run [first, last]
+    bool open           = false;
+    size_t first        = 0;
+    size_t last         = 0;
+
+    for (const container_word& w : m_words)
+    {
+        size_t offset   = w.m_index * block::block_bits;
+        size_t bits     = w.m_word;
+
+        while (bits != 0)
+        {
+            size_t start    = header_type::least_significant_bit_pos(bits);
+            size_t zeros    = ~(bits >> start);
+            size_t length   = (zeros == 0) ? size_t(block::block_bits) 
+                                           : header_type::least_significant_bit_pos(zeros);
+
+            if (open == true && offset + start == last + 1)
+            {
+                last        = offset + start + length - 1;
+            }
+            else
+            {
+                if (open == true)
+                {
+                    write_u16(m_payload, first);
+                    write_u16(m_payload, last - first);
+                };
+
+                open        = true;
+                first       = offset + start;
+                last        = offset + start + length - 1;
+            };
+
+            if (start + length >= size_t(block::block_bits))
+                bits        = 0;
+            else
+                bits        &= ~(((size_t(1) << length) - 1) << start);
+        };
+    };
+
+    if (open == true)
+    {
+        write_u16(m_payload, first);
+        write_u16(m_payload, last - first);
+    };
+};
+
+void roaring_writer::finish()
+{
+    if (m_words.empty() == false)
+        finish_container();
+
+    size_t n            = m_containers.size();
+    bool has_runs       = false;
+
+    for (const container_info& info : m_containers)
+        has_runs        |= (info.m_type == container_type::run);
+
+    size_t start        = m_buffer.size();
+
+    if (has_runs == true)
+    {
+        write_u32(m_buffer, roaring_cookie | (uint64_t(n - 1) << 16));
+
+        size_t pos      = m_buffer.size();
+        m_buffer.resize(pos + (n + 7) / 8, 0);
+
+        for (size_t i = 0; i < n; ++i)
+        {
+            if (m_containers[i].m_type == container_type::run)
+                m_buffer[pos + i / 8]   |= static_cast<unsigned char>(1 << (i % 8));
+        };
+    }
+    else
+    {
+        write_u32(m_buffer, roaring_cookie_no_runs);
+        write_u32(m_buffer, n);
+    };
+
+    for (const container_info& info : m_containers)
+    {
+        write_u16(m_buffer, info.m_key);
+        write_u16(m_buffer, info.m_card - 1);
+    };
+
+    // offsets are counted from the beginning of the image
+    if (has_runs == false || n >= roaring_offset_threshold)
+    {
+        size_t payload  = m_buffer.size() - start + 4 * n;
+
+        for (const container_info& info : m_containers)
+            write_u32(m_buffer, payload + info.m_offset);
+    };
+
+    m_buffer.insert(m_buffer.end(), m_payload.begin(), m_payload.end());
+
+    m_containers.clear();
+    m_payload.clear();
+    m_key               = 0;
+};
+
+//-----------------------------------------------------------------
+//                      roaring_reader
+//-----------------------------------------------------------------
+class roaring_reader
+{
+    private:
+        const unsigned char*    m_data;
+        size_t                  m_size;
+        size_t                  m_read;
+
+    public:
+        roaring_reader(const unsigned char* data, size_t size);
+
+        // return pointer to next n bytes and skip them; throw 
+        // serialization_error if there is not enough data
+        const unsigned char*    read(size_t n);
+
+        // read integer of given number of bytes stored in little endian
+        // order
+        uint64_t                read_int(size_t bytes);
+
+        size_t                  bytes_read() const;
+};
+
+roaring_reader::roaring_reader(const unsigned char* data, size_t size)
+    :m_data(data), m_size(size), m_read(0)
+{};
+
+const unsigned char* roaring_reader::read(size_t n)
+{
+    if (m_size - m_read < n)
+        throw serialization_error("dbs: Roaring image is truncated");
+
+    const unsigned char* ret    = m_data + m_read;
+    m_read          += n;
+
+    return ret;
+};
+
+uint64_t roaring_reader::read_int(size_t bytes)
+{
+    const unsigned char* data   = read(bytes);
+    uint64_t value  = 0;
+
+    for (size_t i = 0; i < bytes; ++i)
+        value       |= uint64_t(data[i]) << (8 * i);
+
+    return value;
+};
+
+size_t roaring_reader::bytes_read() const
+{
+    return m_read;
+};
+
+// collects elements of one block of 2 * block_bits elements before they
+// are added to the builder
+class block_accumulator
+{
+    private:
+        static const size_t block_values    = 2 * block::block_bits;
+
+    private:
+        dbs_stream_builder& m_builder;
+        size_t              m_offset;
+        size_t              m_words[2];
+
+    public:
+        explicit block_accumulator(dbs_stream_builder& builder);
+
+        // add element n or elements in the range [first, last]; elements
+        // must be greater than previously added elements
+        void                add(size_t n);
+        void                add_range(size_t first, size_t last);
+
+        // add collected elements to the builder
+        void                flush();
+
+    private:
+        void                set_block(size_t n);
+};
+
+block_accumulator::block_accumulator(dbs_stream_builder& builder)
+    :m_builder(builder), m_offset(0)
+{
+    m_words[0]      = 0;
+    m_words[1]      = 0;
+};
+
+void block_accumulator::set_block(size_t n)
+{
+    size_t offset   = n - n % block_values;
+
+    if (offset != m_offset)
+    {
+        flush();
+        m_offset    = offset;
+    };
+};
+
+void block_accumulator::add(size_t n)
+{
+    set_block(n);
+
+    size_t pos      = n - m_offset;
+    m_words[pos / block::block_bits]    |= block::bit_mask(pos % block::block_bits);
+};
+
+void block_accumulator::add_range(size_t first, size_t last)
+{
+    flush();
+    m_builder.push_range(first, last);
+};
+
+void block_accumulator::flush()
+{
+    m_builder.push_block(m_offset, m_words[0], m_words[1]);
+
+    m_words[0]      = 0;
+    m_words[1]      = 0;
+};
+
+static void invalid_image()
+{
+    throw serialization_error("dbs: invalid Roaring image");
+};
+
+// read 32-bit Roaring image and add its elements increased by offset to 
+// the builder
+static void read_bitmap(roaring_reader& in, size_t offset, dbs_stream_builder& builder)
+{
+    uint64_t cookie         = in.read_int(4);
+    const unsigned char* run_flags  = nullptr;
+    size_t n;
+
+    if ((cookie & 0xFFFF) == roaring_cookie)
+    {
+        n                   = static_cast<size_t>(cookie >> 16) + 1;
+        run_flags           = in.read((n + 7) / 8);
+    }
+    else if (cookie == roaring_cookie_no_runs)
+    {
+        uint64_t size       = in.read_int(4);
+
+        if (size > (uint64_t(1) << container_bits))
+            invalid_image();
+
+        n                   = static_cast<size_t>(size);
+    }
+    else
+    {
+        invalid_image();
+        return;
+    };
+
+    const unsigned char* headers    = in.read(4 * n);
+
+    if (run_flags == nullptr || n >= roaring_offset_threshold)
+        in.read(4 * n);
+
+    block_accumulator acc(builder);
+    size_t words[container_words];
+
+    for (size_t i = 0; i < n; ++i)
+    {
+        size_t key          = size_t(headers[4 * i]) + (size_t(headers[4 * i + 1]) << 8);
+        size_t card         = size_t(headers[4 * i + 2]) + (size_t(headers[4 * i + 3]) << 8) + 1;
+
+        if (i > 0 && key <= size_t(headers[4 * i - 4]) + (size_t(headers[4 * i - 3]) << 8))
+            invalid_image();
+
+        size_t base         = offset + (key << container_bits);
+        bool is_run         = run_flags != nullptr && ((run_flags[i / 8] >> (i % 8)) & 1) != 0;
+
+        if (is_run == true)
+        {
+            size_t n_runs   = static_cast<size_t>(in.read_int(2));
+            size_t count    = 0;
+            size_t next     = 0;
+
+            for (size_t j = 0; j < n_runs; ++j)
+            {
+                size_t first    = static_cast<size_t>(in.read_int(2));
+                size_t last     = first + static_cast<size_t>(in.read_int(2));
+
+                if (first < next || last >= container_values)
+                    invalid_image();
+
+                acc.add_range(base + first, base + last);
+
+                count       += last - first + 1;
+                next        = last + 1;
+            };
+
+            if (count != card)
+                invalid_image();
+        }
+        else if (card > max_array_size)
+        {
+            const unsigned char* data   = in.read(bitmap_bytes);
+            size_t count    = 0;
+
+            for (size_t j = 0; j < container_words; ++j)
+            {
+                size_t word = 0;
+
+                for (size_t k = 0; k < sizeof(size_t); ++k)
+                    word    |= size_t(data[j * sizeof(size_t) + k]) << (8 * k);
+
+                words[j]    = word;
+                count       += block::count_bits(word);
+            };
+
+            if (count != card)
+                invalid_image();
+
+            acc.flush();
+
+            for (size_t j = 0; j < container_words; j += 2)
+                builder.push_block(base + j * block::block_bits, words[j], words[j + 1]);
+        }
+        else
+        {
+            const unsigned char* data   = in.read(2 * card);
+            size_t next     = 0;
+
+            for (size_t j = 0; j < card; ++j)
+            {
+                size_t value    = size_t(data[2 * j]) + (size_t(data[2 * j + 1]) << 8);
+
+                if (value < next)
+                    invalid_image();
+
+                acc.add(base + value);
+                next        = value + 1;
+            };
+        };
+    };
+
+    acc.flush();
+};
+
+}};
+
+namespace dbs_lib
+{
+
+//-----------------------------------------------------------------
+//                      ROARING FORMAT
+//-----------------------------------------------------------------
+void to_roaring(const dbs& x, std::vector<unsigned char>& buffer)
+{
+    if (x.any() == true && uint64_t(x.last()) > 0xFFFFFFFF)
+    {
+        throw std::invalid_argument("dbs: bitset stores elements not representable in"
+                                    " 32-bit Roaring format");
+    };
+
+    details::roaring_writer out(buffer);
+
+    x.for_each_word([&out](size_t offset, size_t word)
+    {
+        out.add_word(offset, word);
+    });
+
+    out.finish();
+};
+
+void to_roaring64(const dbs& x, std::vector<unsigned char>& buffer)
+{
+    // the number of 32-bit bitmaps is stored when it is known
+    size_t count_pos    = buffer.size();
+    buffer.resize(count_pos + 8, 0);
+
+    details::roaring_writer out(buffer);
+
+    uint64_t count      = 0;
+    uint64_t high       = 0;
+
+    x.for_each_word([&](size_t offset, size_t word)
+    {
+        uint64_t key    = uint64_t(offset) >> 32;
+
+        if (count == 0 || key != high)
+        {
+            if (count > 0)
+                out.finish();
+
+            details::write_u32(buffer, key);
+
+            high        = key;
+            count       += 1;
+        };
+
+        out.add_word(static_cast<size_t>(uint64_t(offset) & 0xFFFFFFFF), word);
+    });
+
+    if (count > 0)
+        out.finish();
+
+    for (size_t i = 0; i < 8; ++i)
+        buffer[count_pos + i]   = static_cast<unsigned char>(count >> (8 * i));
+};
+
+dbs from_roaring(const unsigned char* data, size_t size, size_t* read)
+{
+    details::roaring_reader in(data, size);
+    dbs_stream_builder builder;
+
+    details::read_bitmap(in, 0, builder);
+
+    if (read != nullptr)
+        *read           = in.bytes_read();
+
+    return builder.finish();
+};
+
+dbs from_roaring64(const unsigned char* data, size_t size, size_t* read)
+{
+    details::roaring_reader in(data, size);
+    dbs_stream_builder builder;
+
+    uint64_t count      = in.read_int(8);
+    uint64_t last_key   = 0;
+
+    for (uint64_t i = 0; i < count; ++i)
+    {
+        uint64_t key    = in.read_int(4);
+
+        if (i > 0 && key <= last_key)
+            details::invalid_image();
+
+        if ((key << 32) > uint64_t(size_t(-1)))
+        {
+            throw serialization_error("dbs: Roaring image stores elements, that cannot"
+                                      " be represented by size_t");
+        };
+
+        details::read_bitmap(in, static_cast<size_t>(key << 32), builder);
+        last_key        = key;
+    };
+
+    if (read != nullptr)
+        *read           = in.bytes_read();
+
+    return builder.finish();
+};
+
+}
@@ -0,0 +1,644 @@
+/*
+*  This file is a part of DBS library.
+*
+*  Copyright (c) Pawe Kowal 2017 - 2021
+*
+*  This program is free software; you can redistribute it and/or modify
+*  it under the terms of the GNU General Public License as published by
+*  the Free Software Foundation; either version 2 of the License, or
+*  (at your option) any later version.
+*
+*  This program is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU General Public License for more details.
+*
+*  You should have received a copy of the GNU General Public License
+*  along with this program; if not, write to the Free Software
+*  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+*/
+
+#include "dbs/dbs_serialize.h"
+#include "dbs/dbs_stream_builder.h"
+#include "dbs/details/dbs_impl.h"
+#include "dbs/details/dbs_details.inl"
+
+#include <istream>
+#include <ostream>
+#include <cstring>
+#include <unordered_map>
+#include <stdint.h>
+
+namespace dbs_lib { namespace details
+{
+
+// image header: magic bytes, format version (2 bytes), number of bits in
+// a word and one reserved byte
+static const unsigned char  image_magic[4]  = {'D', 'B', 'S', 'I'};
+static const unsigned char  collection_magic[4] = {'D', 'B', 'S', 'C'};
+static const size_t         header_bytes    = 8;
+
+// buffered output of a binary image
+class image_writer
+{
+    private:
+        static const size_t         flush_bytes = 1 << 16;
+
+    private:
+        std::vector<unsigned char>  m_local;
+        std::vector<unsigned char>& m_buffer;
+        std::ostream*               m_os;
+
+    public:
+        // append image to the buffer
+        explicit image_writer(std::vector<unsigned char>& buffer);
+
+        // write image to the stream
+        explicit image_writer(std::ostream& os);
+
+        void                write_byte(size_t value);
+
+        // write bytes lowest bytes of value in little endian order
+        void                write_word(uint64_t value, size_t bytes);
+
+        // write buffered data to the stream
+        void                flush();
+};
+
+image_writer::image_writer(std::vector<unsigned char>& buffer)
+    :m_buffer(buffer), m_os(nullptr)
+{};
+
+image_writer::image_writer(std::ostream& os)
+    :m_buffer(m_local), m_os(&os)
+{};
+
+void image_writer::write_byte(size_t value)
+{
+    m_buffer.push_back(static_cast<unsigned char>(value));
+};
+
+void image_writer::write_word(uint64_t value, size_t bytes)
+{
+    for (size_t i = 0; i < bytes; ++i)
+        m_buffer.push_back(static_cast<unsigned char>(value >> (8 * i)));
+
+    if (m_os != nullptr && m_buffer.size() >= flush_bytes)
+        flush();
+};
+
+void image_writer::flush()
+{
+    if (m_os == nullptr)
+        return;
+
+    m_os->write(reinterpret_cast<const char*>(m_buffer.data()), m_buffer.size());
+    m_buffer.clear();
+};
+
+// input of a binary image
+class image_reader
+{
+    private:
+        const unsigned char*    m_data;
+        size_t                  m_size;
+        std::istream*           m_is;
+        size_t                  m_read;
+
+    public:
+        // read image from the buffer data of given size
+        image_reader(const unsigned char* data, size_t size);
+
+        // read image from the stream
+        explicit image_reader(std::istream& is);
+
+        // read n bytes to out; throw serialization_error if there is not
+        // enough data
+        void                read(unsigned char* out, size_t n);
+
+        size_t              read_byte();
+
+        // read word of given number of bytes stored in little endian order
+        uint64_t            read_word(size_t bytes);
+
+        // return number of bytes read
+        size_t              bytes_read() const;
+};
+
+image_reader::image_reader(const unsigned char* data, size_t size)
+    :m_data(data), m_size(size), m_is(nullptr), m_read(0)
+{};
+
+image_reader::image_reader(std::istream& is)
+    :m_data(nullptr), m_size(0), m_is(&is), m_read(0)
+{};
+
+void image_reader::read(unsigned char* out, size_t n)
+{
+    if (m_is != nullptr)
+    {
+        m_is->read(reinterpret_cast<char*>(out), n);
+
+        if (static_cast<size_t>(m_is->gcount()) != n)
+            throw serialization_error("dbs: binary image is truncated");
+    }
+    else
+    {
+        if (m_size - m_read < n)
+            throw serialization_error("dbs: binary image is truncated");
+
+        memcpy(out, m_data + m_read, n);
+    };
+
+    m_read          += n;
+};
+
+size_t image_reader::read_byte()
+{
+    unsigned char value;
+    read(&value, 1);
+
+    return value;
+};
+
+uint64_t image_reader::read_word(size_t bytes)
+{
+    unsigned char buf[8];
+    read(buf, bytes);
+
+    uint64_t value  = 0;
+
+    for (size_t i = 0; i < bytes; ++i)
+        value       |= uint64_t(buf[i]) << (8 * i);
+
+    return value;
+};
+
+size_t image_reader::bytes_read() const
+{
+    return m_read;
+};
+
+// layout of a tree stored in an image
+struct image_format
+{
+    size_t      m_word_bits;
+    size_t      m_word_bits_log;
+    size_t      m_word_bytes;
+    size_t      m_max_level;
+
+    explicit image_format(size_t word_bits);
+};
+
+image_format::image_format(size_t word_bits)
+    :m_word_bits(word_bits), m_word_bytes(word_bits / 8)
+{
+    m_word_bits_log = (word_bits == 32) ? 5 : 6;
+    m_max_level     = (word_bits - 2) / m_word_bits_log;
+};
+
+static void write_node(const dbs_impl& x, image_writer& out)
+{
+    const block& data   = x.get_data();
+    size_t level        = data.get_level();
+
+    out.write_byte(level);
+
+    if (level == 0)
+    {
+        out.write_word(data.get_block_0(), sizeof(size_t));
+        out.write_word(data.get_block_1(), sizeof(size_t));
+        return;
+    };
+
+    out.write_word(data.m_flags, sizeof(size_t));
+
+    size_t size         = block::count_bits(data.m_flags);
+    const dbs_set* set  = data.get_fsb_set();
+
+    for (size_t i = 0; i < size; ++i)
+        write_node(set->get_elem(i), out);
+};
+
+// read level of a node and check, that it is lower than the level of the
+// parent node
+static size_t read_level(image_reader& in, size_t parent_level)
+{
+    size_t level        = in.read_byte();
+
+    if (level >= parent_level)
+        throw serialization_error("dbs: binary image has invalid node level");
+
+    return level;
+};
+
+// read flags of an internal node and check, that the node is in the 
+// canonical form and children positions are valid
+static uint64_t read_flags(image_reader& in, const image_format& format, size_t level)
+{
+    uint64_t flags      = in.read_word(format.m_word_bytes);
+    size_t shift        = format.m_word_bits_log * level + 1;
+
+    // a node storing only the first child is not allowed
+    if (flags <= 1)
+        throw serialization_error("dbs: binary image has invalid node");
+
+    // the highest node stores less than word_bits children
+    if (shift + format.m_word_bits_log > format.m_word_bits 
+            && (flags >> (uint64_t(1) << (format.m_word_bits - shift))) != 0)
+    {
+        throw serialization_error("dbs: binary image has invalid node");
+    };
+
+    return flags;
+};
+
+// reconstruct a node from an image created with the same word size
+static dbs_impl read_node(image_reader& in, const image_format& format, size_t parent_level,
+                          bool is_root)
+{
+    size_t level        = read_level(in, parent_level);
+
+    if (level == 0)
+    {
+        dbs_impl ret;
+        ret.get_data().get_block_0()    = static_cast<size_t>(in.read_word(format.m_word_bytes));
+        ret.get_data().get_block_1()    = static_cast<size_t>(in.read_word(format.m_word_bytes));
+
+        if (is_root == false && ret.none() == true)
+            throw serialization_error("dbs: binary image has invalid node");
+
+        return ret;
+    };
+
+    size_t flags        = static_cast<size_t>(read_flags(in, format, level));
+    size_t size         = block::count_bits(flags);
+
+    dbs_impl children[block::block_bits];
+
+    for (size_t i = 0; i < size; ++i)
+        children[i]     = read_node(in, format, level, false);
+
+    block::header_type h(static_cast<block::ushort_type>(level), 
+                         static_cast<block::ushort_type>(size));
+    dbs_impl ret(h, flags, dbs_set::create(size));
+
+    for (size_t i = 0; i < size; ++i)
+        ret.get_data().get_fsb_set()->init(i, std::move(children[i]));
+
+    return ret;
+};
+
+// add elements of a node stored in an image created with different word
+// size to the builder; elements are increased by offset
+static void decode_node(image_reader& in, const image_format& format, size_t parent_level,
+                        bool is_root, uint64_t offset, dbs_stream_builder& builder)
+{
+    size_t level        = read_level(in, parent_level);
+
+    if (level == 0)
+    {
+        uint64_t words[2];
+        words[0]        = in.read_word(format.m_word_bytes);
+        words[1]        = in.read_word(format.m_word_bytes);
+
+        if (is_root == false && words[0] == 0 && words[1] == 0)
+            throw serialization_error("dbs: binary image has invalid node");
+
+        // bit i of the word k represents element 2 * i + k
+        for (size_t i = 0; i < format.m_word_bits; ++i)
+        {
+            for (size_t k = 0; k < 2; ++k)
+            {
+                if (((words[k] >> i) & 1) == 0)
+                    continue;
+
+                uint64_t elem   = offset + 2 * i + k;
+
+                if (elem > uint64_t(size_t(-1)))
+                {
+                    throw serialization_error("dbs: binary image stores element, that"
+                                              " cannot be represented by size_t");
+                };
+
+                builder.push(static_cast<size_t>(elem));
+            };
+        };
+
+        return;
+    };
+
+    uint64_t flags      = read_flags(in, format, level);
+    size_t shift        = format.m_word_bits_log * level + 1;
+
+    for (uint64_t pos = 0; flags != 0; ++pos, flags >>= 1)
+    {
+        if ((flags & 1) != 0)
+            decode_node(in, format, level, false, offset + (pos << shift), builder);
+    };
+};
+
+static void write_image(const dbs& x, image_writer& out)
+{
+    for (size_t i = 0; i < 4; ++i)
+        out.write_byte(image_magic[i]);
+
+    out.write_word(serialization_version, 2);
+    out.write_byte(block::block_bits);
+    out.write_byte(0);
+
+    write_node(x, out);
+    out.flush();
+};
+
+static dbs read_image(image_reader& in)
+{
+    unsigned char header[header_bytes];
+    in.read(header, header_bytes);
+
+    if (memcmp(header, image_magic, 4) != 0)
+        throw serialization_error("dbs: invalid binary image");
+
+    size_t version      = size_t(header[4]) + (size_t(header[5]) << 8);
+    size_t word_bits    = header[6];
+
+    if (version == 0 || version > serialization_version)
+        throw serialization_error("dbs: unsupported version of binary image");
+
+    if (word_bits != 32 && word_bits != 64)
+        throw serialization_error("dbs: invalid binary image");
+
+    image_format format(word_bits);
+
+    if (word_bits == block::block_bits)
+        return dbs(read_node(in, format, format.m_max_level + 1, true));
+
+    dbs_stream_builder builder;
+    decode_node(in, format, format.m_max_level + 1, true, 0, builder);
+
+    return builder.finish();
+};
+
+// internal nodes of a collection indexed by address of children
+class node_table
+{
+    private:
+        using index_map     = std::unordered_map<const dbs_set*, size_t>;
+
+    private:
+        index_map               m_index;
+        std::vector<block>      m_nodes;
+
+    public:
+        // add internal nodes of x in postorder
+        void                    add(const dbs_impl& x);
+
+        // return index of an internal node
+        size_t                  index(const block& node) const;
+
+        const std::vector<block>&   nodes() const;
+};
+
+void node_table::add(const dbs_impl& x)
+{
+    const block& data   = x.get_data();
+
+    if (data.get_level() == 0 || m_index.find(data.get_fsb_set()) != m_index.end())
+        return;
+
+    size_t size         = block::count_bits(data.m_flags);
+    const dbs_set* set  = data.get_fsb_set();
+
+    for (size_t i = 0; i < size; ++i)
+        add(set->get_elem(i));
+
+    m_index[set]        = m_nodes.size();
+    m_nodes.push_back(data);
+};
+
+size_t node_table::index(const block& node) const
+{
+    return m_index.find(node.get_fsb_set())->second;
+};
+
+const std::vector<block>& node_table::nodes() const
+{
+    return m_nodes;
+};
+
+// write level of a node followed by words of a leaf or index of an 
+// internal node
+static void write_node_ref(const block& node, const node_table& table, image_writer& out)
+{
+    size_t level        = node.get_level();
+
+    out.write_byte(level);
+
+    if (level == 0)
+    {
+        out.write_word(node.get_block_0(), sizeof(size_t));
+        out.write_word(node.get_block_1(), sizeof(size_t));
+    }
+    else
+    {
+        out.write_word(table.index(node), sizeof(size_t));
+    };
+};
+
+static void write_collection(const std::vector<dbs>& sets, image_writer& out)
+{
+    node_table table;
+
+    for (const dbs& x : sets)
+        table.add(x);
+
+    for (size_t i = 0; i < 4; ++i)
+        out.write_byte(collection_magic[i]);
+
+    out.write_word(serialization_version, 2);
+    out.write_byte(block::block_bits);
+    out.write_byte(0);
+
+    const std::vector<block>& nodes = table.nodes();
+
+    out.write_word(nodes.size(), sizeof(size_t));
+
+    for (const block& node : nodes)
+    {
+        out.write_byte(node.get_level());
+        out.write_word(node.m_flags, sizeof(size_t));
+
+        size_t size         = block::count_bits(node.m_flags);
+        const dbs_set* set  = node.get_fsb_set();
+
+        for (size_t i = 0; i < size; ++i)
+            write_node_ref(set->get_elem(i).get_data(), table, out);
+    };
+
+    out.write_word(sets.size(), sizeof(size_t));
+
+    for (const dbs& x : sets)
+        write_node_ref(x.get_data(), table, out);
+
+    out.flush();
+};
+
+// read node written by write_node_ref; nodes contains internal nodes 
+// read so far
+static dbs_impl read_node_ref(image_reader& in, const image_format& format, 
+                              size_t parent_level, bool is_root, 
+                              const std::vector<dbs_impl>& nodes)
+{
+    size_t level        = read_level(in, parent_level);
+
+    if (level == 0)
+    {
+        dbs_impl ret;
+        ret.get_data().get_block_0()    = static_cast<size_t>(in.read_word(format.m_word_bytes));
+        ret.get_data().get_block_1()    = static_cast<size_t>(in.read_word(format.m_word_bytes));
+
+        if (is_root == false && ret.none() == true)
+            throw serialization_error("dbs: binary image has invalid node");
+
+        return ret;
+    };
+
+    uint64_t index      = in.read_word(format.m_word_bytes);
+
+    if (index >= nodes.size() || nodes[static_cast<size_t>(index)].get_data().get_level() != level)
+        throw serialization_error("dbs: binary image has invalid node reference");
+
+    return nodes[static_cast<size_t>(index)];
+};
+
+static std::vector<dbs> read_collection(image_reader& in)
+{
+    unsigned char header[header_bytes];
+    in.read(header, header_bytes);
+
+    if (memcmp(header, collection_magic, 4) != 0)
+        throw serialization_error("dbs: invalid binary image");
+
+    size_t version      = size_t(header[4]) + (size_t(header[5]) << 8);
+    size_t word_bits    = header[6];
+
+    if (version == 0 || version > serialization_version)
+        throw serialization_error("dbs: unsupported version of binary image");
+
+    if (word_bits != block::block_bits)
+    {
+        throw serialization_error("dbs: binary image of collection was created with"
+                                  " different word size");
+    };
+
+    image_format format(word_bits);
+
+    // sizes are not trusted; memory is allocated only for data read
+    uint64_t n_nodes    = in.read_word(format.m_word_bytes);
+    std::vector<dbs_impl> nodes;
+
+    for (uint64_t i = 0; i < n_nodes; ++i)
+    {
+        size_t level        = read_level(in, format.m_max_level + 1);
+
+        if (level == 0)
+            throw serialization_error("dbs: binary image has invalid node");
+
+        size_t flags        = static_cast<size_t>(read_flags(in, format, level));
+        size_t size         = block::count_bits(flags);
+
+        dbs_impl children[block::block_bits];
+
+        for (size_t j = 0; j < size; ++j)
+            children[j]     = read_node_ref(in, format, level, false, nodes);
+
+        block::header_type h(static_cast<block::ushort_type>(level), 
+                             static_cast<block::ushort_type>(size));
+        dbs_impl node(h, flags, dbs_set::create(size));
+
+        for (size_t j = 0; j < size; ++j)
+            node.get_data().get_fsb_set()->init(j, std::move(children[j]));
+
+        nodes.push_back(std::move(node));
+    };
+
+    uint64_t n_sets     = in.read_word(format.m_word_bytes);
+    std::vector<dbs> ret;
+
+    for (uint64_t i = 0; i < n_sets; ++i)
+        ret.push_back(dbs(read_node_ref(in, format, format.m_max_level + 1, true, nodes)));
+
+    return ret;
+};
+
+}};
+
+namespace dbs_lib
+{
+
+//-----------------------------------------------------------------
+//                      SERIALIZATION
+//-----------------------------------------------------------------
+serialization_error::serialization_error(const std::string& msg)
+    :std::runtime_error(msg)
+{};
+
+void serialize(const dbs& x, std::ostream& os)
+{
+    details::image_writer out(os);
+    details::write_image(x, out);
+};
+
+void serialize(const dbs& x, std::vector<unsigned char>& buffer)
+{
+    details::image_writer out(buffer);
+    details::write_image(x, out);
+};
+
+dbs deserialize(std::istream& is)
+{
+    details::image_reader in(is);
+    return details::read_image(in);
+};
+
+dbs deserialize(const unsigned char* data, size_t size, size_t* read)
+{
+    details::image_reader in(data, size);
+    dbs ret         = details::read_image(in);
+
+    if (read != nullptr)
+        *read       = in.bytes_read();
+
+    return ret;
+};
+
+void serialize_collection(const std::vector<dbs>& sets, std::ostream& os)
+{
+    details::image_writer out(os);
+    details::write_collection(sets, out);
+};
+
+void serialize_collection(const std::vector<dbs>& sets, std::vector<unsigned char>& buffer)
+{
+    details::image_writer out(buffer);
+    details::write_collection(sets, out);
+};
+
+std::vector<dbs> deserialize_collection(std::istream& is)
+{
+    details::image_reader in(is);
+    return details::read_collection(in);
+};
+
+std::vector<dbs> deserialize_collection(const unsigned char* data, size_t size, size_t* read)
+{
+    details::image_reader in(data, size);
+    std::vector<dbs> ret    = details::read_collection(in);
+
+    if (read != nullptr)
+        *read       = in.bytes_read();
+
+    return ret;
+};
+
+}
@@ -0,0 +1,375 @@
+/*
+*  This file is a part of DBS library.
+*
+*  Copyright (c) Pawe Kowal 2017 - 2021
+*
+*  This program is free software; you can redistribute it and/or modify
+*  it under the terms of the GNU General Public License as published by
+*  the Free Software Foundation; either version 2 of the License, or
+*  (at your option) any later version.
+*
+*  This program is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU General Public License for more details.
+*
+*  You should have received a copy of the GNU General Public License
+*  along with this program; if not, write to the Free Software
+*  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+*/
+
+#include "dbs/dbs_sketch.h"
+#include "dbs/details/dbs_impl.h"
+#include "dbs/details/dbs_details.inl"
+
+#include <stdexcept>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace dbs_lib { namespace details
+{
+
+static const uint64_t   sketch_golden   = 0x9E3779B97F4A7C15ull;
+static const uint64_t   sketch_empty    = std::numeric_limits<uint64_t>::max();
+
+// 64-bit finalizer of splitmix64; bijective
+static inline uint64_t sketch_mix(uint64_t x)
+{
+    x   = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+    x   = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+    return x ^ (x >> 31);
+};
+
+// hash of an element for given seed
+static inline uint64_t sketch_hash(size_t elem, uint64_t seed)
+{
+    return sketch_mix((uint64_t)elem + (seed + 1) * sketch_golden);
+};
+
+// position of the highest set bit of x != 0
+static inline size_t sketch_highest_bit(uint64_t x)
+{
+    using header_type   = block::header_type;
+
+    // size_t can have 32 bits
+    uint32_t hi         = (uint32_t)(x >> 32);
+
+    if (hi != 0)
+        return 32 + header_type::most_significant_bit_pos(hi);
+    else
+        return header_type::most_significant_bit_pos((uint32_t)x);
+};
+
+// call f(elem) for every element of x; words are visited in one traversal
+template<class Func>
+static void sketch_visit(const dbs& x, Func&& f)
+{
+    using header_type   = block::header_type;
+
+    x.for_each_word([&f](size_t offset, size_t word)
+    {
+        while (word != 0)
+        {
+            f(offset + header_type::least_significant_bit_pos(word));
+            word        = word & (word - 1);
+        };
+    });
+};
+
+static void check_compatible(const dbs_minhash& x, const dbs_minhash& y)
+{
+    if (x.k() != y.k() || x.kind() != y.kind() || x.seed() != y.seed())
+        throw std::invalid_argument("dbs: MinHash signatures are not compatible");
+};
+
+static void check_compatible(const dbs_hll& x, const dbs_hll& y)
+{
+    if (x.precision() != y.precision() || x.seed() != y.seed())
+        throw std::invalid_argument("dbs: HyperLogLog sketches are not compatible");
+};
+
+}};
+
+namespace dbs_lib
+{
+
+//-----------------------------------------------------------------
+//                      dbs_minhash
+//-----------------------------------------------------------------
+dbs_minhash::dbs_minhash()
+    :m_kind(minhash_kind::one_permutation), m_seed(0), m_count(0)
+    ,m_source_hash(hash_value(dbs()))
+{};
+
+dbs_minhash::dbs_minhash(const dbs& x, size_t k, minhash_kind kind, uint64_t seed)
+    :m_values(k, details::sketch_empty), m_kind(kind), m_seed(seed), m_count(0)
+    ,m_source_hash(hash_value(x))
+{
+    if (k == 0)
+        return;
+
+    uint64_t* values    = m_values.data();
+    size_t count        = 0;
+
+    if (kind == minhash_kind::k_hash)
+    {
+        // hash function i is the hash for the seed mixed with i
+        std::vector<uint64_t> seeds(k);
+
+        for (size_t i = 0; i < k; ++i)
+            seeds[i]    = details::sketch_mix(seed + i * details::sketch_golden);
+
+        details::sketch_visit(x, [&](size_t elem)
+        {
+            for (size_t i = 0; i < k; ++i)
+            {
+                uint64_t h  = details::sketch_hash(elem, seeds[i]);
+                values[i]   = std::min(values[i], h);
+            };
+
+            ++count;
+        });
+
+        m_count         = count;
+        return;
+    };
+
+    details::sketch_visit(x, [&](size_t elem)
+    {
+        uint64_t h      = details::sketch_hash(elem, seed);
+        size_t bin      = (size_t)(h % k);
+        values[bin]     = std::min(values[bin], h / k);
+
+        ++count;
+    });
+
+    m_count             = count;
+
+    if (count == 0)
+        return;
+
+    // empty bin takes the value of the nearest nonempty bin on the right
+    // mixed with the distance to this bin; equal values of a bin in two
+    // signatures are obtained from the same element with high probability
+    size_t last_full    = 0;
+
+    while (values[last_full] == details::sketch_empty)
+        ++last_full;
+
+    std::vector<uint64_t> full(m_values);
+
+    for (size_t i = k; i > 0; --i)
+    {
+        size_t bin      = i - 1;
+
+        if (full[bin] != details::sketch_empty)
+        {
+            last_full   = bin;
+            continue;
+        };
+
+        size_t dist     = (last_full + k - bin) % k;
+        values[bin]     = details::sketch_mix(full[last_full] + dist * details::sketch_golden);
+    };
+};
+
+size_t dbs_minhash::k() const
+{
+    return m_values.size();
+};
+
+minhash_kind dbs_minhash::kind() const
+{
+    return m_kind;
+};
+
+uint64_t dbs_minhash::seed() const
+{
+    return m_seed;
+};
+
+size_t dbs_minhash::count() const
+{
+    return m_count;
+};
+
+size_t dbs_minhash::source_hash() const
+{
+    return m_source_hash;
+};
+
+const std::vector<uint64_t>& dbs_minhash::values() const
+{
+    return m_values;
+};
+
+//-----------------------------------------------------------------
+//                      dbs_hll
+//-----------------------------------------------------------------
+dbs_hll::dbs_hll()
+    :m_precision(0), m_seed(0), m_source_hash(hash_value(dbs()))
+{};
+
+dbs_hll::dbs_hll(const dbs& x, size_t precision, uint64_t seed)
+    :m_precision(precision), m_seed(seed), m_source_hash(hash_value(x))
+{
+    if (precision < min_precision || precision > max_precision)
+        throw std::invalid_argument("dbs: invalid HyperLogLog precision");
+
+    m_registers.resize(size_t(1) << precision, 0);
+
+    unsigned char* regs = m_registers.data();
+
+    details::sketch_visit(x, [&](size_t elem)
+    {
+        uint64_t h      = details::sketch_hash(elem, seed);
+        size_t pos      = (size_t)(h >> (64 - precision));
+        // rank is the position of the highest set bit of remaining bits;
+        // additional bit limits the rank to 64 - precision + 1
+        uint64_t w      = (h << precision) | (uint64_t(1) << (precision - 1));
+        size_t rank     = 64 - details::sketch_highest_bit(w);
+
+        if (regs[pos] < rank)
+            regs[pos]   = (unsigned char)rank;
+    });
+};
+
+size_t dbs_hll::precision() const
+{
+    return m_precision;
+};
+
+uint64_t dbs_hll::seed() const
+{
+    return m_seed;
+};
+
+size_t dbs_hll::source_hash() const
+{
+    return m_source_hash;
+};
+
+const std::vector<unsigned char>& dbs_hll::registers() const
+{
+    return m_registers;
+};
+
+double dbs_hll::estimate() const
+{
+    size_t m            = m_registers.size();
+
+    if (m == 0)
+        return 0.0;
+
+    double sum          = 0.0;
+    size_t n_zeros      = 0;
+
+    for (unsigned char r : m_registers)
+    {
+        sum             += std::ldexp(1.0, -(int)r);
+        n_zeros         += (r == 0) ? 1 : 0;
+    };
+
+    double alpha;
+
+    if (m == 16)
+        alpha           = 0.673;
+    else if (m == 32)
+        alpha           = 0.697;
+    else if (m == 64)
+        alpha           = 0.709;
+    else
+        alpha           = 0.7213 / (1.0 + 1.079 / (double)m);
+
+    double est          = alpha * (double)m * (double)m / sum;
+
+    // linear counting for small cardinalities; large range correction is
+    // not needed for 64-bit hashes
+    if (est <= 2.5 * (double)m && n_zeros > 0)
+        est             = (double)m * std::log((double)m / (double)n_zeros);
+
+    return est;
+};
+
+dbs_hll dbs_hll::merge(const dbs_hll& other) const
+{
+    details::check_compatible(*this, other);
+
+    dbs_hll ret(*this);
+    ret.m_source_hash   = 0;
+
+    for (size_t i = 0; i < ret.m_registers.size(); ++i)
+        ret.m_registers[i]  = std::max(ret.m_registers[i], other.m_registers[i]);
+
+    return ret;
+};
+
+//-----------------------------------------------------------------
+//                      functions
+//-----------------------------------------------------------------
+double estimate_jaccard(const dbs_minhash& x, const dbs_minhash& y)
+{
+    details::check_compatible(x, y);
+
+    if (x.count() == 0 || y.count() == 0)
+        return (x.count() == y.count()) ? 1.0 : 0.0;
+
+    const std::vector<uint64_t>& vx = x.values();
+    const std::vector<uint64_t>& vy = y.values();
+
+    size_t n_equal      = 0;
+
+    for (size_t i = 0; i < vx.size(); ++i)
+        n_equal         += (vx[i] == vy[i]) ? 1 : 0;
+
+    return vx.empty() ? 0.0 : (double)n_equal / (double)vx.size();
+};
+
+double estimate_union_size(const dbs_minhash& x, const dbs_minhash& y)
+{
+    // |x| + |y| = |x | y| + |x & y| = (1 + J) * |x | y|
+    double jaccard      = estimate_jaccard(x, y);
+    return ((double)x.count() + (double)y.count()) / (1.0 + jaccard);
+};
+
+double estimate_intersection_size(const dbs_minhash& x, const dbs_minhash& y)
+{
+    double jaccard      = estimate_jaccard(x, y);
+    double union_size   = ((double)x.count() + (double)y.count()) / (1.0 + jaccard);
+    double ret          = jaccard * union_size;
+
+    return std::min(ret, (double)std::min(x.count(), y.count()));
+};
+
+double estimate_union_size(const dbs_hll& x, const dbs_hll& y)
+{
+    return x.merge(y).estimate();
+};
+
+double estimate_intersection_size(const dbs_hll& x, const dbs_hll& y)
+{
+    double est_x        = x.estimate();
+    double est_y        = y.estimate();
+    double est_union    = x.merge(y).estimate();
+
+    double ret          = est_x + est_y - est_union;
+    return std::max(0.0, std::min(ret, std::min(est_x, est_y)));
+};
+
+double estimate_jaccard(const dbs_hll& x, const dbs_hll& y)
+{
+    double est_x        = x.estimate();
+    double est_y        = y.estimate();
+    double est_union    = x.merge(y).estimate();
+
+    if (est_union == 0.0)
+        return 1.0;
+
+    double inter        = est_x + est_y - est_union;
+    inter               = std::max(0.0, std::min(inter, std::min(est_x, est_y)));
+
+    return inter / est_union;
+};
+
+}
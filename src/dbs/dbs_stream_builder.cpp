@@ -0,0 +1,290 @@
+/*
+*  This file is a part of DBS library.
+*
+*  Copyright (c) Pawe Kowal 2017 - 2021
+*
+*  This program is free software; you can redistribute it and/or modify
+*  it under the terms of the GNU General Public License as published by
+*  the Free Software Foundation; either version 2 of the License, or
+*  (at your option) any later version.
+*
+*  This program is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU General Public License for more details.
+*
+*  You should have received a copy of the GNU General Public License
+*  along with this program; if not, write to the Free Software
+*  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+*/
+
+#include "dbs/dbs_stream_builder.h"
+#include "dbs/details/dbs_impl.h"
+#include "dbs/details/dbs_details.inl"
+
+#include <stdexcept>
+#include <algorithm>
+
+namespace dbs_lib
+{
+
+//-----------------------------------------------------------------
+//                      dbs_stream_builder
+//-----------------------------------------------------------------
+dbs_stream_builder::dbs_stream_builder()
+    :m_count(0), m_last(0)
+{
+    m_leaf[0]       = 0;
+    m_leaf[1]       = 0;
+
+    for (size_t i = 0; i < max_level; ++i)
+    {
+        m_nodes[i].m_flags  = 0;
+        m_nodes[i].m_size   = 0;
+    };
+};
+
+size_t dbs_stream_builder::size() const
+{
+    return m_count;
+};
+
+void dbs_stream_builder::push(size_t n)
+{
+    using block             = details::block;
+
+    static const size_t leaf_bits   = block::block_bits_log + 1;
+
+    if (m_count > 0)
+    {
+        if (n <= m_last)
+        {
+            if (n == m_last)
+                return;
+
+            throw std::invalid_argument("dbs_stream_builder: elements must be added"
+                                        " in increasing order");
+        };
+
+        if (block::div_pow2<leaf_bits>(n) != block::div_pow2<leaf_bits>(m_last))
+            complete_nodes(n);
+    };
+
+    size_t item             = block::mod_pow2<leaf_bits>(n);
+    m_leaf[block::mod_pow2<1>(item)]    |= block::bit_mask(block::div_pow2<1>(item));
+
+    m_last                  = n;
+    m_count                 += 1;
+};
+
+void dbs_stream_builder::push(size_t count, const size_t* elems)
+{
+    for (size_t i = 0; i < count; ++i)
+        push(elems[i]);
+};
+
+void dbs_stream_builder::push_block(size_t offset, size_t word_0, size_t word_1)
+{
+    using block             = details::block;
+    using header_type       = block::header_type;
+
+    static const size_t leaf_bits   = block::block_bits_log + 1;
+
+    if (word_0 == 0 && word_1 == 0)
+        return;
+
+    if (block::mod_pow2<leaf_bits>(offset) != 0)
+        throw std::invalid_argument("dbs_stream_builder: invalid offset of a block");
+
+    size_t first            = offset + ((word_0 != 0) 
+                                ? header_type::least_significant_bit_pos(word_0)
+                                : block_bits + header_type::least_significant_bit_pos(word_1));
+    size_t last             = offset + ((word_1 != 0) 
+                                ? block_bits + header_type::most_significant_bit_pos(word_1)
+                                : header_type::most_significant_bit_pos(word_0));
+
+    if (m_count > 0)
+    {
+        if (first <= m_last)
+        {
+            throw std::invalid_argument("dbs_stream_builder: elements must be added"
+                                        " in increasing order");
+        };
+
+        if (block::div_pow2<leaf_bits>(first) != block::div_pow2<leaf_bits>(m_last))
+            complete_nodes(first);
+    };
+
+    dbs_impl leaf;
+    leaf.get_data().leaf_deinterleave(word_0, word_1);
+
+    m_leaf[0]               |= leaf.get_data().get_block_0();
+    m_leaf[1]               |= leaf.get_data().get_block_1();
+
+    m_last                  = last;
+    m_count                 += block::count_bits(word_0) + block::count_bits(word_1);
+};
+
+void dbs_stream_builder::push_range(size_t first, size_t last)
+{
+    static const size_t block_values    = 2 * block_bits;
+
+    if (first > last)
+        throw std::invalid_argument("dbs_stream_builder: invalid range of elements");
+
+    if (m_count > 0 && first <= m_last)
+    {
+        if (first < m_last)
+        {
+            throw std::invalid_argument("dbs_stream_builder: elements must be added"
+                                        " in increasing order");
+        };
+
+        if (first == last)
+            return;
+
+        first               += 1;
+    };
+
+    // elements are added in blocks of 2 * block_bits elements
+    for (;;)
+    {
+        size_t offset       = first - first % block_values;
+        size_t lo           = first - offset;
+        size_t hi           = std::min(last - offset, block_values - 1);
+        size_t words[2]     = {0, 0};
+
+        for (size_t k = 0; k < 2; ++k)
+        {
+            size_t word_lo  = std::max(lo, k * block_bits);
+            size_t word_hi  = std::min(hi, k * block_bits + block_bits - 1);
+
+            if (word_lo > word_hi)
+                continue;
+
+            size_t length   = word_hi - word_lo + 1;
+            size_t mask     = (length == block_bits) ? size_t(-1) 
+                                : (details::block::bit_mask(length) - 1);
+
+            words[k]        = mask << (word_lo - k * block_bits);
+        };
+
+        push_block(offset, words[0], words[1]);
+
+        if (last - offset < block_values)
+            break;
+
+        first               = offset + block_values;
+    };
+};
+
+dbs dbs_stream_builder::finish()
+{
+    if (m_count == 0)
+        return dbs();
+
+    complete_levels(max_level);
+
+    dbs ret(take_node(max_level));
+
+    m_count         = 0;
+    m_last          = 0;
+
+    return ret;
+};
+
+void dbs_stream_builder::complete_nodes(size_t n)
+{
+    using block             = details::block;
+
+    // find the lowest pending node storing n; the node of the highest level
+    // stores all elements
+    size_t level            = 1;
+
+    while (level < max_level)
+    {
+        size_t node_bits    = block::block_bits_log * level + block::block_bits_log + 1;
+
+        if (block::div_pow2(n, node_bits) == block::div_pow2(m_last, node_bits))
+            break;
+
+        ++level;
+    };
+
+    complete_levels(level);
+};
+
+void dbs_stream_builder::complete_levels(size_t top_level)
+{
+    dbs_impl node           = take_leaf();
+
+    for (size_t level = 1; level < top_level; ++level)
+    {
+        attach(level, std::move(node));
+        node                = take_node(level);
+    };
+
+    attach(top_level, std::move(node));
+};
+
+details::dbs_impl dbs_stream_builder::take_leaf()
+{
+    dbs_impl ret;
+
+    ret.get_data().get_block_0()    = m_leaf[0];
+    ret.get_data().get_block_1()    = m_leaf[1];
+
+    m_leaf[0]               = 0;
+    m_leaf[1]               = 0;
+
+    return ret;
+};
+
+details::dbs_impl dbs_stream_builder::take_node(size_t level)
+{
+    using block             = details::block;
+
+    pending_node& node      = m_nodes[level - 1];
+
+    size_t flags            = node.m_flags;
+    size_t size             = node.m_size;
+
+    node.m_flags            = 0;
+    node.m_size             = 0;
+
+    if (size == 0)
+        return dbs_impl();
+
+    // a node with only the first child is replaced by the child
+    if (flags == 1)
+        return std::move(node.m_children[0]);
+
+    block::header_type h(static_cast<block::ushort_type>(level), 
+                         static_cast<block::ushort_type>(size));
+    dbs_impl ret(h, flags, details::dbs_set::create(size));
+
+    for (size_t i = 0; i < size; ++i)
+        ret.get_data().get_fsb_set()->init(i, std::move(node.m_children[i]));
+
+    return ret;
+};
+
+void dbs_stream_builder::attach(size_t level, dbs_impl&& child)
+{
+    using block             = details::block;
+
+    if (child.none() == true)
+        return;
+
+    size_t capacity_bits    = block::block_bits_log * level + 1;
+    size_t pos              = block::mod_pow2(block::div_pow2(m_last, capacity_bits), 
+                                block::block_bits_log);
+
+    pending_node& node      = m_nodes[level - 1];
+
+    node.m_children[node.m_size]    = std::move(child);
+    node.m_flags            |= block::bit_mask(pos);
+    node.m_size             += 1;
+};
+
+}
@@ -0,0 +1,762 @@
+/*
+*  This file is a part of DBS library.
+*
+*  Copyright (c) Pawe Kowal 2017 - 2021
+*
+*  This program is free software; you can redistribute it and/or modify
+*  it under the terms of the GNU General Public License as published by
+*  the Free Software Foundation; either version 2 of the License, or
+*  (at your option) any later version.
+*
+*  This program is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU General Public License for more details.
+*
+*  You should have received a copy of the GNU General Public License
+*  along with this program; if not, write to the Free Software
+*  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+*/
+
+#include "dbs/dbs.h"
+#include "dbs/dbs_stream_builder.h"
+#include "dbs/details/dbs_impl.h"
+#include "dbs/details/dbs_details.inl"
+
+#include <algorithm>
+#include <ostream>
+#include <sstream>
+#include <stdexcept>
+#include <stdint.h>
+
+namespace dbs_lib { namespace details
+{
+
+//-----------------------------------------------------------------
+//                      text output
+//-----------------------------------------------------------------
+// buffered output of text
+class text_writer
+{
+    private:
+        static const size_t buffer_size = 4096;
+
+        // maximum number of characters of a number
+        static const size_t max_digits  = 24;
+
+    private:
+        std::ostream&       m_os;
+        char                m_buffer[buffer_size];
+        size_t              m_size;
+
+    public:
+        explicit text_writer(std::ostream& os);
+
+        void                write(const char* str, size_t n);
+        void                write_char(char c);
+        void                write_dec(uint64_t value);
+        void                write_hex(uint64_t value);
+
+        // write buffered text to the stream
+        void                flush();
+
+    private:
+        void                reserve(size_t n);
+};
+
+text_writer::text_writer(std::ostream& os)
+    :m_os(os), m_size(0)
+{};
+
+void text_writer::reserve(size_t n)
+{
+    if (buffer_size - m_size < n)
+        flush();
+};
+
+void text_writer::write(const char* str, size_t n)
+{
+    reserve(n);
+
+    for (size_t i = 0; i < n; ++i)
+        m_buffer[m_size + i]    = str[i];
+
+    m_size          += n;
+};
+
+void text_writer::write_char(char c)
+{
+    reserve(1);
+    m_buffer[m_size++]  = c;
+};
+
+void text_writer::write_dec(uint64_t value)
+{
+    char digits[max_digits];
+    size_t n        = 0;
+
+    do
+    {
+        digits[n++] = static_cast<char>('0' + value % 10);
+        value       /= 10;
+    }
+    while (value != 0);
+
+    reserve(n);
+
+    while (n > 0)
+        m_buffer[m_size++]  = digits[--n];
+};
+
+void text_writer::write_hex(uint64_t value)
+{
+    static const char hex_digits[]  = "0123456789abcdef";
+
+    char digits[max_digits];
+    size_t n        = 0;
+
+    do
+    {
+        digits[n++] = hex_digits[value % 16];
+        value       /= 16;
+    }
+    while (value != 0);
+
+    reserve(n);
+
+    while (n > 0)
+        m_buffer[m_size++]  = digits[--n];
+};
+
+void text_writer::flush()
+{
+    m_os.write(m_buffer, m_size);
+    m_size          = 0;
+};
+
+static void write_list_format(const dbs& x, text_writer& out)
+{
+    bool first          = true;
+
+    x.for_each_word([&](size_t offset, size_t word)
+    {
+        for (; word != 0; word &= word - 1)
+        {
+            if (first == false)
+                out.write(", ", 2);
+
+            out.write_dec(offset + block::header_type::least_significant_bit_pos(word));
+            first       = false;
+        };
+    });
+};
+
+static void write_ranges_format(const dbs& x, text_writer& out)
+{
+    using header_type   = block::header_type;
+
+    // the current run [first, last]
+    bool open           = false;
+    bool any            = false;
+    size_t first        = 0;
+    size_t last         = 0;
+
+    auto write_run      = [&]()
+    {
+        if (any == true)
+            out.write(", ", 2);
+
+        out.write_dec(first);
+
+        if (last != first)
+        {
+            out.write_char('-');
+            out.write_dec(last);
+        };
+
+        any             = true;
+    };
+
+    x.for_each_word([&](size_t offset, size_t bits)
+    {
+        while (bits != 0)
+        {
+            size_t start    = header_type::least_significant_bit_pos(bits);
+            size_t zeros    = ~(bits >> start);
+            size_t length   = (zeros == 0) ? size_t(block::block_bits) 
+                                           : header_type::least_significant_bit_pos(zeros);
+
+            if (open == true && offset + start == last + 1)
+            {
+                last        = offset + start + length - 1;
+            }
+            else
+            {
+                if (open == true)
+                    write_run();
+
+                open        = true;
+                first       = offset + start;
+                last        = offset + start + length - 1;
+            };
+
+            if (start + length >= size_t(block::block_bits))
+                bits        = 0;
+            else
+                bits        &= ~(((size_t(1) << length) - 1) << start);
+        };
+    });
+
+    if (open == true)
+        write_run();
+};
+
+static void write_hex_format(const dbs& x, text_writer& out)
+{
+    // words of the text have 64 bits independently of the size of size_t
+    bool any            = false;
+    uint64_t index      = 0;
+    uint64_t word       = 0;
+    uint64_t last_index = 0;
+
+    auto write_word     = [&]()
+    {
+        if (any == true && index == last_index + 1)
+        {
+            out.write_char(' ');
+        }
+        else
+        {
+            if (any == true)
+                out.write(", ", 2);
+
+            out.write_hex(index * 64);
+            out.write_char(':');
+        };
+
+        out.write_hex(word);
+
+        any             = true;
+        last_index      = index;
+    };
+
+    x.for_each_word([&](size_t offset, size_t bits)
+    {
+        uint64_t pos    = uint64_t(offset) / 64;
+
+        if (pos != index && word != 0)
+        {
+            write_word();
+            word        = 0;
+        };
+
+        index           = pos;
+        word            |= uint64_t(bits) << (uint64_t(offset) % 64);
+    });
+
+    if (word != 0)
+        write_word();
+};
+
+//-----------------------------------------------------------------
+//                      text input
+//-----------------------------------------------------------------
+class text_parser
+{
+    private:
+        const char*         m_begin;
+        const char*         m_pos;
+        const char*         m_end;
+
+    public:
+        text_parser(const char* text, size_t size);
+
+        void                skip_spaces();
+
+        // skip character c and return true if c is the next character
+        bool                accept(char c);
+
+        // skip character c; report error if c is not the next character
+        void                expect(char c);
+
+        // return true if all characters were read
+        bool                at_end() const;
+
+        // return true if the next character is a hex digit
+        bool                has_hex_digit() const;
+
+        uint64_t            read_dec();
+        uint64_t            read_hex();
+
+        // throw std::invalid_argument
+        void                error(const char* msg) const;
+};
+
+text_parser::text_parser(const char* text, size_t size)
+    :m_begin(text), m_pos(text), m_end(text + size)
+{};
+
+void text_parser::skip_spaces()
+{
+    while (m_pos != m_end && (*m_pos == ' ' || *m_pos == '\t' || *m_pos == '\n' 
+                              || *m_pos == '\r'))
+    {
+        ++m_pos;
+    };
+};
+
+bool text_parser::accept(char c)
+{
+    if (m_pos == m_end || *m_pos != c)
+        return false;
+
+    ++m_pos;
+    return true;
+};
+
+void text_parser::expect(char c)
+{
+    if (accept(c) == false)
+        error("unexpected character");
+};
+
+bool text_parser::at_end() const
+{
+    return m_pos == m_end;
+};
+
+static int hex_value(char c)
+{
+    if (c >= '0' && c <= '9')
+        return c - '0';
+    if (c >= 'a' && c <= 'f')
+        return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F')
+        return c - 'A' + 10;
+
+    return -1;
+};
+
+bool text_parser::has_hex_digit() const
+{
+    return m_pos != m_end && hex_value(*m_pos) >= 0;
+};
+
+uint64_t text_parser::read_dec()
+{
+    if (m_pos == m_end || *m_pos < '0' || *m_pos > '9')
+        error("number expected");
+
+    uint64_t value      = 0;
+
+    while (m_pos != m_end && *m_pos >= '0' && *m_pos <= '9')
+    {
+        uint64_t digit  = uint64_t(*m_pos - '0');
+
+        if (value > (uint64_t(-1) - digit) / 10)
+            error("number is too large");
+
+        value           = value * 10 + digit;
+        ++m_pos;
+    };
+
+    return value;
+};
+
+uint64_t text_parser::read_hex()
+{
+    if (has_hex_digit() == false)
+        error("number expected");
+
+    uint64_t value      = 0;
+
+    while (has_hex_digit() == true)
+    {
+        if ((value >> 60) != 0)
+            error("number is too large");
+
+        value           = value * 16 + uint64_t(hex_value(*m_pos));
+        ++m_pos;
+    };
+
+    return value;
+};
+
+void text_parser::error(const char* msg) const
+{
+    std::ostringstream os;
+    os << "dbs::parse: " << msg << " at position " << (m_pos - m_begin);
+
+    throw std::invalid_argument(os.str());
+};
+
+// return position of the lowest bit set in nonzero word
+static size_t lowest_bit(uint64_t word)
+{
+    for (size_t j = 0; ; j += block::block_bits)
+    {
+        size_t part     = static_cast<size_t>(word >> j);
+
+        if (part != 0)
+            return j + block::header_type::least_significant_bit_pos(part);
+    };
+};
+
+// return position of the highest bit set in nonzero word
+static size_t highest_bit(uint64_t word)
+{
+    for (size_t j = 64 - block::block_bits; ; j -= block::block_bits)
+    {
+        size_t part     = static_cast<size_t>(word >> j);
+
+        if (part != 0)
+            return j + block::header_type::most_significant_bit_pos(part);
+    };
+};
+
+// adds parsed elements to dbs_stream_builder; functions return false if
+// elements are not increasing
+class builder_sink
+{
+    private:
+        dbs_stream_builder  m_builder;
+        size_t              m_last;
+        bool                m_any;
+
+    public:
+        builder_sink();
+
+        bool                push(size_t n);
+        bool                push_range(size_t first, size_t last);
+
+        // add elements offset + i for bits i set in word
+        bool                push_word(size_t offset, uint64_t word);
+
+        dbs                 finish();
+};
+
+builder_sink::builder_sink()
+    :m_last(0), m_any(false)
+{};
+
+bool builder_sink::push(size_t n)
+{
+    if (m_any == true && n <= m_last)
+        return false;
+
+    m_builder.push(n);
+
+    m_last          = n;
+    m_any           = true;
+    return true;
+};
+
+bool builder_sink::push_range(size_t first, size_t last)
+{
+    if (m_any == true && first <= m_last)
+        return false;
+
+    m_builder.push_range(first, last);
+
+    m_last          = last;
+    m_any           = true;
+    return true;
+};
+
+bool builder_sink::push_word(size_t offset, uint64_t word)
+{
+    static const size_t block_bits  = block::block_bits;
+
+    if (word == 0)
+        return true;
+
+    if (m_any == true && offset + lowest_bit(word) <= m_last)
+        return false;
+
+    if (offset % 64 == 0)
+    {
+        // the word is split into parts of block_bits bits
+        for (size_t j = 0; j < 64; j += block_bits)
+        {
+            size_t part     = static_cast<size_t>(word >> j);
+            size_t pos      = offset + j;
+            size_t base     = pos - pos % (2 * block_bits);
+
+            if (part != 0)
+                m_builder.push_block(base, (pos == base) ? part : 0, (pos == base) ? 0 : part);
+        };
+    }
+    else
+    {
+        for (size_t i = 0; i < 64; ++i)
+        {
+            if (((word >> i) & 1) != 0)
+                m_builder.push(offset + i);
+        };
+    };
+
+    m_last          = offset + highest_bit(word);
+    m_any           = true;
+    return true;
+};
+
+dbs builder_sink::finish()
+{
+    return m_builder.finish();
+};
+
+// collects parsed elements in any order as ranges of elements; ranges are
+// sorted and merged when the set is built, therefore the memory used does
+// not depend on lengths of ranges
+class vector_sink
+{
+    private:
+        using range_type    = std::pair<size_t, size_t>;
+
+    private:
+        std::vector<range_type> m_ranges;
+
+    public:
+        bool                push(size_t n);
+        bool                push_range(size_t first, size_t last);
+        bool                push_word(size_t offset, uint64_t word);
+
+        dbs                 finish();
+};
+
+bool vector_sink::push(size_t n)
+{
+    m_ranges.push_back(range_type(n, n));
+    return true;
+};
+
+bool vector_sink::push_range(size_t first, size_t last)
+{
+    m_ranges.push_back(range_type(first, last));
+    return true;
+};
+
+bool vector_sink::push_word(size_t offset, uint64_t word)
+{
+    // every run of consecutive set bits is stored as one range
+    size_t i = 0;
+
+    while (i < 64)
+    {
+        if (((word >> i) & 1) == 0)
+        {
+            ++i;
+            continue;
+        };
+
+        size_t first    = i;
+
+        while (i < 64 && ((word >> i) & 1) != 0)
+            ++i;
+
+        m_ranges.push_back(range_type(offset + first, offset + i - 1));
+    };
+
+    return true;
+};
+
+dbs vector_sink::finish()
+{
+    std::sort(m_ranges.begin(), m_ranges.end());
+
+    dbs_stream_builder builder;
+
+    size_t pos          = 0;
+    size_t n_ranges     = m_ranges.size();
+
+    while (pos < n_ranges)
+    {
+        size_t first    = m_ranges[pos].first;
+        size_t last     = m_ranges[pos].second;
+
+        // merge overlapping and adjacent ranges
+        for (++pos; pos < n_ranges; ++pos)
+        {
+            if (last != size_t(-1) && m_ranges[pos].first > last + 1)
+                break;
+
+            if (m_ranges[pos].second > last)
+                last    = m_ranges[pos].second;
+        };
+
+        builder.push_range(first, last);
+    };
+
+    return builder.finish();
+};
+
+static size_t to_element(uint64_t value, const text_parser& in)
+{
+    if (value > uint64_t(size_t(-1)))
+        in.error("element cannot be represented by size_t");
+
+    return static_cast<size_t>(value);
+};
+
+// parse text and add elements to the sink; return false if the sink 
+// rejected elements
+template<class Sink>
+static bool parse_text(const char* text, size_t size, Sink& sink)
+{
+    text_parser in(text, size);
+
+    in.skip_spaces();
+
+    bool hex            = in.accept('x');
+
+    in.expect('{');
+    in.skip_spaces();
+
+    if (in.accept('}') == false)
+    {
+        for (;;)
+        {
+            if (hex == true)
+            {
+                uint64_t offset = in.read_hex();
+
+                in.skip_spaces();
+                in.expect(':');
+                in.skip_spaces();
+
+                // words at consecutive offsets
+                for (bool first = true; first == true || in.has_hex_digit() == true; 
+                     first = false)
+                {
+                    if (first == false)
+                    {
+                        if (offset > uint64_t(-1) - 64)
+                            in.error("element cannot be represented by size_t");
+
+                        offset  += 64;
+                    };
+
+                    uint64_t word   = in.read_hex();
+
+                    if (word != 0)
+                    {
+                        size_t high = highest_bit(word);
+
+                        if (offset > uint64_t(-1) - high)
+                            in.error("element cannot be represented by size_t");
+
+                        to_element(offset + high, in);
+
+                        if (sink.push_word(static_cast<size_t>(offset), word) == false)
+                            return false;
+                    };
+
+                    in.skip_spaces();
+                };
+            }
+            else
+            {
+                size_t first    = to_element(in.read_dec(), in);
+                in.skip_spaces();
+
+                if (in.accept('-') == true)
+                {
+                    in.skip_spaces();
+                    size_t last = to_element(in.read_dec(), in);
+
+                    if (last < first)
+                        in.error("invalid range");
+
+                    if (sink.push_range(first, last) == false)
+                        return false;
+                }
+                else
+                {
+                    if (sink.push(first) == false)
+                        return false;
+                };
+
+                in.skip_spaces();
+            };
+
+            if (in.accept('}') == true)
+                break;
+
+            in.expect(',');
+            in.skip_spaces();
+        };
+    };
+
+    in.skip_spaces();
+
+    if (in.at_end() == false)
+        in.error("unexpected character");
+
+    return true;
+};
+
+}};
+
+namespace dbs_lib
+{
+
+//-----------------------------------------------------------------
+//                      TEXT FORMAT
+//-----------------------------------------------------------------
+void write_text(std::ostream& os, const dbs& x, text_format format)
+{
+    details::text_writer out(os);
+
+    switch (format)
+    {
+        case text_format::list:
+            out.write_char('{');
+            details::write_list_format(x, out);
+            break;
+
+        case text_format::ranges:
+            out.write_char('{');
+            details::write_ranges_format(x, out);
+            break;
+
+        default:
+            out.write("x{", 2);
+            details::write_hex_format(x, out);
+            break;
+    };
+
+    out.write_char('}');
+    out.flush();
+};
+
+std::string to_string(const dbs& x, text_format format)
+{
+    std::ostringstream os;
+    write_text(os, x, format);
+
+    return os.str();
+};
+
+dbs dbs::parse(const std::string& text)
+{
+    return parse(text.data(), text.size());
+};
+
+dbs dbs::parse(const char* text, size_t size)
+{
+    // sorted input is added directly to the tree; the text is parsed 
+    // again if elements are not increasing
+    {
+        details::builder_sink sink;
+
+        if (details::parse_text(text, size, sink) == true)
+            return sink.finish();
+    };
+
+    details::vector_sink sink;
+    details::parse_text(text, size, sink);
+
+    return sink.finish();
+};
+
+}
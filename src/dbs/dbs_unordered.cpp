@@ -0,0 +1,72 @@
+/*
+*  This file is a part of DBS library.
+*
+*  Copyright (c) Pawe Kowal 2017 - 2021
+*
+*  This program is free software; you can redistribute it and/or modify
+*  it under the terms of the GNU General Public License as published by
+*  the Free Software Foundation; either version 2 of the License, or
+*  (at your option) any later version.
+*
+*  This program is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU General Public License for more details.
+*
+*  You should have received a copy of the GNU General Public License
+*  along with this program; if not, write to the Free Software
+*  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+*/
+
+#include "dbs/dbs_unordered.h"
+
+namespace dbs_lib
+{
+
+//-----------------------------------------------------------------
+//                      dbs_unordered_set
+//-----------------------------------------------------------------
+dbs_unordered_set::dbs_unordered_set()
+{};
+
+bool dbs_unordered_set::insert(const dbs& x)
+{
+    return m_table.emplace(x).second;
+};
+
+const dbs& dbs_unordered_set::intern(const dbs& x)
+{
+    return m_table.emplace(x).first->m_key;
+};
+
+bool dbs_unordered_set::contains(const dbs& x) const
+{
+    return m_table.find(x) != nullptr;
+};
+
+bool dbs_unordered_set::erase(const dbs& x)
+{
+    return m_table.erase(x);
+};
+
+size_t dbs_unordered_set::size() const
+{
+    return m_table.size();
+};
+
+bool dbs_unordered_set::empty() const
+{
+    return m_table.size() == 0;
+};
+
+void dbs_unordered_set::clear()
+{
+    m_table.clear();
+};
+
+void dbs_unordered_set::reserve(size_t n)
+{
+    m_table.reserve(n);
+};
+
+}
@@ -0,0 +1,868 @@
+/*
+*  This file is a part of DBS library.
+*
+*  Copyright (c) Pawe Kowal 2017 - 2021
+*
+*  This program is free software; you can redistribute it and/or modify
+*  it under the terms of the GNU General Public License as published by
+*  the Free Software Foundation; either version 2 of the License, or
+*  (at your option) any later version.
+*
+*  This program is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU General Public License for more details.
+*
+*  You should have received a copy of the GNU General Public License
+*  along with this program; if not, write to the Free Software
+*  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+*/
+
+#include "dbs/dbs_view.h"
+#include "dbs/dbs_serialize.h"
+#include "dbs/details/dbs_impl.h"
+#include "dbs/details/dbs_details.inl"
+
+#include <ostream>
+#include <cstring>
+#include <stdexcept>
+#include <stdint.h>
+
+#ifdef _WIN32
+    #ifndef NOMINMAX
+        #define NOMINMAX
+    #endif
+    #include <windows.h>
+#else
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <fcntl.h>
+    #include <unistd.h>
+#endif
+
+namespace dbs_lib { namespace details
+{
+
+//-----------------------------------------------------------------
+//                      frozen image
+//-----------------------------------------------------------------
+// image header: magic bytes, format version (2 bytes), number of bits in
+// a word and byte order
+static const unsigned char  frozen_magic[4]     = {'D', 'B', 'S', 'F'};
+static const size_t         frozen_version      = 1;
+static const size_t         frozen_header_bytes = 8;
+static const size_t         frozen_alignment    = 8;
+
+static const size_t         little_endian       = 1;
+static const size_t         big_endian          = 2;
+
+static size_t native_byte_order()
+{
+    uint16_t value  = 1;
+    unsigned char byte;
+    memcpy(&byte, &value, 1);
+
+    return (byte == 1) ? little_endian : big_endian;
+};
+
+// write children of the node x stored in the image at node_pos; children
+// arrays are stored in preorder
+static void freeze_children(const dbs_impl& x, size_t image, size_t node_pos,
+                            std::vector<unsigned char>& buffer)
+{
+    const block& data   = x.get_data();
+
+    if (data.get_level() == 0)
+        return;
+
+    size_t size         = block::count_bits(data.m_flags);
+    size_t array_pos    = buffer.size();
+
+    size_t offset       = array_pos - image;
+    memcpy(buffer.data() + node_pos + offsetof(frozen_block, m_data), &offset, sizeof(size_t));
+
+    buffer.resize(array_pos + size * sizeof(frozen_block));
+
+    const dbs_set* set  = data.get_fsb_set();
+
+    for (size_t i = 0; i < size; ++i)
+    {
+        const block& child      = set->get_elem(i).get_data();
+
+        frozen_block node;
+        node.m_level    = child.get_level();
+        node.m_flags    = child.m_flags;
+        node.m_data     = (node.m_level == 0) ? child.get_block_1() : 0;
+
+        memcpy(buffer.data() + array_pos + i * sizeof(frozen_block), &node, sizeof(frozen_block));
+    };
+
+    for (size_t i = 0; i < size; ++i)
+        freeze_children(set->get_elem(i), image, array_pos + i * sizeof(frozen_block), buffer);
+};
+
+//-----------------------------------------------------------------
+//                      view algorithms
+//-----------------------------------------------------------------
+// node of a view; m_block is null if the node does not exist
+struct view_node
+{
+    const dbs_view*     m_view;
+    const frozen_block* m_block;
+};
+
+static size_t leaf_first(size_t word_0, size_t word_1)
+{
+    using header_type   = block::header_type;
+
+    size_t pos_0    = (word_0 == 0) ? dbs::npos : 2 * header_type::least_significant_bit_pos(word_0);
+    size_t pos_1    = (word_1 == 0) ? dbs::npos : 2 * header_type::least_significant_bit_pos(word_1) + 1;
+
+    return std::min(pos_0, pos_1);
+};
+
+static size_t leaf_last(size_t word_0, size_t word_1)
+{
+    using header_type   = block::header_type;
+
+    size_t pos_0    = (word_0 == 0) ? 0 : 2 * header_type::most_significant_bit_pos(word_0);
+    size_t pos_1    = (word_1 == 0) ? 0 : 2 * header_type::most_significant_bit_pos(word_1) + 1;
+
+    return std::max(pos_0, pos_1);
+};
+
+// return index of the child stored at position pos of a node with given flags
+static size_t child_index(size_t flags, size_t pos)
+{
+    return block::count_bits(block::bits_before_pos(flags, pos));
+};
+
+// return mask of bits at positions not less than pos
+static size_t bits_from(size_t pos)
+{
+    return (pos >= size_t(block::block_bits)) ? 0 : (size_t(-1) << pos);
+};
+
+static size_t view_size(const dbs_view& view, const frozen_block* node)
+{
+    if (node->m_level == 0)
+        return block::count_bits(node->m_flags) + block::count_bits(node->m_data);
+
+    size_t size     = block::count_bits(node->m_flags);
+    size_t ret      = 0;
+
+    for (size_t i = 0; i < size; ++i)
+        ret         += view_size(view, view.child(node, i));
+
+    return ret;
+};
+
+static bool view_test(const dbs_view& view, const frozen_block* node, size_t n)
+{
+    for (;;)
+    {
+        if (node->m_level == 0)
+        {
+            if (n >= 2 * size_t(block::block_bits))
+                return false;
+
+            size_t word = (n % 2 == 0) ? node->m_flags : node->m_data;
+            return ((word >> (n / 2)) & 1) != 0;
+        };
+
+        size_t shift    = block::block_bits_log * node->m_level + 1;
+        size_t pos      = block::div_pow2(n, shift);
+
+        if (pos >= size_t(block::block_bits) || ((node->m_flags >> pos) & 1) == 0)
+            return false;
+
+        node            = view.child(node, child_index(node->m_flags, pos));
+        n               = block::mod_pow2(n, shift);
+    };
+};
+
+static size_t view_first(const dbs_view& view, const frozen_block* node)
+{
+    size_t offset       = 0;
+
+    while (node->m_level != 0)
+    {
+        size_t shift    = block::block_bits_log * node->m_level + 1;
+        size_t pos      = block::header_type::least_significant_bit_pos(node->m_flags);
+
+        offset          += pos << shift;
+        node            = view.child(node, 0);
+    };
+
+    return offset + leaf_first(node->m_flags, node->m_data);
+};
+
+static size_t view_last(const dbs_view& view, const frozen_block* node)
+{
+    size_t offset       = 0;
+
+    while (node->m_level != 0)
+    {
+        size_t shift    = block::block_bits_log * node->m_level + 1;
+        size_t pos      = block::header_type::most_significant_bit_pos(node->m_flags);
+
+        offset          += pos << shift;
+        node            = view.child(node, block::count_bits(node->m_flags) - 1);
+    };
+
+    return offset + leaf_last(node->m_flags, node->m_data);
+};
+
+// find the lowest element not less than n; return false if there is no
+// such element
+static bool view_find_next(const dbs_view& view, const frozen_block* node, size_t n, 
+                           size_t& result)
+{
+    if (node->m_level == 0)
+    {
+        if (n >= 2 * size_t(block::block_bits))
+            return false;
+
+        // element 2 * i is stored in the first word, 2 * i + 1 in the second
+        size_t word_0   = node->m_flags & bits_from((n + 1) / 2);
+        size_t word_1   = node->m_data & bits_from(n / 2);
+
+        if (word_0 == 0 && word_1 == 0)
+            return false;
+
+        result          = leaf_first(word_0, word_1);
+        return true;
+    };
+
+    size_t shift        = block::block_bits_log * node->m_level + 1;
+    size_t pos          = block::div_pow2(n, shift);
+
+    if (pos >= size_t(block::block_bits))
+        return false;
+
+    size_t flags        = node->m_flags;
+
+    if (((flags >> pos) & 1) != 0)
+    {
+        size_t k        = child_index(flags, pos);
+
+        if (view_find_next(view, view.child(node, k), block::mod_pow2(n, shift), result) == true)
+        {
+            result      += pos << shift;
+            return true;
+        };
+    };
+
+    size_t rest         = flags & bits_from(pos + 1);
+
+    if (rest == 0)
+        return false;
+
+    size_t next_pos     = block::header_type::least_significant_bit_pos(rest);
+    size_t k            = child_index(flags, next_pos);
+
+    result              = (next_pos << shift) + view_first(view, view.child(node, k));
+    return true;
+};
+
+// create a tree storing elements of a view node
+static dbs_impl materialize(const dbs_view& view, const frozen_block* node)
+{
+    if (node->m_level == 0)
+    {
+        dbs_impl ret;
+        ret.get_data().get_block_0()    = node->m_flags;
+        ret.get_data().get_block_1()    = node->m_data;
+
+        return ret;
+    };
+
+    size_t size         = block::count_bits(node->m_flags);
+
+    block::header_type h(static_cast<block::ushort_type>(node->m_level), 
+                         static_cast<block::ushort_type>(size));
+    dbs_impl ret(h, node->m_flags, dbs_set::create(size));
+
+    for (size_t i = 0; i < size; ++i)
+        ret.get_data().get_fsb_set()->init(i, materialize(view, view.child(node, i)));
+
+    return ret;
+};
+
+static dbs_impl materialize(const view_node& node)
+{
+    return materialize(*node.m_view, node.m_block);
+};
+
+static view_node view_child(const view_node& node, size_t k)
+{
+    return view_node{node.m_view, node.m_view->child(node.m_block, k)};
+};
+
+// build a node of given level from children stored at positions given by
+// flags; empty children are removed; the result is in the canonical form
+static dbs_impl assemble_node(size_t level, size_t flags, dbs_impl* children)
+{
+    using header_type   = block::header_type;
+
+    size_t ret_flags    = 0;
+    size_t size         = 0;
+
+    for (size_t k = 0; flags != 0; ++k, flags &= flags - 1)
+    {
+        if (children[k].any() == true)
+        {
+            ret_flags   |= size_t(1) << header_type::least_significant_bit_pos(flags);
+
+            if (size != k)
+                children[size]  = std::move(children[k]);
+
+            ++size;
+        };
+    };
+
+    if (size == 0)
+        return dbs_impl();
+
+    // a node with only the first child is replaced by the child
+    if (ret_flags == 1)
+        return std::move(children[0]);
+
+    block::header_type h(static_cast<block::ushort_type>(level), 
+                         static_cast<block::ushort_type>(size));
+    dbs_impl ret(h, ret_flags, dbs_set::create(size));
+
+    for (size_t i = 0; i < size; ++i)
+        ret.get_data().get_fsb_set()->init(i, std::move(children[i]));
+
+    return ret;
+};
+
+static dbs_impl view_binary(const view_node& x, const view_node& y, expr_code op)
+{
+    using header_type   = block::header_type;
+
+    if (x.m_block == nullptr && y.m_block == nullptr)
+        return dbs_impl();
+
+    if (y.m_block == nullptr)
+        return (op == expr_code::op_and) ? dbs_impl() : materialize(x);
+
+    if (x.m_block == nullptr)
+    {
+        if (op == expr_code::op_and || op == expr_code::op_diff)
+            return dbs_impl();
+        else
+            return materialize(y);
+    };
+
+    size_t level_x      = x.m_block->m_level;
+    size_t level_y      = y.m_block->m_level;
+
+    if (level_x == 0 && level_y == 0)
+    {
+        size_t words[2];
+
+        for (size_t i = 0; i < 2; ++i)
+        {
+            size_t word_x   = (i == 0) ? x.m_block->m_flags : x.m_block->m_data;
+            size_t word_y   = (i == 0) ? y.m_block->m_flags : y.m_block->m_data;
+
+            switch (op)
+            {
+                case expr_code::op_and:     words[i] = word_x & word_y; break;
+                case expr_code::op_or:      words[i] = word_x | word_y; break;
+                case expr_code::op_xor:     words[i] = word_x ^ word_y; break;
+                default:                    words[i] = word_x & ~word_y; break;
+            };
+        };
+
+        dbs_impl ret;
+        ret.get_data().get_block_0()    = words[0];
+        ret.get_data().get_block_1()    = words[1];
+
+        return ret;
+    };
+
+    dbs_impl children[block::block_bits];
+
+    if (level_x != level_y)
+    {
+        // the lower operand is a subtree of the first child of the higher one
+        bool x_high         = level_x > level_y;
+        const view_node& high   = x_high ? x : y;
+        const view_node& low    = x_high ? y : x;
+
+        size_t flags        = high.m_block->m_flags;
+        view_node high_0    = ((flags & 1) != 0) ? view_child(high, 0) : view_node{high.m_view, nullptr};
+
+        if (op == expr_code::op_and)
+            return x_high ? view_binary(high_0, low, op) : view_binary(low, high_0, op);
+
+        if (op == expr_code::op_diff && x_high == false)
+            return view_binary(low, high_0, op);
+
+        // children of the result are stored at positions given by flags | 1
+        size_t k            = 0;
+
+        for (size_t rest = flags | 1; rest != 0; rest &= rest - 1, ++k)
+        {
+            size_t pos      = header_type::least_significant_bit_pos(rest);
+
+            if (pos == 0)
+                children[k] = x_high ? view_binary(high_0, low, op) : view_binary(low, high_0, op);
+            else
+                children[k] = materialize(view_child(high, child_index(flags, pos)));
+        };
+
+        return assemble_node(high.m_block->m_level, flags | 1, children);
+    };
+
+    size_t flags_x      = x.m_block->m_flags;
+    size_t flags_y      = y.m_block->m_flags;
+    size_t flags;
+
+    switch (op)
+    {
+        case expr_code::op_and:     flags = flags_x & flags_y; break;
+        case expr_code::op_diff:    flags = flags_x; break;
+        default:                    flags = flags_x | flags_y; break;
+    };
+
+    size_t k            = 0;
+
+    for (size_t rest = flags; rest != 0; rest &= rest - 1, ++k)
+    {
+        size_t pos      = header_type::least_significant_bit_pos(rest);
+        size_t mask     = size_t(1) << pos;
+
+        view_node child_x   = {x.m_view, nullptr};
+        view_node child_y   = {y.m_view, nullptr};
+
+        if ((flags_x & mask) != 0)
+            child_x     = view_child(x, child_index(flags_x, pos));
+
+        if ((flags_y & mask) != 0)
+            child_y     = view_child(y, child_index(flags_y, pos));
+
+        children[k]     = view_binary(child_x, child_y, op);
+    };
+
+    return assemble_node(level_x, flags, children);
+};
+
+static dbs view_binary(const dbs_view& x, const dbs_view& y, expr_code op)
+{
+    return dbs(view_binary(view_node{&x, x.root()}, view_node{&y, y.root()}, op));
+};
+
+// check the node and its subtree; cursor is the expected position of the
+// next children array
+static bool view_validate(const unsigned char* image, size_t image_size, 
+                          const frozen_block* node, size_t parent_level, bool is_root,
+                          size_t& cursor)
+{
+    size_t level        = node->m_level;
+
+    if (level >= parent_level)
+        return false;
+
+    if (level == 0)
+        return is_root == true || node->m_flags != 0 || node->m_data != 0;
+
+    size_t flags        = node->m_flags;
+    size_t shift        = block::block_bits_log * level + 1;
+
+    // the node must be in the canonical form
+    if (flags <= 1)
+        return false;
+
+    // the highest node stores less than block_bits children
+    if (shift + block::block_bits_log > size_t(block::block_bits)
+            && (flags >> (size_t(1) << (block::block_bits - shift))) != 0)
+    {
+        return false;
+    };
+
+    size_t size         = block::count_bits(flags);
+
+    if (node->m_data != cursor || image_size < cursor 
+            || image_size - cursor < size * sizeof(frozen_block))
+    {
+        return false;
+    };
+
+    const frozen_block* children    = reinterpret_cast<const frozen_block*>(image + cursor);
+    cursor              += size * sizeof(frozen_block);
+
+    for (size_t i = 0; i < size; ++i)
+    {
+        if (view_validate(image, image_size, children + i, level, false, cursor) == false)
+            return false;
+    };
+
+    return true;
+};
+
+}};
+
+namespace dbs_lib
+{
+
+//-----------------------------------------------------------------
+//                      FROZEN IMAGE
+//-----------------------------------------------------------------
+size_t freeze(const dbs& x, std::vector<unsigned char>& buffer)
+{
+    using frozen_block  = details::frozen_block;
+
+    size_t image        = buffer.size();
+    image               = (image + details::frozen_alignment - 1) / details::frozen_alignment
+                        * details::frozen_alignment;
+
+    buffer.resize(image + details::frozen_header_bytes + sizeof(frozen_block), 0);
+
+    unsigned char* header   = buffer.data() + image;
+
+    memcpy(header, details::frozen_magic, 4);
+    header[4]           = static_cast<unsigned char>(details::frozen_version);
+    header[5]           = static_cast<unsigned char>(details::frozen_version >> 8);
+    header[6]           = static_cast<unsigned char>(details::block::block_bits);
+    header[7]           = static_cast<unsigned char>(details::native_byte_order());
+
+    const details::block& data  = x.get_data();
+
+    frozen_block root;
+    root.m_level        = data.get_level();
+    root.m_flags        = data.m_flags;
+    root.m_data         = (root.m_level == 0) ? data.get_block_1() : 0;
+
+    size_t root_pos     = image + details::frozen_header_bytes;
+    memcpy(buffer.data() + root_pos, &root, sizeof(frozen_block));
+
+    details::freeze_children(x, image, root_pos, buffer);
+    return image;
+};
+
+void freeze(const dbs& x, std::ostream& os)
+{
+    std::vector<unsigned char> buffer;
+    freeze(x, buffer);
+
+    os.write(reinterpret_cast<const char*>(buffer.data()), buffer.size());
+};
+
+//-----------------------------------------------------------------
+//                      dbs_view
+//-----------------------------------------------------------------
+dbs_view::dbs_view()
+    :m_image(nullptr), m_size(0), m_root(nullptr)
+{};
+
+dbs_view::dbs_view(const void* data, size_t size)
+    :m_image(static_cast<const unsigned char*>(data)), m_size(size), m_root(nullptr)
+{
+    if (reinterpret_cast<uintptr_t>(data) % sizeof(size_t) != 0)
+        throw serialization_error("dbs_view: frozen image is not aligned");
+
+    if (size < details::frozen_header_bytes + sizeof(frozen_block)
+            || memcmp(m_image, details::frozen_magic, 4) != 0)
+    {
+        throw serialization_error("dbs_view: invalid frozen image");
+    };
+
+    size_t version      = size_t(m_image[4]) + (size_t(m_image[5]) << 8);
+
+    if (version == 0 || version > details::frozen_version)
+        throw serialization_error("dbs_view: unsupported version of frozen image");
+
+    if (m_image[6] != details::block::block_bits || m_image[7] != details::native_byte_order())
+    {
+        throw serialization_error("dbs_view: frozen image was created with different word"
+                                  " size or byte order");
+    };
+
+    m_root              = reinterpret_cast<const frozen_block*>(m_image + details::frozen_header_bytes);
+};
+
+const details::frozen_block* dbs_view::root() const
+{
+    return m_root;
+};
+
+const details::frozen_block* dbs_view::child(const frozen_block* node, size_t k) const
+{
+    return reinterpret_cast<const frozen_block*>(m_image + node->m_data) + k;
+};
+
+size_t dbs_view::size() const
+{
+    if (m_root == nullptr)
+        return 0;
+
+    return details::view_size(*this, m_root);
+};
+
+bool dbs_view::any() const
+{
+    return m_root != nullptr && (m_root->m_flags != 0 || (m_root->m_level == 0 && m_root->m_data != 0));
+};
+
+bool dbs_view::none() const
+{
+    return any() == false;
+};
+
+bool dbs_view::test(size_t n) const
+{
+    if (m_root == nullptr)
+        return false;
+
+    return details::view_test(*this, m_root, n);
+};
+
+size_t dbs_view::first() const
+{
+    if (none() == true)
+        return npos;
+
+    return details::view_first(*this, m_root);
+};
+
+size_t dbs_view::last() const
+{
+    if (none() == true)
+        return npos;
+
+    return details::view_last(*this, m_root);
+};
+
+size_t dbs_view::next(size_t n) const
+{
+    size_t result;
+
+    if (n == npos || none() == true)
+        return npos;
+
+    if (details::view_find_next(*this, m_root, n + 1, result) == false)
+        return npos;
+
+    return result;
+};
+
+dbs_view::const_iterator dbs_view::begin() const
+{
+    return const_iterator(this, none());
+};
+
+dbs_view::const_iterator dbs_view::end() const
+{
+    return const_iterator(this, true);
+};
+
+dbs dbs_view::to_dbs() const
+{
+    if (m_root == nullptr)
+        return dbs();
+
+    return dbs(details::materialize(*this, m_root));
+};
+
+bool dbs_view::validate() const
+{
+    if (m_root == nullptr)
+        return true;
+
+    size_t cursor       = details::frozen_header_bytes + sizeof(frozen_block);
+
+    if (details::view_validate(m_image, m_size, m_root, details::block::max_level + 1, 
+                               true, cursor) == false)
+    {
+        return false;
+    };
+
+    // the whole image must be used
+    return cursor == m_size;
+};
+
+//-----------------------------------------------------------------
+//                      dbs_view_iterator
+//-----------------------------------------------------------------
+dbs_view_iterator::dbs_view_iterator()
+    :m_view(nullptr), m_value(0), m_last(0), m_end(true)
+{};
+
+dbs_view_iterator::dbs_view_iterator(const dbs_view* view, bool end)
+    :m_view(view), m_value(0), m_last(0), m_end(end)
+{
+    if (m_end == false)
+    {
+        m_value     = view->first();
+        m_last      = view->last();
+    };
+};
+
+dbs_view_iterator& dbs_view_iterator::operator++()
+{
+    if (m_value == m_last)
+        m_end       = true;
+    else
+        m_value     = m_view->next(m_value);
+
+    return *this;
+};
+
+dbs_view_iterator dbs_view_iterator::operator++(int)
+{
+    dbs_view_iterator ret   = *this;
+    ++(*this);
+
+    return ret;
+};
+
+bool dbs_view_iterator::operator==(const dbs_view_iterator& other) const
+{
+    if (m_end == true || other.m_end == true)
+        return m_end == other.m_end;
+
+    return m_value == other.m_value;
+};
+
+bool dbs_view_iterator::operator!=(const dbs_view_iterator& other) const
+{
+    return !(*this == other);
+};
+
+//-----------------------------------------------------------------
+//                      view operators
+//-----------------------------------------------------------------
+dbs operator&(const dbs_view& x, const dbs_view& y)
+{
+    return details::view_binary(x, y, details::expr_code::op_and);
+};
+
+dbs operator|(const dbs_view& x, const dbs_view& y)
+{
+    return details::view_binary(x, y, details::expr_code::op_or);
+};
+
+dbs operator^(const dbs_view& x, const dbs_view& y)
+{
+    return details::view_binary(x, y, details::expr_code::op_xor);
+};
+
+dbs operator-(const dbs_view& x, const dbs_view& y)
+{
+    return details::view_binary(x, y, details::expr_code::op_diff);
+};
+
+//-----------------------------------------------------------------
+//                      mapped_file
+//-----------------------------------------------------------------
+#ifdef _WIN32
+
+mapped_file::mapped_file(const std::string& path)
+    :m_data(nullptr), m_size(0), m_file(INVALID_HANDLE_VALUE), m_mapping(nullptr)
+{
+    m_file          = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+                                  OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+
+    if (m_file == INVALID_HANDLE_VALUE)
+        throw std::runtime_error("mapped_file: cannot open file " + path);
+
+    LARGE_INTEGER size;
+
+    if (GetFileSizeEx(m_file, &size) == FALSE)
+    {
+        CloseHandle(m_file);
+        throw std::runtime_error("mapped_file: cannot read size of file " + path);
+    };
+
+    m_size          = static_cast<size_t>(size.QuadPart);
+
+    if (m_size == 0)
+        return;
+
+    m_mapping       = CreateFileMappingA(m_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+
+    if (m_mapping != nullptr)
+        m_data      = MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0);
+
+    if (m_data == nullptr)
+    {
+        if (m_mapping != nullptr)
+            CloseHandle(m_mapping);
+
+        CloseHandle(m_file);
+        throw std::runtime_error("mapped_file: cannot map file " + path);
+    };
+};
+
+mapped_file::~mapped_file()
+{
+    if (m_data != nullptr)
+        UnmapViewOfFile(m_data);
+
+    if (m_mapping != nullptr)
+        CloseHandle(m_mapping);
+
+    if (m_file != INVALID_HANDLE_VALUE)
+        CloseHandle(m_file);
+};
+
+#else
+
+mapped_file::mapped_file(const std::string& path)
+    :m_data(nullptr), m_size(0), m_file(nullptr), m_mapping(nullptr)
+{
+    int fd          = open(path.c_str(), O_RDONLY);
+
+    if (fd < 0)
+        throw std::runtime_error("mapped_file: cannot open file " + path);
+
+    struct stat st;
+
+    if (fstat(fd, &st) != 0)
+    {
+        close(fd);
+        throw std::runtime_error("mapped_file: cannot read size of file " + path);
+    };
+
+    m_size          = static_cast<size_t>(st.st_size);
+
+    if (m_size > 0)
+    {
+        void* ptr   = mmap(nullptr, m_size, PROT_READ, MAP_SHARED, fd, 0);
+
+        if (ptr == MAP_FAILED)
+        {
+            close(fd);
+            throw std::runtime_error("mapped_file: cannot map file " + path);
+        };
+
+        m_data      = ptr;
+    };
+
+    // the mapping remains valid after the file is closed
+    close(fd);
+};
+
+mapped_file::~mapped_file()
+{
+    if (m_data != nullptr)
+        munmap(const_cast<void*>(m_data), m_size);
+};
+
+#endif
+
+const void* mapped_file::data() const
+{
+    return m_data;
+};
+
+size_t mapped_file::size() const
+{
+    return m_size;
+};
+
+}
@@ -23,9 +23,48 @@
 #ifdef _MSC_VER
     #define DBS_FORCE_INLINE __forceinline
 #else
-    #define DBS_FORCE_INLINE
+    #define DBS_FORCE_INLINE inline
 #endif
 
 // define this macro if popcnt instruction is available
 // (that calculates number of bits set)
 #define DBS_HAS_POPCNT
+
+// define this macro if tzcnt and lzcnt instructions are available
+// (BMI1 and ABM instruction sets), that calculate number of trailing and
+// leading zero bits
+#define DBS_HAS_BMI
+
+// define this macro if pdep instruction is available (BMI2 instruction set);
+// used for decoding leaf blocks
+#define DBS_HAS_BMI2
+
+// define this macro in order to make reference counts and the allocator of
+// tree nodes thread safe; required if bitsets sharing nodes are used from 
+// many threads; parallel set operators (see dbs_parallel.h) and dbs_atom
+// are available only if this macro is defined; atomic reference counting
+// makes copying of tree nodes about 2 times slower, therefore this macro is
+// not defined by default; the Test configuration of the solution defines
+// this macro
+//#define DBS_THREAD_SAFE
+
+// define this macro in order to count refcount operations (see function
+// refcount_operations); the library and all clients should be compiled
+// with the same definition of this macro; the Test configuration of the
+// solution defines this macro
+//#define DBS_REFCOUNT_STATS
+
+// define this macro in order to compile functions called by tests at chosen
+// points of concurrent operations (see details::atom_hook); the Test 
+// configuration of the solution defines this macro
+//#define DBS_TEST_HOOKS
+
+// three-way comparison operator is available (C++20)
+#if defined(__cpp_impl_three_way_comparison) && __cpp_impl_three_way_comparison >= 201907L
+    #define DBS_HAS_THREE_WAY_COMPARISON
+#endif
+
+// std::pmr::memory_resource is available (C++17)
+#if __cplusplus >= 201703L || (defined(_MSVC_LANG) && _MSVC_LANG >= 201703L)
+    #define DBS_HAS_PMR
+#endif
@@ -23,9 +23,16 @@
 #include "dbs/config.h"
 #include "dbs/details/dbs_details.h"
 #include "dbs/details/dbs_impl.h"
+#include "dbs/details/dbs_iterator.h"
 
 #include <vector>
 #include <iosfwd>
+#include <iterator>
+#include <string>
+
+#ifdef DBS_HAS_THREE_WAY_COMPARISON
+    #include <compare>
+#endif
 
 namespace dbs_lib
 {
@@ -45,6 +52,13 @@ class dbs : public details::dbs_impl
         // maximum value for size_t type
         static const size_t npos        = details::dbs_impl::npos;
 
+        // bidirectional iterator over elements in increasing order;
+        // elements cannot be modified through iterators
+        using const_iterator            = details::dbs_iterator;
+        using iterator                  = const_iterator;
+        using const_reverse_iterator    = std::reverse_iterator<const_iterator>;
+        using reverse_iterator          = const_reverse_iterator;
+
     public:
         // create empty bitset
         dbs();
@@ -60,16 +74,31 @@ class dbs : public details::dbs_impl
         // values in the elems array must be different and sorted increasingly
         dbs(std::initializer_list<size_t> elems);
 
+        // create bitset with count elements stored in the array elems in any
+        // order; values may be repeated; large inputs are sorted and the tree
+        // is built in parallel by threads set by set_parallel_threads (see
+        // dbs_parallel.h); temporary memory of count elements is required
+        static dbs          from_unsorted(size_t count, const size_t* elems);
+
+        // create bitset from text representation in any format written by
+        // write_text or operator<<; elements and ranges may be given in any
+        // order and may be repeated; sorted input is added directly to the
+        // tree, otherwise elements are collected and passed to from_unsorted;
+        // throw std::invalid_argument if the text is invalid or stores
+        // elements not representable by size_t
+        static dbs          parse(const std::string& text);
+        static dbs          parse(const char* text, size_t size);
+
         // standard copy and move constructors
         dbs(const dbs& copy);
-        dbs(dbs&& copy);
+        dbs(dbs&& copy) noexcept;
         
         // destructor
         ~dbs();
 
         // standard assignment and move assignment 
         dbs&	            operator=(const dbs& copy);
-        dbs&	            operator=(dbs&& copy);
+        dbs&	            operator=(dbs&& copy) noexcept;
 
     public:
         // return number of elements stored in the bitset
@@ -84,7 +113,12 @@ class dbs : public details::dbs_impl
         bool				none() const;
         
         // construct a new bitset containing bit n
-        dbs		            set(size_t n) const;
+        dbs		            set(size_t n) const &;
+
+        // construct a new bitset containing bit n; nodes of this bitset, that
+        // are not shared with other bitsets, give their children to the new
+        // bitset instead of copying them; this bitset is left empty
+        dbs		            set(size_t n) &&;
 
         // construct a new bitset not containing bit n
         dbs		            reset(size_t n) const;
@@ -103,6 +137,22 @@ class dbs : public details::dbs_impl
         // if this set is empty
         size_t              last() const;               
 
+        // return lowest index m > n, such that bit m is set or npos if
+        // there is no such index
+        size_t              next(size_t n) const;
+
+        // return highest index m < n, such that bit m is set or npos if
+        // there is no such index
+        size_t              prev(size_t n) const;
+
+        // return lowest index m > n, such that bit m is not set or npos if
+        // there is no such index
+        size_t              next_unset(size_t n) const;
+
+        // return highest index m < n, such that bit m is not set or npos
+        // if there is no such index
+        size_t              prev_unset(size_t n) const;
+
         // return true if this bitset contains at least one bit stored
         // in other bitset
         bool                test_any(const dbs& other) const;
@@ -114,61 +164,169 @@ class dbs : public details::dbs_impl
         // append indices of stored bits in this bitset to the vector elems
         void                get_elements(std::vector<size_t>& elems) const;
 
+        // write at most capacity elements to the buffer starting from the 
+        // element pointed by pos, advance pos past the last written element
+        // and return number of written elements; all elements can be obtained
+        // in chunks by calling this function with pos = begin() until 0 is
+        // returned
+        size_t              get_elements(const_iterator& pos, size_t* buffer, 
+                                size_t capacity) const;
+
+        // iterators over elements of this bitset in increasing order;
+        // iterators are valid as long as this bitset is not destroyed or
+        // assigned to
+        const_iterator      begin() const;
+        const_iterator      end() const;
+
+        // iterators over elements of this bitset in decreasing order
+        const_reverse_iterator  rbegin() const;
+        const_reverse_iterator  rend() const;
+
+        // return iterator pointing to the lowest element not less than n
+        // or end() if there is no such element
+        const_iterator      lower_bound(size_t n) const;
+
+        // call f(offset, word) for every nonzero word of bits in increasing
+        // order, where bit i of the word represents element offset + i and
+        // offset is a multiple of dbs::block_bits (number of bits in size_t);
+        // empty regions are skipped; if f returns bool, then returning false
+        // stops the traversal; return false if the traversal was stopped
+        template<class Func>
+        bool                for_each_word(Func&& f) const;
+
+        // call f(offset, word_0, word_1) for every nonempty block of 
+        // 2 * block_bits elements in increasing order, where bit i of word_0
+        // represents element offset + i and bit i of word_1 represents
+        // element offset + block_bits + i; stopping rules are the same as
+        // in for_each_word
+        template<class Func>
+        bool                for_each_block(Func&& f) const;
+
     public:
         // internal use only
         explicit dbs(const details::dbs_impl& impl);
-        explicit dbs(details::dbs_impl&& impl);
+        explicit dbs(details::dbs_impl&& impl) noexcept;
 };
 
-// return a new bitset that is the bitwise-AND of the bitsets x and y
-dbs         operator&(const dbs& x, const dbs& y);
-
-// return a new bitset that is the bitwise-OR of the bitsets x and y
-dbs         operator|(const dbs& x, const dbs& y);
+// set operators &, |, ^ and - return lazy expressions, that are
+// evaluated when converted to dbs; see dbs_expr.h
 
-// return a new bitset that is the bitwise-XOR of the bitsets x and y
-dbs         operator^(const dbs& x, const dbs& y);
-
-// calculate hash function of a bitset x
+// calculate hash function of a bitset x; hashes of subtrees are cached in
+// tree nodes and updated when nodes are created, therefore the cost is O(1)
 size_t      hash_value(const dbs& x);
 
-// return true if two bitsets contain the same elements
+// return true if two bitsets contain the same elements; bitsets with
+// different hashes are rejected in O(1)
 bool        operator==(const dbs& x, const dbs& y);
 
 // return true if two bitsets are different in at least one bit
 bool        operator!=(const dbs& x, const dbs& y);
 
-// return true if bitset x is lexicographically less than y
+// relational operators order bitsets as compare_elements
+
+// return true if bitset x is less than y
 bool        operator<(const dbs& x, const dbs& y);
 
-// return true if bitset x is lexicographically less than y or
-// equal to y
+// return true if bitset x is less than y or equal to y
 bool        operator<=(const dbs& x, const dbs& y);
 
-// return true if bitset x is lexicographically greater than y
-// or equal to y
+// return true if bitset x is greater than y
 bool        operator>(const dbs& x, const dbs& y);
 
-// return true if bitset x is lexicographically greater than y
+// return true if bitset x is greater than y or equal to y
 bool        operator>=(const dbs& x, const dbs& y);
 
-// result of compare function
+#ifdef DBS_HAS_THREE_WAY_COMPARISON
+    // three-way comparison consistent with relational operators
+    std::strong_ordering operator<=>(const dbs& x, const dbs& y);
+#endif
+
+// result of compare functions
 enum class order_type
 {
-    // first bitset is lexicographically less than the second
+    // first bitset is less than the second
     less, 
 
     // two bitsets are equal
     equal, 
 
-    // first bitset is lexicographically greater than the second
+    // first bitset is greater than the second
     greater
 };
 
-// compare two bitsets
+// compare two bitsets by their sequences of elements in increasing order
+// using lexicographic order, e.g. {1, 5} < {1, 5, 7} < {1, 6} < {2}; both
+// trees are traversed in one synchronized walk, that stops at the first
+// different word and skips shared subtrees; elements are not extracted
+order_type  compare_elements(const dbs& x, const dbs& y);
+
+// compare two bitsets using order of internal representation; this order
+// is consistent with equality but does not agree with order of elements
 order_type  compare(const dbs& x, const dbs& y);
 
-// print content of a bitset
+// print content of a bitset; equivalent to write_text with the list format
 std::ostream&   operator<<(std::ostream& os, const dbs& x);
 
-}
\ No newline at end of file
+// format of text representation of a bitset
+enum class text_format
+{
+    // all elements in increasing order, e.g. {1, 5, 6, 7}
+    list,
+
+    // runs of at least two consecutive elements are written as first-last,
+    // e.g. {1, 5-7}
+    ranges,
+
+    // nonzero 64-bit words written in hex, where bit i of a word following
+    // offset: represents element offset + i; words at consecutive offsets
+    // are separated by spaces, e.g. x{0:e2 1, 1c0:ffff} represents elements
+    // 1, 5, 6, 7, 64, 448, ..., 463
+    hex
+};
+
+// write text representation of a bitset to the stream os; elements are 
+// not extracted to a temporary array
+void            write_text(std::ostream& os, const dbs& x, 
+                    text_format format = text_format::ranges);
+
+// return text representation of a bitset
+std::string     to_string(const dbs& x, text_format format = text_format::ranges);
+
+// policy of releasing memory of bitsets, that are no longer referenced
+enum class reclamation_mode
+{
+    // memory is released immediately when the last reference is dropped
+    immediate,
+
+    // unreferenced tree nodes are put on a queue and released later
+    // by calls to reclaim
+    deferred
+};
+
+// set reclamation mode; when switching to the immediate mode all nodes
+// waiting in the reclamation queue are released
+void                set_reclamation_mode(reclamation_mode mode);
+
+// return current reclamation mode
+reclamation_mode    get_reclamation_mode();
+
+// release at most max_nodes tree nodes from the reclamation queue; nodes, 
+// that become unreferenced, are added to the queue; return number of
+// released nodes
+size_t              reclaim(size_t max_nodes = dbs::npos);
+
+// return number of tree nodes waiting in the reclamation queue
+size_t              reclamation_queue_size();
+
+// return number of tree nodes currently allocated
+size_t              allocated_nodes();
+
+// return number of refcount operations performed so far; refcount operations
+// are counted only if DBS_REFCOUNT_STATS macro is defined (see config.h),
+// otherwise 0 is returned
+size_t              refcount_operations();
+
+}
+
+#include "dbs/dbs_expr.h"
+#include "dbs/details/dbs_visitor.inl"
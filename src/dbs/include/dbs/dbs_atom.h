@@ -0,0 +1,144 @@
+/*
+*  This file is a part of DBS library.
+*
+*  Copyright (c) Pawe Kowal 2017 - 2021
+*
+*  This program is free software; you can redistribute it and/or modify
+*  it under the terms of the GNU General Public License as published by
+*  the Free Software Foundation; either version 2 of the License, or
+*  (at your option) any later version.
+*
+*  This program is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU General Public License for more details.
+*
+*  You should have received a copy of the GNU General Public License
+*  along with this program; if not, write to the Free Software
+*  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+*/
+
+#pragma once
+
+#include "dbs/dbs.h"
+
+#include <atomic>
+#include <stdint.h>
+
+#ifdef DBS_THREAD_SAFE
+
+namespace dbs_lib
+{
+
+namespace details
+{
+    struct atom_node;
+
+    // points of operations on dbs_atom, at which atom_hook is called
+    enum class atom_event
+    {
+        // a reader holds the current node
+        acquired,
+
+        // a writer replaced the current node, but did not retire it yet
+        replaced,
+    };
+
+    #ifdef DBS_TEST_HOOKS
+        // function called at given points of operations on dbs_atom if not 
+        // null; used by tests in order to interleave threads
+        extern void (*atom_hook)(atom_event);
+    #endif
+};
+
+// Variable storing a bitset, that can be accessed concurrently by many
+// threads without locking. Readers take snapshots of the current value,
+// writers compute a new value and install it. Since bitsets are immutable,
+// a snapshot remains valid after the value is replaced.
+//
+// Values are stored in separately allocated nodes. Number of readers 
+// accessing the current node is stored together with pointer to the node
+// in one word (split reference count); when the node is replaced, this
+// number is moved to the node, which is released by the last reader.
+//
+// dbs_atom is available only if DBS_THREAD_SAFE macro is defined (see
+// config.h).
+class dbs_atom
+{
+    private:
+        using word_type     = uint64_t;
+
+    private:
+        // low bits store pointer to atom_node holding the current value,
+        // high bits store number of readers accessing the node
+        mutable std::atomic<word_type>  m_word;
+
+    public:
+        // create variable storing empty set
+        dbs_atom();
+
+        // create variable storing the bitset value
+        explicit dbs_atom(const dbs& value);
+
+        // destructor; the variable cannot be accessed concurrently
+        ~dbs_atom();
+
+        dbs_atom(const dbs_atom&) = delete;
+        dbs_atom& operator=(const dbs_atom&) = delete;
+
+    public:
+        // return snapshot of the current value
+        dbs                 load() const;
+
+        // replace the current value
+        void                store(const dbs& value);
+
+        // replace the current value and return the previous one
+        dbs                 exchange(const dbs& value);
+
+        // replace the current value by desired if the current value is
+        // represented by the same tree as expected, which holds if expected
+        // was returned by this variable and the value was not replaced
+        // since (small sets stored without tree nodes are compared by
+        // value); otherwise store the current value in expected; return
+        // true if the value was replaced
+        bool                compare_exchange(dbs& expected, const dbs& desired);
+
+        // replace the current value x by f(x) using compare_exchange in
+        // a loop; f can be called many times and should not have side 
+        // effects; return the stored value
+        template<class Func>
+        dbs                 update(Func&& f);
+
+        // return true if operations on this variable are lock free, 
+        // excluding allocation of nodes
+        bool                is_lock_free() const;
+
+    private:
+        // increase number of readers of the current node and return it
+        details::atom_node* acquire() const;
+
+        // decrease number of readers of a node returned by acquire
+        void                release(details::atom_node* node) const;
+
+        // install a new node storing value; return previous word
+        word_type           install(const dbs& value);
+};
+
+template<class Func>
+dbs dbs_atom::update(Func&& f)
+{
+    dbs current     = load();
+
+    for (;;)
+    {
+        dbs next    = f(static_cast<const dbs&>(current));
+
+        if (compare_exchange(current, next) == true)
+            return next;
+    };
+};
+
+}
+
+#endif
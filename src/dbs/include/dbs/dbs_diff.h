@@ -0,0 +1,83 @@
+/*
+*  This file is a part of DBS library.
+*
+*  Copyright (c) Pawe Kowal 2017 - 2021
+*
+*  This program is free software; you can redistribute it and/or modify
+*  it under the terms of the GNU General Public License as published by
+*  the Free Software Foundation; either version 2 of the License, or
+*  (at your option) any later version.
+*
+*  This program is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU General Public License for more details.
+*
+*  You should have received a copy of the GNU General Public License
+*  along with this program; if not, write to the Free Software
+*  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+*/
+
+#pragma once
+
+#include "dbs/dbs.h"
+
+namespace dbs_lib
+{
+
+// Difference between two versions of a bitset. Both versions are traversed
+// in one synchronized walk, that skips subtrees shared by pointer; since
+// a modified bitset shares all unchanged subtrees with the original one,
+// the cost is proportional to the number of nodes on paths to modified
+// elements, not to the size of the bitsets. Subtrees present in only one
+// version are shared by the patch, not copied.
+
+// elements added and removed between two versions of a bitset
+class dbs_patch
+{
+    private:
+        dbs                 m_added;
+        dbs                 m_removed;
+
+    public:
+        // create empty patch
+        dbs_patch();
+
+        // create patch adding elements added and removing elements removed;
+        // sets added and removed should be disjoint
+        dbs_patch(const dbs& added, const dbs& removed);
+
+    public:
+        // elements added by the patch
+        const dbs&          added() const;
+
+        // elements removed by the patch
+        const dbs&          removed() const;
+
+        // return true if the patch does not change any element
+        bool                empty() const;
+
+        // return the patch reverting changes made by this patch
+        dbs_patch           inverse() const;
+};
+
+// return the patch transforming old_set into new_set
+dbs_patch   diff(const dbs& old_set, const dbs& new_set);
+
+// apply the patch to the bitset x; all changes are applied in one traversal
+// of x, that shares all unchanged subtrees; apply_patch(old_set,
+// diff(old_set, new_set)) is equal to new_set
+dbs         apply_patch(const dbs& x, const dbs_patch& patch);
+
+// call f(offset, added, removed) for every word of bits, in which old_set
+// and new_set differ, in increasing order, where bit i of the word added
+// (removed) is set if element offset + i is stored in new_set but not in
+// old_set (in old_set but not in new_set) and offset is a multiple of
+// dbs::block_bits; subtrees shared by both versions are skipped; stopping
+// rules are the same as in dbs::for_each_word
+template<class Func>
+bool        for_each_change(const dbs& old_set, const dbs& new_set, Func&& f);
+
+}
+
+#include "dbs/details/dbs_diff.inl"
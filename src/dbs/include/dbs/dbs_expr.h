@@ -0,0 +1,235 @@
+/*
+*  This file is a part of DBS library.
+*
+*  Copyright (c) Pawe Kowal 2017 - 2021
+*
+*  This program is free software; you can redistribute it and/or modify
+*  it under the terms of the GNU General Public License as published by
+*  the Free Software Foundation; either version 2 of the License, or
+*  (at your option) any later version.
+*
+*  This program is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU General Public License for more details.
+*
+*  You should have received a copy of the GNU General Public License
+*  along with this program; if not, write to the Free Software
+*  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+*/
+
+#pragma once
+
+#include "dbs/dbs.h"
+
+#include <type_traits>
+#include <utility>
+
+namespace dbs_lib { namespace details
+{
+
+// operations in an expression
+enum class expr_code
+{
+    op_and, op_or, op_xor, op_diff
+};
+
+// result of an expression at given position in the tree
+struct expr_shape
+{
+    enum kind_type
+    {
+        // result is empty
+        empty,
+
+        // result is equal to the subtree m_node of one of operands
+        node,
+
+        // result must be evaluated
+        mixed
+    };
+
+    kind_type           m_kind;
+    const dbs_impl*     m_node;
+};
+
+template<class Expr>
+class expr_evaluator;
+
+// base class of all expressions
+struct expr_tag
+{};
+
+}};
+
+namespace dbs_lib
+{
+
+// lazy expression on bitsets; an expression is evaluated in one traversal
+// of all operands, that does not create intermediate bitsets, when it is
+// converted to dbs or when eval, count, any or none is called; expressions
+// store references to bitsets, that are lvalues, therefore these bitsets
+// must be alive when the expression is evaluated
+template<class Derived>
+class dbs_expr : public details::expr_tag
+{
+    public:
+        // evaluate the expression
+        dbs                 eval() const;
+        operator dbs() const                    { return eval(); };
+
+        // return number of elements in the result of the expression; the
+        // result is not constructed
+        size_t              count() const;
+
+        // return true if the result of the expression is not empty; the
+        // result is not constructed
+        bool                any() const;
+
+        // return true if the result of the expression is empty; the
+        // result is not constructed
+        bool                none() const        { return any() == false; };
+};
+
+}
+
+namespace dbs_lib { namespace details
+{
+
+// bitset stored in an expression by reference
+class expr_ref : public dbs_expr<expr_ref>
+{
+    public:
+        static const size_t n_leaves    = 1;
+
+    private:
+        const dbs*          m_set;
+
+    public:
+        explicit expr_ref(const dbs& set)   : m_set(&set) {};
+
+        void                get_leaves(const dbs_impl** leaves) const   { leaves[0] = m_set; };
+};
+
+// bitset stored in an expression by value
+class expr_value : public dbs_expr<expr_value>
+{
+    public:
+        static const size_t n_leaves    = 1;
+
+    private:
+        dbs                 m_set;
+
+    public:
+        explicit expr_value(const dbs& set) : m_set(set) {};
+        explicit expr_value(dbs&& set)      : m_set(std::move(set)) {};
+
+        void                get_leaves(const dbs_impl** leaves) const   { leaves[0] = &m_set; };
+};
+
+// binary operation
+template<expr_code Op, class Left, class Right>
+class expr_binary : public dbs_expr<expr_binary<Op, Left, Right>>
+{
+    public:
+        static const size_t n_leaves    = Left::n_leaves + Right::n_leaves;
+
+        using left_type     = Left;
+        using right_type    = Right;
+
+    private:
+        Left                m_left;
+        Right               m_right;
+
+    public:
+        expr_binary(Left&& left, Right&& right)
+            : m_left(std::move(left)), m_right(std::move(right))
+        {};
+
+        void get_leaves(const dbs_impl** leaves) const
+        {
+            m_left.get_leaves(leaves);
+            m_right.get_leaves(leaves + Left::n_leaves);
+        };
+};
+
+// conversion of operands of set operators to expressions; lvalue bitsets
+// are stored by reference, temporary bitsets are stored by value and
+// expressions are copied
+template<class T, 
+    bool Is_dbs     = std::is_same<typename std::decay<T>::type, dbs>::value,
+    bool Is_expr    = std::is_base_of<expr_tag, typename std::decay<T>::type>::value>
+struct make_expr
+{};
+
+template<class T>
+struct make_expr<T, true, false>
+{
+    using type  = typename std::conditional<std::is_lvalue_reference<T>::value, 
+                    expr_ref, expr_value>::type;
+
+    static type make(T&& x)     { return type(std::forward<T>(x)); };
+};
+
+template<class T>
+struct make_expr<T, false, true>
+{
+    using type  = typename std::decay<T>::type;
+
+    static type make(T&& x)     { return type(std::forward<T>(x)); };
+};
+
+template<expr_code Op, class L, class R>
+using make_binary   = expr_binary<Op, typename make_expr<L>::type, typename make_expr<R>::type>;
+
+template<expr_code Op, class L, class R>
+make_binary<Op, L, R> make_binary_expr(L&& x, R&& y)
+{
+    return make_binary<Op, L, R>(make_expr<L>::make(std::forward<L>(x)), 
+                                 make_expr<R>::make(std::forward<R>(y)));
+};
+
+}};
+
+namespace dbs_lib
+{
+
+// return an expression representing bitwise-AND of the bitsets or
+// expressions x and y
+template<class L, class R>
+details::make_binary<details::expr_code::op_and, L, R>
+operator&(L&& x, R&& y)
+{
+    return details::make_binary_expr<details::expr_code::op_and>(std::forward<L>(x), std::forward<R>(y));
+};
+
+// return an expression representing bitwise-OR of the bitsets or
+// expressions x and y
+template<class L, class R>
+details::make_binary<details::expr_code::op_or, L, R>
+operator|(L&& x, R&& y)
+{
+    return details::make_binary_expr<details::expr_code::op_or>(std::forward<L>(x), std::forward<R>(y));
+};
+
+// return an expression representing bitwise-XOR of the bitsets or
+// expressions x and y
+template<class L, class R>
+details::make_binary<details::expr_code::op_xor, L, R>
+operator^(L&& x, R&& y)
+{
+    return details::make_binary_expr<details::expr_code::op_xor>(std::forward<L>(x), std::forward<R>(y));
+};
+
+// return an expression representing difference of the bitsets or
+// expressions x and y, i.e. elements of x, that are not in y
+template<class L, class R>
+details::make_binary<details::expr_code::op_diff, L, R>
+operator-(L&& x, R&& y)
+{
+    return details::make_binary_expr<details::expr_code::op_diff>(std::forward<L>(x), std::forward<R>(y));
+};
+
+}
+
+#include "dbs/details/dbs_expr.inl"
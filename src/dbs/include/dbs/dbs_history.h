@@ -0,0 +1,117 @@
+/*
+*  This file is a part of DBS library.
+*
+*  Copyright (c) Pawe Kowal 2017 - 2021
+*
+*  This program is free software; you can redistribute it and/or modify
+*  it under the terms of the GNU General Public License as published by
+*  the Free Software Foundation; either version 2 of the License, or
+*  (at your option) any later version.
+*
+*  This program is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU General Public License for more details.
+*
+*  You should have received a copy of the GNU General Public License
+*  along with this program; if not, write to the Free Software
+*  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+*/
+
+#pragma once
+
+#include "dbs/dbs.h"
+
+#include <deque>
+#include <mutex>
+
+namespace dbs_lib
+{
+
+// memory used by tree nodes of versions stored in a history
+struct history_memory
+{
+    // number of tree nodes and their size in bytes; nodes shared by many
+    // versions are counted once
+    size_t      m_nodes;
+    size_t      m_bytes;
+
+    // number of tree nodes and their size in bytes if versions did not 
+    // share nodes
+    size_t      m_unshared_nodes;
+    size_t      m_unshared_bytes;
+};
+
+// Sequence of versions of a bitset. Versions are numbered 0, 1, ... in
+// order of commits. Since a modified bitset shares all unchanged subtrees
+// with the original one, storing a new version costs only nodes on paths
+// to modified elements.
+//
+// Old versions are released according to the retention policy: at most
+// max_versions last versions are kept (all versions if max_versions is 0);
+// older versions can also be released explicitly. A snapshot returned by
+// get remains valid after its version is released.
+//
+// All functions can be called concurrently, if DBS_THREAD_SAFE macro is
+// defined.
+class dbs_history
+{
+    private:
+        mutable std::mutex  m_mutex;
+
+        // versions m_first, ..., m_first + m_versions.size() - 1
+        std::deque<dbs>     m_versions;
+        size_t              m_first;
+        size_t              m_max_versions;
+
+    public:
+        // create empty history keeping at most max_versions last versions
+        // or all versions if max_versions is 0
+        explicit dbs_history(size_t max_versions = 0);
+
+        dbs_history(const dbs_history&) = delete;
+        dbs_history& operator=(const dbs_history&) = delete;
+
+    public:
+        // add a new version and return its number; old versions are
+        // released according to the retention policy
+        size_t              commit(const dbs& value);
+
+        // return version with given number; throw std::out_of_range if the
+        // version was released or does not exist
+        dbs                 get(size_t version) const;
+
+        // return the last version or empty set if there are no versions
+        dbs                 current() const;
+
+        // return true if the version with given number is stored
+        bool                contains(size_t version) const;
+
+        // return number of the oldest stored version
+        size_t              first_version() const;
+
+        // return number of the next version to be committed
+        size_t              next_version() const;
+
+        // return number of stored versions
+        size_t              size() const;
+
+        // set maximum number of stored versions; 0 means no limit; old
+        // versions are released if necessary
+        void                set_max_versions(size_t max_versions);
+
+        // return maximum number of stored versions
+        size_t              get_max_versions() const;
+
+        // release all versions older than version
+        void                release_before(size_t version);
+
+        // return memory used by tree nodes of stored versions
+        history_memory      memory() const;
+
+    private:
+        // release versions exceeding the limit; m_mutex must be held
+        void                apply_retention();
+};
+
+}
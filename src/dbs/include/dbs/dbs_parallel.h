@@ -0,0 +1,109 @@
+/*
+*  This file is a part of DBS library.
+*
+*  Copyright (c) Pawe Kowal 2017 - 2021
+*
+*  This program is free software; you can redistribute it and/or modify
+*  it under the terms of the GNU General Public License as published by
+*  the Free Software Foundation; either version 2 of the License, or
+*  (at your option) any later version.
+*
+*  This program is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU General Public License for more details.
+*
+*  You should have received a copy of the GNU General Public License
+*  along with this program; if not, write to the Free Software
+*  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+*/
+
+#pragma once
+
+#include "dbs/dbs.h"
+
+#include <functional>
+
+namespace dbs_lib
+{
+
+// Parallel algorithms split a bitset into independent subtrees at the top
+// levels of the tree and process them on a pool of threads. The calling
+// thread takes part in the computation; parallel algorithms called from 
+// a thread of the pool are executed sequentially.
+
+// set number of threads used by parallel algorithms (including the calling
+// thread); n = 0 restores the default value, which is equal to the number
+// of hardware threads
+void        set_parallel_threads(size_t n);
+
+// return number of threads used by parallel algorithms
+size_t      get_parallel_threads();
+
+// return number of elements stored in the bitset x
+size_t      parallel_size(const dbs& x);
+
+// append elements of the bitset x to the vector elems in increasing order
+void        parallel_get_elements(const dbs& x, std::vector<size_t>& elems);
+
+// call f(elem) for every element of the bitset x; f is called concurrently
+// from many threads, but elements of one subtree are passed in increasing
+// order by the same thread
+template<class Func>
+void        parallel_for_each(const dbs& x, Func&& f);
+
+// return x & y, x | y and x ^ y respectively; for large operands pairs of 
+// subtrees are processed in parallel and the result is assembled from
+// partial results; available only if DBS_THREAD_SAFE is defined
+#ifdef DBS_THREAD_SAFE
+    dbs     parallel_and(const dbs& x, const dbs& y);
+    dbs     parallel_or(const dbs& x, const dbs& y);
+    dbs     parallel_xor(const dbs& x, const dbs& y);
+#endif
+
+}
+
+namespace dbs_lib { namespace details
+{
+
+// call f(node, offset) concurrently for every subtree node of the root, 
+// which stores elements increased by offset
+void        parallel_visit(const dbs_impl& root, 
+                const std::function<void (const dbs_impl&, size_t)>& f);
+
+}};
+
+namespace dbs_lib
+{
+
+template<class Func>
+void parallel_for_each(const dbs& x, Func&& f)
+{
+    static const size_t block_bits  = details::block::block_bits;
+
+    auto visit_leaf = [&f](size_t offset, size_t word_0, size_t word_1)
+    {
+        size_t words[2]     = {word_0, word_1};
+
+        for (size_t k = 0; k < 2; ++k)
+        {
+            size_t bits     = words[k];
+
+            while (bits != 0)
+            {
+                size_t pos  = details::block::header_type::least_significant_bit_pos(bits);
+                f(offset + k * block_bits + pos);
+                bits        = bits & (bits - 1);
+            };
+        };
+    };
+
+    auto visit_subtree = [&visit_leaf](const details::dbs_impl& node, size_t offset)
+    {
+        details::visit_blocks(node, offset, visit_leaf);
+    };
+
+    details::parallel_visit(x, visit_subtree);
+};
+
+}
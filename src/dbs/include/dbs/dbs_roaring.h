@@ -0,0 +1,59 @@
+/*
+*  This file is a part of DBS library.
+*
+*  Copyright (c) Pawe Kowal 2017 - 2021
+*
+*  This program is free software; you can redistribute it and/or modify
+*  it under the terms of the GNU General Public License as published by
+*  the Free Software Foundation; either version 2 of the License, or
+*  (at your option) any later version.
+*
+*  This program is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU General Public License for more details.
+*
+*  You should have received a copy of the GNU General Public License
+*  along with this program; if not, write to the Free Software
+*  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+*/
+
+#pragma once
+
+#include "dbs/dbs.h"
+
+#include <vector>
+
+namespace dbs_lib
+{
+
+// Conversion between bitsets and the portable serialization format of
+// Roaring bitmaps. A Roaring bitmap splits 32-bit values into containers
+// of 2^16 values keyed by the high 16 bits; a container stores sorted
+// values (array container), 2^16 bits (bitmap container) or sorted runs 
+// of consecutive values (run container). The 64-bit extension stores
+// the number of 32-bit bitmaps followed by the high 32 bits and the image
+// of every 32-bit bitmap. Containers are created from words of bitsets 
+// and are loaded as blocks of bits, elements are not extracted one by one.
+// Exported containers have the smallest of the three representations.
+
+// append portable Roaring image of the bitset x to the buffer; throw
+// std::invalid_argument if x stores elements greater than 2^32 - 1
+void        to_roaring(const dbs& x, std::vector<unsigned char>& buffer);
+
+// append portable image of the bitset x in the 64-bit extension of the
+// Roaring format to the buffer
+void        to_roaring64(const dbs& x, std::vector<unsigned char>& buffer);
+
+// read bitset from portable Roaring image stored in the buffer data of
+// given size; if read is not null, then number of bytes of the image is 
+// stored in read; throw serialization_error (see dbs_serialize.h) if the
+// image is invalid or truncated
+dbs         from_roaring(const unsigned char* data, size_t size, size_t* read = nullptr);
+
+// read bitset from portable image in the 64-bit extension of the Roaring
+// format; errors are reported as in from_roaring; serialization_error is
+// also thrown if the image stores elements not representable by size_t
+dbs         from_roaring64(const unsigned char* data, size_t size, size_t* read = nullptr);
+
+}
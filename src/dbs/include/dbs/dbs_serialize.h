@@ -0,0 +1,94 @@
+/*
+*  This file is a part of DBS library.
+*
+*  Copyright (c) Pawe Kowal 2017 - 2021
+*
+*  This program is free software; you can redistribute it and/or modify
+*  it under the terms of the GNU General Public License as published by
+*  the Free Software Foundation; either version 2 of the License, or
+*  (at your option) any later version.
+*
+*  This program is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU General Public License for more details.
+*
+*  You should have received a copy of the GNU General Public License
+*  along with this program; if not, write to the Free Software
+*  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+*/
+
+#pragma once
+
+#include "dbs/dbs.h"
+
+#include <vector>
+#include <iosfwd>
+#include <stdexcept>
+#include <string>
+
+namespace dbs_lib
+{
+
+// Binary image of a bitset stores the tree in preorder: level of every
+// node followed by two words of a leaf or flags of an internal node and 
+// images of its children. Integers are stored in little endian order. 
+// The header of an image contains format version and number of bits in
+// words of the tree (32 or 64). An image created in a build with the same
+// word size is loaded by direct reconstruction of tree nodes; otherwise
+// elements are decoded in increasing order and the tree is rebuilt with
+// dbs_stream_builder.
+
+// error reported when a binary image of a bitset is invalid
+class serialization_error : public std::runtime_error
+{
+    public:
+        explicit serialization_error(const std::string& msg);
+};
+
+// current version of the binary image format
+static const unsigned   serialization_version   = 1;
+
+// write binary image of the bitset x to the stream os
+void        serialize(const dbs& x, std::ostream& os);
+
+// append binary image of the bitset x to the buffer
+void        serialize(const dbs& x, std::vector<unsigned char>& buffer);
+
+// read bitset from binary image stored in the stream is; the stream is
+// positioned after the image; throw serialization_error if the image is
+// invalid or truncated or stores elements not representable by size_t
+dbs         deserialize(std::istream& is);
+
+// read bitset from binary image stored in the buffer data of given size;
+// if read is not null, then number of bytes of the image is stored in 
+// read; errors are reported as in deserialize(std::istream&)
+dbs         deserialize(const unsigned char* data, size_t size, size_t* read = nullptr);
+
+// Binary image of a collection of bitsets stores every internal tree node
+// once, even if it is shared by many bitsets or by many places in one
+// bitset; loaded bitsets share nodes in the same way. Nodes are identified
+// by address, therefore equal subtrees created independently are stored 
+// separately. Internal nodes are stored in postorder, children refer to 
+// earlier nodes by index; leaves are stored in parent nodes. Collection 
+// images can be loaded only by builds with the same word size.
+
+// write binary image of the collection of bitsets sets to the stream os
+void        serialize_collection(const std::vector<dbs>& sets, std::ostream& os);
+
+// append binary image of the collection of bitsets sets to the buffer
+void        serialize_collection(const std::vector<dbs>& sets, 
+                std::vector<unsigned char>& buffer);
+
+// read collection of bitsets from binary image stored in the stream is;
+// throw serialization_error if the image is invalid or truncated or was
+// created by a build with different word size
+std::vector<dbs>    deserialize_collection(std::istream& is);
+
+// read collection of bitsets from binary image stored in the buffer data
+// of given size; if read is not null, then number of bytes of the image is
+// stored in read; errors are reported as in deserialize_collection(std::istream&)
+std::vector<dbs>    deserialize_collection(const unsigned char* data, size_t size, 
+                        size_t* read = nullptr);
+
+}
@@ -0,0 +1,160 @@
+/*
+*  This file is a part of DBS library.
+*
+*  Copyright (c) Pawe Kowal 2017 - 2021
+*
+*  This program is free software; you can redistribute it and/or modify
+*  it under the terms of the GNU General Public License as published by
+*  the Free Software Foundation; either version 2 of the License, or
+*  (at your option) any later version.
+*
+*  This program is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU General Public License for more details.
+*
+*  You should have received a copy of the GNU General Public License
+*  along with this program; if not, write to the Free Software
+*  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+*/
+
+#pragma once
+
+
+#include "dbs/dbs.h"
+
+#include <vector>
+#include <stdint.h>
+
+namespace dbs_lib
+{
+
+// Sketches of bitsets used to estimate similarity of sets without computing
+// intersections. A sketch is computed in one traversal of words of a bitset
+// (see dbs::for_each_word) and is much smaller than the bitset. Sketches are
+// immutable values and can be cached together with sets, for example in
+// dbs_unordered_map (see dbs_unordered.h); every sketch stores the hash
+// of the sketched set (see hash_value).
+//
+// Estimates can be computed only for sketches created with the same
+// parameters; otherwise std::invalid_argument is thrown.
+
+// kinds of MinHash signatures
+enum class minhash_kind
+{
+    // k independent hash functions; the minimal hash value of elements
+    // is stored for every function; computing cost is proportional to
+    // k * size()
+    k_hash,
+
+    // one hash function; elements are assigned to k bins according to
+    // hash values and the minimal hash value is stored for every bin;
+    // empty bins are filled with values of nearest nonempty bins (rotation
+    // densification); computing cost is proportional to size() + k
+    one_permutation,
+};
+
+// MinHash signature of a bitset
+class dbs_minhash
+{
+    private:
+        std::vector<uint64_t>   m_values;
+        minhash_kind            m_kind;
+        uint64_t                m_seed;
+        size_t                  m_count;
+        size_t                  m_source_hash;
+
+    public:
+        // create signature of the empty set with k = 0
+        dbs_minhash();
+
+        // create signature of the bitset x with k values; hash functions
+        // are determined by the seed
+        dbs_minhash(const dbs& x, size_t k, minhash_kind kind = minhash_kind::one_permutation,
+                    uint64_t seed = 0);
+
+    public:
+        // number of values of the signature
+        size_t                  k() const;
+
+        // kind of the signature
+        minhash_kind            kind() const;
+
+        // seed of hash functions
+        uint64_t                seed() const;
+
+        // exact number of elements of the sketched set
+        size_t                  count() const;
+
+        // hash of the sketched set
+        size_t                  source_hash() const;
+
+        // values of the signature
+        const std::vector<uint64_t>&
+                                values() const;
+};
+
+// HyperLogLog sketch of a bitset; the relative error of estimates is about 
+// 1.04 / sqrt(2^precision)
+class dbs_hll
+{
+    private:
+        std::vector<unsigned char>  m_registers;
+        size_t                      m_precision;
+        uint64_t                    m_seed;
+        size_t                      m_source_hash;
+
+    public:
+        // smallest and largest supported precision
+        static const size_t     min_precision   = 4;
+        static const size_t     max_precision   = 18;
+
+    public:
+        // create sketch of the empty set with precision 0
+        dbs_hll();
+
+        // create sketch of the bitset x with 2^precision registers; hash
+        // function is determined by the seed; throw std::invalid_argument
+        // if precision is not in [min_precision, max_precision]
+        explicit dbs_hll(const dbs& x, size_t precision = 12, uint64_t seed = 0);
+
+    public:
+        // number of bits of hash values selecting a register
+        size_t                  precision() const;
+
+        // seed of the hash function
+        uint64_t                seed() const;
+
+        // hash of the sketched set or 0 if the sketch was created by merge
+        size_t                  source_hash() const;
+
+        // registers of the sketch
+        const std::vector<unsigned char>&
+                                registers() const;
+
+        // estimated number of elements of the sketched set
+        double                  estimate() const;
+
+        // return the sketch of the union of sketched sets; throw 
+        // std::invalid_argument if sketches are not compatible; source_hash
+        // of the result is 0
+        dbs_hll                 merge(const dbs_hll& other) const;
+};
+
+// estimated Jaccard similarity |x & y| / |x | y| of sketched sets; 
+// the similarity of two empty sets is 1
+double      estimate_jaccard(const dbs_minhash& x, const dbs_minhash& y);
+double      estimate_jaccard(const dbs_hll& x, const dbs_hll& y);
+
+// estimated size of the union of sketched sets; MinHash estimates use
+// exact sizes of both sets
+double      estimate_union_size(const dbs_minhash& x, const dbs_minhash& y);
+double      estimate_union_size(const dbs_hll& x, const dbs_hll& y);
+
+// estimated size of the intersection of sketched sets; HyperLogLog
+// estimates are obtained from the inclusion-exclusion principle and are
+// inaccurate if the intersection is small compared to the union
+double      estimate_intersection_size(const dbs_minhash& x, const dbs_minhash& y);
+double      estimate_intersection_size(const dbs_hll& x, const dbs_hll& y);
+
+}
@@ -0,0 +1,115 @@
+/*
+*  This file is a part of DBS library.
+*
+*  Copyright (c) Pawe Kowal 2017 - 2021
+*
+*  This program is free software; you can redistribute it and/or modify
+*  it under the terms of the GNU General Public License as published by
+*  the Free Software Foundation; either version 2 of the License, or
+*  (at your option) any later version.
+*
+*  This program is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU General Public License for more details.
+*
+*  You should have received a copy of the GNU General Public License
+*  along with this program; if not, write to the Free Software
+*  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+*/
+
+#pragma once
+
+#include "dbs/dbs.h"
+
+namespace dbs_lib
+{
+
+// Builder of a bitset from elements given in increasing order. Elements
+// can be added one by one or in chunks; subtrees of the result are built
+// as soon as all their elements are known, therefore the builder requires
+// memory for at most block_bits children at every level of the tree 
+// instead of storing all elements.
+class dbs_stream_builder
+{
+    private:
+        using dbs_impl                  = details::dbs_impl;
+
+        static const size_t max_level   = details::block::max_level;
+        static const size_t block_bits  = details::block::block_bits;
+
+        // node of a given level storing the last added element
+        struct pending_node
+        {
+            size_t          m_flags;
+            size_t          m_size;
+            dbs_impl        m_children[block_bits];
+        };
+
+    private:
+        // number of different elements added and the last added element
+        size_t              m_count;
+        size_t              m_last;
+
+        // leaf storing the last added element; m_leaf[k] stores elements
+        // with the lowest bit equal to k
+        size_t              m_leaf[2];
+
+        // pending nodes of levels 1, ..., max_level
+        pending_node        m_nodes[max_level];
+
+    public:
+        // create builder of empty set
+        dbs_stream_builder();
+
+        dbs_stream_builder(const dbs_stream_builder&) = delete;
+        dbs_stream_builder& operator=(const dbs_stream_builder&) = delete;
+
+    public:
+        // add element n; n must not be less than previously added elements;
+        // repeated elements are ignored; throw std::invalid_argument if n is
+        // less than the last added element
+        void                push(size_t n);
+
+        // add count elements stored in the array elems; elements must be
+        // sorted increasingly
+        void                push(size_t count, const size_t* elems);
+
+        // add elements of a block of 2 * block_bits elements starting at
+        // offset, which must be a multiple of 2 * block_bits; bit i of word_0
+        // represents element offset + i and bit i of word_1 represents 
+        // element offset + block_bits + i (as in dbs::for_each_block); added
+        // elements must be greater than previously added elements; throw
+        // std::invalid_argument if these conditions are not satisfied
+        void                push_block(size_t offset, size_t word_0, size_t word_1);
+
+        // add elements first, first + 1, ..., last; first must not be less
+        // than previously added elements; throw std::invalid_argument if 
+        // first > last or first is less than the last added element
+        void                push_range(size_t first, size_t last);
+
+        // return bitset containing all added elements; the builder is reset
+        // to the empty state
+        dbs                 finish();
+
+        // return number of different elements added so far
+        size_t              size() const;
+
+    private:
+        // build nodes not storing the element n and attach them to parents
+        void                complete_nodes(size_t n);
+
+        // attach nodes of levels lower than top_level to their parents
+        void                complete_levels(size_t top_level);
+
+        // remove and return the current leaf or the pending node of given
+        // level; the returned node is in the canonical form
+        dbs_impl            take_leaf();
+        dbs_impl            take_node(size_t level);
+
+        // add a child storing the last added element to the pending node
+        // of given level
+        void                attach(size_t level, dbs_impl&& child);
+};
+
+}
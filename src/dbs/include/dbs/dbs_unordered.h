@@ -0,0 +1,241 @@
+/*
+*  This file is a part of DBS library.
+*
+*  Copyright (c) Pawe Kowal 2017 - 2021
+*
+*  This program is free software; you can redistribute it and/or modify
+*  it under the terms of the GNU General Public License as published by
+*  the Free Software Foundation; either version 2 of the License, or
+*  (at your option) any later version.
+*
+*  This program is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU General Public License for more details.
+*
+*  You should have received a copy of the GNU General Public License
+*  along with this program; if not, write to the Free Software
+*  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+*/
+
+#pragma once
+
+#include "dbs/dbs.h"
+
+#include <vector>
+#include <utility>
+
+namespace dbs_lib { namespace details
+{
+
+// entry of a hash table with keys of type dbs and values of type Mapped
+template<class Mapped>
+struct dbs_table_entry
+{
+    dbs                 m_key;
+    Mapped              m_value;
+
+    template<class ... Args>
+    explicit dbs_table_entry(const dbs& key, Args&& ... args)
+        : m_key(key), m_value(std::forward<Args>(args)...)
+    {};
+};
+
+// entry of a hash set
+template<>
+struct dbs_table_entry<void>
+{
+    dbs                 m_key;
+
+    explicit dbs_table_entry(const dbs& key)
+        : m_key(key)
+    {};
+};
+
+// hash table with open addressing and linear probing; entries are stored
+// inline in the array of slots together with cached hashes of keys; keys
+// sharing the root node are equal without comparing trees; erased entries
+// are removed by shifting following entries back, so that no tombstones
+// are left
+template<class Mapped>
+class dbs_table
+{
+    public:
+        using entry_type    = dbs_table_entry<Mapped>;
+
+    private:
+        struct slot
+        {
+            // hash of the key with the lowest bit set or 0 if the slot
+            // is empty
+            size_t                  m_hash;
+            pod_type<entry_type>    m_entry;
+        };
+
+    private:
+        std::vector<slot>   m_slots;
+        size_t              m_size;
+
+    public:
+        dbs_table();
+        dbs_table(const dbs_table& other);
+        dbs_table(dbs_table&& other) noexcept;
+        ~dbs_table();
+
+        dbs_table&          operator=(const dbs_table& other);
+        dbs_table&          operator=(dbs_table&& other) noexcept;
+
+    public:
+        // return entry with the key equal to key or nullptr
+        entry_type*         find(const dbs& key) const;
+
+        // insert entry constructed from key and args if there is no entry
+        // with the key equal to key; return the entry with this key and
+        // true if the entry was inserted
+        template<class ... Args>
+        std::pair<entry_type*, bool>
+                            emplace(const dbs& key, Args&& ... args);
+
+        // remove entry with the key equal to key; return true if the entry
+        // was found
+        bool                erase(const dbs& key);
+
+        void                clear();
+        void                reserve(size_t n);
+        size_t              size() const;
+
+        // call f(entry) for every entry
+        template<class Func>
+        void                for_each(Func& f) const;
+
+    private:
+        static size_t       get_hash(const dbs& key);
+        size_t              home_pos(size_t hash) const;
+        entry_type&         get_entry(size_t pos) const;
+
+        // return position of the entry with given key or an empty slot
+        size_t              find_pos(const dbs& key, size_t hash) const;
+
+        void                rehash(size_t capacity);
+        void                destroy_entries();
+        void                copy_entries(const dbs_table& other);
+};
+
+}};
+
+namespace dbs_lib
+{
+
+// Hash set of bitsets. Entries are stored inline in an array of slots with
+// open addressing; hashes of bitsets are cached in tree nodes (see
+// hash_value) and in slots, and bitsets sharing the root node are equal
+// without comparing trees, therefore lookups do not traverse trees unless
+// hashes are equal and roots are different.
+//
+// In intern mode (see intern) the set stores canonical instances of bitsets;
+// interned bitsets are equal if and only if they share the root node.
+//
+// Concurrent modifications are not allowed.
+class dbs_unordered_set
+{
+    private:
+        using table_type    = details::dbs_table<void>;
+
+    private:
+        table_type          m_table;
+
+    public:
+        // create empty set
+        dbs_unordered_set();
+
+    public:
+        // insert bitset x; return true if x was not stored
+        bool                insert(const dbs& x);
+
+        // return the stored bitset equal to x; x is inserted if there is no
+        // such bitset; the returned reference is valid until this set
+        // is modified
+        const dbs&          intern(const dbs& x);
+
+        // return true if a bitset equal to x is stored
+        bool                contains(const dbs& x) const;
+
+        // remove bitset equal to x; return true if x was stored
+        bool                erase(const dbs& x);
+
+        // return number of stored bitsets
+        size_t              size() const;
+
+        // return true if the set is empty
+        bool                empty() const;
+
+        // remove all bitsets
+        void                clear();
+
+        // allocate memory for at least n bitsets
+        void                reserve(size_t n);
+
+        // call f(x) for every stored bitset x in unspecified order
+        template<class Func>
+        void                for_each(Func&& f) const;
+};
+
+// Hash map with keys of type dbs and values of type T; see dbs_unordered_set
+// for details. Values must be movable.
+template<class T>
+class dbs_unordered_map
+{
+    private:
+        using table_type    = details::dbs_table<T>;
+
+    private:
+        table_type          m_table;
+
+    public:
+        // create empty map
+        dbs_unordered_map();
+
+    public:
+        // return value assigned to key; default constructed value is
+        // inserted if key is not stored
+        T&                  operator[](const dbs& key);
+
+        // insert key with given value; return true if key was not stored,
+        // otherwise the stored value is not changed
+        bool                insert(const dbs& key, const T& value);
+        bool                insert(const dbs& key, T&& value);
+
+        // return pointer to value assigned to key or nullptr if key is not
+        // stored; pointers are valid until this map is modified
+        T*                  find(const dbs& key);
+        const T*            find(const dbs& key) const;
+
+        // return true if key is stored
+        bool                contains(const dbs& key) const;
+
+        // remove key; return true if key was stored
+        bool                erase(const dbs& key);
+
+        // return number of stored keys
+        size_t              size() const;
+
+        // return true if the map is empty
+        bool                empty() const;
+
+        // remove all keys
+        void                clear();
+
+        // allocate memory for at least n keys
+        void                reserve(size_t n);
+
+        // call f(key, value) for every stored key in unspecified order
+        template<class Func>
+        void                for_each(Func&& f);
+
+        template<class Func>
+        void                for_each(Func&& f) const;
+};
+
+}
+
+#include "dbs/details/dbs_unordered.inl"
@@ -0,0 +1,211 @@
+/*
+*  This file is a part of DBS library.
+*
+*  Copyright (c) Pawe Kowal 2017 - 2021
+*
+*  This program is free software; you can redistribute it and/or modify
+*  it under the terms of the GNU General Public License as published by
+*  the Free Software Foundation; either version 2 of the License, or
+*  (at your option) any later version.
+*
+*  This program is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU General Public License for more details.
+*
+*  You should have received a copy of the GNU General Public License
+*  along with this program; if not, write to the Free Software
+*  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+*/
+
+#pragma once
+
+#include "dbs/dbs.h"
+
+#include <vector>
+#include <iosfwd>
+#include <iterator>
+#include <string>
+
+namespace dbs_lib { namespace details
+{
+
+// tree node stored in a frozen image; the same as block, except that
+// children are referenced by offsets from the beginning of the image
+struct frozen_block
+{
+    // level of the node
+    size_t      m_level;
+
+    // flags of an internal node or the first word of a leaf
+    size_t      m_flags;
+
+    // offset of the array of children of an internal node or the second
+    // word of a leaf
+    size_t      m_data;
+};
+
+}};
+
+namespace dbs_lib
+{
+
+class dbs_view;
+
+// Frozen image of a bitset is a read-only representation of the tree, that
+// can be used directly after mapping a file into memory. The image starts
+// with a header (magic bytes "DBSF", format version, number of bits in a 
+// word and byte order), followed by the root node; children of every 
+// internal node are stored in an array, which is referenced by offset from
+// the beginning of the image. Arrays are stored in preorder. Words are 
+// stored in the native byte order, therefore an image can be used only
+// by builds with the same word size and byte order.
+
+// append frozen image of the bitset x to the buffer; the buffer is padded
+// with zeros, such that the image starts at offset being a multiple of 8;
+// return the offset of the image
+size_t      freeze(const dbs& x, std::vector<unsigned char>& buffer);
+
+// write frozen image of the bitset x to the stream os
+void        freeze(const dbs& x, std::ostream& os);
+
+// forward iterator over elements of a dbs_view in increasing order
+class dbs_view_iterator
+{
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type        = size_t;
+        using difference_type   = std::ptrdiff_t;
+        using pointer           = const size_t*;
+        using reference         = size_t;
+
+    private:
+        const dbs_view*     m_view;
+        size_t              m_value;
+        size_t              m_last;
+        bool                m_end;
+
+    public:
+        // create singular iterator
+        dbs_view_iterator();
+
+        // return current element
+        size_t              operator*() const       { return m_value; };
+
+        dbs_view_iterator&  operator++();
+        dbs_view_iterator   operator++(int);
+
+        // iterators obtained from the same view can be compared
+        bool                operator==(const dbs_view_iterator& other) const;
+        bool                operator!=(const dbs_view_iterator& other) const;
+
+    private:
+        dbs_view_iterator(const dbs_view* view, bool end);
+
+        friend class dbs_view;
+};
+
+// Read-only bitset stored in a frozen image; the image is not copied and
+// must be valid as long as the view is used. Set operators on views create
+// a dbs; a view can also be converted to a dbs in order to be used together
+// with other bitsets.
+class dbs_view
+{
+    public:
+        using const_iterator    = dbs_view_iterator;
+        using iterator          = const_iterator;
+        using frozen_block      = details::frozen_block;
+
+        static const size_t npos    = dbs::npos;
+
+    private:
+        const unsigned char*    m_image;
+        size_t                  m_size;
+        const frozen_block*     m_root;
+
+    public:
+        // create view of empty set
+        dbs_view();
+
+        // create view of the frozen image stored at data of given size;
+        // data must be aligned to the size of size_t; throw 
+        // serialization_error if the header of the image is invalid or 
+        // the image was created by an incompatible build; other parts of
+        // the image are not checked (see validate)
+        dbs_view(const void* data, size_t size);
+
+    public:
+        // return number of elements
+        size_t              size() const;
+
+        // return true if the set is not empty
+        bool                any() const;
+
+        // return true if the set is empty
+        bool                none() const;
+
+        // return true if bit n is set
+        bool                test(size_t n) const;
+
+        // return the lowest element or npos if this set is empty
+        size_t              first() const;
+
+        // return the highest element or npos if this set is empty
+        size_t              last() const;
+
+        // return the lowest element m > n or npos if there is no such
+        // element
+        size_t              next(size_t n) const;
+
+        // iterators over elements in increasing order
+        const_iterator      begin() const;
+        const_iterator      end() const;
+
+        // create a bitset storing the same elements
+        dbs                 to_dbs() const;
+
+        // check the whole image; return false if the image is invalid; 
+        // images from untrusted sources should be checked before use
+        bool                validate() const;
+
+    public:
+        // internal use only
+        const frozen_block* root() const;
+        const frozen_block* child(const frozen_block* node, size_t k) const;
+};
+
+// return x & y, x | y, x ^ y and x - y respectively
+dbs         operator&(const dbs_view& x, const dbs_view& y);
+dbs         operator|(const dbs_view& x, const dbs_view& y);
+dbs         operator^(const dbs_view& x, const dbs_view& y);
+dbs         operator-(const dbs_view& x, const dbs_view& y);
+
+// read-only memory mapping of a file
+class mapped_file
+{
+    private:
+        const void*         m_data;
+        size_t              m_size;
+
+        // handles of the file and the mapping (Windows only)
+        void*               m_file;
+        void*               m_mapping;
+
+    public:
+        // map the file given by path; throw std::runtime_error if the file
+        // cannot be mapped
+        explicit mapped_file(const std::string& path);
+
+        // unmap the file
+        ~mapped_file();
+
+        mapped_file(const mapped_file&) = delete;
+        mapped_file& operator=(const mapped_file&) = delete;
+
+    public:
+        // return mapped memory and its size in bytes
+        const void*         data() const;
+        size_t              size() const;
+};
+
+}
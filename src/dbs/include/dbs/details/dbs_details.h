@@ -20,8 +20,14 @@
 
 #pragma once
 
+#include "dbs/config.h"
+
 #include <stdint.h>
 
+#ifdef DBS_THREAD_SAFE
+    #include <atomic>
+#endif
+
 namespace dbs_lib { namespace details
 {
 
@@ -59,6 +65,15 @@ class header<block_type, 4>
         static size_t       least_significant_bit(size_t bits);
         static size_t       most_significant_bit_pos(size_t bits);
         static size_t       least_significant_bit_pos(size_t bits);
+
+        // move bit i of the lower half of bits to position 2*i
+        static size_t       spread_bits(size_t bits);
+
+        // move bit 2*i of bits to position i; inverse of spread_bits
+        static size_t       gather_bits(size_t bits);
+
+        // bijective mixing of bits used by hash functions
+        static size_t       mix_bits(size_t bits);
 };
 
 template<class block_type>
@@ -90,12 +105,55 @@ class header<block_type, 8>
 	    static size_t       least_significant_bit(size_t bits);
 	    static size_t       most_significant_bit_pos(size_t bits);
 	    static size_t       least_significant_bit_pos(size_t bits);
+
+	    // move bit i of the lower half of bits to position 2*i
+	    static size_t       spread_bits(size_t bits);
+
+	    // move bit 2*i of bits to position i; inverse of spread_bits
+	    static size_t       gather_bits(size_t bits);
+
+	    // bijective mixing of bits used by hash functions
+	    static size_t       mix_bits(size_t bits);
+};
+
+class dbs_set;
+
+// uninitialized storage for an object of type value_type
+template<class value_type>
+struct pod_type
+{    
+    alignas(value_type) char m_data[sizeof(value_type)];
+};
+
+// a set that is no longer referenced and must be released
+struct dead_set
+{
+    dbs_set*    m_set;
+    size_t      m_size;
 };
 
 class dbs_set
 {
+    public:
+        // highest bits of refcount store index of a memory resource, 
+        // from which this set was allocated
+        static const int    tag_bits    = 4;
+        static const int    tag_shift   = sizeof(size_t) * 8 - tag_bits;
+        static const size_t count_mask  = (size_t(1) << tag_shift) - 1;
+
+        #ifdef DBS_THREAD_SAFE
+            using refcount_type = std::atomic<size_t>;
+        #else
+            using refcount_type = size_t;
+        #endif
+
     private:
-        size_t          m_refcount;
+        refcount_type   m_refcount;
+
+        // hash of children; every initialized child adds a value depending
+        // on its hash and position, therefore the hash is complete when all
+        // children are initialized in any order
+        size_t          m_hash;
         //+variable length array of dbs
 
     public:
@@ -103,10 +161,24 @@ class dbs_set
         void            init(size_t pos, dbs_impl&& elem);
 
         const dbs_impl& get_elem(size_t pos) const;        
+        dbs_impl&       get_elem(size_t pos);
+        size_t          get_hash() const;
+
+        // return true if this set is referenced only once
+        bool            is_unique() const;
         void            increase_refcount();
         bool            decrease_refcount();
-        void            destroy(size_t elems);
         static dbs_set* create(size_t elems);
+        size_t          get_tag() const;
+
+        // release this set, which is no longer referenced; depending on
+        // the reclamation mode memory is freed immediately or the set is
+        // put on the reclamation queue
+        void            destroy(size_t elems);
+
+        // free memory of this set and decrease refcount of subsets; subsets
+        // that are no longer referenced are put on the stack dead
+        void            release(size_t elems, dead_set* dead, size_t& n_dead);
 
     private:
         dbs_impl*       get_elem_ptr();
@@ -122,6 +194,9 @@ class block
         static const int block_bits_log = header_type::block_bits_log;
         static const int block_bits     = header_type::block_bits;
 
+        // maximum level of a tree storing values of type size_t
+        static const int max_level      = (sizeof(size_t) * 8 - 2) / block_bits_log;
+
     public:
         header_type     m_header;
         size_t          m_flags;
@@ -131,11 +206,11 @@ class block
         block();
         block(header_type h, size_t f, dbs_set* ptr);
         block(const block& other);
-        block(block&&);
+        block(block&&) noexcept;
         ~block();
 
         block&          operator=(const block&);
-        block&          operator=(block&&);
+        block&          operator=(block&&) noexcept;
 
         dbs_set*        get_fsb_set() const         { return m_ptrs;};
         ushort_type     get_level() const           { return m_header.get_level(); };
@@ -159,6 +234,39 @@ class block
         template<size_t bits>
         static size_t   div_pow2(size_t a);
 
+        // return position of the first bit set in bits at position not less
+        // than pos or block_bits if there is no such bit
+        static size_t   next_bit_pos(size_t bits, size_t pos);
+
+        // return position of the last bit set in bits at position not greater
+        // than pos or size_t(-1) if there is no such bit
+        static size_t   prev_bit_pos(size_t bits, size_t pos);
+
+        // leaf block only; return the lowest element not less than pos or
+        // size_t(-1) if there is no such element; pos < 2 * block_bits
+        size_t          leaf_next(size_t pos) const;
+
+        // leaf block only; return the highest element not greater than pos or
+        // size_t(-1) if there is no such element; pos < 2 * block_bits
+        size_t          leaf_prev(size_t pos) const;
+
+        // leaf block only; store elements of this block in two words, such
+        // that bit i of the word k represents element k * block_bits + i
+        void            leaf_interleave(size_t& lo, size_t& hi) const;
+
+        // leaf block only; inverse of leaf_interleave
+        void            leaf_deinterleave(size_t lo, size_t hi);
+
+        // write offset + i to out for every bit i set in bits in increasing
+        // order; return pointer past the last written element
+        static size_t*  decode_bits(size_t bits, size_t offset, size_t* out);
+
+        // return hash of the subtree rooted at this block; hashes of
+        // children are cached in the dbs_set, therefore the cost is O(1)
+        size_t          hash_value() const;
+
+        static size_t   hash_combine(size_t seed, size_t value);
+
     private:
         void            increase_refcount() const;
         void            decrease_refcount() const;
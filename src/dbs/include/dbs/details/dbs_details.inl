@@ -21,11 +21,18 @@
 #pragma once
 
 #include "dbs_details.h"
+#include "dbs_impl.h"
+
+#include <utility>
 
 #ifdef DBS_HAS_POPCNT
     #include "nmmintrin.h"
 #endif
 
+#if defined(DBS_HAS_BMI) || defined(DBS_HAS_BMI2)
+    #include "immintrin.h"
+#endif
+
 namespace dbs_lib { namespace details
 {
 
@@ -75,28 +82,36 @@ template<class block_type>
 DBS_FORCE_INLINE
 size_t header<block_type, 4>::most_significant_bit_pos(size_t x)
 {
-    //taken from The Aggregate Magic Algorithms
-    x       |= (x >> 1);
-    x       |= (x >> 2);
-    x       |= (x >> 4);
-    x       |= (x >> 8);
-    x       |= (x >> 16);
+    #ifdef DBS_HAS_BMI
+        return 31 - (size_t)_lzcnt_u32((unsigned int)x);
+    #else
+        //taken from The Aggregate Magic Algorithms
+        x       |= (x >> 1);
+        x       |= (x >> 2);
+        x       |= (x >> 4);
+        x       |= (x >> 8);
+        x       |= (x >> 16);
 
-    return count_bits(x)-1;
+        return count_bits(x)-1;
+    #endif
 };
 
 template<class block_type>
 DBS_FORCE_INLINE
 size_t header<block_type, 4>::least_significant_bit_pos(size_t x)
 {
-    //taken from The Aggregate Magic Algorithms
-    x       |= (x << 1);
-    x       |= (x << 2);
-    x       |= (x << 4);
-    x       |= (x << 8);
-    x       |= (x << 16);
+    #ifdef DBS_HAS_BMI
+        return _tzcnt_u32((unsigned int)x);
+    #else
+        //taken from The Aggregate Magic Algorithms
+        x       |= (x << 1);
+        x       |= (x << 2);
+        x       |= (x << 4);
+        x       |= (x << 8);
+        x       |= (x << 16);
 
-    return 32 - count_bits(x);
+        return 32 - count_bits(x);
+    #endif
 };
 
 #pragma warning(push)
@@ -112,6 +127,49 @@ size_t header<block_type, 4>::least_significant_bit(size_t bits)
 };
 
 #pragma warning(pop)
+
+template<class block_type>
+DBS_FORCE_INLINE
+size_t header<block_type, 4>::spread_bits(size_t x)
+{
+    #ifdef DBS_HAS_BMI2
+        return _pdep_u32((unsigned int)x, 0x55555555);
+    #else
+        x       = x & 0x0000ffff;
+        x       = (x | (x << 8)) & 0x00ff00ff;
+        x       = (x | (x << 4)) & 0x0f0f0f0f;
+        x       = (x | (x << 2)) & 0x33333333;
+        x       = (x | (x << 1)) & 0x55555555;
+        return x;
+    #endif
+};
+
+template<class block_type>
+DBS_FORCE_INLINE
+size_t header<block_type, 4>::gather_bits(size_t x)
+{
+    #ifdef DBS_HAS_BMI2
+        return _pext_u32((unsigned int)x, 0x55555555);
+    #else
+        x       = x & 0x55555555;
+        x       = (x | (x >> 1)) & 0x33333333;
+        x       = (x | (x >> 2)) & 0x0f0f0f0f;
+        x       = (x | (x >> 4)) & 0x00ff00ff;
+        x       = (x | (x >> 8)) & 0x0000ffff;
+        return x;
+    #endif
+};
+
+template<class block_type>
+DBS_FORCE_INLINE
+size_t header<block_type, 4>::mix_bits(size_t x)
+{
+    // finalizer of MurmurHash3
+    x       = (x ^ (x >> 16)) * 0x85ebca6b;
+    x       = (x ^ (x >> 13)) * 0xc2b2ae35;
+    return x ^ (x >> 16);
+};
+
 template<class block_type>
 DBS_FORCE_INLINE
 size_t header<block_type, 8>::bits_before_pos(size_t bits, size_t pos)
@@ -162,30 +220,38 @@ template<class block_type>
 DBS_FORCE_INLINE
 size_t header<block_type, 8>::most_significant_bit_pos(size_t x)
 {
-	//taken from The Aggregate Magic Algorithms
-	x |= (x >> 1);
-	x |= (x >> 2);
-	x |= (x >> 4);
-	x |= (x >> 8);
-	x |= (x >> 16);
-	x |= (x >> 32);
-
-	return count_bits(x) - 1;
+    #ifdef DBS_HAS_BMI
+        return 63 - (size_t)_lzcnt_u64(x);
+    #else
+	    //taken from The Aggregate Magic Algorithms
+	    x |= (x >> 1);
+	    x |= (x >> 2);
+	    x |= (x >> 4);
+	    x |= (x >> 8);
+	    x |= (x >> 16);
+	    x |= (x >> 32);
+
+	    return count_bits(x) - 1;
+    #endif
 };
 
 template<class block_type>
 DBS_FORCE_INLINE
 size_t header<block_type, 8>::least_significant_bit_pos(size_t x)
 {
-	//taken from The Aggregate Magic Algorithms
-	x |= (x << 1);
-	x |= (x << 2);
-	x |= (x << 4);
-	x |= (x << 8);
-	x |= (x << 16);
-	x |= (x << 32);
-
-	return 64 - count_bits(x);
+    #ifdef DBS_HAS_BMI
+        return _tzcnt_u64(x);
+    #else
+	    //taken from The Aggregate Magic Algorithms
+	    x |= (x << 1);
+	    x |= (x << 2);
+	    x |= (x << 4);
+	    x |= (x << 8);
+	    x |= (x << 16);
+	    x |= (x << 32);
+
+	    return 64 - count_bits(x);
+    #endif
 };
 
 #pragma warning(push)
@@ -202,14 +268,68 @@ size_t header<block_type, 8>::least_significant_bit(size_t bits)
 
 #pragma warning(pop)
 
+template<class block_type>
+DBS_FORCE_INLINE
+size_t header<block_type, 8>::spread_bits(size_t x)
+{
+    #ifdef DBS_HAS_BMI2
+        return _pdep_u64(x, 0x5555555555555555);
+    #else
+        x       = x & 0x00000000ffffffff;
+        x       = (x | (x << 16)) & 0x0000ffff0000ffff;
+        x       = (x | (x << 8))  & 0x00ff00ff00ff00ff;
+        x       = (x | (x << 4))  & 0x0f0f0f0f0f0f0f0f;
+        x       = (x | (x << 2))  & 0x3333333333333333;
+        x       = (x | (x << 1))  & 0x5555555555555555;
+        return x;
+    #endif
+};
+
+template<class block_type>
+DBS_FORCE_INLINE
+size_t header<block_type, 8>::gather_bits(size_t x)
+{
+    #ifdef DBS_HAS_BMI2
+        return _pext_u64(x, 0x5555555555555555);
+    #else
+        x       = x & 0x5555555555555555;
+        x       = (x | (x >> 1))  & 0x3333333333333333;
+        x       = (x | (x >> 2))  & 0x0f0f0f0f0f0f0f0f;
+        x       = (x | (x >> 4))  & 0x00ff00ff00ff00ff;
+        x       = (x | (x >> 8))  & 0x0000ffff0000ffff;
+        x       = (x | (x >> 16)) & 0x00000000ffffffff;
+        return x;
+    #endif
+};
+
+template<class block_type>
+DBS_FORCE_INLINE
+size_t header<block_type, 8>::mix_bits(size_t x)
+{
+    // finalizer of MurmurHash3
+    x       = (x ^ (x >> 33)) * 0xff51afd7ed558ccd;
+    x       = (x ^ (x >> 33)) * 0xc4ceb9fe1a85ec53;
+    return x ^ (x >> 33);
+};
+
 //------------------------------------------------------------
 //                      Allocator
 //------------------------------------------------------------
 class Allocator
 {
     public:
-        static dbs_set*     create(size_t elems);
+        // allocate a set of given size; tag is set to index of memory
+        // resource used
+        static dbs_set*     create(size_t elems, size_t& tag);
         static void         destroy(dbs_set*, size_t elems);
+
+        // return index of memory resource used by the current thread
+        static size_t       current_tag();
+
+        // use memory resource with given index in the current thread and
+        // return previous index; the memory resource must remain installed
+        // by another thread until this thread restores the previous index
+        static size_t       exchange_tag(size_t tag);
 };
 
 //-----------------------------------------------------------------
@@ -218,41 +338,70 @@ class Allocator
 DBS_FORCE_INLINE
 void dbs_set::increase_refcount()
 {
-    ++m_refcount;
+    #ifdef DBS_THREAD_SAFE
+        m_refcount.fetch_add(1, std::memory_order_relaxed);
+    #else
+        ++m_refcount;
+    #endif
 };
 
 DBS_FORCE_INLINE
 bool dbs_set::decrease_refcount()
 {
-    return (--m_refcount) == 0;
+    #ifdef DBS_THREAD_SAFE
+        // the last reference cannot be shared with other threads; atomic
+        // decrement is not required
+        if ((m_refcount.load(std::memory_order_acquire) & count_mask) == 1)
+            return true;
+
+        // release changes made by this thread to the thread, that frees
+        // the set
+        size_t count    = m_refcount.fetch_sub(1, std::memory_order_acq_rel) - 1;
+        return (count & count_mask) == 0;
+    #else
+        return ((--m_refcount) & count_mask) == 0;
+    #endif
 };
 
 DBS_FORCE_INLINE
-void dbs_set::destroy(size_t elems)
+size_t dbs_set::get_tag() const
 {
-    for (size_t i = 0; i < elems; ++i)
-        get_elem(i).~dbs_impl();
-
-    Allocator::destroy(this,elems);    
+    #ifdef DBS_THREAD_SAFE
+        return m_refcount.load(std::memory_order_relaxed) >> tag_shift;
+    #else
+        return m_refcount >> tag_shift;
+    #endif
 };
 
 DBS_FORCE_INLINE
 dbs_set* dbs_set::create(size_t elems)
 {
-    dbs_set* ptr = Allocator::create(elems);
-    ptr->m_refcount = 1;
+    size_t tag;
+    dbs_set* ptr    = Allocator::create(elems, tag);
+    new(&ptr->m_refcount) refcount_type((tag << tag_shift) + 1);
+    ptr->m_hash     = 0;
     return ptr;
 };
 
 DBS_FORCE_INLINE
 void dbs_set::init(size_t pos, const dbs_impl& elem)
 {
+    using header_type   = block::header_type;
+
+    size_t hash     = block::hash_combine(elem.get_data().hash_value(), pos);
+    m_hash          += header_type::mix_bits(hash);
+
     new(get_elem_ptr() + pos) dbs_impl(elem);
 };
 
 DBS_FORCE_INLINE
 void dbs_set::init(size_t pos, dbs_impl&& elem)
 {
+    using header_type   = block::header_type;
+
+    size_t hash     = block::hash_combine(elem.get_data().hash_value(), pos);
+    m_hash          += header_type::mix_bits(hash);
+
     new(get_elem_ptr() + pos) dbs_impl(std::move(elem));
 };
 
@@ -262,23 +411,52 @@ const dbs_impl& dbs_set::get_elem(size_t pos) const
     return get_elem_ptr()[pos];
 };
 
+DBS_FORCE_INLINE
+dbs_impl& dbs_set::get_elem(size_t pos)
+{
+    return get_elem_ptr()[pos];
+};
+
+DBS_FORCE_INLINE
+size_t dbs_set::get_hash() const
+{
+    return m_hash;
+};
+
+DBS_FORCE_INLINE
+bool dbs_set::is_unique() const
+{
+    #ifdef DBS_THREAD_SAFE
+        return (m_refcount.load(std::memory_order_acquire) & count_mask) == 1;
+    #else
+        return (m_refcount & count_mask) == 1;
+    #endif
+};
+
 DBS_FORCE_INLINE
 const dbs_impl* dbs_set::get_elem_ptr() const
 {
-    const size_t* ptr = &m_refcount + 1;
-    return reinterpret_cast<const dbs_impl*>(ptr);
+    return reinterpret_cast<const dbs_impl*>(this + 1);
 };
 
 DBS_FORCE_INLINE 
 dbs_impl* dbs_set::get_elem_ptr()
 {
-    size_t* ptr = &m_refcount + 1;
-    return reinterpret_cast<dbs_impl*>(ptr);
+    return reinterpret_cast<dbs_impl*>(this + 1);
 };
 
 //-----------------------------------------------------------------
 //                      block
 //-----------------------------------------------------------------
+#ifdef DBS_REFCOUNT_STATS
+    // number of refcount operations
+    #ifdef DBS_THREAD_SAFE
+        extern std::atomic<size_t> g_refcount_ops;
+    #else
+        extern size_t g_refcount_ops;
+    #endif
+#endif
+
 DBS_FORCE_INLINE 
 size_t block::bits_before_pos(size_t bits, size_t pos)
 { 
@@ -318,6 +496,115 @@ size_t block::div_pow2(size_t a)
     return a >> bits;
 };
 
+DBS_FORCE_INLINE
+size_t block::next_bit_pos(size_t bits, size_t pos)
+{
+    if (pos >= block_bits)
+        return block_bits;
+
+    bits        = bits & (~size_t(0) << pos);
+    return header_type::least_significant_bit_pos(bits);
+};
+
+DBS_FORCE_INLINE
+size_t block::prev_bit_pos(size_t bits, size_t pos)
+{
+    if (pos < block_bits)
+        bits    = bits & (~size_t(0) >> (block_bits - 1 - pos));
+
+    if (bits == 0)
+        return size_t(-1);
+
+    return header_type::most_significant_bit_pos(bits);
+};
+
+DBS_FORCE_INLINE
+size_t block::leaf_next(size_t pos) const
+{
+    // even elements are stored in the first block, odd elements in the
+    // second block
+    size_t pos_0    = next_bit_pos(get_block_0(), (pos + 1) >> 1);
+    size_t pos_1    = next_bit_pos(get_block_1(), pos >> 1);
+
+    size_t elem_0   = (pos_0 < block_bits) ? (pos_0 << 1) : size_t(-1);
+    size_t elem_1   = (pos_1 < block_bits) ? (pos_1 << 1) + 1 : size_t(-1);
+
+    return elem_0 < elem_1 ? elem_0 : elem_1;
+};
+
+DBS_FORCE_INLINE
+size_t block::leaf_prev(size_t pos) const
+{
+    size_t pos_0    = prev_bit_pos(get_block_0(), pos >> 1);
+    size_t pos_1    = (pos == 0) ? size_t(-1) : prev_bit_pos(get_block_1(), (pos - 1) >> 1);
+
+    size_t elem_0   = (pos_0 != size_t(-1)) ? (pos_0 << 1) : size_t(-1);
+    size_t elem_1   = (pos_1 != size_t(-1)) ? (pos_1 << 1) + 1 : size_t(-1);
+
+    if (elem_0 == size_t(-1))
+        return elem_1;
+    if (elem_1 == size_t(-1))
+        return elem_0;
+
+    return elem_0 > elem_1 ? elem_0 : elem_1;
+};
+
+DBS_FORCE_INLINE
+void block::leaf_interleave(size_t& lo, size_t& hi) const
+{
+    // even elements are stored in the first block, odd elements in the
+    // second block
+    static const int half   = block_bits / 2;
+
+    size_t block_0  = get_block_0();
+    size_t block_1  = get_block_1();
+
+    lo              = header_type::spread_bits(block_0) 
+                    | (header_type::spread_bits(block_1) << 1);
+    hi              = header_type::spread_bits(block_0 >> half) 
+                    | (header_type::spread_bits(block_1 >> half) << 1);
+};
+
+DBS_FORCE_INLINE
+void block::leaf_deinterleave(size_t lo, size_t hi)
+{
+    static const int half   = block_bits / 2;
+
+    get_block_0()   = header_type::gather_bits(lo) 
+                    | (header_type::gather_bits(hi) << half);
+    get_block_1()   = header_type::gather_bits(lo >> 1) 
+                    | (header_type::gather_bits(hi >> 1) << half);
+};
+
+DBS_FORCE_INLINE
+size_t* block::decode_bits(size_t bits, size_t offset, size_t* out)
+{
+    while (bits)
+    {
+        *out        = offset + header_type::least_significant_bit_pos(bits);
+        ++out;
+        bits        = bits & (bits - 1);
+    };
+
+    return out;
+};
+
+DBS_FORCE_INLINE
+size_t block::hash_combine(size_t seed, size_t value)
+{
+    return seed ^ (value + 0x9e3779b9 + (seed << 6) + (seed >> 2));
+};
+
+DBS_FORCE_INLINE
+size_t block::hash_value() const
+{
+    if (get_level() == 0)
+        return hash_combine(get_block_0(), get_block_1());
+
+    size_t seed     = hash_combine(m_flags, get_level());
+    return hash_combine(seed, get_fsb_set()->get_hash());
+};
+
 DBS_FORCE_INLINE
 block::block()
     : m_header(), m_flags(0), m_ptrs(nullptr) 
@@ -336,11 +623,12 @@ block::block(const block& other)
 };
 
 DBS_FORCE_INLINE
-block::block(block&& other)
+block::block(block&& other) noexcept
     : m_header(other.m_header), m_flags(other.m_flags), m_ptrs(other.m_ptrs)
 {
-    if (other.get_level() > 0)
-        other.m_header.to_block() = 0;
+    other.m_header  = header_type();
+    other.m_flags   = 0;
+    other.m_ptrs    = nullptr;
 };
 
 DBS_FORCE_INLINE
@@ -363,14 +651,22 @@ block& block::operator=(const block& other)
 };
 
 DBS_FORCE_INLINE
-block& block::operator=(block&& other)
+block& block::operator=(block&& other) noexcept
 {
-    other.increase_refcount();
-    this->decrease_refcount();
+    if (this == &other)
+        return *this;
 
-    m_header    = other.m_header;
-    m_flags     = other.m_flags;
-    m_ptrs      = other.m_ptrs;
+    // ownership is transferred; old value is released after the move,
+    // since other can be owned by this block
+    block old(std::move(*this));
+
+    m_header        = other.m_header;
+    m_flags         = other.m_flags;
+    m_ptrs          = other.m_ptrs;
+
+    other.m_header  = header_type();
+    other.m_flags   = 0;
+    other.m_ptrs    = nullptr;
 
     return *this;
 };
@@ -379,7 +675,13 @@ DBS_FORCE_INLINE
 void block::increase_refcount() const
 {
     if (this->get_level() > 0)
+    {
+        #ifdef DBS_REFCOUNT_STATS
+            ++g_refcount_ops;
+        #endif
+
         m_ptrs->increase_refcount();
+    };
 };
 
 DBS_FORCE_INLINE
@@ -387,9 +689,89 @@ void block::decrease_refcount() const
 {
     if (this->get_level() > 0)
     {
+        #ifdef DBS_REFCOUNT_STATS
+            ++g_refcount_ops;
+        #endif
+
         if (m_ptrs->decrease_refcount() == true)
             m_ptrs->destroy(this->m_header.get_size());
     };
 };
 
-}}
\ No newline at end of file
+//-----------------------------------------------------------------
+//                      dbs_impl
+//-----------------------------------------------------------------
+DBS_FORCE_INLINE
+dbs_impl::dbs_impl()
+{};
+
+DBS_FORCE_INLINE
+dbs_impl::dbs_impl(details::block::header_type h, size_t f, details::dbs_set* ptr)
+    :m_data(h,f,ptr)
+{};
+
+DBS_FORCE_INLINE
+dbs_impl::dbs_impl(const dbs_impl& copy)
+    :m_data(copy.m_data)
+{};
+
+DBS_FORCE_INLINE
+dbs_impl::dbs_impl(dbs_impl&& copy) noexcept
+    :m_data(std::move(copy.m_data))
+{};
+
+DBS_FORCE_INLINE
+dbs_impl::~dbs_impl()
+{}
+
+DBS_FORCE_INLINE
+dbs_impl& dbs_impl::operator=(const dbs_impl& copy)
+{
+    this->m_data = copy.m_data;
+    return *this;
+};
+
+DBS_FORCE_INLINE
+dbs_impl& dbs_impl::operator=(dbs_impl&& copy) noexcept
+{
+    this->m_data = std::move(copy.m_data);
+    return *this;
+}
+
+DBS_FORCE_INLINE
+dbs_impl::block_type& dbs_impl::get_data()
+{
+    return m_data;
+}
+
+DBS_FORCE_INLINE
+const dbs_impl::block_type& dbs_impl::get_data() const
+{
+    return m_data;
+}
+
+DBS_FORCE_INLINE
+bool dbs_impl::any() const
+{
+    if (this->m_data.m_flags != 0)
+        return true;
+
+    if (this->m_data.get_level() == 0 && this->m_data.get_block_1() != 0)
+        return true;
+
+    return false;
+};
+
+DBS_FORCE_INLINE
+bool dbs_impl::none() const
+{
+    if (this->m_data.m_flags != 0)
+        return false;
+
+    if (this->m_data.get_level() == 0 && this->m_data.get_block_1() != 0)
+        return false;
+
+    return true;
+};
+
+}}
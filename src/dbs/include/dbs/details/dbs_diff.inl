@@ -0,0 +1,159 @@
+/*
+*  This file is a part of DBS library.
+*
+*  Copyright (c) Pawe Kowal 2017 - 2021
+*
+*  This program is free software; you can redistribute it and/or modify
+*  it under the terms of the GNU General Public License as published by
+*  the Free Software Foundation; either version 2 of the License, or
+*  (at your option) any later version.
+*
+*  This program is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU General Public License for more details.
+*
+*  You should have received a copy of the GNU General Public License
+*  along with this program; if not, write to the Free Software
+*  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+*/
+
+#pragma once
+
+#include "dbs/dbs_diff.h"
+#include "dbs/details/dbs_visitor.inl"
+#include "dbs/details/dbs_expr.inl"
+
+#include <algorithm>
+
+namespace dbs_lib { namespace details
+{
+
+// return the child coord of a node at given level or nullptr if this child
+// is empty; node can be stored at a lower level or can be nullptr
+DBS_FORCE_INLINE
+const dbs_impl* diff_child(const dbs_impl* node, size_t level, size_t coord)
+{
+    if (node == nullptr)
+        return nullptr;
+
+    const block& data   = node->get_data();
+
+    // a node at lower level is a descendant of a chain of nodes, that
+    // have only the child 0
+    if (data.get_level() < level)
+        return (coord == 0) ? node : nullptr;
+
+    if ((data.m_flags & block::bit_mask(coord)) == 0)
+        return nullptr;
+
+    size_t bits_before  = block::bits_before_pos(data.m_flags, coord);
+    return &data.get_fsb_set()->get_elem(block::count_bits(bits_before));
+};
+
+// return root of a bitset or nullptr if the bitset is empty
+DBS_FORCE_INLINE
+const dbs_impl* diff_root(const dbs_impl& x)
+{
+    return x.none() ? nullptr : &x;
+};
+
+// call f(offset, added, removed) for every word, in which subtrees x and y
+// at given level differ; empty subtrees are represented by nullptr; return
+// false if the traversal was stopped
+template<class Func>
+bool visit_changes(size_t level, const dbs_impl* x, const dbs_impl* y, size_t offset,
+                   Func& f)
+{
+    using header_type   = block::header_type;
+
+    static const size_t block_bits  = block::block_bits;
+
+    if (x == nullptr || y == nullptr)
+    {
+        if (x == y)
+            return true;
+
+        // all elements of the nonempty subtree are added or removed
+        bool added      = (x == nullptr);
+
+        auto visit_leaf = [&f, added](size_t off, size_t word_0, size_t word_1) -> bool
+        {
+            for (size_t k = 0; k < 2; ++k)
+            {
+                size_t word = (k == 0) ? word_0 : word_1;
+
+                if (word == 0)
+                    continue;
+
+                if (call_visitor(f, off + k * block_bits, added ? word : size_t(0),
+                                 added ? size_t(0) : word) == false)
+                {
+                    return false;
+                };
+            };
+
+            return true;
+        };
+
+        return visit_blocks(added ? *y : *x, offset, visit_leaf);
+    };
+
+    // subtree shared by both versions
+    if (expr_same_node(x, y) == true)
+        return true;
+
+    if (level == 0)
+    {
+        size_t x_lo, x_hi, y_lo, y_hi;
+        x->get_data().leaf_interleave(x_lo, x_hi);
+        y->get_data().leaf_interleave(y_lo, y_hi);
+
+        if (x_lo != y_lo && call_visitor(f, offset, y_lo & ~x_lo, x_lo & ~y_lo) == false)
+            return false;
+
+        if (x_hi != y_hi && call_visitor(f, offset + block_bits, y_hi & ~x_hi,
+                                         x_hi & ~y_hi) == false)
+        {
+            return false;
+        };
+
+        return true;
+    };
+
+    size_t shift        = block::block_bits_log * level + 1;
+    size_t flags        = expr_node_flags(x, level) | expr_node_flags(y, level);
+
+    while (flags != 0)
+    {
+        size_t pos      = header_type::least_significant_bit_pos(flags);
+        flags           = flags & (flags - 1);
+
+        if (visit_changes(level - 1, diff_child(x, level, pos), diff_child(y, level, pos),
+                          offset + (pos << shift), f) == false)
+        {
+            return false;
+        };
+    };
+
+    return true;
+};
+
+}};
+
+namespace dbs_lib
+{
+
+template<class Func>
+bool for_each_change(const dbs& old_set, const dbs& new_set, Func&& f)
+{
+    const details::dbs_impl* x  = details::diff_root(old_set);
+    const details::dbs_impl* y  = details::diff_root(new_set);
+
+    size_t level_x  = x ? x->get_data().get_level() : 0;
+    size_t level_y  = y ? y->get_data().get_level() : 0;
+
+    return details::visit_changes(std::max(level_x, level_y), x, y, 0, f);
+};
+
+};
@@ -0,0 +1,528 @@
+/*
+*  This file is a part of DBS library.
+*
+*  Copyright (c) Pawe Kowal 2017 - 2021
+*
+*  This program is free software; you can redistribute it and/or modify
+*  it under the terms of the GNU General Public License as published by
+*  the Free Software Foundation; either version 2 of the License, or
+*  (at your option) any later version.
+*
+*  This program is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU General Public License for more details.
+*
+*  You should have received a copy of the GNU General Public License
+*  along with this program; if not, write to the Free Software
+*  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+*/
+
+#pragma once
+
+#include "dbs/dbs_expr.h"
+#include "dbs/details/dbs_details.inl"
+
+namespace dbs_lib { namespace details
+{
+
+//-----------------------------------------------------------------
+//                      expr_ops
+//-----------------------------------------------------------------
+// return true if two subtrees are equal; only sharing is detected
+DBS_FORCE_INLINE
+bool expr_same_node(const dbs_impl* x, const dbs_impl* y)
+{
+    if (x == y)
+        return true;
+
+    const block& b1 = x->get_data();
+    const block& b2 = y->get_data();
+
+    return b1.get_level() == b2.get_level() && b1.m_flags == b2.m_flags 
+            && b1.m_ptrs == b2.m_ptrs;
+};
+
+// flags of nonempty children of a node at given level
+DBS_FORCE_INLINE
+size_t expr_node_flags(const dbs_impl* node, size_t level)
+{
+    if (node == nullptr)
+        return 0;
+
+    // a node at lower level is a descendant of a chain of nodes, that
+    // have only the child 0
+    if (node->get_data().get_level() < level)
+        return 1;
+
+    return node->get_data().m_flags;
+};
+
+// evaluation of an expression at given position in the tree; states[I + i]
+// is the subtree of i-th operand at this position or nullptr
+template<class Expr>
+struct expr_ops;
+
+template<class Expr>
+struct expr_leaf_ops
+{
+    template<size_t I>
+    static expr_shape shape(const dbs_impl* const* states)
+    {
+        const dbs_impl* node    = states[I];
+        return expr_shape{node ? expr_shape::node : expr_shape::empty, node};
+    };
+
+    template<size_t I>
+    static size_t flags(const dbs_impl* const* states, size_t level)
+    {
+        return expr_node_flags(states[I], level);
+    };
+
+    template<size_t I>
+    static void words(const dbs_impl* const* states, size_t& word_0, size_t& word_1)
+    {
+        const dbs_impl* node    = states[I];
+        word_0                  = node ? node->get_data().get_block_0() : 0;
+        word_1                  = node ? node->get_data().get_block_1() : 0;
+    };
+};
+
+template<>
+struct expr_ops<expr_ref> : expr_leaf_ops<expr_ref>
+{};
+
+template<>
+struct expr_ops<expr_value> : expr_leaf_ops<expr_value>
+{};
+
+template<expr_code Op, class Left, class Right>
+struct expr_ops<expr_binary<Op, Left, Right>>
+{
+    static const size_t n_left  = Left::n_leaves;
+
+    template<size_t I>
+    static expr_shape shape(const dbs_impl* const* states)
+    {
+        expr_shape x    = expr_ops<Left>::template shape<I>(states);
+
+        // right operand is not evaluated if the result is known
+        if (x.m_kind == expr_shape::empty && (Op == expr_code::op_and || Op == expr_code::op_diff))
+            return x;
+
+        expr_shape y    = expr_ops<Right>::template shape<I + n_left>(states);
+
+        bool x_empty    = x.m_kind == expr_shape::empty;
+        bool y_empty    = y.m_kind == expr_shape::empty;
+        bool same       = x.m_kind == expr_shape::node && y.m_kind == expr_shape::node 
+                        && expr_same_node(x.m_node, y.m_node);
+
+        if constexpr (Op == expr_code::op_and)
+        {
+            if (y_empty)
+                return y;
+            if (same == false)
+                x.m_kind    = expr_shape::mixed;
+        }
+        else if constexpr (Op == expr_code::op_or)
+        {
+            if (x_empty)
+                return y;
+            if (y_empty == false && same == false)
+                x.m_kind    = expr_shape::mixed;
+        }
+        else if constexpr (Op == expr_code::op_xor)
+        {
+            if (x_empty)
+                return y;
+            if (same == true)
+                x.m_kind    = expr_shape::empty;
+            else if (y_empty == false)
+                x.m_kind    = expr_shape::mixed;
+        }
+        else
+        {
+            if (same == true)
+                x.m_kind    = expr_shape::empty;
+            else if (y_empty == false)
+                x.m_kind    = expr_shape::mixed;
+        };
+
+        return x;
+    };
+
+    template<size_t I>
+    static size_t flags(const dbs_impl* const* states, size_t level)
+    {
+        // flags of children, that can be nonempty
+        size_t x        = expr_ops<Left>::template flags<I>(states, level);
+
+        if constexpr (Op == expr_code::op_diff)
+        {
+            return x;
+        }
+        else
+        {
+            size_t y    = expr_ops<Right>::template flags<I + n_left>(states, level);
+
+            if constexpr (Op == expr_code::op_and)
+                return x & y;
+            else
+                return x | y;
+        };
+    };
+
+    template<size_t I>
+    static void words(const dbs_impl* const* states, size_t& word_0, size_t& word_1)
+    {
+        size_t x_0, x_1, y_0, y_1;
+        expr_ops<Left>::template words<I>(states, x_0, x_1);
+        expr_ops<Right>::template words<I + n_left>(states, y_0, y_1);
+
+        if constexpr (Op == expr_code::op_and)
+        {
+            word_0      = x_0 & y_0;
+            word_1      = x_1 & y_1;
+        }
+        else if constexpr (Op == expr_code::op_or)
+        {
+            word_0      = x_0 | y_0;
+            word_1      = x_1 | y_1;
+        }
+        else if constexpr (Op == expr_code::op_xor)
+        {
+            word_0      = x_0 ^ y_0;
+            word_1      = x_1 ^ y_1;
+        }
+        else
+        {
+            word_0      = x_0 & ~y_0;
+            word_1      = x_1 & ~y_1;
+        };
+    };
+};
+
+//-----------------------------------------------------------------
+//                      expr_evaluator
+//-----------------------------------------------------------------
+template<class Expr>
+class expr_evaluator
+{
+    private:
+        using ops_type      = expr_ops<Expr>;
+        using header_type   = block::header_type;
+        using ushort_type   = block::ushort_type;
+        using pod_dbs       = pod_type<dbs_impl>;
+
+        static const size_t n_leaves    = Expr::n_leaves;
+        static const int block_bits     = block::block_bits;
+
+        struct states_type
+        {
+            const dbs_impl* m_nodes[n_leaves];
+        };
+
+    public:
+        static dbs_impl     eval(const Expr& ex);
+        static size_t       count(const Expr& ex);
+        static bool         any(const Expr& ex);
+
+    private:
+        // initialize states of operands at the root; return level of the
+        // root or -1 if all operands are empty
+        static int          init_roots(const Expr& ex, states_type& states);
+
+        static dbs_impl     eval(size_t level, const states_type& states);
+        static size_t       count(size_t level, const states_type& states);
+        static bool         any(size_t level, const states_type& states);
+
+        static void         child_states(const states_type& states, size_t level, 
+                                size_t coord, states_type& children);
+};
+
+template<class Expr>
+int expr_evaluator<Expr>::init_roots(const Expr& ex, states_type& states)
+{
+    ex.get_leaves(states.m_nodes);
+
+    int level       = -1;
+
+    for (size_t i = 0; i < n_leaves; ++i)
+    {
+        const dbs_impl* leaf    = states.m_nodes[i];
+
+        if (leaf->none() == true)
+        {
+            states.m_nodes[i]   = nullptr;
+            continue;
+        };
+
+        level       = std::max(level, (int)leaf->get_data().get_level());
+    };
+
+    return level;
+};
+
+template<class Expr>
+DBS_FORCE_INLINE
+void expr_evaluator<Expr>::child_states(const states_type& states, size_t level, size_t coord, 
+                                        states_type& children)
+{
+    for (size_t i = 0; i < n_leaves; ++i)
+    {
+        const dbs_impl* node    = states.m_nodes[i];
+        const dbs_impl* child   = nullptr;
+
+        if (node != nullptr)
+        {
+            const block& data   = node->get_data();
+
+            if (data.get_level() < level)
+            {
+                child           = (coord == 0) ? node : nullptr;
+            }
+            else if (data.m_flags & block::bit_mask(coord))
+            {
+                size_t bits_before  = block::bits_before_pos(data.m_flags, coord);
+                child           = &data.get_fsb_set()->get_elem(block::count_bits(bits_before));
+            };
+        };
+
+        children.m_nodes[i]     = child;
+    };
+};
+
+template<class Expr>
+dbs_impl expr_evaluator<Expr>::eval(const Expr& ex)
+{
+    states_type states;
+    int level       = init_roots(ex, states);
+
+    if (level < 0)
+        return dbs_impl();
+
+    return eval(level, states);
+};
+
+template<class Expr>
+size_t expr_evaluator<Expr>::count(const Expr& ex)
+{
+    states_type states;
+    int level       = init_roots(ex, states);
+
+    if (level < 0)
+        return 0;
+
+    return count(level, states);
+};
+
+template<class Expr>
+bool expr_evaluator<Expr>::any(const Expr& ex)
+{
+    states_type states;
+    int level       = init_roots(ex, states);
+
+    if (level < 0)
+        return false;
+
+    return any(level, states);
+};
+
+template<class Expr>
+dbs_impl expr_evaluator<Expr>::eval(size_t level, const states_type& states)
+{
+    expr_shape shape        = ops_type::template shape<0>(states.m_nodes);
+
+    if (shape.m_kind == expr_shape::empty)
+        return dbs_impl();
+
+    // share subtree
+    if (shape.m_kind == expr_shape::node)
+        return *shape.m_node;
+
+    if (level == 0)
+    {
+        dbs_impl ret;
+        ops_type::template words<0>(states.m_nodes, ret.get_data().get_block_0(), 
+                                    ret.get_data().get_block_1());
+        return ret;
+    };
+
+    size_t flags            = ops_type::template flags<0>(states.m_nodes, level);
+
+    pod_dbs buf[block_bits];
+    ushort_type ret_size    = 0;
+    size_t ret_flags        = 0;
+    states_type children;
+
+    while (flags != 0)
+    {
+        size_t pos          = header_type::least_significant_bit_pos(flags);
+        flags               = flags & (flags - 1);
+
+        child_states(states, level, pos, children);
+        dbs_impl res        = eval(level - 1, children);
+
+        if (res.any() == true)
+        {
+            new (buf + ret_size) dbs_impl(std::move(res));
+
+            ret_flags       |= block::bit_mask(pos);
+            ++ret_size;
+        };
+    };
+
+    if (ret_size == 0)
+        return dbs_impl();
+
+    // node with only the child 0 is replaced by the child
+    if (ret_flags == 1)
+    {
+        dbs_impl ret(reinterpret_cast<dbs_impl&&>(buf[0]));
+        return ret;
+    };
+
+    block::header_type h((ushort_type)level, ret_size);
+    dbs_impl ret(h, ret_flags, dbs_set::create(ret_size));
+
+    for(ushort_type i = 0; i < ret_size; ++i)
+        ret.get_data().get_fsb_set()->init(i, reinterpret_cast<dbs_impl&&>(buf[i]));
+
+    return ret;
+};
+
+template<class Expr>
+size_t expr_evaluator<Expr>::count(size_t level, const states_type& states)
+{
+    expr_shape shape        = ops_type::template shape<0>(states.m_nodes);
+
+    if (shape.m_kind == expr_shape::empty)
+        return 0;
+
+    if (shape.m_kind == expr_shape::node)
+        return shape.m_node->size();
+
+    if (level == 0)
+    {
+        size_t word_0, word_1;
+        ops_type::template words<0>(states.m_nodes, word_0, word_1);
+
+        return block::count_bits(word_0) + block::count_bits(word_1);
+    };
+
+    size_t flags            = ops_type::template flags<0>(states.m_nodes, level);
+    size_t ret              = 0;
+    states_type children;
+
+    while (flags != 0)
+    {
+        size_t pos          = header_type::least_significant_bit_pos(flags);
+        flags               = flags & (flags - 1);
+
+        child_states(states, level, pos, children);
+        ret                 += count(level - 1, children);
+    };
+
+    return ret;
+};
+
+template<class Expr>
+bool expr_evaluator<Expr>::any(size_t level, const states_type& states)
+{
+    expr_shape shape        = ops_type::template shape<0>(states.m_nodes);
+
+    // only nonempty subtrees are stored
+    if (shape.m_kind != expr_shape::mixed)
+        return shape.m_kind == expr_shape::node;
+
+    if (level == 0)
+    {
+        size_t word_0, word_1;
+        ops_type::template words<0>(states.m_nodes, word_0, word_1);
+
+        return (word_0 | word_1) != 0;
+    };
+
+    size_t flags            = ops_type::template flags<0>(states.m_nodes, level);
+    states_type children;
+
+    while (flags != 0)
+    {
+        size_t pos          = header_type::least_significant_bit_pos(flags);
+        flags               = flags & (flags - 1);
+
+        child_states(states, level, pos, children);
+
+        if (any(level - 1, children) == true)
+            return true;
+    };
+
+    return false;
+};
+
+// binary operations on two bitsets have specialized implementations
+template<class Expr>
+struct expr_binary_impl
+{
+    static const bool value = false;
+};
+
+template<expr_code Op, class Left, class Right>
+struct expr_binary_impl<expr_binary<Op, Left, Right>>
+{
+    static const bool value = Left::n_leaves == 1 && Right::n_leaves == 1
+                            && Op != expr_code::op_diff;
+
+    static dbs_impl eval(const dbs_impl& x, const dbs_impl& y)
+    {
+        if constexpr (Op == expr_code::op_and)
+            return dbs_impl::and_impl(x, y);
+        else if constexpr (Op == expr_code::op_or)
+            return dbs_impl::or_impl(x, y);
+        else
+            return dbs_impl::xor_impl(x, y);
+    };
+};
+
+}};
+
+namespace dbs_lib
+{
+
+//-----------------------------------------------------------------
+//                      dbs_expr
+//-----------------------------------------------------------------
+template<class Derived>
+dbs dbs_expr<Derived>::eval() const
+{
+    const Derived& ex   = static_cast<const Derived&>(*this);
+    using binary_impl   = details::expr_binary_impl<Derived>;
+
+    if constexpr (binary_impl::value == true)
+    {
+        const details::dbs_impl* leaves[2];
+        ex.get_leaves(leaves);
+
+        return dbs(binary_impl::eval(*leaves[0], *leaves[1]));
+    }
+    else
+    {
+        return dbs(details::expr_evaluator<Derived>::eval(ex));
+    };
+};
+
+template<class Derived>
+size_t dbs_expr<Derived>::count() const
+{
+    const Derived& ex   = static_cast<const Derived&>(*this);
+    return details::expr_evaluator<Derived>::count(ex);
+};
+
+template<class Derived>
+bool dbs_expr<Derived>::any() const
+{
+    const Derived& ex   = static_cast<const Derived&>(*this);
+    return details::expr_evaluator<Derived>::any(ex);
+};
+
+}
@@ -54,14 +54,14 @@ class dbs_impl
         
         // standard copy and move constructors
         dbs_impl(const dbs_impl& copy);
-        dbs_impl(dbs_impl&& copy);
+        dbs_impl(dbs_impl&& copy) noexcept;
         
         // destructor
         ~dbs_impl();
 
         // standard assignment and move assignment 
         dbs_impl&	        operator=(const dbs_impl& copy);
-        dbs_impl&	        operator=(dbs_impl&& copy);
+        dbs_impl&	        operator=(dbs_impl&& copy) noexcept;
 
     public:
         // return number of elements stored in the bitset
@@ -78,48 +78,82 @@ class dbs_impl
         dbs_impl		    set(size_t pos) const;
         dbs_impl		    reset(size_t pos) const;
         dbs_impl		    flip(size_t pos) const;
+
+        // version of set, that moves children of nodes not shared with other
+        // bitsets to the result instead of copying them; if changed is true,
+        // then this bitset can only be destroyed or assigned after the call
+        dbs_impl            set_owned(size_t pos, bool& changed);
         bool				test(size_t n) const;
         
         size_t              first() const;
         size_t              last() const;        
+        size_t              next(size_t n) const;
+        size_t              prev(size_t n) const;
+        size_t              next_unset(size_t n) const;
+        size_t              prev_unset(size_t n) const;
 
         size_t              hash_value_impl() const;
         void                get_elements(std::vector<size_t>& elems) const;
 
+        static dbs_impl     and_impl(const dbs_impl& x, const dbs_impl& y);
+        static dbs_impl     or_impl(const dbs_impl& x, const dbs_impl& y);
+        static dbs_impl     xor_impl(const dbs_impl& x, const dbs_impl& y);
+
+        // return -1 if x < y, 0 if x == y and 1 if x > y
+        static int          compare_impl(const dbs_impl& x, const dbs_impl& y);
+
     public:
         block_type&         get_data();
         const block_type&   get_data() const;
 
         dbs_impl(details::block::header_type h, size_t f, details::dbs_set* ptr);
 
+        // write elements increased by offset to out; return pointer past
+        // the last written element
+        size_t*             get_elements(size_t offset, size_t* out) const;
+
+        // return level of the tree storing the element max_elem
+        static ushort_type  get_level(size_t max_elem);
+
+        // build bitset from count elements reduced modulo 2^offset_bits; values
+        // in the elems array must be different and sorted increasingly
+        static dbs_impl     build_dbs(size_t count, const size_t* elems, size_t offset_bits);
+
     private:                
         dbs_impl            increase_level(size_t pos) const;
         dbs_impl            insert_block(size_t this_level_coord, size_t prev_level_coord) const;
 
         dbs_impl            set(size_t pos, bool& changed) const;
         dbs_impl            set_elem(size_t this_level_coord, size_t prev_level_coord, bool& changed) const;
+
+        // versions of insert_block and set_elem used by set_owned
+        dbs_impl            insert_block_owned(size_t this_level_coord, size_t prev_level_coord);
+        dbs_impl            set_elem_owned(size_t this_level_coord, size_t prev_level_coord, 
+                                bool& changed);
         dbs_impl            reset(size_t pos, bool& changed) const;
         dbs_impl            reset_elem(size_t this_level_coord, size_t prev_level_coord, bool & changed) const;
         dbs_impl            flip_elem(size_t this_level_coord, size_t prev_level_coord) const;
 
-        static ushort_type  get_level(size_t max_elem);
-        static dbs_impl     build_dbs(size_t count, const size_t* elems, size_t offset_bits);
+        // return the lowest element not less than n
+        size_t              find_next(size_t n) const;
+
+        // return the highest element not greater than n
+        size_t              find_prev(size_t n) const;
+
+        // return the lowest value not less than n, that is not stored in
+        // the bitset; if all values in the range covered by this node are
+        // set, then the first value after this range is returned
+        size_t              find_next_unset(size_t n) const;
+
+        // return the highest value not greater than n, that is not stored
+        // in the bitset
+        size_t              find_prev_unset(size_t n) const;
+
         static dbs_impl     build_dbs(size_t count, const size_t* elems);
         static dbs_impl     build_level(ushort_type level, size_t count, const size_t* elems);
 
-        void                get_elements(size_t offset, std::vector<size_t>& elems) const;        
-
         friend class details::block;
 };
 
-// initializer of dbs library
-struct dbs_initializer 
-{
-    dbs_initializer();
-    ~dbs_initializer();
-};
-
-// static initializer for every translation unit
-static dbs_initializer init;
 
 }};
\ No newline at end of file
@@ -0,0 +1,94 @@
+/*
+*  This file is a part of DBS library.
+*
+*  Copyright (c) Pawe Kowal 2017 - 2021
+*
+*  This program is free software; you can redistribute it and/or modify
+*  it under the terms of the GNU General Public License as published by
+*  the Free Software Foundation; either version 2 of the License, or
+*  (at your option) any later version.
+*
+*  This program is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU General Public License for more details.
+*
+*  You should have received a copy of the GNU General Public License
+*  along with this program; if not, write to the Free Software
+*  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+*/
+
+#pragma once
+
+#include "dbs/config.h"
+#include "dbs/details/dbs_details.h"
+
+#include <iterator>
+#include <cstddef>
+
+namespace dbs_lib { namespace details
+{
+
+// bidirectional iterator over elements of a bitset in increasing order;
+// iterator stores path from the root to the current leaf, therefore
+// increment and decrement take O(1) amortized time; iterator is valid
+// as long as the bitset it was obtained from is alive
+class dbs_iterator
+{
+    public:
+        using iterator_category = std::bidirectional_iterator_tag;
+        using value_type        = size_t;
+        using difference_type   = std::ptrdiff_t;
+        using pointer           = const size_t*;
+        using reference         = size_t;
+
+    private:
+        // maximum number of nodes on a path from the root to a leaf
+        static const int max_depth  = block::max_level + 1;
+
+    private:
+        const dbs_impl*     m_root;
+        const dbs_impl*     m_path[max_depth];
+        int                 m_depth;
+        size_t              m_value;
+
+    public:
+        // create singular iterator
+        dbs_iterator();
+
+        // return current element
+        size_t              operator*() const       { return m_value; };
+
+        dbs_iterator&       operator++();
+        dbs_iterator        operator++(int);
+        dbs_iterator&       operator--();
+        dbs_iterator        operator--(int);
+
+        // iterators obtained from the same bitset can be compared
+        bool                operator==(const dbs_iterator& other) const;
+        bool                operator!=(const dbs_iterator& other) const;
+
+        // write at most capacity elements starting from the current one to
+        // the buffer, advance this iterator past the last written element
+        // and return number of written elements
+        size_t              read_elements(size_t* buffer, size_t capacity);
+
+    public:
+        // internal use only
+        static dbs_iterator make_begin(const dbs_impl& root);
+        static dbs_iterator make_end(const dbs_impl& root);
+        static dbs_iterator make_lower_bound(const dbs_impl& root, size_t n);
+
+    private:
+        explicit dbs_iterator(const dbs_impl& root);
+
+        bool                is_end() const          { return m_depth == 0; };
+        void                set_end();
+        void                push_first(const dbs_impl* node, size_t base);
+        void                push_last(const dbs_impl* node, size_t base);
+        void                lower_bound(size_t n);
+        void                next_from(int depth, size_t value);
+        bool                prev_from(int depth, size_t value);
+};
+
+}};
@@ -0,0 +1,424 @@
+/*
+*  This file is a part of DBS library.
+*
+*  Copyright (c) Pawe Kowal 2017 - 2021
+*
+*  This program is free software; you can redistribute it and/or modify
+*  it under the terms of the GNU General Public License as published by
+*  the Free Software Foundation; either version 2 of the License, or
+*  (at your option) any later version.
+*
+*  This program is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU General Public License for more details.
+*
+*  You should have received a copy of the GNU General Public License
+*  along with this program; if not, write to the Free Software
+*  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+*/
+
+#pragma once
+
+#include "dbs/dbs_unordered.h"
+#include "dbs/details/dbs_details.inl"
+#include "dbs/details/dbs_expr.inl"
+
+namespace dbs_lib { namespace details
+{
+
+//-----------------------------------------------------------------
+//                      dbs_table
+//-----------------------------------------------------------------
+template<class Mapped>
+dbs_table<Mapped>::dbs_table()
+    :m_size(0)
+{};
+
+template<class Mapped>
+dbs_table<Mapped>::dbs_table(const dbs_table& other)
+    :m_size(0)
+{
+    copy_entries(other);
+};
+
+template<class Mapped>
+dbs_table<Mapped>::dbs_table(dbs_table&& other) noexcept
+    :m_slots(std::move(other.m_slots)), m_size(other.m_size)
+{
+    other.m_slots.clear();
+    other.m_size    = 0;
+};
+
+template<class Mapped>
+dbs_table<Mapped>::~dbs_table()
+{
+    destroy_entries();
+};
+
+template<class Mapped>
+dbs_table<Mapped>& dbs_table<Mapped>::operator=(const dbs_table& other)
+{
+    if (this != &other)
+    {
+        clear();
+        copy_entries(other);
+    };
+
+    return *this;
+};
+
+template<class Mapped>
+dbs_table<Mapped>& dbs_table<Mapped>::operator=(dbs_table&& other) noexcept
+{
+    if (this != &other)
+    {
+        destroy_entries();
+
+        m_slots         = std::move(other.m_slots);
+        m_size          = other.m_size;
+
+        other.m_slots.clear();
+        other.m_size    = 0;
+    };
+
+    return *this;
+};
+
+template<class Mapped>
+DBS_FORCE_INLINE
+size_t dbs_table<Mapped>::get_hash(const dbs& key)
+{
+    return hash_value(key) | size_t(1);
+};
+
+template<class Mapped>
+DBS_FORCE_INLINE
+size_t dbs_table<Mapped>::home_pos(size_t hash) const
+{
+    // hashes of leaves are not mixed
+    return block::header_type::mix_bits(hash) & (m_slots.size() - 1);
+};
+
+template<class Mapped>
+DBS_FORCE_INLINE
+typename dbs_table<Mapped>::entry_type& dbs_table<Mapped>::get_entry(size_t pos) const
+{
+    const slot& s   = m_slots[pos];
+    return const_cast<entry_type&>(reinterpret_cast<const entry_type&>(s.m_entry));
+};
+
+template<class Mapped>
+size_t dbs_table<Mapped>::find_pos(const dbs& key, size_t hash) const
+{
+    size_t mask     = m_slots.size() - 1;
+    size_t pos      = home_pos(hash);
+
+    for (;; pos = (pos + 1) & mask)
+    {
+        const slot& s   = m_slots[pos];
+
+        if (s.m_hash == 0)
+            return pos;
+
+        if (s.m_hash != hash)
+            continue;
+
+        // keys sharing the root node are equal
+        const dbs& stored   = get_entry(pos).m_key;
+
+        if (expr_same_node(&stored, &key) == true || stored == key)
+            return pos;
+    };
+};
+
+template<class Mapped>
+typename dbs_table<Mapped>::entry_type* dbs_table<Mapped>::find(const dbs& key) const
+{
+    if (m_size == 0)
+        return nullptr;
+
+    size_t pos      = find_pos(key, get_hash(key));
+
+    if (m_slots[pos].m_hash == 0)
+        return nullptr;
+
+    return &get_entry(pos);
+};
+
+template<class Mapped>
+template<class ... Args>
+std::pair<typename dbs_table<Mapped>::entry_type*, bool>
+dbs_table<Mapped>::emplace(const dbs& key, Args&& ... args)
+{
+    // load factor is kept below 3/4
+    if (4 * (m_size + 1) > 3 * m_slots.size())
+        rehash(std::max(m_slots.size() * 2, size_t(16)));
+
+    size_t hash     = get_hash(key);
+    size_t pos      = find_pos(key, hash);
+    slot& s         = m_slots[pos];
+
+    if (s.m_hash != 0)
+        return std::pair<entry_type*, bool>(&get_entry(pos), false);
+
+    new (&s.m_entry) entry_type(key, std::forward<Args>(args)...);
+
+    s.m_hash        = hash;
+    ++m_size;
+
+    return std::pair<entry_type*, bool>(&get_entry(pos), true);
+};
+
+template<class Mapped>
+bool dbs_table<Mapped>::erase(const dbs& key)
+{
+    if (m_size == 0)
+        return false;
+
+    size_t mask     = m_slots.size() - 1;
+    size_t hole     = find_pos(key, get_hash(key));
+
+    if (m_slots[hole].m_hash == 0)
+        return false;
+
+    get_entry(hole).~entry_type();
+
+    // entries following the hole are moved back, if the hole is between
+    // their home positions and their current positions
+    for (size_t pos = (hole + 1) & mask; m_slots[pos].m_hash != 0; pos = (pos + 1) & mask)
+    {
+        size_t home     = home_pos(m_slots[pos].m_hash);
+
+        if (((pos - home) & mask) < ((pos - hole) & mask))
+            continue;
+
+        entry_type& entry   = get_entry(pos);
+
+        new (&m_slots[hole].m_entry) entry_type(std::move(entry));
+        entry.~entry_type();
+
+        m_slots[hole].m_hash    = m_slots[pos].m_hash;
+        hole                    = pos;
+    };
+
+    m_slots[hole].m_hash    = 0;
+    --m_size;
+
+    return true;
+};
+
+template<class Mapped>
+void dbs_table<Mapped>::clear()
+{
+    destroy_entries();
+
+    m_slots.clear();
+    m_size          = 0;
+};
+
+template<class Mapped>
+void dbs_table<Mapped>::reserve(size_t n)
+{
+    size_t capacity = 16;
+
+    while (3 * capacity < 4 * n)
+        capacity    *= 2;
+
+    if (capacity > m_slots.size())
+        rehash(capacity);
+};
+
+template<class Mapped>
+size_t dbs_table<Mapped>::size() const
+{
+    return m_size;
+};
+
+template<class Mapped>
+template<class Func>
+void dbs_table<Mapped>::for_each(Func& f) const
+{
+    for (size_t pos = 0; pos < m_slots.size(); ++pos)
+    {
+        if (m_slots[pos].m_hash != 0)
+            f(get_entry(pos));
+    };
+};
+
+template<class Mapped>
+void dbs_table<Mapped>::rehash(size_t capacity)
+{
+    std::vector<slot> old_slots(capacity, slot());
+    old_slots.swap(m_slots);
+
+    size_t mask     = capacity - 1;
+
+    for (slot& s : old_slots)
+    {
+        if (s.m_hash == 0)
+            continue;
+
+        entry_type& entry   = reinterpret_cast<entry_type&>(s.m_entry);
+        size_t pos          = home_pos(s.m_hash);
+
+        while (m_slots[pos].m_hash != 0)
+            pos             = (pos + 1) & mask;
+
+        new (&m_slots[pos].m_entry) entry_type(std::move(entry));
+        entry.~entry_type();
+
+        m_slots[pos].m_hash = s.m_hash;
+    };
+};
+
+template<class Mapped>
+void dbs_table<Mapped>::destroy_entries()
+{
+    for (size_t pos = 0; pos < m_slots.size(); ++pos)
+    {
+        if (m_slots[pos].m_hash != 0)
+        {
+            get_entry(pos).~entry_type();
+            m_slots[pos].m_hash = 0;
+        };
+    };
+};
+
+template<class Mapped>
+void dbs_table<Mapped>::copy_entries(const dbs_table& other)
+{
+    std::vector<slot> slots(other.m_slots.size(), slot());
+
+    for (size_t pos = 0; pos < slots.size(); ++pos)
+    {
+        if (other.m_slots[pos].m_hash == 0)
+            continue;
+
+        new (&slots[pos].m_entry) entry_type(other.get_entry(pos));
+        slots[pos].m_hash   = other.m_slots[pos].m_hash;
+    };
+
+    m_slots.swap(slots);
+    m_size          = other.m_size;
+};
+
+}};
+
+namespace dbs_lib
+{
+
+//-----------------------------------------------------------------
+//                      dbs_unordered_set
+//-----------------------------------------------------------------
+template<class Func>
+void dbs_unordered_set::for_each(Func&& f) const
+{
+    auto visit  = [&f](const table_type::entry_type& entry)
+    {
+        f(entry.m_key);
+    };
+
+    m_table.for_each(visit);
+};
+
+//-----------------------------------------------------------------
+//                      dbs_unordered_map
+//-----------------------------------------------------------------
+template<class T>
+dbs_unordered_map<T>::dbs_unordered_map()
+{};
+
+template<class T>
+T& dbs_unordered_map<T>::operator[](const dbs& key)
+{
+    return m_table.emplace(key).first->m_value;
+};
+
+template<class T>
+bool dbs_unordered_map<T>::insert(const dbs& key, const T& value)
+{
+    return m_table.emplace(key, value).second;
+};
+
+template<class T>
+bool dbs_unordered_map<T>::insert(const dbs& key, T&& value)
+{
+    return m_table.emplace(key, std::move(value)).second;
+};
+
+template<class T>
+T* dbs_unordered_map<T>::find(const dbs& key)
+{
+    auto entry  = m_table.find(key);
+    return entry ? &entry->m_value : nullptr;
+};
+
+template<class T>
+const T* dbs_unordered_map<T>::find(const dbs& key) const
+{
+    auto entry  = m_table.find(key);
+    return entry ? &entry->m_value : nullptr;
+};
+
+template<class T>
+bool dbs_unordered_map<T>::contains(const dbs& key) const
+{
+    return m_table.find(key) != nullptr;
+};
+
+template<class T>
+bool dbs_unordered_map<T>::erase(const dbs& key)
+{
+    return m_table.erase(key);
+};
+
+template<class T>
+size_t dbs_unordered_map<T>::size() const
+{
+    return m_table.size();
+};
+
+template<class T>
+bool dbs_unordered_map<T>::empty() const
+{
+    return m_table.size() == 0;
+};
+
+template<class T>
+void dbs_unordered_map<T>::clear()
+{
+    m_table.clear();
+};
+
+template<class T>
+void dbs_unordered_map<T>::reserve(size_t n)
+{
+    m_table.reserve(n);
+};
+
+template<class T>
+template<class Func>
+void dbs_unordered_map<T>::for_each(Func&& f)
+{
+    auto visit  = [&f](typename table_type::entry_type& entry)
+    {
+        f(static_cast<const dbs&>(entry.m_key), entry.m_value);
+    };
+
+    m_table.for_each(visit);
+};
+
+template<class T>
+template<class Func>
+void dbs_unordered_map<T>::for_each(Func&& f) const
+{
+    auto visit  = [&f](const typename table_type::entry_type& entry)
+    {
+        f(entry.m_key, static_cast<const T&>(entry.m_value));
+    };
+
+    m_table.for_each(visit);
+};
+
+}
@@ -0,0 +1,119 @@
+/*
+*  This file is a part of DBS library.
+*
+*  Copyright (c) Pawe Kowal 2017 - 2021
+*
+*  This program is free software; you can redistribute it and/or modify
+*  it under the terms of the GNU General Public License as published by
+*  the Free Software Foundation; either version 2 of the License, or
+*  (at your option) any later version.
+*
+*  This program is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU General Public License for more details.
+*
+*  You should have received a copy of the GNU General Public License
+*  along with this program; if not, write to the Free Software
+*  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+*/
+
+#pragma once
+
+#include "dbs/details/dbs_impl.h"
+#include "dbs/details/dbs_details.inl"
+
+#include <type_traits>
+
+namespace dbs_lib { namespace details
+{
+
+// call a visitor f; return false if the traversal should be stopped;
+// visitors returning void never stop the traversal
+template<class Func, class ... Args>
+DBS_FORCE_INLINE
+bool call_visitor(Func& f, Args ... args)
+{
+    using result_type   = decltype(f(args...));
+
+    if constexpr (std::is_same<result_type, void>::value)
+    {
+        f(args...);
+        return true;
+    }
+    else
+    {
+        return static_cast<bool>(f(args...));
+    };
+};
+
+// call f(offset, word_0, word_1) for every nonempty leaf of the tree
+// rooted at node; return false if the traversal was stopped
+template<class Func>
+bool visit_blocks(const dbs_impl& node, size_t offset, Func& f)
+{
+    using header_type   = block::header_type;
+
+    const block& data   = node.get_data();
+    size_t level        = data.get_level();
+
+    if (level == 0)
+    {
+        size_t lo, hi;
+        data.leaf_interleave(lo, hi);
+
+        // only root of an empty set can be empty
+        if (lo == 0 && hi == 0)
+            return true;
+
+        return call_visitor(f, offset, lo, hi);
+    };
+
+    size_t shift        = block::block_bits_log * level + 1;
+    size_t flags        = data.m_flags;
+    const dbs_set* set  = data.get_fsb_set();
+
+    for (size_t k = 0; flags != 0; ++k)
+    {
+        size_t pos      = header_type::least_significant_bit_pos(flags);
+
+        if (visit_blocks(set->get_elem(k), offset + (pos << shift), f) == false)
+            return false;
+
+        flags           = flags & (flags - 1);
+    };
+
+    return true;
+};
+
+}};
+
+namespace dbs_lib
+{
+
+template<class Func>
+bool dbs::for_each_block(Func&& f) const
+{
+    return details::visit_blocks(*this, 0, f);
+};
+
+template<class Func>
+bool dbs::for_each_word(Func&& f) const
+{
+    static const size_t block_bits  = details::block::block_bits;
+
+    auto visit_leaf = [&f](size_t offset, size_t word_0, size_t word_1) -> bool
+    {
+        if (word_0 != 0 && details::call_visitor(f, offset, word_0) == false)
+            return false;
+
+        if (word_1 != 0 && details::call_visitor(f, offset + block_bits, word_1) == false)
+            return false;
+
+        return true;
+    };
+
+    return details::visit_blocks(*this, 0, visit_leaf);
+};
+
+};
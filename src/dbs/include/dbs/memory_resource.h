@@ -0,0 +1,116 @@
+/*
+*  This file is a part of DBS library.
+*
+*  Copyright (c) Pawe Kowal 2017 - 2021
+*
+*  This program is free software; you can redistribute it and/or modify
+*  it under the terms of the GNU General Public License as published by
+*  the Free Software Foundation; either version 2 of the License, or
+*  (at your option) any later version.
+*
+*  This program is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU General Public License for more details.
+*
+*  You should have received a copy of the GNU General Public License
+*  along with this program; if not, write to the Free Software
+*  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+*/
+
+#pragma once
+
+#include "dbs/config.h"
+
+#include <cstddef>
+
+#ifdef DBS_HAS_PMR
+    #include <memory_resource>
+#endif
+
+namespace dbs_lib
+{
+
+// Source of memory for tree nodes of bitsets. Nodes are allocated from
+// pools of fixed size blocks; pools request memory from a memory resource.
+// Alternatively nodes can be allocated directly from the memory resource.
+//
+// A memory resource must outlive all bitsets allocated from it. Calls to
+// allocate and deallocate are serialized by the library. The memory resource
+// used for allocation of new tree nodes is selected separately by every
+// thread; new threads use the default memory resource. Parallel functions
+// (see dbs_parallel.h) allocate nodes from the memory resource of the 
+// calling thread.
+class memory_resource
+{
+    public:
+        virtual ~memory_resource() {};
+
+        // allocate bytes of memory aligned to alignment; throw 
+        // std::bad_alloc if memory cannot be allocated
+        virtual void*       allocate(size_t bytes, size_t alignment) = 0;
+
+        // release memory previously allocated by allocate
+        virtual void        deallocate(void* ptr, size_t bytes, size_t alignment) = 0;
+};
+
+// return memory resource using malloc and free; this is the default 
+// memory resource
+memory_resource*    malloc_resource();
+
+// return memory resource used to allocate new tree nodes by the current
+// thread
+memory_resource*    get_memory_resource();
+
+// use the memory resource res for allocation of new tree nodes by the
+// current thread; if use_pools is true, then nodes are allocated from pools, which request
+// memory from res, otherwise nodes are allocated directly from res;
+// return previous memory resource; at most 15 memory resources, different
+// than the default one, can be used at the same time
+memory_resource*    set_memory_resource(memory_resource* res, bool use_pools = true);
+
+// use given memory resource for allocation of new tree nodes by the current
+// thread until this object is destroyed; scopes must be destroyed by the
+// thread, that created them, in reverse order of creation; see also 
+// set_memory_resource
+class memory_resource_scope
+{
+    private:
+        size_t          m_previous;
+        size_t          m_tag;
+
+    public:
+        explicit memory_resource_scope(memory_resource* res, bool use_pools = true);
+        ~memory_resource_scope();
+
+        memory_resource_scope(const memory_resource_scope&) = delete;
+        memory_resource_scope& operator=(const memory_resource_scope&) = delete;
+};
+
+#ifdef DBS_HAS_PMR
+
+// memory resource forwarding requests to std::pmr::memory_resource
+class pmr_resource : public memory_resource
+{
+    private:
+        std::pmr::memory_resource*  m_resource;
+
+    public:
+        explicit pmr_resource(std::pmr::memory_resource* res)
+            :m_resource(res)
+        {};
+
+        void* allocate(size_t bytes, size_t alignment) override
+        {
+            return m_resource->allocate(bytes, alignment);
+        };
+
+        void deallocate(void* ptr, size_t bytes, size_t alignment) override
+        {
+            m_resource->deallocate(ptr, bytes, alignment);
+        };
+};
+
+#endif
+
+}
@@ -20,18 +20,101 @@
 
 #include "test_dbs.h"
 #include "dbs/dbs.h"
+#include "dbs/memory_resource.h"
+#include "dbs/dbs_parallel.h"
+#include "dbs/dbs_atom.h"
+#include "dbs/dbs_stream_builder.h"
+#include "dbs/dbs_history.h"
+#include "dbs/dbs_serialize.h"
+#include "dbs/dbs_view.h"
+#include "dbs/dbs_roaring.h"
+#include "dbs/dbs_diff.h"
+#include "dbs/dbs_unordered.h"
+#include "dbs/dbs_sketch.h"
 #include "timer.h"
 #include "rand.h"
 
 #include <set>
+#include <map>
+#include <unordered_set>
 #include <iostream>
 #include <algorithm>
+#include <iterator>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <stdexcept>
+#include <sstream>
+#include <fstream>
+#include <cstdio>
+#include <cstring>
+#include <cmath>
 
 #pragma warning(disable :4146)  // unary minus operator applied to unsigned type, result still unsigned
 
 namespace dbs_lib { namespace testing
 {
 
+// memory resource counting allocated memory
+class counting_resource : public memory_resource
+{
+    public:
+        size_t  m_bytes;
+        size_t  m_blocks;
+
+    public:
+        counting_resource()
+            :m_bytes(0), m_blocks(0)
+        {};
+
+        void* allocate(size_t bytes, size_t alignment) override
+        {
+            m_bytes     += bytes;
+            m_blocks    += 1;
+
+            return malloc_resource()->allocate(bytes, alignment);
+        };
+
+        void deallocate(void* ptr, size_t bytes, size_t alignment) override
+        {
+            m_bytes     -= bytes;
+            m_blocks    -= 1;
+
+            malloc_resource()->deallocate(ptr, bytes, alignment);
+        };
+};
+
+// sets created by several threads started during static initialization;
+// the library must be usable before main and these sets are released during
+// static destruction
+static dbs make_static_set()
+{
+    dbs sets[4];
+
+    #ifdef DBS_THREAD_SAFE
+        std::vector<std::thread> threads;
+
+        for (size_t i = 0; i < 4; ++i)
+        {
+            threads.push_back(std::thread([&sets, i]()
+            {
+                sets[i] = dbs{i, 1000 + i, size_t(-1) - i};
+            }));
+        };
+
+        for (auto& th : threads)
+            th.join();
+    #else
+        // nodes cannot be allocated concurrently
+        for (size_t i = 0; i < 4; ++i)
+            sets[i]     = dbs{i, 1000 + i, size_t(-1) - i};
+    #endif
+
+    return dbs(sets[0] | sets[1] | sets[2] | sets[3]);
+};
+
+static dbs g_static_set = make_static_set();
+
 bool test_dbs::test_all(size_t n_rep)
 {
     bool ret        = true;               
@@ -48,6 +131,29 @@ bool test_dbs::test_all(size_t n_rep)
     ret             &= test_and_all(n_rep);
     ret             &= test_or_all(n_rep);
     ret             &= test_xor_all(n_rep);
+    ret             &= test_reclaim_all(n_rep);
+    ret             &= test_resource_all(n_rep);
+    ret             &= test_move_all(n_rep);
+    ret             &= test_iterator_all(n_rep);
+    ret             &= test_decode_all(n_rep);
+    ret             &= test_next_all(n_rep);
+    ret             &= test_visitor_all(n_rep);
+    ret             &= test_expr_all(n_rep);
+    ret             &= test_parallel_all(n_rep);
+    ret             &= test_init_all(n_rep);
+    ret             &= test_atom_all(n_rep);
+    ret             &= test_from_unsorted_all(n_rep);
+    ret             &= test_stream_builder_all(n_rep);
+    ret             &= test_history_all(n_rep);
+    ret             &= test_serialize_all(n_rep);
+    ret             &= test_view_all(n_rep);
+    ret             &= test_roaring_all(n_rep);
+    ret             &= test_text_all(n_rep);
+    ret             &= test_diff_all(n_rep);
+    ret             &= test_hash_all(n_rep);
+    ret             &= test_compare_elements_all(n_rep);
+    ret             &= test_unordered_all(n_rep);
+    ret             &= test_sketch_all(n_rep);
 
     return ret;
 };
@@ -77,6 +183,108 @@ void test_dbs::test_perf_all(size_t n_rep, bool& ret)
 
         std::cout << "find - " << max_elem << ": set " << t1 << ", dbs " << t2 << ", ratio " << t1/t2 << "\n";
     };
+
+    {
+        size_t max_elem = 64*32*32*32*32;
+        size_t n_items  = 1000;
+        size_t n_alloc  = n_rep / 100;
+
+        double t1       = test_perf_alloc(max_elem, n_items, n_alloc);
+
+        counting_resource res;
+        double t2;
+        {
+            memory_resource_scope scope(&res);
+            t2          = test_perf_alloc(max_elem, n_items, n_alloc);
+        };
+
+        std::cout << "alloc - pools: malloc " << t1 << ", counting resource " << t2 << "\n";
+
+        #ifdef DBS_HAS_PMR
+        {
+            std::pmr::unsynchronized_pool_resource pool;
+            pmr_resource res_pool(&pool);
+            pmr_resource res_new(std::pmr::new_delete_resource());
+
+            double t3, t4;
+            {
+                memory_resource_scope scope(&res_new);
+                t3      = test_perf_alloc(max_elem, n_items, n_alloc);
+            };
+            {
+                memory_resource_scope scope(&res_pool, false);
+                t4      = test_perf_alloc(max_elem, n_items, n_alloc);
+            };
+
+            std::cout << "alloc - pools: pmr new_delete " << t3 
+                      << ", no pools: pmr unsynchronized_pool " << t4 << "\n";
+        };
+        #endif
+    };
+
+    test_perf_refcount(64*32*32*32*32, 1000, n_rep / 100);
+    test_perf_iterator(64*32*32*32*32, 100000, n_rep / 1000);
+    test_perf_expr(64*32*32*32*32, 10000, n_rep / 100);
+    test_perf_parallel(64*32*32*32*32, 1000000, n_rep / 10000);
+
+    // inputs up to 10^9 elements can be tested; 16 bytes of memory per
+    // element are required
+    for (size_t n_items : {size_t(1000000), size_t(10000000)})
+        test_perf_from_unsorted(n_items * 4, n_items);
+
+    test_perf_stream_builder(64*32*32*32*32, 10000000);
+    test_perf_history(64*32*32*32*32, 1000000, 100);
+    test_perf_serialize(64*32*32*32*32, 1000000);
+    test_perf_serialize_collection(64*32*32*32*32, 1000000, 100);
+    test_perf_view(64*32*32*32*32, 1000000, 1000000);
+
+    // sparse, dense and run-heavy sets
+    test_perf_roaring(size_t(1) << 32, 1000000, 0);
+    test_perf_roaring(4000000, 1000000, 0);
+    test_perf_roaring(size_t(1) << 32, 10000, 200);
+
+    test_perf_text(64*32*32*32*32, 1000000, 0);
+    test_perf_text(size_t(1) << 32, 10000, 200);
+    test_perf_diff(64*32*32*32*32, 1000000, 100, n_rep / 1000);
+    test_perf_hash(64*32*32*32*32, 100000, 10000);
+    test_perf_unordered(64*32*32*32*32, 100000, 10000);
+    test_perf_sketch(64*32*32*32*32, 1000000);
+
+    #ifdef DBS_THREAD_SAFE
+        for (size_t n_threads : {1, 2, 4})
+        {
+            double t1   = test_perf_atom(n_threads, n_rep * 10, 0.05);
+            double t2   = test_perf_atom(n_threads, n_rep * 10, 0.5);
+
+            std::cout << "atom - threads " << n_threads << ", read-mostly " << t1 
+                      << ", write-heavy " << t2 << "\n";
+        };
+    #endif
+};
+
+
+double test_dbs::test_perf_alloc(size_t max_elem, size_t n_items, size_t n_rep)
+{
+    std::set<size_t> s      = this->rand_set(max_elem, n_items);
+    std::vector<size_t> sv  = to_vector(s);
+
+    std::vector<size_t> v;
+    v.reserve(n_rep);
+
+    for(size_t i = 0; i < n_rep; ++i)
+        v.push_back(rand_elem(max_elem));
+
+    tic();
+
+    dbs bs(sv.size(), sv.data());
+
+    for(size_t i = 0; i < n_rep; ++i)
+    {
+        dbs tmp(sv.size(), sv.data());
+        bs  = bs.flip(v[i]) | tmp;
+    };
+
+    return toc();
 };
 
 double test_dbs::test_perf_find_set(size_t max_elem, size_t n_rep, bool& ret)
@@ -101,694 +309,4076 @@ double test_dbs::test_perf_find_dbs(size_t max_elem, size_t n_rep, bool& ret)
     return t;
 }; 
 
-bool test_dbs::test_perf_find_set(size_t max_elem, size_t n_items, size_t n_rep, double& t)
+void test_dbs::test_perf_refcount(size_t max_elem, size_t n_items, size_t n_rep)
 {
-    std::set<size_t> s = this->rand_set(max_elem, n_items);
+    #ifdef DBS_REFCOUNT_STATS
+        std::vector<dbs> sets;
 
-    std::vector<size_t> v;
-    v.reserve(n_rep);
+        for(size_t i = 0; i < n_rep; ++i)
+        {
+            std::set<size_t> s      = this->rand_set(max_elem, n_items);
+            std::vector<size_t> sv  = to_vector(s);
 
-    double tol = 0.5;
+            sets.push_back(dbs(sv.size(), sv.data()));
+        };
 
-    for(size_t i = 0; i < n_rep; ++i)
-    {
-        size_t elem = rand_elem(max_elem);
+        size_t n_ops    = refcount_operations();
 
-        if (testing::genrand_real1() < tol)
-        {
-            v.push_back(elem);
-        }
-        else
+        for(size_t i = 1; i < n_rep; ++i)
         {
-            v.push_back(elem);
-            s.insert(elem);
+            dbs tmp     = (sets[i - 1] | sets[i]) ^ (sets[i - 1] & sets[i]);
+            (void)tmp;
         };
-    };
-
-    bool val = false;
-    tic();
 
-    for(size_t i = 0; i < n_rep; ++i)
-        val |= (s.find(v[i]) != s.end());
+        n_ops           = refcount_operations() - n_ops;
 
-    t += toc();
+        std::cout << "refcount operations per operator: " << double(n_ops) / (3 * (n_rep - 1)) << "\n";
+    #else
+        (void)max_elem;
+        (void)n_items;
+        (void)n_rep;
 
-    return val;
-};  
+        std::cout << "refcount operations: not counted, DBS_REFCOUNT_STATS is not defined\n";
+    #endif
+};
 
-bool test_dbs::test_perf_find_dbs(size_t max_elem, size_t n_items, size_t n_rep, double& t)
+void test_dbs::test_perf_parallel(size_t max_elem, size_t n_items, size_t n_rep)
 {
     std::set<size_t> s      = this->rand_set(max_elem, n_items);
     std::vector<size_t> sv  = to_vector(s);
 
     dbs bs(sv.size(), sv.data());
 
-    std::vector<size_t> v;
-    v.reserve(n_rep);
-
-    double tol = 0.5;
+    size_t size_1   = 0;
+    size_t size_2   = 0;
 
+    tic();
     for(size_t i = 0; i < n_rep; ++i)
     {
-        size_t elem = rand_elem(max_elem);
-
-        if (genrand_real1() < tol)
-        {
-            v.push_back(elem);
-        }
-        else
-        {
-            v.push_back(elem);
-            bs = bs.set(elem);
-        };
+        std::vector<size_t> elems;
+        bs.get_elements(elems);
+        size_1      += elems.size() + bs.size();
     };
+    double t1       = toc();
 
     tic();
-
-    bool val = false;
-    
     for(size_t i = 0; i < n_rep; ++i)
-        val |= bs.test(v[i]);
+    {
+        std::vector<size_t> elems;
+        parallel_get_elements(bs, elems);
+        size_2      += elems.size() + parallel_size(bs);
+    };
+    double t2       = toc();
 
-    t += toc();
+    std::cout << "parallel - threads " << get_parallel_threads() << ", sequential " << t1 
+              << ", parallel " << t2 << (size_1 == size_2 ? "" : " FAILED") << "\n";
 
-    return val;
-}; 
+    #ifdef DBS_THREAD_SAFE
+        std::set<size_t> s2     = this->rand_set(max_elem, n_items);
+        std::vector<size_t> sv2 = to_vector(s2);
 
-bool test_dbs::test_set_all(size_t n_rep)
-{
-    bool ret    = true;
+        dbs bs2(sv2.size(), sv2.data());
 
-    for (size_t i = 0; i < n_rep; ++i)
-    {
-        ret         &= test_set(64*32, 10);
-        ret         &= test_set(64*32, 100);
-        //ret       &= test_set(64*32, 1000);
+        bool ok         = true;
 
-        ret         &= test_set(64*32*32*32*32, 10);
-        ret         &= test_set(64*32*32*32*32, 100);
-        //ret       &= test_set(64*32*32*32*32, 1000);
+        tic();
+        for(size_t i = 0; i < n_rep; ++i)
+        {
+            dbs r1      = bs | bs2;
+            dbs r2      = bs & bs2;
+            ok          &= r1.any() && r2.any();
+        };
+        double t3       = toc();
 
-        ret         &= test_set(-size_t(1), 10);
-        ret         &= test_set(-size_t(1), 100);
-        //ret       &= test_set(-size_t(1), 1000);
-    };
+        tic();
+        for(size_t i = 0; i < n_rep; ++i)
+        {
+            dbs r1      = parallel_or(bs, bs2);
+            dbs r2      = parallel_and(bs, bs2);
+            ok          &= r1.any() && r2.any();
+        };
+        double t4       = toc();
 
-    std::cout << "test_set: " << (ret? "OK" : "FAILED") << "\n";
-    return ret;
+        std::cout << "parallel operators - sequential " << t3 << ", parallel " << t4 
+                  << (ok ? "" : " FAILED") << "\n";
+    #endif
 };
-bool test_dbs::test_constructor_all(size_t n_rep)
+
+void test_dbs::test_perf_from_unsorted(size_t max_elem, size_t n_items)
 {
-    bool ret    = true;
+    std::vector<size_t> v(n_items);
 
-    for (size_t i = 0; i < n_rep; ++i)
-    {
-        ret         &= test_constructor(64*32, 10);
-        ret         &= test_constructor(64*32, 100);
-        ret         &= test_constructor(64*32, 1000);
+    for (size_t i = 0; i < n_items; ++i)
+        v[i]        = rand_elem(max_elem);
 
-        ret         &= test_constructor(64*32*32*32*32, 10);
-        ret         &= test_constructor(64*32*32*32*32, 100);
-        ret         &= test_constructor(64*32*32*32*32, 1000);
+    tic();
+    std::vector<size_t> sorted  = v;
+    std::sort(sorted.begin(), sorted.end());
+    sorted.erase(std::unique(sorted.begin(), sorted.end()), sorted.end());
 
-        ret         &= test_constructor(-size_t(1), 10);
-        ret         &= test_constructor(-size_t(1), 100);
-        ret         &= test_constructor(-size_t(1), 1000);
-    };
+    dbs bs1(sorted.size(), sorted.data());
+    double t1       = toc();
 
-    std::cout << "test_constructor: " << (ret? "OK" : "FAILED") << "\n";
-    return ret;
+    tic();
+    dbs bs2         = dbs::from_unsorted(v.size(), v.data());
+    double t2       = toc();
+
+    std::cout << "from_unsorted - " << n_items << " elements, threads " << get_parallel_threads() 
+              << ": sort and build " << n_items / t1 / 1e6 << " M/s, from_unsorted " 
+              << n_items / t2 / 1e6 << " M/s" << (bs1 == bs2 ? "" : " FAILED") << "\n";
 };
 
-bool test_dbs::test_find_all(size_t n_rep)
+void test_dbs::test_perf_stream_builder(size_t max_elem, size_t n_items)
 {
-    bool ret    = true;
+    std::vector<size_t> v(n_items);
 
-    size_t n_search = 100;
+    for (size_t i = 0; i < n_items; ++i)
+        v[i]        = rand_elem(max_elem);
 
-    for (size_t i = 0; i < n_rep; ++i)
-    {
-        ret         &= test_find(64*32, 10, n_search);
-        ret         &= test_find(64*32, 100, n_search);
-        ret         &= test_find(64*32, 1000, n_search);
+    std::sort(v.begin(), v.end());
+    v.erase(std::unique(v.begin(), v.end()), v.end());
 
-        ret         &= test_find(64*32*32*32*32, 10, n_search);
-        ret         &= test_find(64*32*32*32*32, 100, n_search);
-        ret         &= test_find(64*32*32*32*32, 1000, n_search);
+    tic();
+    dbs bs1(v.size(), v.data());
+    double t1       = toc();
 
-        ret         &= test_find(-size_t(1), 10, n_search);
-        ret         &= test_find(-size_t(1), 100, n_search);
-        ret         &= test_find(-size_t(1), 1000, n_search);
-    };
+    tic();
+    dbs_stream_builder builder;
 
-    std::cout << "test_find: " << (ret? "OK" : "FAILED") << "\n";
-    return ret;
+    for (size_t elem : v)
+        builder.push(elem);
+
+    dbs bs2         = builder.finish();
+    double t2       = toc();
+
+    std::cout << "stream builder - " << v.size() << " elements: array " << t1 
+              << ", stream " << t2 << (bs1 == bs2 ? "" : " FAILED") << "\n";
 };
 
-bool test_dbs::test_reset_all(size_t n_rep)
+void test_dbs::test_perf_history(size_t max_elem, size_t n_items, size_t n_versions)
 {
-    bool ret    = true;
+    std::set<size_t> s      = rand_set(max_elem, n_items);
+    std::vector<size_t> sv  = to_vector(s);
 
-    size_t n_search = 100;
+    dbs bs(sv.size(), sv.data());
+    dbs_history history;
 
-    for (size_t i = 0; i < n_rep; ++i)
+    tic();
+    for (size_t i = 0; i < n_versions; ++i)
     {
-        ret         &= test_reset(64*32, 10, n_search);
-        ret         &= test_reset(64*32, 100, n_search);
-        ret         &= test_reset(64*32, 1000, n_search);
+        for (size_t j = 0; j < 100; ++j)
+            bs      = bs.flip(rand_elem(max_elem));
 
-        ret         &= test_reset(64*32*32*32*32, 10, n_search);
-        ret         &= test_reset(64*32*32*32*32, 100, n_search);
-        ret         &= test_reset(64*32*32*32*32, 1000, n_search);
-
-        ret         &= test_reset(-size_t(1), 10, n_search);
-        ret         &= test_reset(-size_t(1), 100, n_search);
-        ret         &= test_reset(-size_t(1), 1000, n_search);
+        history.commit(bs);
     };
+    double t        = toc();
 
-    std::cout << "test_reset: " << (ret? "OK" : "FAILED") << "\n";
-    return ret;
+    history_memory mem  = history.memory();
+
+    std::cout << "history - " << n_versions << " versions: time " << t << ", bytes " << mem.m_bytes 
+              << ", unshared bytes " << mem.m_unshared_bytes << ", ratio " 
+              << double(mem.m_unshared_bytes) / double(mem.m_bytes) << "\n";
 };
 
-bool test_dbs::test_not_all(size_t n_rep)
+void test_dbs::test_perf_serialize(size_t max_elem, size_t n_items)
 {
-    bool ret    = true;
-
-    size_t n_search = 100;
+    std::set<size_t> s      = rand_set(max_elem, n_items);
+    std::vector<size_t> sv  = to_vector(s);
 
-    for (size_t i = 0; i < n_rep; ++i)
-    {
-        ret         &= test_not(64*32, 10, n_search);
-        ret         &= test_not(64*32, 100, n_search);
-        ret         &= test_not(64*32, 1000, n_search);
+    dbs bs(sv.size(), sv.data());
+    std::vector<unsigned char> image;
 
-        ret         &= test_not(64*32*32*32*32, 10, n_search);
-        ret         &= test_not(64*32*32*32*32, 100, n_search);
-        ret         &= test_not(64*32*32*32*32, 1000, n_search);
+    tic();
+    serialize(bs, image);
+    double t1       = toc();
 
-        ret         &= test_not(-size_t(1), 10, n_search);
-        ret         &= test_not(-size_t(1), 100, n_search);
-        ret         &= test_not(-size_t(1), 1000, n_search);
-    };
+    tic();
+    dbs bs2         = deserialize(image.data(), image.size());
+    double t2       = toc();
 
-    std::cout << "test_not: " << (ret? "OK" : "FAILED") << "\n";
-    return ret;
+    std::cout << "serialize - " << sv.size() << " elements: bytes per element " 
+              << double(image.size()) / double(sv.size()) << ", write " << t1 
+              << ", read " << t2 << (bs == bs2 ? "" : " FAILED") << "\n";
 };
 
-bool test_dbs::test_eq_all(size_t n_rep)
+void test_dbs::test_perf_view(size_t max_elem, size_t n_items, size_t n_rep)
 {
-    bool ret    = true;
+    std::set<size_t> s      = rand_set(max_elem, n_items);
+    std::vector<size_t> sv  = to_vector(s);
+
+    dbs bs(sv.size(), sv.data());
+    std::vector<unsigned char> image;
+    freeze(bs, image);
+
+    tic();
+    std::vector<unsigned char> serialized;
+    serialize(bs, serialized);
+    dbs bs2         = deserialize(serialized.data(), serialized.size());
+    double t1       = toc();
+
+    tic();
+    dbs_view view(image.data(), image.size());
+    double t2       = toc();
 
+    std::vector<size_t> queries;
     for (size_t i = 0; i < n_rep; ++i)
-    {
-        ret         &= test_eq(64*32, 10);
-        ret         &= test_eq(64*32, 100);
-        ret         &= test_eq(64*32, 1000);
+        queries.push_back(rand_elem(max_elem));
 
-        ret         &= test_eq(64*32*32*32*32, 10);
-        ret         &= test_eq(64*32*32*32*32, 100);
-        ret         &= test_eq(64*32*32*32*32, 1000);
+    size_t hits_1   = 0;
+    size_t hits_2   = 0;
 
-        ret         &= test_eq(-size_t(1), 10);
-        ret         &= test_eq(-size_t(1), 100);
-        ret         &= test_eq(-size_t(1), 1000);
-    };
+    tic();
+    for (size_t elem : queries)
+        hits_1      += bs.test(elem) ? 1 : 0;
+    double t3       = toc();
 
-    std::cout << "test_eq: " << (ret? "OK" : "FAILED") << "\n";
-    return ret;
+    tic();
+    for (size_t elem : queries)
+        hits_2      += view.test(elem) ? 1 : 0;
+    double t4       = toc();
+
+    std::cout << "view - " << sv.size() << " elements: deserialize " << t1 << ", open view " 
+              << t2 << "; " << n_rep << " tests: dbs " << t3 << ", view " << t4 
+              << (hits_1 == hits_2 && bs2 == bs ? "" : " FAILED") << "\n";
 };
 
-bool test_dbs::test_neq_all(size_t n_rep)
+void test_dbs::test_perf_serialize_collection(size_t max_elem, size_t n_items, size_t n_sets)
 {
-    bool ret    = true;
+    std::set<size_t> s      = rand_set(max_elem, n_items);
+    std::vector<size_t> sv  = to_vector(s);
 
-    for (size_t i = 0; i < n_rep; ++i)
+    // versions derived from one another
+    std::vector<dbs> sets   = {dbs(sv.size(), sv.data())};
+
+    for (size_t i = 1; i < n_sets; ++i)
     {
-        ret         &= test_eq(64*32, 10);
-        ret         &= test_eq(64*32, 100);
+        dbs bs      = sets.back();
+
+        for (size_t j = 0; j < 100; ++j)
+            bs      = bs.flip(rand_elem(max_elem));
+
+        sets.push_back(bs);
+    };
+
+    size_t independent  = 0;
+
+    for (const dbs& bs : sets)
+    {
+        std::vector<unsigned char> image;
+        serialize(bs, image);
+        independent     += image.size();
+    };
+
+    std::vector<unsigned char> image;
+
+    tic();
+    serialize_collection(sets, image);
+    double t1       = toc();
+
+    tic();
+    std::vector<dbs> sets2  = deserialize_collection(image.data(), image.size());
+    double t2       = toc();
+
+    std::cout << "serialize collection - " << n_sets << " versions: independent bytes " 
+              << independent << ", collection bytes " << image.size() << ", ratio " 
+              << double(independent) / double(image.size()) << ", write " << t1 
+              << ", read " << t2 << (sets2 == sets ? "" : " FAILED") << "\n";
+};
+
+void test_dbs::test_perf_roaring(size_t max_elem, size_t n_items, size_t n_ranges)
+{
+    std::set<size_t> s      = rand_set(max_elem, n_items);
+    std::vector<size_t> sv  = to_vector(s);
+    add_ranges(sv, max_elem, n_ranges);
+
+    dbs bs                  = dbs::from_unsorted(sv.size(), sv.data());
+
+    std::vector<unsigned char> serialized;
+    serialize(bs, serialized);
+
+    std::vector<unsigned char> image;
+
+    tic();
+    to_roaring(bs, image);
+    double t1       = toc();
+
+    tic();
+    dbs bs2         = from_roaring(image.data(), image.size());
+    double t2       = toc();
+
+    std::cout << "roaring - " << bs.size() << " elements: roaring bytes " << image.size() 
+              << ", dbs image bytes " << serialized.size() << ", export " << t1 
+              << ", import " << t2 
+              << (bs2 == bs ? "" : " FAILED") << "\n";
+};
+
+void test_dbs::test_perf_text(size_t max_elem, size_t n_items, size_t n_ranges)
+{
+    std::set<size_t> s      = rand_set(max_elem, n_items);
+    std::vector<size_t> sv  = to_vector(s);
+    add_ranges(sv, max_elem, n_ranges);
+
+    dbs bs                  = dbs::from_unsorted(sv.size(), sv.data());
+
+    std::cout << "text - " << bs.size() << " elements:";
+
+    for (text_format format : {text_format::list, text_format::ranges, text_format::hex})
+    {
+        std::ostringstream os;
+
+        tic();
+        write_text(os, bs, format);
+        double t1   = toc();
+
+        std::string text    = os.str();
+
+        tic();
+        dbs bs2     = dbs::parse(text);
+        double t2   = toc();
+
+        std::cout << " [bytes " << text.size() << ", write " << t1 << ", parse " << t2 
+                  << (bs2 == bs ? "" : " FAILED") << "]";
+    };
+
+    std::cout << "\n";
+};
+
+void test_dbs::test_perf_diff(size_t max_elem, size_t n_items, size_t n_changes, size_t n_rep)
+{
+    std::set<size_t> s      = rand_set(max_elem, n_items);
+    std::vector<size_t> sv  = to_vector(s);
+
+    dbs old_set(sv.size(), sv.data());
+    dbs new_set             = old_set;
+
+    for (size_t i = 0; i < n_changes; ++i)
+        new_set             = new_set.flip(rand_elem(max_elem));
+
+    size_t n1 = 0, n2 = 0;
+
+    tic();
+    for (size_t i = 0; i < n_rep; ++i)
+        n1                  += dbs(old_set ^ new_set).size();
+    double t1               = toc();
+
+    tic();
+    for (size_t i = 0; i < n_rep; ++i)
+    {
+        dbs_patch patch     = diff(old_set, new_set);
+        n2                  += patch.added().size() + patch.removed().size();
+    };
+    double t2               = toc();
+
+    std::cout << "diff - " << n_changes << " changes: xor " << t1 << ", diff " << t2 
+              << ", ratio " << t1 / t2 << (n1 == n2 ? "" : " FAILED") << "\n";
+};
+
+void test_dbs::test_perf_hash(size_t max_elem, size_t n_items, size_t n_sets)
+{
+    std::set<size_t> s      = rand_set(max_elem, n_items);
+    std::vector<size_t> sv  = to_vector(s);
+
+    dbs bs(sv.size(), sv.data());
+    std::vector<dbs> sets;
+
+    for (size_t i = 0; i < n_sets; ++i)
+    {
+        bs                  = bs.flip(rand_elem(max_elem));
+        sets.push_back(bs);
+    };
+
+    struct dbs_hasher
+    {
+        size_t operator()(const dbs& x) const   { return hash_value(x); };
+    };
+
+    std::unordered_set<dbs, dbs_hasher> table;
+
+    tic();
+    for (const dbs& x : sets)
+        table.insert(x);
+
+    size_t found            = 0;
+    for (const dbs& x : sets)
+        found               += table.count(x);
+    double t                = toc();
+
+    std::cout << "hash - " << n_sets << " sets of " << n_items << " elements: unordered_set "
+              << t << (found == table.size() ? "" : " FAILED") << "\n";
+};
+
+void test_dbs::test_perf_unordered(size_t max_elem, size_t n_items, size_t n_sets)
+{
+    std::set<size_t> s      = rand_set(max_elem, n_items);
+    std::vector<size_t> sv  = to_vector(s);
+
+    dbs bs(sv.size(), sv.data());
+    std::vector<dbs> sets;
+
+    for (size_t i = 0; i < n_sets; ++i)
+    {
+        bs                  = bs.flip(rand_elem(max_elem));
+        sets.push_back(bs);
+    };
+
+    struct dbs_hasher
+    {
+        size_t operator()(const dbs& x) const   { return hash_value(x); };
+    };
+
+    std::unordered_set<dbs, dbs_hasher> std_table;
+    dbs_unordered_set table;
+
+    tic();
+    for (const dbs& x : sets)
+        std_table.insert(x);
+    double t1               = toc();
+
+    tic();
+    for (const dbs& x : sets)
+        table.insert(x);
+    double t2               = toc();
+
+    tic();
+    size_t found_1          = 0;
+    for (const dbs& x : sets)
+        found_1             += std_table.count(x);
+    double t3               = toc();
+
+    tic();
+    size_t found_2          = 0;
+    for (const dbs& x : sets)
+        found_2             += table.contains(x) ? 1 : 0;
+    double t4               = toc();
+
+    std::cout << "unordered - " << n_sets << " sets: insert unordered_set " << t1 
+              << ", dbs_unordered_set " << t2 << ", find unordered_set " << t3 
+              << ", dbs_unordered_set " << t4 << ", ratio " << t3 / t4
+              << (found_1 == found_2 ? "" : " FAILED") << "\n";
+};
+
+void test_dbs::test_perf_sketch(size_t max_elem, size_t n_items)
+{
+    std::set<size_t> s      = rand_set(max_elem, n_items);
+    std::vector<size_t> sv  = to_vector(s);
+
+    dbs bs(sv.size(), sv.data());
+
+    tic();
+    size_t n                = bs.size();
+    double t0               = toc();
+
+    tic();
+    dbs_minhash m1(bs, 128, minhash_kind::k_hash);
+    double t1               = toc();
+
+    tic();
+    dbs_minhash m2(bs, 128, minhash_kind::one_permutation);
+    double t2               = toc();
+
+    tic();
+    dbs_hll h(bs);
+    double t3               = toc();
+
+    std::cout << "sketch - " << n_items << " elements: size " << t0 << ", k-hash " << t1 
+              << ", one permutation " << t2 << ", hll " << t3
+              << (m1.count() == n && m2.count() == n ? "" : " FAILED") << "\n";
+};
+
+double test_dbs::test_perf_atom(size_t n_threads, size_t n_ops, double write_ratio)
+{
+    #ifdef DBS_THREAD_SAFE
+        static const size_t max_elem    = 64*32*32*32;
+
+        std::set<size_t> s      = this->rand_set(max_elem, 1000);
+        std::vector<size_t> sv  = to_vector(s);
+
+        dbs_atom atom(dbs(sv.size(), sv.data()));
+
+        size_t write_limit      = static_cast<size_t>(write_ratio * 1024);
+        std::atomic<size_t> hits(0);
+        std::vector<std::thread> threads;
+
+        tic();
+
+        for (size_t t = 0; t < n_threads; ++t)
+        {
+            threads.push_back(std::thread([&, t]()
+            {
+                // linear congruential generator local to the thread
+                size_t state    = t + 1;
+                size_t n_hits   = 0;
+
+                for (size_t i = 0; i < n_ops / n_threads; ++i)
+                {
+                    state       = state * 6364136223846793005ull + 1442695040888963407ull;
+                    size_t r    = state >> 16;
+                    size_t elem = r % max_elem;
+
+                    if ((r >> 24) % 1024 < write_limit)
+                        atom.update([elem](const dbs& x) { return x.flip(elem); });
+                    else
+                        n_hits  += atom.load().test(elem) ? 1 : 0;
+                };
+
+                hits    += n_hits;
+            }));
+        };
+
+        for (std::thread& th : threads)
+            th.join();
+
+        return toc();
+    #else
+        (void)n_threads;
+        (void)n_ops;
+        (void)write_ratio;
+        return 0.0;
+    #endif
+};
+
+void test_dbs::test_perf_iterator(size_t max_elem, size_t n_items, size_t n_rep)
+{
+    std::set<size_t> s      = this->rand_set(max_elem, n_items);
+    std::vector<size_t> sv  = to_vector(s);
+
+    dbs bs(sv.size(), sv.data());
+
+    size_t sum_1    = 0;
+    size_t sum_2    = 0;
+    size_t sum_3    = 0;
+
+    tic();
+    for(size_t i = 0; i < n_rep; ++i)
+    {
+        for (size_t elem : s)
+            sum_1   += elem;
+    };
+    double t1       = toc();
+
+    tic();
+    for(size_t i = 0; i < n_rep; ++i)
+    {
+        for (size_t elem : bs)
+            sum_2   += elem;
+    };
+    double t2       = toc();
+
+    tic();
+    for(size_t i = 0; i < n_rep; ++i)
+    {
+        std::vector<size_t> elems;
+        bs.get_elements(elems);
+
+        for (size_t elem : elems)
+            sum_3   += elem;
+    };
+    double t3       = toc();
+
+    size_t sum_4    = 0;
+    size_t chunk[256];
+
+    tic();
+    for(size_t i = 0; i < n_rep; ++i)
+    {
+        dbs::const_iterator pos = bs.begin();
+
+        while (size_t n = bs.get_elements(pos, chunk, 256))
+        {
+            for (size_t j = 0; j < n; ++j)
+                sum_4   += chunk[j];
+        };
+    };
+    double t4       = toc();
+
+    std::cout << "iterate - set " << t1 << ", dbs iterator " << t2 << ", dbs get_elements " << t3
+              << ", dbs chunks " << t4
+              << (sum_1 == sum_2 && sum_1 == sum_3 && sum_1 == sum_4 ? "" : " FAILED") << "\n";
+};
+
+void test_dbs::test_perf_expr(size_t max_elem, size_t n_items, size_t n_rep)
+{
+    std::vector<dbs> sets;
+
+    for(size_t i = 0; i < 4; ++i)
+    {
+        std::set<size_t> s      = this->rand_set(max_elem, n_items);
+
+        // sets share some elements
+        std::set<size_t> s2     = this->rand_set(max_elem / 16, n_items);
+        s.insert(s2.begin(), s2.end());
+
+        std::vector<size_t> sv  = to_vector(s);
+        sets.push_back(dbs(sv.size(), sv.data()));
+    };
+
+    const dbs& a    = sets[0];
+    const dbs& b    = sets[1];
+    const dbs& c    = sets[2];
+    const dbs& d    = sets[3];
+
+    size_t sum_1    = 0;
+    size_t sum_2    = 0;
+    size_t sum_3    = 0;
+
+    tic();
+    for(size_t i = 0; i < n_rep; ++i)
+    {
+        dbs tmp_1   = a & b;
+        dbs tmp_2   = c - d;
+        dbs res     = tmp_1 | tmp_2;
+        sum_1       += res.size();
+    };
+    double t1       = toc();
+
+    tic();
+    for(size_t i = 0; i < n_rep; ++i)
+    {
+        dbs res     = (a & b) | (c - d);
+        sum_2       += res.size();
+    };
+    double t2       = toc();
+
+    tic();
+    for(size_t i = 0; i < n_rep; ++i)
+        sum_3       += ((a & b) | (c - d)).count();
+
+    double t3       = toc();
+
+    std::cout << "expression - pairwise " << t1 << ", fused " << t2 << ", count only " << t3
+              << (sum_1 == sum_2 && sum_1 == sum_3 ? "" : " FAILED") << "\n";
+};
+
+bool test_dbs::test_perf_find_set(size_t max_elem, size_t n_items, size_t n_rep, double& t)
+{
+    std::set<size_t> s = this->rand_set(max_elem, n_items);
+
+    std::vector<size_t> v;
+    v.reserve(n_rep);
+
+    double tol = 0.5;
+
+    for(size_t i = 0; i < n_rep; ++i)
+    {
+        size_t elem = rand_elem(max_elem);
+
+        if (testing::genrand_real1() < tol)
+        {
+            v.push_back(elem);
+        }
+        else
+        {
+            v.push_back(elem);
+            s.insert(elem);
+        };
+    };
+
+    bool val = false;
+    tic();
+
+    for(size_t i = 0; i < n_rep; ++i)
+        val |= (s.find(v[i]) != s.end());
+
+    t += toc();
+
+    return val;
+};  
+
+bool test_dbs::test_perf_find_dbs(size_t max_elem, size_t n_items, size_t n_rep, double& t)
+{
+    std::set<size_t> s      = this->rand_set(max_elem, n_items);
+    std::vector<size_t> sv  = to_vector(s);
+
+    dbs bs(sv.size(), sv.data());
+
+    std::vector<size_t> v;
+    v.reserve(n_rep);
+
+    double tol = 0.5;
+
+    for(size_t i = 0; i < n_rep; ++i)
+    {
+        size_t elem = rand_elem(max_elem);
+
+        if (genrand_real1() < tol)
+        {
+            v.push_back(elem);
+        }
+        else
+        {
+            v.push_back(elem);
+            bs = bs.set(elem);
+        };
+    };
+
+    tic();
+
+    bool val = false;
+    
+    for(size_t i = 0; i < n_rep; ++i)
+        val |= bs.test(v[i]);
+
+    t += toc();
+
+    return val;
+}; 
+
+bool test_dbs::test_set_all(size_t n_rep)
+{
+    bool ret    = true;
+
+    for (size_t i = 0; i < n_rep; ++i)
+    {
+        ret         &= test_set(64*32, 10);
+        ret         &= test_set(64*32, 100);
+        //ret       &= test_set(64*32, 1000);
+
+        ret         &= test_set(64*32*32*32*32, 10);
+        ret         &= test_set(64*32*32*32*32, 100);
+        //ret       &= test_set(64*32*32*32*32, 1000);
+
+        ret         &= test_set(-size_t(1), 10);
+        ret         &= test_set(-size_t(1), 100);
+        //ret       &= test_set(-size_t(1), 1000);
+    };
+
+    std::cout << "test_set: " << (ret? "OK" : "FAILED") << "\n";
+    return ret;
+};
+bool test_dbs::test_constructor_all(size_t n_rep)
+{
+    bool ret    = true;
+
+    for (size_t i = 0; i < n_rep; ++i)
+    {
+        ret         &= test_constructor(64*32, 10);
+        ret         &= test_constructor(64*32, 100);
+        ret         &= test_constructor(64*32, 1000);
+
+        ret         &= test_constructor(64*32*32*32*32, 10);
+        ret         &= test_constructor(64*32*32*32*32, 100);
+        ret         &= test_constructor(64*32*32*32*32, 1000);
+
+        ret         &= test_constructor(-size_t(1), 10);
+        ret         &= test_constructor(-size_t(1), 100);
+        ret         &= test_constructor(-size_t(1), 1000);
+    };
+
+    std::cout << "test_constructor: " << (ret? "OK" : "FAILED") << "\n";
+    return ret;
+};
+
+bool test_dbs::test_find_all(size_t n_rep)
+{
+    bool ret    = true;
+
+    size_t n_search = 100;
+
+    for (size_t i = 0; i < n_rep; ++i)
+    {
+        ret         &= test_find(64*32, 10, n_search);
+        ret         &= test_find(64*32, 100, n_search);
+        ret         &= test_find(64*32, 1000, n_search);
+
+        ret         &= test_find(64*32*32*32*32, 10, n_search);
+        ret         &= test_find(64*32*32*32*32, 100, n_search);
+        ret         &= test_find(64*32*32*32*32, 1000, n_search);
+
+        ret         &= test_find(-size_t(1), 10, n_search);
+        ret         &= test_find(-size_t(1), 100, n_search);
+        ret         &= test_find(-size_t(1), 1000, n_search);
+    };
+
+    std::cout << "test_find: " << (ret? "OK" : "FAILED") << "\n";
+    return ret;
+};
+
+bool test_dbs::test_reset_all(size_t n_rep)
+{
+    bool ret    = true;
+
+    size_t n_search = 100;
+
+    for (size_t i = 0; i < n_rep; ++i)
+    {
+        ret         &= test_reset(64*32, 10, n_search);
+        ret         &= test_reset(64*32, 100, n_search);
+        ret         &= test_reset(64*32, 1000, n_search);
+
+        ret         &= test_reset(64*32*32*32*32, 10, n_search);
+        ret         &= test_reset(64*32*32*32*32, 100, n_search);
+        ret         &= test_reset(64*32*32*32*32, 1000, n_search);
+
+        ret         &= test_reset(-size_t(1), 10, n_search);
+        ret         &= test_reset(-size_t(1), 100, n_search);
+        ret         &= test_reset(-size_t(1), 1000, n_search);
+    };
+
+    std::cout << "test_reset: " << (ret? "OK" : "FAILED") << "\n";
+    return ret;
+};
+
+bool test_dbs::test_not_all(size_t n_rep)
+{
+    bool ret    = true;
+
+    size_t n_search = 100;
+
+    for (size_t i = 0; i < n_rep; ++i)
+    {
+        ret         &= test_not(64*32, 10, n_search);
+        ret         &= test_not(64*32, 100, n_search);
+        ret         &= test_not(64*32, 1000, n_search);
+
+        ret         &= test_not(64*32*32*32*32, 10, n_search);
+        ret         &= test_not(64*32*32*32*32, 100, n_search);
+        ret         &= test_not(64*32*32*32*32, 1000, n_search);
+
+        ret         &= test_not(-size_t(1), 10, n_search);
+        ret         &= test_not(-size_t(1), 100, n_search);
+        ret         &= test_not(-size_t(1), 1000, n_search);
+    };
+
+    std::cout << "test_not: " << (ret? "OK" : "FAILED") << "\n";
+    return ret;
+};
+
+bool test_dbs::test_eq_all(size_t n_rep)
+{
+    bool ret    = true;
+
+    for (size_t i = 0; i < n_rep; ++i)
+    {
+        ret         &= test_eq(64*32, 10);
+        ret         &= test_eq(64*32, 100);
+        ret         &= test_eq(64*32, 1000);
+
+        ret         &= test_eq(64*32*32*32*32, 10);
+        ret         &= test_eq(64*32*32*32*32, 100);
+        ret         &= test_eq(64*32*32*32*32, 1000);
+
+        ret         &= test_eq(-size_t(1), 10);
+        ret         &= test_eq(-size_t(1), 100);
+        ret         &= test_eq(-size_t(1), 1000);
+    };
+
+    std::cout << "test_eq: " << (ret? "OK" : "FAILED") << "\n";
+    return ret;
+};
+
+bool test_dbs::test_neq_all(size_t n_rep)
+{
+    bool ret    = true;
+
+    for (size_t i = 0; i < n_rep; ++i)
+    {
+        ret         &= test_eq(64*32, 10);
+        ret         &= test_eq(64*32, 100);
         ret         &= test_eq(64*32, 1000);
 
-        ret         &= test_eq(64*32*32*32*32, 10);
-        ret         &= test_eq(64*32*32*32*32, 100);
-        ret         &= test_eq(64*32*32*32*32, 1000);
+        ret         &= test_eq(64*32*32*32*32, 10);
+        ret         &= test_eq(64*32*32*32*32, 100);
+        ret         &= test_eq(64*32*32*32*32, 1000);
+
+        ret         &= test_eq(-size_t(1), 10);
+        ret         &= test_eq(-size_t(1), 100);
+        ret         &= test_eq(-size_t(1), 1000);
+    };
+
+    std::cout << "test_neq: " << (ret? "OK" : "FAILED") << "\n";
+    return ret;
+
+};
+bool test_dbs::test_and_all(size_t n_rep)
+{
+    bool ret    = true;
+
+    for (size_t i = 0; i < n_rep; ++i)
+    {
+        ret         &= test_and(64*32, 10);
+        ret         &= test_and(64*32, 100);
+        ret         &= test_and(64*32, 1000);
+
+        ret         &= test_and(64*32*32*32*32, 10);
+        ret         &= test_and(64*32*32*32*32, 100);
+        ret         &= test_and(64*32*32*32*32, 1000);
+
+        ret         &= test_and(-size_t(1), 10);
+        ret         &= test_and(-size_t(1), 100);
+        ret         &= test_and(-size_t(1), 1000);
+
+        ret         &= test_and_levels(64*32*32*32*32, 10);
+        ret         &= test_and_levels(-size_t(1), 100);
+    };
+
+    std::cout << "test_and: " << (ret? "OK" : "FAILED") << "\n";
+    return ret;
+};
+
+bool test_dbs::test_or_all(size_t n_rep)
+{
+    bool ret    = true;
+
+    for (size_t i = 0; i < n_rep; ++i)
+    {
+        ret         &= test_or(64*32, 10);
+        ret         &= test_or(64*32, 100);
+        ret         &= test_or(64*32, 1000);
+
+        ret         &= test_or(64*32*32*32*32, 10);
+        ret         &= test_or(64*32*32*32*32, 100);
+        ret         &= test_or(64*32*32*32*32, 1000);
+
+        ret         &= test_or(-size_t(1), 10);
+        ret         &= test_or(-size_t(1), 100);
+        ret         &= test_or(-size_t(1), 1000);
+    };
+
+    std::cout << "test_or: " << (ret? "OK" : "FAILED") << "\n";
+    return ret;
+};
+
+bool test_dbs::test_xor_all(size_t n_rep)
+{
+    bool ret    = true;
+
+    for (size_t i = 0; i < n_rep; ++i)
+    {
+        ret         &= test_xor(64*32, 10);
+        ret         &= test_xor(64*32, 100);
+        ret         &= test_xor(64*32, 1000);
+
+        ret         &= test_xor(64*32*32*32*32, 10);
+        ret         &= test_xor(64*32*32*32*32, 100);
+        ret         &= test_xor(64*32*32*32*32, 1000);
+
+        ret         &= test_xor(-size_t(1), 10);
+        ret         &= test_xor(-size_t(1), 100);
+        ret         &= test_xor(-size_t(1), 1000);
+    };
+
+    std::cout << "test_xor: " << (ret? "OK" : "FAILED") << "\n";
+    return ret;
+};
+
+bool test_dbs::test_reclaim_all(size_t n_rep)
+{
+    bool ret    = true;
+
+    for (size_t i = 0; i < n_rep; ++i)
+    {
+        ret         &= test_reclaim(64*32, 100);
+        ret         &= test_reclaim(64*32*32*32*32, 1000);
+        ret         &= test_reclaim(-size_t(1), 1000);
+    };
+
+    std::cout << "test_reclaim: " << (ret? "OK" : "FAILED") << "\n";
+    return ret;
+};
+
+bool test_dbs::test_resource_all(size_t n_rep)
+{
+    bool ret    = true;
+
+    for (size_t i = 0; i < n_rep; ++i)
+    {
+        ret         &= test_resource(64*32, 100, true);
+        ret         &= test_resource(64*32*32*32*32, 1000, true);
+        ret         &= test_resource(-size_t(1), 1000, false);
+    };
+
+    ret             &= test_resource_threads(-size_t(1), 100000);
+
+    std::cout << "test_resource: " << (ret? "OK" : "FAILED") << "\n";
+    return ret;
+};
+
+bool test_dbs::test_move_all(size_t n_rep)
+{
+    bool ret    = true;
+
+    for (size_t i = 0; i < n_rep; ++i)
+    {
+        ret         &= test_move(64*32, 100);
+        ret         &= test_move(64*32*32*32*32, 1000);
+        ret         &= test_move(-size_t(1), 1000);
+    };
+
+    #ifndef DBS_REFCOUNT_STATS
+        std::cout << "test_move: refcount operations are not checked, DBS_REFCOUNT_STATS is not defined\n";
+    #endif
+
+    std::cout << "test_move: " << (ret? "OK" : "FAILED") << "\n";
+    return ret;
+};
+
+bool test_dbs::test_iterator_all(size_t n_rep)
+{
+    bool ret    = true;
+
+    for (size_t i = 0; i < n_rep; ++i)
+    {
+        ret         &= test_iterator(64*32, 100, 100);
+        ret         &= test_iterator(64*32*32*32*32, 1000, 100);
+        ret         &= test_iterator(-size_t(1), 1000, 100);
+    };
+
+    std::cout << "test_iterator: " << (ret? "OK" : "FAILED") << "\n";
+    return ret;
+};
+
+bool test_dbs::test_decode_all(size_t n_rep)
+{
+    bool ret    = true;
+
+    for (size_t i = 0; i < n_rep; ++i)
+    {
+        ret         &= test_decode(64*32, 100);
+        ret         &= test_decode(64*32, 2000);
+        ret         &= test_decode(64*32*32*32*32, 1000);
+        ret         &= test_decode(-size_t(1), 1000);
+    };
+
+    std::cout << "test_decode: " << (ret? "OK" : "FAILED") << "\n";
+    return ret;
+};
+
+bool test_dbs::test_next_all(size_t n_rep)
+{
+    bool ret    = true;
+
+    for (size_t i = 0; i < n_rep; ++i)
+    {
+        ret         &= test_next(64*32, 100, 100);
+        ret         &= test_next(64*32, 3000, 100);
+        ret         &= test_next(64*32*32*32*32, 1000, 100);
+        ret         &= test_next(-size_t(1), 1000, 100);
+    };
+
+    std::cout << "test_next: " << (ret? "OK" : "FAILED") << "\n";
+    return ret;
+};
+
+bool test_dbs::test_visitor_all(size_t n_rep)
+{
+    bool ret    = true;
+
+    for (size_t i = 0; i < n_rep; ++i)
+    {
+        ret         &= test_visitor(64*32, 100);
+        ret         &= test_visitor(64*32*32*32*32, 1000);
+        ret         &= test_visitor(-size_t(1), 1000);
+    };
+
+    std::cout << "test_visitor: " << (ret? "OK" : "FAILED") << "\n";
+    return ret;
+};
+
+bool test_dbs::test_from_unsorted(size_t max_elem, size_t n_items, size_t n_threads)
+{
+    set_parallel_threads(n_threads);
+
+    std::vector<size_t> v;
+
+    for (size_t i = 0; i < n_items; ++i)
+        v.push_back(rand_elem(max_elem));
+
+    // add duplicates and shuffle
+    for (size_t i = 0; i < n_items / 4; ++i)
+        v.push_back(v[rand_elem(n_items)]);
+
+    for (size_t i = v.size(); i > 1; --i)
+        std::swap(v[i - 1], v[rand_elem(i)]);
+
+    std::set<size_t> s(v.begin(), v.end());
+    std::vector<size_t> sv  = to_vector(s);
+
+    dbs expected(sv.size(), sv.data());
+    dbs bs          = dbs::from_unsorted(v.size(), v.data());
+
+    set_parallel_threads(0);
+
+    // trees must be identical
+    if (bs != expected || bs.size() != sv.size())
+        return false;
+
+    if (hash_value(bs) != hash_value(expected))
+        return false;
+
+    std::vector<size_t> elems;
+    bs.get_elements(elems);
+
+    if (elems != sv)
+        return false;
+
+    return true;
+};
+
+bool test_dbs::test_from_unsorted_all(size_t n_rep)
+{
+    bool ret    = true;
+
+    for (size_t i = 0; i < n_rep / 100; ++i)
+    {
+        for (size_t n_threads = 1; n_threads <= 4; n_threads += 3)
+        {
+            ret     &= test_from_unsorted(64*2, 20000, n_threads);
+            ret     &= test_from_unsorted(64*32, 20000, n_threads);
+            ret     &= test_from_unsorted(64*32*32*32*32, 100, n_threads);
+            ret     &= test_from_unsorted(64*32*32*32*32, 20000, n_threads);
+            ret     &= test_from_unsorted(-size_t(1), 20000, n_threads);
+        };
+    };
+
+    std::cout << "test_from_unsorted: " << (ret? "OK" : "FAILED") << "\n";
+    return ret;
+};
+
+bool test_dbs::test_stream_builder(size_t max_elem, size_t n_items)
+{
+    std::set<size_t> s      = rand_set(max_elem, n_items);
+    std::vector<size_t> sv  = to_vector(s);
+
+    dbs expected(sv.size(), sv.data());
+
+    dbs_stream_builder builder;
+
+    // elements are added one by one, repeated and in chunks
+    size_t pos      = 0;
+
+    while (pos < sv.size())
+    {
+        size_t chunk    = std::min(rand_elem(10), sv.size() - pos);
+
+        if (chunk == 0)
+        {
+            builder.push(sv[pos]);
+            builder.push(sv[pos]);
+            ++pos;
+        }
+        else
+        {
+            builder.push(chunk, sv.data() + pos);
+            pos         += chunk;
+        };
+    };
+
+    if (builder.size() != sv.size())
+        return false;
+
+    // elements cannot be added in decreasing order
+    if (sv.empty() == false && sv[0] > 0)
+    {
+        try
+        {
+            builder.push(sv[0] - 1);
+            return false;
+        }
+        catch (std::invalid_argument&)
+        {};
+    };
+
+    dbs bs          = builder.finish();
+
+    // trees must be identical
+    if (bs != expected || hash_value(bs) != hash_value(expected))
+        return false;
+
+    std::vector<size_t> elems;
+    bs.get_elements(elems);
+
+    if (elems != sv)
+        return false;
+
+    // the builder is reset
+    if (builder.size() != 0 || builder.finish().any() == true)
+        return false;
+
+    builder.push(max_elem);
+
+    if (builder.finish() != dbs(max_elem))
+        return false;
+
+    return true;
+};
+
+bool test_dbs::test_stream_builder_all(size_t n_rep)
+{
+    bool ret    = true;
+
+    for (size_t i = 0; i < n_rep; ++i)
+    {
+        ret         &= test_stream_builder(64*2, 10);
+        ret         &= test_stream_builder(64*32, 100);
+        ret         &= test_stream_builder(64*32*32*32*32, 1000);
+        ret         &= test_stream_builder(-size_t(1), 1000);
+    };
+
+    std::cout << "test_stream_builder: " << (ret? "OK" : "FAILED") << "\n";
+    return ret;
+};
+
+bool test_dbs::test_history(size_t max_elem, size_t n_items, size_t n_versions)
+{
+    size_t allocated        = allocated_nodes();
+    bool ret                = true;
+
+    {
+        dbs_history history;
+
+        std::set<size_t> s  = rand_set(max_elem, n_items);
+        std::vector<size_t> sv  = to_vector(s);
+
+        std::vector<std::set<size_t>> expected;
+        dbs bs(sv.size(), sv.data());
+
+        // every version modifies few elements of the previous one
+        for (size_t i = 0; i < n_versions; ++i)
+        {
+            for (size_t j = 0; j < 5; ++j)
+            {
+                size_t elem = rand_elem(max_elem);
+
+                if (s.count(elem) == 0)
+                {
+                    s.insert(elem);
+                    bs      = bs.set(elem);
+                }
+                else
+                {
+                    s.erase(elem);
+                    bs      = bs.reset(elem);
+                };
+            };
+
+            expected.push_back(s);
+
+            if (history.commit(bs) != i)
+                ret         = false;
+        };
+
+        if (history.size() != n_versions || history.next_version() != n_versions
+                || history.current() != bs)
+        {
+            ret             = false;
+        };
+
+        for (size_t i = 0; i < n_versions; ++i)
+        {
+            std::vector<size_t> elems;
+            history.get(i).get_elements(elems);
+
+            if (elems != to_vector(expected[i]))
+                ret         = false;
+        };
+
+        // versions share nodes; unshared memory is the sum of memory of
+        // versions
+        history_memory mem  = history.memory();
+        size_t unshared     = 0;
+
+        for (size_t i = 0; i < n_versions; ++i)
+        {
+            dbs_history single;
+            single.commit(history.get(i));
+            unshared        += single.memory().m_nodes;
+        };
+
+        if (mem.m_unshared_nodes != unshared || mem.m_unshared_bytes < mem.m_bytes)
+            ret             = false;
+
+        if (bs.get_data().get_level() > 1 && n_versions > 1 && mem.m_nodes >= unshared)
+            ret             = false;
+
+        // retention
+        dbs snapshot        = history.get(0);
+        size_t n_kept       = n_versions / 2 + 1;
+
+        history.set_max_versions(n_kept);
+
+        if (history.size() != n_kept || history.first_version() != n_versions - n_kept
+                || history.contains(0) == true || history.get_max_versions() != n_kept)
+        {
+            ret             = false;
+        };
+
+        try
+        {
+            history.get(0);
+            ret             = false;
+        }
+        catch (std::out_of_range&)
+        {};
+
+        // snapshots outlive released versions
+        std::vector<size_t> elems;
+        snapshot.get_elements(elems);
+
+        if (elems != to_vector(expected[0]))
+            ret             = false;
+
+        history.release_before(n_versions - 1);
+
+        if (history.size() != 1 || history.current() != bs)
+            ret             = false;
+
+        if (history.commit(dbs()) != n_versions || history.size() != 2)
+            ret             = false;
+    };
+
+    if (allocated_nodes() != allocated)
+        ret                 = false;
+
+    return ret;
+};
+
+bool test_dbs::test_history_all(size_t n_rep)
+{
+    bool ret    = true;
+
+    for (size_t i = 0; i < n_rep / 10; ++i)
+    {
+        ret         &= test_history(64*32, 100, 10);
+        ret         &= test_history(64*32*32*32*32, 1000, 20);
+        ret         &= test_history(-size_t(1), 1000, 20);
+    };
+
+    std::cout << "test_history: " << (ret? "OK" : "FAILED") << "\n";
+    return ret;
+};
+
+// write binary image of elements reduced modulo 2^bits as stored in a tree 
+// of 32-bit words; elements must be sorted and less than 2^32
+static void write_node_32(const size_t* elems, size_t count, size_t bits, 
+                          std::vector<unsigned char>& out)
+{
+    auto write_word = [&out](size_t value)
+    {
+        for (size_t i = 0; i < 4; ++i)
+            out.push_back(static_cast<unsigned char>(value >> (8 * i)));
+    };
+
+    size_t mask     = (bits >= 64) ? size_t(-1) : (size_t(1) << bits) - 1;
+    size_t level    = 0;
+
+    for (size_t max = (elems[count - 1] & mask) >> 6; max != 0; max >>= 5)
+        ++level;
+
+    out.push_back(static_cast<unsigned char>(level));
+
+    if (level == 0)
+    {
+        size_t words[2] = {0, 0};
+
+        for (size_t i = 0; i < count; ++i)
+        {
+            size_t item = elems[i] & 63;
+            words[item & 1] |= size_t(1) << (item >> 1);
+        };
+
+        write_word(words[0]);
+        write_word(words[1]);
+        return;
+    };
+
+    size_t shift    = 5 * level + 1;
+    size_t flags    = 0;
+
+    for (size_t i = 0; i < count; ++i)
+        flags       |= size_t(1) << (((elems[i] & mask) >> shift) & 31);
+
+    write_word(flags);
+
+    for (size_t first = 0; first < count; )
+    {
+        size_t pos  = ((elems[first] & mask) >> shift) & 31;
+        size_t last = first + 1;
+
+        while (last < count && (((elems[last] & mask) >> shift) & 31) == pos)
+            ++last;
+
+        write_node_32(elems + first, last - first, shift, out);
+        first       = last;
+    };
+};
+
+bool test_dbs::test_serialize(size_t max_elem, size_t n_items)
+{
+    std::set<size_t> s      = rand_set(max_elem, n_items);
+    std::vector<size_t> sv  = to_vector(s);
+
+    dbs bs(sv.size(), sv.data());
+
+    std::vector<unsigned char> image   = {1, 2};
+    serialize(bs, image);
+
+    size_t read     = 0;
+    dbs bs2         = deserialize(image.data() + 2, image.size() - 2, &read);
+
+    if (bs2 != bs || hash_value(bs2) != hash_value(bs) || read != image.size() - 2)
+        return false;
+
+    // two images stored in a stream
+    std::stringstream stream;
+    serialize(bs, stream);
+    serialize(bs.set(max_elem), stream);
+
+    if (deserialize(stream) != bs || deserialize(stream) != bs.set(max_elem))
+        return false;
+
+    // truncated and corrupted images are rejected
+    for (size_t i = 0; i < 10; ++i)
+    {
+        size_t size = rand_elem(image.size() - 2);
+
+        try
+        {
+            deserialize(image.data() + 2, size);
+            return false;
+        }
+        catch (serialization_error&)
+        {};
+    };
+
+    for (size_t i = 0; i < 10; ++i)
+    {
+        std::vector<unsigned char> corrupted(image.begin() + 2, image.end());
+        corrupted[rand_elem(corrupted.size())] ^= static_cast<unsigned char>(1 + rand_elem(255));
+
+        try
+        {
+            deserialize(corrupted.data(), corrupted.size());
+        }
+        catch (serialization_error&)
+        {};
+    };
+
+    // images created by builds with 32-bit words
+    std::vector<size_t> sv_32;
+
+    for (size_t elem : sv)
+    {
+        if (elem <= 0xFFFFFFFF)
+            sv_32.push_back(elem);
+    };
+
+    std::vector<unsigned char> image_32 = {'D', 'B', 'S', 'I', 1, 0, 32, 0};
+
+    if (sv_32.empty() == true)
+        image_32.insert(image_32.end(), 9, 0);
+    else
+        write_node_32(sv_32.data(), sv_32.size(), 64, image_32);
+
+    if (deserialize(image_32.data(), image_32.size()) != dbs(sv_32.size(), sv_32.data()))
+        return false;
+
+    return true;
+};
+
+// add internal nodes of x to nodes
+static void collect_nodes(const details::dbs_impl& x, std::set<const details::dbs_set*>& nodes)
+{
+    const details::block& data  = x.get_data();
+
+    if (data.get_level() == 0 || nodes.insert(data.get_fsb_set()).second == false)
+        return;
+
+    size_t size     = details::block::count_bits(data.m_flags);
+
+    for (size_t i = 0; i < size; ++i)
+        collect_nodes(data.get_fsb_set()->get_elem(i), nodes);
+};
+
+bool test_dbs::test_serialize_collection(size_t max_elem, size_t n_items, size_t n_sets)
+{
+    std::set<size_t> s      = rand_set(max_elem, n_items);
+    std::vector<size_t> sv  = to_vector(s);
+
+    // sets derived from one another, repeated sets and the empty set
+    std::vector<dbs> sets   = {dbs(sv.size(), sv.data()), dbs()};
+
+    for (size_t i = 0; i < n_sets; ++i)
+    {
+        const dbs& base = sets[rand_elem(sets.size())];
+
+        switch (rand_elem(4))
+        {
+            case 0:     sets.push_back(base.flip(rand_elem(max_elem))); break;
+            case 1:     sets.push_back(base); break;
+            case 2:     sets.push_back(dbs(base | sets[rand_elem(sets.size())])); break;
+            default:    sets.push_back(dbs(base - dbs(rand_elem(max_elem)))); break;
+        };
+    };
+
+    std::vector<unsigned char> image    = {1};
+    serialize_collection(sets, image);
+
+    size_t read     = 0;
+    std::vector<dbs> sets2  = deserialize_collection(image.data() + 1, image.size() - 1, &read);
+
+    if (sets2 != sets || read != image.size() - 1)
+        return false;
+
+    // nodes are shared in the same way
+    std::set<const details::dbs_set*> nodes;
+    std::set<const details::dbs_set*> nodes2;
+
+    for (size_t i = 0; i < sets.size(); ++i)
+    {
+        collect_nodes(sets[i], nodes);
+        collect_nodes(sets2[i], nodes2);
+    };
+
+    if (nodes.size() != nodes2.size())
+        return false;
+
+    // two collections stored in a stream
+    std::stringstream stream;
+    serialize_collection(sets, stream);
+    serialize_collection(std::vector<dbs>(), stream);
+
+    if (deserialize_collection(stream) != sets || deserialize_collection(stream).empty() == false)
+        return false;
+
+    // truncated and corrupted images are rejected
+    for (size_t i = 0; i < 10; ++i)
+    {
+        size_t size = rand_elem(image.size() - 1);
+
+        try
+        {
+            deserialize_collection(image.data() + 1, size);
+            return false;
+        }
+        catch (serialization_error&)
+        {};
+    };
+
+    for (size_t i = 0; i < 10; ++i)
+    {
+        std::vector<unsigned char> corrupted(image.begin() + 1, image.end());
+        corrupted[rand_elem(corrupted.size())] ^= static_cast<unsigned char>(1 + rand_elem(255));
+
+        try
+        {
+            deserialize_collection(corrupted.data(), corrupted.size());
+        }
+        catch (serialization_error&)
+        {};
+    };
+
+    return true;
+};
+
+bool test_dbs::test_serialize_all(size_t n_rep)
+{
+    bool ret    = true;
+
+    for (size_t i = 0; i < n_rep; ++i)
+    {
+        ret         &= test_serialize(64*2, 10);
+        ret         &= test_serialize(64*32, 100);
+        ret         &= test_serialize(64*32*32*32*32, 1000);
+        ret         &= test_serialize(-size_t(1), 1000);
+
+        ret         &= test_serialize_collection(64*2, 10, 10);
+        ret         &= test_serialize_collection(64*32*32*32*32, 1000, 20);
+        ret         &= test_serialize_collection(-size_t(1), 1000, 20);
+    };
+
+    // empty set and invalid headers
+    std::vector<unsigned char> image;
+    serialize(dbs(), image);
+
+    ret             &= deserialize(image.data(), image.size()).none();
+
+    for (size_t pos : {0, 4, 6})
+    {
+        std::vector<unsigned char> invalid  = image;
+        invalid[pos]    = 99;
+
+        try
+        {
+            deserialize(invalid.data(), invalid.size());
+            ret         = false;
+        }
+        catch (serialization_error&)
+        {};
+    };
+
+    // collections can be loaded only with the same word size
+    image.clear();
+    serialize_collection(std::vector<dbs>{dbs()}, image);
+
+    for (size_t pos : {0, 4, 6})
+    {
+        std::vector<unsigned char> invalid  = image;
+        invalid[pos]    = (pos == 6) ? 96 - image[6] : 99;
+
+        try
+        {
+            deserialize_collection(invalid.data(), invalid.size());
+            ret         = false;
+        }
+        catch (serialization_error&)
+        {};
+    };
+
+    std::cout << "test_serialize: " << (ret? "OK" : "FAILED") << "\n";
+    return ret;
+};
+
+bool test_dbs::test_view(size_t max_elem, size_t n_items)
+{
+    std::set<size_t> s      = rand_set(max_elem, n_items);
+    std::vector<size_t> sv  = to_vector(s);
+
+    dbs bs(sv.size(), sv.data());
+
+    // a modified copy sharing most of the tree and a set of small elements
+    dbs bs2         = bs;
+    for (size_t i = 0; i < n_items / 4 + 1; ++i)
+        bs2         = bs2.flip(rand_elem(max_elem));
+
+    std::set<size_t> s3     = rand_set(std::min(max_elem, size_t(64*32)), n_items / 10 + 1);
+    std::vector<size_t> sv3 = to_vector(s3);
+    dbs bs3(sv3.size(), sv3.data());
+
+    // several images stored in one buffer
+    std::vector<dbs> sets   = {bs, bs2, bs3, dbs()};
+    std::vector<unsigned char> buffer   = {1};
+    std::vector<size_t> offsets;
+    std::vector<size_t> sizes;
+
+    for (const dbs& set : sets)
+    {
+        offsets.push_back(freeze(set, buffer));
+        sizes.push_back(buffer.size() - offsets.back());
+    };
+
+    std::vector<dbs_view> views;
+
+    for (size_t i = 0; i < sets.size(); ++i)
+    {
+        if (offsets[i] % 8 != 0)
+            return false;
+
+        views.push_back(dbs_view(buffer.data() + offsets[i], sizes[i]));
+    };
+
+    for (size_t i = 0; i < sets.size(); ++i)
+    {
+        const dbs& set          = sets[i];
+        const dbs_view& view    = views[i];
+
+        if (view.validate() == false || view.to_dbs() != set)
+            return false;
+
+        if (view.size() != set.size() || view.any() != set.any() || view.none() != set.none())
+            return false;
+
+        if (view.first() != set.first() || view.last() != set.last())
+            return false;
+
+        std::vector<size_t> elems;
+        set.get_elements(elems);
+
+        if (std::equal(view.begin(), view.end(), elems.begin(), elems.end()) == false)
+            return false;
+
+        for (size_t elem : elems)
+        {
+            if (view.test(elem) == false || view.next(elem) != set.next(elem))
+                return false;
+        };
+
+        for (size_t j = 0; j < 100; ++j)
+        {
+            size_t elem = rand_elem(max_elem);
+
+            if (view.test(elem) != set.test(elem) || view.next(elem) != set.next(elem))
+                return false;
+        };
+
+        if (view.test(dbs::npos) != set.test(dbs::npos) || view.next(dbs::npos) != dbs::npos)
+            return false;
+    };
+
+    // set operators
+    for (size_t i = 0; i < sets.size(); ++i)
+    {
+        for (size_t j = 0; j < sets.size(); ++j)
+        {
+            const dbs& x        = sets[i];
+            const dbs& y        = sets[j];
+
+            if ((views[i] & views[j]) != dbs(x & y) || (views[i] | views[j]) != dbs(x | y))
+                return false;
+
+            if ((views[i] ^ views[j]) != dbs(x ^ y) || (views[i] - views[j]) != dbs(x - y))
+                return false;
+        };
+    };
+
+    // truncated and corrupted images are detected by validate
+    const unsigned char* image  = buffer.data() + offsets[0];
+
+    if (sizes[0] > 32 && dbs_view(image, sizes[0] - 8).validate() == true)
+        return false;
+
+    for (size_t i = 0; i < 10; ++i)
+    {
+        std::vector<size_t> words(sizes[0] / sizeof(size_t));
+        memcpy(words.data(), image, sizes[0]);
+
+        unsigned char* corrupted    = reinterpret_cast<unsigned char*>(words.data());
+        corrupted[8 + rand_elem(sizes[0] - 8)] ^= static_cast<unsigned char>(1 + rand_elem(255));
+
+        dbs_view view(corrupted, sizes[0]);
+
+        if (view.validate() == true)
+            view.to_dbs();
+    };
+
+    // view of a mapped file
+    const char* path    = "test_dbs_view.tmp";
+
+    {
+        std::ofstream file(path, std::ios::binary);
+        freeze(bs, file);
+    };
+
+    bool mapped_ok;
+
+    {
+        mapped_file file(path);
+        dbs_view view(file.data(), file.size());
+        mapped_ok       = view.validate() == true && view.to_dbs() == bs;
+    };
+
+    std::remove(path);
+    return mapped_ok;
+};
+
+bool test_dbs::test_view_all(size_t n_rep)
+{
+    bool ret    = true;
+
+    for (size_t i = 0; i < n_rep; ++i)
+    {
+        ret         &= test_view(64*2, 10);
+        ret         &= test_view(64*32, 100);
+        ret         &= test_view(64*32*32*32*32, 1000);
+        ret         &= test_view(-size_t(1), 1000);
+    };
+
+    // invalid headers and incompatible builds
+    std::vector<unsigned char> image;
+    freeze(dbs(), image);
+
+    ret             &= dbs_view().none() && dbs_view().begin() == dbs_view().end();
+    ret             &= dbs_view(image.data(), image.size()).none();
+
+    for (size_t pos : {0, 4, 6, 7})
+    {
+        std::vector<unsigned char> invalid  = image;
+        invalid[pos]    = 99;
+
+        try
+        {
+            dbs_view view(invalid.data(), invalid.size());
+            ret         = false;
+        }
+        catch (serialization_error&)
+        {};
+    };
+
+    try
+    {
+        mapped_file file("test_dbs_view.missing");
+        ret             = false;
+    }
+    catch (std::runtime_error&)
+    {};
+
+    std::cout << "test_view: " << (ret? "OK" : "FAILED") << "\n";
+    return ret;
+};
+
+bool test_dbs::test_roaring(size_t max_elem, size_t n_items, size_t n_ranges)
+{
+    std::set<size_t> s      = rand_set(max_elem, n_items);
+    std::vector<size_t> sv  = to_vector(s);
+    add_ranges(sv, max_elem, n_ranges);
+
+    dbs bs                  = dbs::from_unsorted(sv.size(), sv.data());
+
+    // 64-bit extension
+    std::vector<unsigned char> image    = {1};
+    to_roaring64(bs, image);
+
+    size_t read     = 0;
+
+    if (from_roaring64(image.data() + 1, image.size() - 1, &read) != bs || read != image.size() - 1)
+        return false;
+
+    // truncated images are rejected
+    for (size_t i = 0; i < 10; ++i)
+    {
+        try
+        {
+            from_roaring64(image.data() + 1, rand_elem(image.size() - 1));
+            return false;
+        }
+        catch (serialization_error&)
+        {};
+    };
+
+    // 32-bit format
+    dbs bs_32       = bs;
+    
+    if (bs.any() == true && uint64_t(bs.last()) > 0xFFFFFFFF)
+    {
+        try
+        {
+            image.clear();
+            to_roaring(bs, image);
+            return false;
+        }
+        catch (std::invalid_argument&)
+        {};
+
+        std::vector<size_t> elems;
+        bs.get_elements(elems);
+        elems.erase(std::upper_bound(elems.begin(), elems.end(), size_t(0xFFFFFFFF)), 
+                    elems.end());
+
+        bs_32       = dbs(elems.size(), elems.data());
+    };
+
+    image.clear();
+    to_roaring(bs_32, image);
+
+    if (from_roaring(image.data(), image.size(), &read) != bs_32 || read != image.size())
+        return false;
+
+    for (size_t i = 0; i < 10; ++i)
+    {
+        try
+        {
+            from_roaring(image.data(), rand_elem(image.size()));
+            return false;
+        }
+        catch (serialization_error&)
+        {};
+    };
+
+    for (size_t i = 0; i < 10; ++i)
+    {
+        std::vector<unsigned char> corrupted    = image;
+        corrupted[rand_elem(corrupted.size())] ^= static_cast<unsigned char>(1 + rand_elem(255));
+
+        try
+        {
+            from_roaring(corrupted.data(), corrupted.size());
+        }
+        catch (serialization_error&)
+        {};
+    };
+
+    return true;
+};
+
+bool test_dbs::test_roaring_all(size_t n_rep)
+{
+    bool ret    = true;
+
+    for (size_t i = 0; i < n_rep; ++i)
+    {
+        ret         &= test_roaring(64*2, 10, 0);
+        ret         &= test_roaring(1000000, 10000, 0);
+        ret         &= test_roaring(1000000, 100, 10);
+        ret         &= test_roaring(size_t(1) << 32, 1000, 10);
+        ret         &= test_roaring(-size_t(1), 1000, 10);
+    };
+
+    // images created by other implementations; array container
+    std::vector<unsigned char> image_1  = {0x3A, 0x30, 0, 0, 1, 0, 0, 0, 0, 0, 2, 0, 
+                                           16, 0, 0, 0, 0, 0, 1, 0, 2, 0};
+
+    // run container and array container with key 1
+    std::vector<unsigned char> image_2  = {0x3B, 0x30, 1, 0, 1, 0, 0, 99, 0, 1, 0, 0, 0, 
+                                           1, 0, 10, 0, 99, 0, 5, 0};
+
+    dbs bs_1        = {0, 1, 2};
+    std::vector<size_t> elems_2;
+
+    for (size_t i = 10; i < 110; ++i)
+        elems_2.push_back(i);
+
+    elems_2.push_back(65536 + 5);
+
+    dbs bs_2(elems_2.size(), elems_2.data());
+    std::vector<unsigned char> image;
+
+    ret             &= from_roaring(image_1.data(), image_1.size()) == bs_1;
+    ret             &= from_roaring(image_2.data(), image_2.size()) == bs_2;
+
+    to_roaring(bs_1, image);
+    ret             &= image == image_1;
+
+    image.clear();
+    to_roaring(bs_2, image);
+    ret             &= image == image_2;
+
+    // empty set
+    image.clear();
+    to_roaring(dbs(), image);
+    ret             &= image == std::vector<unsigned char>{0x3A, 0x30, 0, 0, 0, 0, 0, 0};
+
+    image.clear();
+    to_roaring64(dbs(), image);
+    ret             &= image == std::vector<unsigned char>(8, 0);
+    ret             &= from_roaring64(image.data(), image.size()).none();
+
+    std::cout << "test_roaring: " << (ret? "OK" : "FAILED") << "\n";
+    return ret;
+};
+
+bool test_dbs::test_text(size_t max_elem, size_t n_items, size_t n_ranges)
+{
+    std::set<size_t> s      = rand_set(max_elem, n_items);
+    std::vector<size_t> sv  = to_vector(s);
+    add_ranges(sv, max_elem, n_ranges);
+
+    dbs bs                  = dbs::from_unsorted(sv.size(), sv.data());
+
+    for (text_format format : {text_format::list, text_format::ranges, text_format::hex})
+    {
+        if (dbs::parse(to_string(bs, format)) != bs)
+            return false;
+    };
+
+    std::ostringstream os;
+    os << bs;
+
+    if (os.str() != to_string(bs, text_format::list))
+        return false;
+
+    // elements in any order with repetitions
+    std::string text    = "{";
+    std::vector<size_t> chosen;
+
+    for (size_t i = 0; i < sv.size(); ++i)
+    {
+        size_t elem     = sv[rand_elem(sv.size())];
+
+        text            += (i == 0 ? "" : ", ") + std::to_string(elem);
+        chosen.push_back(elem);
+
+        if (elem < size_t(-1) && rand_elem(10) == 0)
+        {
+            text        += " - " + std::to_string(elem + 1);
+            chosen.push_back(elem + 1);
+        };
+    };
+
+    text                += "}";
+
+    std::sort(chosen.begin(), chosen.end());
+    chosen.erase(std::unique(chosen.begin(), chosen.end()), chosen.end());
+
+    if (dbs::parse(text) != dbs(chosen.size(), chosen.data()))
+        return false;
+
+    return true;
+};
+
+bool test_dbs::test_text_all(size_t n_rep)
+{
+    bool ret    = true;
+
+    for (size_t i = 0; i < n_rep; ++i)
+    {
+        ret         &= test_text(64*2, 10, 0);
+        ret         &= test_text(64*32, 100, 2);
+        ret         &= test_text(64*32*32*32*32, 1000, 10);
+        ret         &= test_text(-size_t(1), 1000, 10);
+    };
+
+    std::vector<size_t> elems   = {1, 5, 6, 7, 64};
+
+    for (size_t i = 448; i < 464; ++i)
+        elems.push_back(i);
+
+    dbs bs(elems.size(), elems.data());
+
+    ret             &= to_string(bs, text_format::list) == "{1, 5, 6, 7, 64, 448, 449, 450, 451,"
+                        " 452, 453, 454, 455, 456, 457, 458, 459, 460, 461, 462, 463}";
+    ret             &= to_string(bs, text_format::ranges) == "{1, 5-7, 64, 448-463}";
+    ret             &= to_string(bs, text_format::hex) == "x{0:e2 1, 1c0:ffff}";
+    ret             &= to_string(dbs(), text_format::hex) == "x{}";
+
+    ret             &= dbs::parse(" { 1 , 5 -7,64\n, 448 - 463 } ") == bs;
+    ret             &= dbs::parse("{448-463, 1, 64, 5-7, 6}") == bs;
+    ret             &= dbs::parse("x{1c0:FFFF, 0:e2 1}") == bs;
+    ret             &= dbs::parse("x{1:71, 40:1 0, 1c0:ffff}") == bs;
+    ret             &= dbs::parse("{}").none();
+    ret             &= dbs::parse("{18446744073709551615}") == dbs(size_t(-1));
+
+    // unsorted long ranges are not expanded to elements
+    {
+        dbs_stream_builder builder;
+        builder.push_range(0, 100000000);
+
+        ret         &= dbs::parse("{10, 0-100000000}") == builder.finish();
+    };
+    {
+        dbs_stream_builder builder;
+        builder.push_range(5, 100000000);
+
+        ret         &= dbs::parse("{100-100000000, 5-200, 7, 201}") == builder.finish();
+    };
+
+    ret             &= dbs::parse("x{40:3, 0:ffffffffffffffff, 42:1}") == dbs::parse("{0-66}");
+    ret             &= dbs::parse("x{40:f0f, 0:81}") == dbs::parse("{0, 7, 64-67, 72-75}");
+
+    for (const char* text : {"", "{", "{1,", "{1 2}", "{a}", "{5-3}", "{1} x", "x{0}", 
+                             "x{0:1 g}", "{18446744073709551616}", "x{ffffffffffffffc0:0 1}"})
+    {
+        try
+        {
+            dbs::parse(text);
+            ret     = false;
+        }
+        catch (std::invalid_argument&)
+        {};
+    };
+
+    std::cout << "test_text: " << (ret? "OK" : "FAILED") << "\n";
+    return ret;
+};
+
+bool test_dbs::test_diff(size_t max_elem, size_t n_items, size_t n_changes)
+{
+    size_t allocated        = allocated_nodes();
+    bool ret                = true;
+
+    {
+        std::set<size_t> s1 = rand_set(max_elem, n_items);
+        std::vector<size_t> sv  = to_vector(s1);
+
+        dbs old_set(sv.size(), sv.data());
+        dbs new_set         = old_set;
+        std::set<size_t> s2 = s1;
+
+        for (size_t i = 0; i < n_changes; ++i)
+        {
+            size_t elem     = rand_elem(max_elem);
+
+            if (s2.count(elem) == 0)
+                s2.insert(elem);
+            else
+                s2.erase(elem);
+
+            new_set         = new_set.flip(elem);
+        };
+
+        std::vector<size_t> added, removed;
+        std::set_difference(s2.begin(), s2.end(), s1.begin(), s1.end(), std::back_inserter(added));
+        std::set_difference(s1.begin(), s1.end(), s2.begin(), s2.end(), std::back_inserter(removed));
+
+        // unshared copy of the new version gives the same patch
+        std::vector<size_t> sv2 = to_vector(s2);
+        dbs copy(sv2.size(), sv2.data());
+
+        for (const dbs& target : {new_set, copy})
+        {
+            dbs_patch patch     = diff(old_set, target);
+
+            if (patch.added() != dbs(added.size(), added.data())
+                    || patch.removed() != dbs(removed.size(), removed.data()))
+            {
+                ret             = false;
+            };
+
+            if (apply_patch(old_set, patch) != target || apply_patch(target, patch.inverse()) != old_set)
+                ret             = false;
+
+            if (patch.empty() != (added.empty() && removed.empty()))
+                ret             = false;
+
+            // changed words
+            std::vector<size_t> added_2, removed_2;
+            size_t last_offset  = 0;
+            bool first          = true;
+
+            for_each_change(old_set, target, [&](size_t offset, size_t word_add, size_t word_rem)
+            {
+                if ((word_add | word_rem) == 0 || (word_add & word_rem) != 0 
+                        || (first == false && offset <= last_offset))
+                {
+                    ret         = false;
+                };
+
+                for (size_t i = 0; i < dbs::block_bits; ++i)
+                {
+                    if ((word_add >> i) & 1)
+                        added_2.push_back(offset + i);
+                    if ((word_rem >> i) & 1)
+                        removed_2.push_back(offset + i);
+                };
+
+                last_offset     = offset;
+                first           = false;
+            });
+
+            if (added_2 != added || removed_2 != removed)
+                ret             = false;
+        };
+
+        // shared subtrees are skipped; every change is reported in at most
+        // one word
+        size_t n_words          = 0;
+        for_each_change(old_set, new_set, [&](size_t, size_t, size_t) { ++n_words; });
+
+        if (n_words > n_changes)
+            ret                 = false;
+
+        // traversal can be stopped
+        size_t n_visited        = 0;
+        bool finished           = for_each_change(old_set, dbs(), [&](size_t, size_t, size_t)
+                                    {
+                                        ++n_visited;
+                                        return false;
+                                    });
+
+        if (old_set.any() && (finished == true || n_visited != 1))
+            ret                 = false;
+
+        if (diff(new_set, new_set).empty() == false || diff(dbs(), dbs()).empty() == false)
+            ret                 = false;
+
+        // versions with different number of levels
+        dbs_patch patch         = diff(dbs(), new_set);
+
+        if (patch.added() != new_set || patch.removed().any() == true)
+            ret                 = false;
+
+        if (apply_patch(dbs(5), diff(dbs(5), new_set)) != new_set
+                || apply_patch(new_set, diff(new_set, dbs(5))) != dbs(5))
+        {
+            ret                 = false;
+        };
+    };
+
+    if (allocated_nodes() != allocated)
+        ret                     = false;
+
+    return ret;
+};
+
+bool test_dbs::test_diff_all(size_t n_rep)
+{
+    bool ret    = true;
+
+    for (size_t i = 0; i < n_rep; ++i)
+    {
+        ret         &= test_diff(64*2, 10, 3);
+        ret         &= test_diff(64*32, 100, 10);
+        ret         &= test_diff(64*32*32*32*32, 1000, 10);
+        ret         &= test_diff(-size_t(1), 1000, 100);
+    };
+
+    std::cout << "test_diff: " << (ret? "OK" : "FAILED") << "\n";
+    return ret;
+};
+
+bool test_dbs::test_hash(size_t max_elem, size_t n_items)
+{
+    std::set<size_t> s      = rand_set(max_elem, n_items);
+    std::vector<size_t> sv  = to_vector(s);
+
+    dbs bs(sv.size(), sv.data());
+
+    // equal bitsets constructed in different ways have equal hashes
+    std::vector<dbs> sets;
+    sets.push_back(dbs::from_unsorted(sv.size(), sv.data()));
+    sets.push_back(dbs::parse(to_string(bs)));
+
+    {
+        std::vector<size_t> v   = sv;
+
+        for (size_t i = v.size(); i > 1; --i)
+            std::swap(v[i - 1], v[rand_elem(i)]);
+
+        dbs bs2;
+        for (size_t elem : v)
+            bs2                 = bs2.set(elem);
+
+        sets.push_back(bs2);
+
+        // elements are added and removed
+        std::vector<size_t> extra;
+        for (size_t i = 0; i < n_items; ++i)
+        {
+            size_t elem         = rand_elem(max_elem);
+
+            if (s.count(elem) == 0)
+                extra.push_back(elem);
+        };
+
+        dbs bs3                 = bs;
+        for (size_t elem : extra)
+            bs3                 = bs3.set(elem);
+        for (size_t elem : extra)
+            bs3                 = bs3.reset(elem);
+
+        sets.push_back(bs3);
+
+        std::vector<size_t> v1(v.begin(), v.begin() + v.size() / 2);
+        std::vector<size_t> v2(v.begin() + v.size() / 2, v.end());
+        std::sort(v1.begin(), v1.end());
+        std::sort(v2.begin(), v2.end());
+
+        dbs bs_1(v1.size(), v1.data());
+        dbs bs_2(v2.size(), v2.data());
+        dbs bs_12               = bs_1 | bs_2;
+
+        sets.push_back(bs_1 | bs_2);
+        sets.push_back(bs_1 ^ bs_2);
+        sets.push_back((bs_12 - bs_1) | (bs_1 & bs_12));
+    };
+
+    size_t hash                 = hash_value(bs);
+    bool ret                    = true;
+
+    for (const dbs& x : sets)
+    {
+        if (x != bs || hash_value(x) != hash)
+            ret                 = false;
+    };
+
+    // modified bitsets have different hashes with high probability
+    if (bs.any() == true)
+    {
+        size_t n_equal          = 0;
+
+        for (size_t i = 0; i < 10; ++i)
+        {
+            dbs bs2             = bs.flip(rand_elem(max_elem));
+
+            if (hash_value(bs2) == hash)
+                ++n_equal;
+            if (hash_value(bs2.flip(bs2.first())) == hash_value(bs2) )
+                ++n_equal;
+        };
+
+        if (n_equal > 0)
+            ret                 = false;
+    };
+
+    return ret;
+};
+
+bool test_dbs::test_hash_all(size_t n_rep)
+{
+    bool ret    = true;
+
+    for (size_t i = 0; i < n_rep; ++i)
+    {
+        ret         &= test_hash(64*2, 10);
+        ret         &= test_hash(64*32, 100);
+        ret         &= test_hash(64*32*32*32*32, 1000);
+        ret         &= test_hash(-size_t(1), 1000);
+    };
+
+    std::cout << "test_hash: " << (ret? "OK" : "FAILED") << "\n";
+    return ret;
+};
+
+// compare sequences of elements
+static order_type compare_vectors(const std::vector<size_t>& x, const std::vector<size_t>& y)
+{
+    if (std::lexicographical_compare(x.begin(), x.end(), y.begin(), y.end()) == true)
+        return order_type::less;
+    if (std::lexicographical_compare(y.begin(), y.end(), x.begin(), x.end()) == true)
+        return order_type::greater;
+
+    return order_type::equal;
+};
+
+bool test_dbs::test_compare_elements(size_t max_elem, size_t n_items)
+{
+    std::set<size_t> s      = rand_set(max_elem, n_items);
+    std::vector<size_t> sv  = to_vector(s);
+
+    dbs bs(sv.size(), sv.data());
+
+    // bitsets sharing nodes with bs, prefixes, extensions and unrelated
+    // bitsets
+    std::vector<dbs> sets   = {bs, dbs(), bs.flip(rand_elem(max_elem)), 
+                                bs.flip(rand_elem(max_elem)).flip(rand_elem(max_elem))};
+
+    if (sv.empty() == false)
+    {
+        size_t n_prefix     = rand_elem(sv.size());
+        sets.push_back(dbs(n_prefix, sv.data()));
+        sets.push_back(bs.reset(sv.back()));
+        sets.push_back(bs.reset(sv.front()));
+
+        if (sv.back() < max_elem - 1)
+            sets.push_back(bs.set(sv.back() + 1 + rand_elem(max_elem - 1 - sv.back())));
+    };
+
+    {
+        std::set<size_t> s2 = rand_set(max_elem, n_items);
+        std::vector<size_t> sv2 = to_vector(s2);
+        sets.push_back(dbs(sv2.size(), sv2.data()));
+    };
+
+    std::vector<std::vector<size_t>> elems;
+
+    for (const dbs& x : sets)
+    {
+        elems.push_back(std::vector<size_t>());
+        x.get_elements(elems.back());
+    };
+
+    bool ret                = true;
+
+    for (size_t i = 0; i < sets.size(); ++i)
+    {
+        for (size_t j = 0; j < sets.size(); ++j)
+        {
+            const dbs& x    = sets[i];
+            const dbs& y    = sets[j];
+            order_type ot   = compare_elements(x, y);
+
+            if (ot != compare_vectors(elems[i], elems[j]))
+                ret         = false;
+
+            if ((x < y) != (ot == order_type::less) || (x > y) != (ot == order_type::greater)
+                || (x <= y) != (ot != order_type::greater) || (x >= y) != (ot != order_type::less))
+            {
+                ret         = false;
+            };
+
+            if ((ot == order_type::equal) != (compare(x, y) == order_type::equal))
+                ret         = false;
+        };
+    };
+
+    return ret;
+};
+
+bool test_dbs::test_compare_elements_all(size_t n_rep)
+{
+    bool ret    = true;
+
+    for (size_t i = 0; i < n_rep; ++i)
+    {
+        ret         &= test_compare_elements(64*2, 10);
+        ret         &= test_compare_elements(64*32, 100);
+        ret         &= test_compare_elements(64*32*32*32*32, 1000);
+        ret         &= test_compare_elements(-size_t(1), 1000);
+    };
+
+    // sets ordered by sequences of elements
+    std::vector<dbs> sorted = {dbs(), dbs{0}, dbs{0, 1000}, dbs{1}, dbs{1, 5}, dbs{1, 5, 7}, 
+                               dbs{1, 6}, dbs{2}, dbs{size_t(-1)}};
+
+    for (size_t i = 0; i + 1 < sorted.size(); ++i)
+        ret         &= sorted[i] < sorted[i + 1];
+
+    std::cout << "test_compare_elements: " << (ret? "OK" : "FAILED") << "\n";
+    return ret;
+};
+
+bool test_dbs::test_unordered(size_t max_elem, size_t n_items, size_t n_sets)
+{
+    std::set<size_t> s      = rand_set(max_elem, n_items);
+    std::vector<size_t> sv  = to_vector(s);
+
+    // bitsets sharing nodes and equal bitsets not sharing nodes
+    dbs bs(sv.size(), sv.data());
+    std::vector<dbs> sets;
+
+    for (size_t i = 0; i < n_sets; ++i)
+    {
+        if (rand_elem(4) == 0 && sets.empty() == false)
+        {
+            std::vector<size_t> elems;
+            sets[rand_elem(sets.size())].get_elements(elems);
+            sets.push_back(dbs(elems.size(), elems.data()));
+        }
+        else
+        {
+            bs              = bs.flip(rand_elem(max_elem));
+            sets.push_back(bs);
+        };
+    };
+
+    bool ret                = true;
+
+    dbs_unordered_set table;
+    dbs_unordered_map<size_t> map;
+    std::map<std::vector<size_t>, size_t> model;
+
+    for (size_t i = 0; i < 4 * n_sets; ++i)
+    {
+        const dbs& x        = sets[rand_elem(sets.size())];
+
+        std::vector<size_t> key;
+        x.get_elements(key);
+
+        bool stored         = model.count(key) > 0;
+
+        switch (rand_elem(4))
+        {
+            case 0:
+            case 1:
+            {
+                if (table.insert(x) == stored)
+                    ret     = false;
+                if (map.insert(x, i) == stored)
+                    ret     = false;
+
+                if (stored == false)
+                    model[key]  = i;
+
+                break;
+            }
+            case 2:
+            {
+                if (table.erase(x) != stored || map.erase(x) != stored)
+                    ret     = false;
+
+                model.erase(key);
+                break;
+            }
+            default:
+            {
+                const size_t* val   = map.find(x);
+
+                if (table.contains(x) != stored || (val != nullptr) != stored)
+                    ret     = false;
+                if (stored == true && *val != model[key])
+                    ret     = false;
+
+                break;
+            }
+        };
+
+        if (table.size() != model.size() || map.size() != model.size())
+            ret             = false;
+    };
+
+    // all stored bitsets are visited
+    size_t n_visited        = 0;
+    table.for_each([&](const dbs& x)
+    {
+        std::vector<size_t> key;
+        x.get_elements(key);
+        n_visited           += model.count(key);
+    });
+
+    map.for_each([&](const dbs& x, size_t val)
+    {
+        std::vector<size_t> key;
+        x.get_elements(key);
+        n_visited           += (model.count(key) > 0 && model[key] == val) ? 1 : 0;
+    });
+
+    if (n_visited != 2 * model.size())
+        ret                 = false;
+
+    // copies are independent
+    {
+        dbs_unordered_set copy  = table;
+        table.clear();
+
+        if (copy.size() != model.size() || table.empty() == false)
+            ret             = false;
+
+        table               = std::move(copy);
+    };
+
+    // interned bitsets are equal iff they share the root node
+    dbs_unordered_set interned;
+    std::vector<dbs> canonical;
+
+    for (const dbs& x : sets)
+        canonical.push_back(interned.intern(x));
+
+    for (size_t i = 0; i < 100; ++i)
+    {
+        size_t k1           = rand_elem(sets.size());
+        size_t k2           = rand_elem(sets.size());
+
+        const dbs& c1       = canonical[k1];
+        const dbs& c2       = canonical[k2];
+
+        if (c1 != sets[k1])
+            ret             = false;
+
+        bool same_root      = c1.get_data().m_ptrs == c2.get_data().m_ptrs 
+                            && c1.get_data().m_flags == c2.get_data().m_flags;
+
+        if (same_root != (sets[k1] == sets[k2]))
+            ret             = false;
+    };
+
+    if (interned.size() > sets.size())
+        ret                 = false;
+
+    return ret;
+};
+
+bool test_dbs::test_unordered_all(size_t n_rep)
+{
+    bool ret    = true;
+
+    for (size_t i = 0; i < n_rep; ++i)
+    {
+        ret         &= test_unordered(64*2, 10, 10);
+        ret         &= test_unordered(64*32, 100, 100);
+        ret         &= test_unordered(64*32*32*32*32, 1000, 1000);
+        ret         &= test_unordered(-size_t(1), 1000, 100);
+    };
+
+    // empty bitset and bitsets stored in leaves
+    dbs_unordered_map<int> map;
+    map[dbs()]      = 1;
+    map[dbs{1}]     = 2;
+    map[dbs{1,2}]   = 3;
+
+    ret             &= map.size() == 3 && *map.find(dbs{1}) == 2 && map[dbs()] == 1
+                    && map.find(dbs{2}) == nullptr;
+
+    std::cout << "test_unordered: " << (ret? "OK" : "FAILED") << "\n";
+    return ret;
+};
+
+bool test_dbs::test_sketch(size_t max_elem, size_t n_items)
+{
+    std::set<size_t> s1     = rand_set(max_elem, n_items);
+    std::set<size_t> s2;
+
+    // sets sharing about a half of elements
+    for (size_t elem : s1)
+    {
+        if (rand_elem(2) == 0)
+            s2.insert(elem);
+    };
+
+    for (size_t i = 0; i < n_items / 2; ++i)
+        s2.insert(rand_elem(max_elem));
+
+    std::vector<size_t> sv1 = to_vector(s1);
+    std::vector<size_t> sv2 = to_vector(s2);
+
+    dbs bs1(sv1.size(), sv1.data());
+    dbs bs2(sv2.size(), sv2.data());
+    dbs bs1_copy            = dbs::from_unsorted(sv1.size(), sv1.data());
+
+    std::vector<size_t> v_inter;
+    std::set_intersection(s1.begin(), s1.end(), s2.begin(), s2.end(), 
+                          std::back_inserter(v_inter));
+
+    double n_union          = double(s1.size() + s2.size() - v_inter.size());
+    double n_inter          = double(v_inter.size());
+    double jaccard          = n_union == 0.0 ? 1.0 : n_inter / n_union;
+
+    bool ret                = true;
+
+    for (minhash_kind kind : {minhash_kind::k_hash, minhash_kind::one_permutation})
+    {
+        dbs_minhash m1(bs1, 256, kind);
+        dbs_minhash m2(bs2, 256, kind);
+        dbs_minhash m1_copy(bs1_copy, 256, kind);
+
+        // equal sets have equal signatures
+        if (m1.values() != m1_copy.values() || estimate_jaccard(m1, m1_copy) != 1.0)
+            ret             = false;
+        if (m1.count() != s1.size() || m1.source_hash() != hash_value(bs1))
+            ret             = false;
+
+        if (n_items < 1000)
+            continue;
+
+        if (std::abs(estimate_jaccard(m1, m2) - jaccard) > 0.2)
+            ret             = false;
+        if (std::abs(estimate_union_size(m1, m2) - n_union) > 0.2 * n_union)
+            ret             = false;
+        if (std::abs(estimate_intersection_size(m1, m2) - n_inter) > 0.2 * n_union)
+            ret             = false;
+    };
+
+    {
+        dbs_hll h1(bs1);
+        dbs_hll h2(bs2);
+        dbs_hll h1_copy(bs1_copy);
+
+        if (h1.registers() != h1_copy.registers())
+            ret             = false;
+
+        // merged sketches are sketches of unions
+        if (h1.merge(h2).registers() != dbs_hll(bs1 | bs2).registers())
+            ret             = false;
+
+        // relative standard error of estimates is about 1.04 / 2^(precision/2),
+        // therefore tolerances are checked only for large sets
+        if (n_items < 1000)
+            return ret;
+
+        double n1           = double(s1.size());
+
+        if (std::abs(h1.estimate() - n1) > 0.1 * n1)
+            ret             = false;
+        if (std::abs(estimate_union_size(h1, h2) - n_union) > 0.1 * n_union)
+            ret             = false;
+        if (std::abs(estimate_intersection_size(h1, h2) - n_inter) > 0.1 * n_union)
+            ret             = false;
+        if (std::abs(estimate_jaccard(h1, h2) - jaccard) > 0.2)
+            ret             = false;
+    };
+
+    return ret;
+};
+
+bool test_dbs::test_sketch_all(size_t n_rep)
+{
+    bool ret    = true;
+
+    for (size_t i = 0; i < n_rep; ++i)
+    {
+        ret         &= test_sketch(64*2, 10);
+        ret         &= test_sketch(64*32, 100);
+        ret         &= test_sketch(64*32*32*32*32, 1000);
+        ret         &= test_sketch(-size_t(1), 1000);
+    };
+
+    // empty sets
+    dbs bs{1, 2, 3};
+    dbs_minhash m0(dbs(), 16);
+
+    ret             &= estimate_jaccard(m0, m0) == 1.0 
+                    && estimate_jaccard(m0, dbs_minhash(bs, 16)) == 0.0
+                    && dbs_hll(dbs()).estimate() == 0.0;
+
+    // sketches with different parameters cannot be compared
+    bool thrown     = false;
+
+    try
+    {
+        estimate_jaccard(dbs_minhash(bs, 16), dbs_minhash(bs, 32));
+    }
+    catch (std::invalid_argument&)
+    {
+        thrown      = true;
+    };
+
+    ret             &= thrown;
+
+    std::cout << "test_sketch: " << (ret? "OK" : "FAILED") << "\n";
+    return ret;
+};
+
+bool test_dbs::test_init()
+{
+    size_t elems[]  = {0, 1, 2, 3, 1000, 1001, 1002, 1003, size_t(-4), 
+                        size_t(-3), size_t(-2), size_t(-1)};
+
+    dbs expected    = dbs(12, elems);
+
+    if (g_static_set != expected)
+        return false;
+
+    // sets created before main share the allocator with sets created now
+    dbs x           = g_static_set.reset(1000);
+
+    if (x.size() != 11 || g_static_set.size() != 12)
+        return false;
+
+    return true;
+};
+
+bool test_dbs::test_init_all(size_t n_rep)
+{
+    (void)n_rep;
+
+    bool ret    = test_init();
+
+    std::cout << "test_init: " << (ret? "OK" : "FAILED") << "\n";
+    return ret;
+};
+
+#if defined(DBS_THREAD_SAFE) && defined(DBS_TEST_HOOKS)
+
+// stage of threads interleaved by atom_hook
+static std::atomic<int> g_atom_stage(0);
+
+// a reader holding a node waits until the node is replaced; the writer waits
+// until the reader releases the node before retiring it
+static void atom_interleave_hook(details::atom_event ev)
+{
+    if (ev == details::atom_event::acquired && g_atom_stage == 1)
+    {
+        g_atom_stage    = 2;
+
+        while (g_atom_stage != 3)
+            std::this_thread::yield();
+    }
+    else if (ev == details::atom_event::replaced && g_atom_stage == 2)
+    {
+        g_atom_stage    = 3;
+
+        while (g_atom_stage != 4)
+            std::this_thread::yield();
+    };
+};
+
+static void atom_yield_hook(details::atom_event)
+{
+    std::this_thread::yield();
+};
+
+#endif
+
+bool test_dbs::test_atom_retire(size_t n_threads, size_t n_items)
+{
+    #ifdef DBS_THREAD_SAFE
+        bool ret        = true;
+        size_t n_nodes  = allocated_nodes();
+
+        #ifdef DBS_TEST_HOOKS
+            // readers release a replaced node before the writer retires it;
+            // mode 0 - store, 1 - exchange, 2 - compare_exchange
+            for (int mode = 0; mode < 3; ++mode)
+            {
+                dbs_atom atom(dbs{1, 2, 1000003});
+                dbs expected        = atom.load();
+
+                g_atom_stage        = 1;
+                details::atom_hook  = &atom_interleave_hook;
+
+                std::thread reader([&]()
+                {
+                    if (atom.load() != dbs{1, 2, 1000003})
+                        ret         = false;
+
+                    g_atom_stage    = 4;
+                });
+
+                while (g_atom_stage != 2)
+                    std::this_thread::yield();
+
+                if (mode == 0)
+                    atom.store(dbs{5, 1000003});
+                else if (mode == 1)
+                    atom.exchange(dbs{5, 1000003});
+                else if (atom.compare_exchange(expected, dbs{5, 1000003}) == false)
+                    ret             = false;
+
+                reader.join();
+                details::atom_hook  = nullptr;
+
+                if (atom.load() != dbs{5, 1000003})
+                    ret             = false;
+            };
+        #endif
+
+        // readers and writers are rescheduled between acquiring, replacing
+        // and retiring nodes if test hooks are available
+        {
+            dbs_atom atom;
+
+            #ifdef DBS_TEST_HOOKS
+                details::atom_hook  = &atom_yield_hook;
+            #endif
+
+            std::vector<std::thread> threads;
+
+            for (size_t t = 0; t < n_threads; ++t)
+            {
+                threads.push_back(std::thread([&, t]()
+                {
+                    for (size_t i = 0; i < n_items; ++i)
+                    {
+                        size_t elem = (i * n_threads + t) * 1000003;
+
+                        switch (i % 4)
+                        {
+                            case 0:     atom.store(dbs{elem});                      break;
+                            case 1:     atom.exchange(dbs{elem});                   break;
+                            case 2:     atom.update([elem](const dbs& x) { return x.set(elem); });
+                                        break;
+                            default:    atom.load();                                break;
+                        };
+                    };
+                }));
+            };
+
+            for (std::thread& th : threads)
+                th.join();
+
+            #ifdef DBS_TEST_HOOKS
+                details::atom_hook  = nullptr;
+            #endif
+        };
+
+        // all nodes are released
+        if (allocated_nodes() != n_nodes)
+            ret         = false;
+
+        return ret;
+    #else
+        (void)n_threads;
+        (void)n_items;
+        return true;
+    #endif
+};
+
+bool test_dbs::test_atom_all(size_t n_rep)
+{
+    bool ret    = true;
+
+    for (size_t i = 0; i < n_rep / 10; ++i)
+    {
+        ret         &= test_atom(1, 100);
+        ret         &= test_atom(4, 100);
+    };
+
+    ret             &= test_atom_retire(4, 1000);
+
+    std::cout << "test_atom: " << (ret? "OK" : "FAILED") << "\n";
+    return ret;
+};
+
+bool test_dbs::test_expr_all(size_t n_rep)
+{
+    bool ret    = true;
+
+    for (size_t i = 0; i < n_rep; ++i)
+    {
+        ret         &= test_expr(64*32, 100);
+        ret         &= test_expr(64*32*32*32*32, 1000);
+        ret         &= test_expr(-size_t(1), 1000);
+    };
+
+    std::cout << "test_expr: " << (ret? "OK" : "FAILED") << "\n";
+    return ret;
+};
+
+bool test_dbs::test_parallel_all(size_t n_rep)
+{
+    bool ret    = true;
+
+    for (size_t i = 0; i < n_rep; ++i)
+    {
+        size_t n_threads    = 1 + rand_elem(8);
+
+        ret         &= test_parallel(64*32, 100, n_threads);
+        ret         &= test_parallel(64*32*32*32*32, 1000, n_threads);
+        ret         &= test_parallel(-size_t(1), 1000, n_threads);
+    };
+
+    // restore default number of threads
+    set_parallel_threads(0);
+
+    std::cout << "test_parallel: " << (ret? "OK" : "FAILED") << "\n";
+    return ret;
+};
+
+bool test_dbs::test_set(size_t max_elem, size_t n_items)
+{        
+    dbs bs;
+
+    std::vector<size_t> dbs_elems;
+    std::set<size_t>    true_elems;
+
+    bool ret = true;
+
+    for (size_t i = 0; i < n_items; ++i)
+    {
+        dbs_elems.clear();
+
+        size_t t    = static_cast<size_t>(genrand_int32());
+        t           = t % max_elem;
+
+        true_elems.insert(t);
+
+        bs          = bs.set(t);
+        bs.get_elements(dbs_elems);            
+
+        auto it1    = true_elems.begin();
+        auto it2    = dbs_elems.begin();
+
+        int pos     = 0;
+        for (; it1 != true_elems.end() && it2 != dbs_elems.end(); ++it1, ++it2, ++pos)
+        {
+            if (*it1 != *it2)
+            {
+                ret = false;
+                //std::cout << pos << " " << *it1 << " " << *it2 << "\n";
+            };
+        };
+    };
+
+    return ret;
+};
+
+bool test_dbs::test_constructor(size_t max_elem, size_t n_items)
+{        
+    std::set<size_t> s          = rand_set(max_elem, n_items);
+    std::vector<size_t> v1      = to_vector(s);
+    std::vector<size_t> v2;
+
+    dbs bs(v1.size(), v1.data());
+    bs.get_elements(v2);
+
+    auto it1    = v1.begin();
+    auto it2    = v2.begin();
+
+    bool ret    = true;
+
+    for (; it1 != v1.end() && it2 != v2.end(); ++it1, ++it2)
+    {
+        if (*it1 != *it2)
+            ret = false;
+    };
+
+    return ret;
+};
+
+bool test_dbs::test_find(size_t max_elem, size_t n_items, size_t n_search)
+{        
+    std::set<size_t> s          = rand_set(max_elem, n_items);
+    std::vector<size_t> vec     = to_vector(s);
+
+    dbs bs(vec.size(), vec.data());
+
+    bool ret    = true;
+
+    for(size_t i = 0; i < n_search; ++i)
+    {
+        bool exist = (genrand_real1() < 0.5);
+
+        if (exist == true)
+        {
+            size_t elem     = this->rand_elem(max_elem);
+            s.insert(elem);
+            bs = bs.set(elem);
+
+            bool val        = bs.test(elem);
+            
+            if (val == false)
+                ret         = false;
+        }
+        else
+        {
+            size_t elem     = this->rand_elem(max_elem);
+            bool v1         = (s.find(elem) != s.end());
+            bool v2         = bs.test(elem);
+
+            if (v1 != v2)
+                ret         = false;
+        };
+    };
+
+    return ret;
+};
+
+bool test_dbs::test_reset(size_t max_elem, size_t n_items, size_t n_search)
+{        
+    std::set<size_t> s          = rand_set(max_elem, n_items);
+    std::vector<size_t> v1      = to_vector(s);
+
+    dbs bs(v1.size(), v1.data());
+
+    bool ret    = true;
+
+    for(size_t i = 0; i < n_search; ++i)
+    {
+        bool exist = (genrand_real1() < 0.5);
+
+        if (exist == true)
+        {
+            size_t elem     = this->rand_elem(max_elem);
+            s.erase(elem);
+
+            bs = bs.set(elem);
+            bs = bs.reset(elem);
+
+            bool val        = bs.test(elem);
+            
+            if (val == true)
+                ret         = false;
+        }
+        else
+        {
+            size_t elem     = this->rand_elem(max_elem);
+            s.erase(elem);
+
+            bs              = bs.reset(elem);
+            bool v2         = bs.test(elem);
+
+            if (v2 == true)
+                ret         = false;
+        };
+    };
+
+    for(auto it = s.begin(); it != s.end(); ++it)
+        bs = bs.reset(*it);
+
+    if (bs.size() != 0)
+        ret = false;
+
+    return ret;
+};
+
+bool test_dbs::test_not(size_t max_elem, size_t n_items, size_t n_search)
+{        
+    std::set<size_t> s          = rand_set(max_elem, n_items);
+    std::vector<size_t> vec     = to_vector(s);
+
+    dbs bs(vec.size(), vec.data());
+
+    bool ret    = true;
+
+    for(size_t i = 0; i < n_search; ++i)
+    {
+        bool exist = (genrand_real1() < 0.5);
+
+        if (exist == true)
+        {
+            size_t elem     = this->rand_elem(max_elem);
+            s.erase(elem);
+
+            bs = bs.set(elem);
+            bs = bs.flip(elem);
+
+            bool val        = bs.test(elem);
+            
+            if (val == true)
+                ret         = false;
+        }
+        else
+        {
+            size_t elem     = this->rand_elem(max_elem);
+            bool v1         = s.find(elem) != s.end();
+
+            if (v1)
+                s.erase(elem);
+            else
+                s.insert(elem);
+
+            bs              = bs.flip(elem);
+            bool v2         = bs.test(elem);
+            v1              = !v1;
+
+            if (v2 != v1)
+                ret         = false;
+        };
+    };
+
+    for(auto it = s.begin(); it != s.end(); ++it)
+        bs = bs.reset(*it);
+
+    if (bs.size() != 0)
+        ret = false;
+
+    return ret;
+};
+
+bool test_dbs::test_eq(size_t max_elem, size_t n_item)
+{        
+    std::set<size_t> s          = rand_set(max_elem, n_item);
+    std::vector<size_t> vec     = to_vector(s);
+
+    dbs bs(vec.size(), vec.data());
+
+    bool exist = (genrand_real1() < 0.5);
+
+    if (exist == true)
+    {
+        bool ret        = (bs == bs);
+
+        if (ret == false)
+            return false;
+        else
+            return true;
+    }
+    else
+    {
+        size_t elem     = this->rand_elem(max_elem);
+        bool v1         = s.find(elem) != s.end();
+
+        s.insert(elem);
+
+        dbs bs2         = bs.set(elem);
+        bool v2         = (bs == bs2);
+
+        if (v2 != v1)
+            return false;
+        else
+            return true;
+    };
+};
+
+bool test_dbs::test_neq(size_t max_elem, size_t n_item)
+{        
+    std::set<size_t> s          = rand_set(max_elem, n_item);
+    std::vector<size_t> vec     = to_vector(s);
+
+    dbs bs(vec.size(), vec.data());
+
+    bool exist = (genrand_real1() < 0.5);
+
+    if (exist == true)
+    {
+        bool ret        = ((bs != bs) == false);
+
+        if (ret == false)
+            return false;
+        else
+            return true;
+    }
+    else
+    {
+        size_t elem     = this->rand_elem(max_elem);
+        bool v1         = s.find(elem) != s.end();
+
+        s.insert(elem);
+
+        dbs bs2         = bs.set(elem);
+        bool v2         = (bs != bs2);
+        v1              = !v1;
+
+        if (v2 != v1)
+            return false;
+        else
+            return true;
+    };
+};
+bool test_dbs::test_and_levels(size_t max_elem, size_t n_item)
+{
+    // operands of different levels; first children of roots are subtrees
+    // of much lower level
+    std::set<size_t> s1         = rand_set(64*32, n_item);
+    std::set<size_t> s2         = rand_set(64*32, n_item);
+
+    s1.insert(rand_elem(max_elem));
+    s2.insert(rand_elem(rand_elem(max_elem) + 1));
+
+    std::set<size_t> s3;
+    std::set_intersection(s1.begin(), s1.end(), s2.begin(), s2.end(), 
+                          std::inserter(s3, s3.end()));
+
+    std::vector<size_t> v1      = to_vector(s1);
+    std::vector<size_t> v2      = to_vector(s2);
+    std::vector<size_t> v3      = to_vector(s3);
+
+    dbs bs1(v1.size(), v1.data());
+    dbs bs2(v2.size(), v2.data());
+    dbs bs3(v3.size(), v3.data());
+
+    bool ret    = true;
+
+    if (dbs(bs1 & bs2) != bs3 || dbs(bs2 & bs1) != bs3)
+        ret     = false;
+
+    return ret;
+};
+
+bool test_dbs::test_and(size_t max_elem, size_t n_item)
+{        
+    std::set<size_t> s1         = rand_set(max_elem, n_item);
+    std::set<size_t> s2         = rand_set(max_elem, n_item);
+
+    size_t common               = this->rand_elem(max_elem);
+    s1.insert(common);
+    s2.insert(common);
+
+    std::vector<size_t> v3;
+    v3.resize(s1.size() + s2.size());
+    auto it = std::set_intersection(s1.begin(), s1.end(), s2.begin(), s2.end(), v3.begin());
+    v3.resize(it-v3.begin());
+
+    std::vector<size_t> v1      = to_vector(s1);
+    std::vector<size_t> v2      = to_vector(s2);
+
+    dbs bs1(v1.size(), v1.data());
+    dbs bs2(v2.size(), v2.data());
+    dbs bs3 = bs1 & bs2;
+
+    std::vector<size_t> vret;
+    bs3.get_elements(vret);
+
+    auto it1 = v3.begin();
+    auto it2 = vret.begin();
+
+    bool ret = true;
+    for (; it1 != v3.end() && it2 != vret.end(); ++it1, ++it2)
+    {
+        if (*it1 != *it2)
+            ret = false;
+    };
+
+    return ret;
+};
+
+bool test_dbs::test_or(size_t max_elem, size_t n_item)
+{        
+    std::set<size_t> s1         = rand_set(max_elem, n_item);
+    std::set<size_t> s2         = rand_set(max_elem, n_item);
+
+    std::vector<size_t> v3;
+    v3.resize(s1.size() + s2.size());
+    auto it = std::set_union(s1.begin(), s1.end(), s2.begin(), s2.end(), v3.begin());
+    v3.resize(it-v3.begin());
+
+    std::vector<size_t> v1      = to_vector(s1);
+    std::vector<size_t> v2      = to_vector(s2);
+
+    dbs bs1(v1.size(), v1.data());
+    dbs bs2(v2.size(), v2.data());
+    dbs bs3 = bs1 | bs2;
+
+    std::vector<size_t> vret;
+    bs3.get_elements(vret);
+
+    auto it1 = v3.begin();
+    auto it2 = vret.begin();
+
+    bool ret = true;
+    for (; it1 != v3.end() && it2 != vret.end(); ++it1, ++it2)
+    {
+        if (*it1 != *it2)
+            ret = false;
+    };
+
+    return ret;
+};
+
+bool test_dbs::test_xor(size_t max_elem, size_t n_item)
+{        
+    std::set<size_t> s1         = rand_set(max_elem, n_item);
+    std::set<size_t> s2         = rand_set(max_elem, n_item);
+
+    size_t common               = this->rand_elem(max_elem);
+    s1.insert(common);
+    s2.insert(common);
+
+    std::vector<size_t> v3;
+    v3.resize(s1.size() + s2.size());
+    auto it = std::set_symmetric_difference(s1.begin(), s1.end(), s2.begin(), s2.end(), v3.begin());
+    v3.resize(it-v3.begin());
 
-        ret         &= test_eq(-size_t(1), 10);
-        ret         &= test_eq(-size_t(1), 100);
-        ret         &= test_eq(-size_t(1), 1000);
+    std::vector<size_t> v1      = to_vector(s1);
+    std::vector<size_t> v2      = to_vector(s2);
+
+    dbs bs1(v1.size(), v1.data());
+    dbs bs2(v2.size(), v2.data());
+    dbs bs3 = bs1 ^ bs2;
+
+    std::vector<size_t> vret;
+    bs3.get_elements(vret);
+
+    auto it1 = v3.begin();
+    auto it2 = vret.begin();
+
+    bool ret = true;
+    for (; it1 != v3.end() && it2 != vret.end(); ++it1, ++it2)
+    {
+        if (*it1 != *it2)
+        {
+            std::cout << "error\n";
+            dbs bs4 = bs1 ^ bs2;
+            ret = false;
+        };
     };
 
-    std::cout << "test_neq: " << (ret? "OK" : "FAILED") << "\n";
     return ret;
-
 };
-bool test_dbs::test_and_all(size_t n_rep)
+
+bool test_dbs::test_reclaim(size_t max_elem, size_t n_items)
 {
-    bool ret    = true;
+    size_t n_nodes  = allocated_nodes();
+    bool ret        = true;
 
-    for (size_t i = 0; i < n_rep; ++i)
     {
-        ret         &= test_and(64*32, 10);
-        ret         &= test_and(64*32, 100);
-        ret         &= test_and(64*32, 1000);
+        std::set<size_t> s      = rand_set(max_elem, n_items);
+        std::vector<size_t> vec = to_vector(s);
 
-        ret         &= test_and(64*32*32*32*32, 10);
-        ret         &= test_and(64*32*32*32*32, 100);
-        ret         &= test_and(64*32*32*32*32, 1000);
+        dbs bs1(vec.size(), vec.data());
+        dbs bs2 = bs1.set(rand_elem(max_elem));
+    };
 
-        ret         &= test_and(-size_t(1), 10);
-        ret         &= test_and(-size_t(1), 100);
-        ret         &= test_and(-size_t(1), 1000);
+    if (allocated_nodes() != n_nodes)
+        ret         = false;
+
+    set_reclamation_mode(reclamation_mode::deferred);
+
+    {
+        std::set<size_t> s      = rand_set(max_elem, n_items);
+        std::vector<size_t> vec = to_vector(s);
+
+        dbs bs1(vec.size(), vec.data());
+        dbs bs2 = bs1.flip(rand_elem(max_elem));
     };
 
-    std::cout << "test_and: " << (ret? "OK" : "FAILED") << "\n";
+    size_t n_dead   = allocated_nodes() - n_nodes;
+    size_t n_rel    = 0;
+
+    while (reclamation_queue_size() > 0)
+    {
+        size_t n    = reclaim(4);
+
+        if (n == 0 || n > 4)
+            ret     = false;
+
+        n_rel       += n;
+    };
+
+    if (n_rel != n_dead || allocated_nodes() != n_nodes)
+        ret         = false;
+
+    set_reclamation_mode(reclamation_mode::immediate);
+
     return ret;
 };
 
-bool test_dbs::test_or_all(size_t n_rep)
+bool test_dbs::test_resource(size_t max_elem, size_t n_items, bool use_pools)
 {
+    counting_resource res;
     bool ret    = true;
 
-    for (size_t i = 0; i < n_rep; ++i)
     {
-        ret         &= test_or(64*32, 10);
-        ret         &= test_or(64*32, 100);
-        ret         &= test_or(64*32, 1000);
+        std::set<size_t> s      = rand_set(max_elem, n_items);
+        std::vector<size_t> v1  = to_vector(s);
+        std::vector<size_t> v2;
 
-        ret         &= test_or(64*32*32*32*32, 10);
-        ret         &= test_or(64*32*32*32*32, 100);
-        ret         &= test_or(64*32*32*32*32, 1000);
+        dbs bs2;
 
-        ret         &= test_or(-size_t(1), 10);
-        ret         &= test_or(-size_t(1), 100);
-        ret         &= test_or(-size_t(1), 1000);
+        {
+            memory_resource_scope scope(&res, use_pools);
+
+            if (get_memory_resource() != &res)
+                ret             = false;
+
+            dbs bs1(v1.size(), v1.data());
+            bs2                 = bs1.set(v1[0]);
+        };
+
+        if (get_memory_resource() != malloc_resource() || res.m_blocks == 0)
+            ret                 = false;
+
+        bs2.get_elements(v2);
+
+        if (v1 != v2)
+            ret                 = false;
     };
 
-    std::cout << "test_or: " << (ret? "OK" : "FAILED") << "\n";
+    // memory is returned to the resource, when last set is destroyed
+    if (res.m_blocks != 0 || res.m_bytes != 0)
+        ret                     = false;
+
     return ret;
 };
 
-bool test_dbs::test_xor_all(size_t n_rep)
+bool test_dbs::test_resource_threads(size_t max_elem, size_t n_items)
 {
-    bool ret    = true;
+    #ifdef DBS_THREAD_SAFE
+        counting_resource res;
+        bool ret            = true;
+        size_t n_threads    = get_parallel_threads();
 
-    for (size_t i = 0; i < n_rep; ++i)
-    {
-        ret         &= test_xor(64*32, 10);
-        ret         &= test_xor(64*32, 100);
-        ret         &= test_xor(64*32, 1000);
+        set_parallel_threads(4);
 
-        ret         &= test_xor(64*32*32*32*32, 10);
-        ret         &= test_xor(64*32*32*32*32, 100);
-        ret         &= test_xor(64*32*32*32*32, 1000);
+        {
+            memory_resource_scope scope(&res, false);
 
-        ret         &= test_xor(-size_t(1), 10);
-        ret         &= test_xor(-size_t(1), 100);
-        ret         &= test_xor(-size_t(1), 1000);
+            // other threads use their own memory resource
+            std::thread th([&]()
+            {
+                dbs bs{1, 1000, 1000000};
+
+                if (get_memory_resource() != malloc_resource() || res.m_blocks != 0)
+                    ret     = false;
+            });
+
+            th.join();
+
+            // nodes created by worker threads are allocated from the memory
+            // resource of the calling thread; nodes are allocated directly
+            // from the resource
+            std::vector<size_t> v;
+
+            for (size_t i = 0; i < n_items; ++i)
+                v.push_back(rand_elem(max_elem));
+
+            size_t n_nodes  = allocated_nodes();
+            dbs bs          = dbs::from_unsorted(v.size(), v.data());
+
+            if (allocated_nodes() - n_nodes != res.m_blocks)
+                ret         = false;
+        };
+
+        if (res.m_blocks != 0 || get_memory_resource() != malloc_resource())
+            ret             = false;
+
+        set_parallel_threads(n_threads);
+        return ret;
+    #else
+        (void)max_elem;
+        (void)n_items;
+        return true;
+    #endif
+};
+
+bool test_dbs::test_move(size_t max_elem, size_t n_items)
+{
+    std::set<size_t> s          = rand_set(max_elem, n_items);
+    std::vector<size_t> v1      = to_vector(s);
+    std::vector<size_t> v2;
+
+    dbs bs1(v1.size(), v1.data());
+
+    size_t n_ops    = refcount_operations();
+
+    // moves are ownership transfers
+    dbs bs2(std::move(bs1));
+    dbs bs3;
+    bs3             = std::move(bs2);
+    bs3             = std::move(bs3);
+
+    // elements are moved when vector is reallocated
+    size_t n_copy   = 100;
+    std::vector<dbs> vec;
+
+    for (size_t i = 0; i < n_copy; ++i)
+        vec.push_back(bs3);
+
+    n_ops           = refcount_operations() - n_ops;
+
+    bool ret        = true;
+
+    #ifdef DBS_REFCOUNT_STATS
+        bool has_tree   = bs3.get_data().get_level() > 0;
+
+        if (n_ops != (has_tree ? n_copy : 0))
+            ret         = false;
+    #endif
+
+    if (bs1.any() == true || bs2.any() == true)
+        ret         = false;
+
+    bs3.get_elements(v2);
+
+    if (v1 != v2 || vec.back() != bs3)
+        ret         = false;
+
+    // elements are added to a temporary; a copy taken in the middle shares
+    // nodes, which must not be modified
+    std::vector<size_t> v3      = v1;
+
+    for (size_t i = v3.size(); i > 1; --i)
+        std::swap(v3[i - 1], v3[rand_elem(i)]);
+
+    size_t n_half   = v3.size() / 2;
+    dbs acc;
+    dbs half;
+
+    for (size_t i = 0; i < v3.size(); ++i)
+    {
+        if (i == n_half)
+            half    = acc;
+
+        acc         = std::move(acc).set(v3[i]);
     };
 
-    std::cout << "test_xor: " << (ret? "OK" : "FAILED") << "\n";
+    std::sort(v3.begin(), v3.begin() + n_half);
+
+    if (acc != bs3 || half != dbs(n_half, v3.data()))
+        ret         = false;
+
+    // children of nodes, that are not shared, are moved instead of copied
+    size_t elem     = rand_elem(max_elem);
+    dbs bs4         = bs3;
+    dbs bs5         = bs3;
+
+    size_t n_copy_ops   = refcount_operations();
+    dbs bs6         = bs4.set(elem);
+    bs4             = dbs();
+    n_copy_ops      = refcount_operations() - n_copy_ops;
+
+    // bs5 is shared with bs3
+    bs5             = bs5.set(elem);
+
+    size_t n_move_ops   = refcount_operations();
+    dbs bs7         = std::move(bs5).set(elem);
+    n_move_ops      = refcount_operations() - n_move_ops;
+
+    if (bs6 != bs7 || bs6 != bs3.set(elem) || bs5.any() == true || bs4.any() == true)
+        ret         = false;
+
+    #ifdef DBS_REFCOUNT_STATS
+        if (bs3.get_data().get_level() > 1 && n_move_ops >= n_copy_ops)
+            ret     = false;
+    #else
+        (void)n_copy_ops;
+        (void)n_move_ops;
+    #endif
+
     return ret;
 };
 
-bool test_dbs::test_set(size_t max_elem, size_t n_items)
-{        
-    dbs bs;
+bool test_dbs::test_iterator(size_t max_elem, size_t n_items, size_t n_search)
+{
+    std::set<size_t> s          = rand_set(max_elem, n_items);
 
-    std::vector<size_t> dbs_elems;
-    std::set<size_t>    true_elems;
+    // elements stored in the highest levels
+    if (max_elem == size_t(-1) && genrand_real1() < 0.5)
+    {
+        s.insert(max_elem - 1);
+        s.insert(max_elem / 2 + rand_elem(max_elem));
+    };
 
-    bool ret = true;
+    std::vector<size_t> v1      = to_vector(s);
+    std::vector<size_t> v2;
+    std::vector<size_t> v3;
 
-    for (size_t i = 0; i < n_items; ++i)
+    dbs bs(v1.size(), v1.data());
+
+    for (size_t elem : bs)
+        v2.push_back(elem);
+
+    for (auto it = bs.rbegin(); it != bs.rend(); ++it)
+        v3.push_back(*it);
+
+    std::reverse(v3.begin(), v3.end());
+
+    bool ret    = true;
+
+    if (v1 != v2 || v1 != v3)
+        ret     = false;
+
+    // decrement and post increment
+    auto it     = bs.end();
+    for (auto pos = s.rbegin(); pos != s.rend(); ++pos)
     {
-        dbs_elems.clear();
+        --it;
+        if (*it != *pos)
+            ret = false;
+    };
 
-        size_t t    = static_cast<size_t>(genrand_int32());
-        t           = t % max_elem;
+    if (it != bs.begin())
+        ret     = false;
 
-        true_elems.insert(t);
+    for (auto pos = s.begin(); pos != s.end(); ++pos)
+    {
+        if (*(it++) != *pos)
+            ret = false;
+    };
 
-        bs          = bs.set(t);
-        bs.get_elements(dbs_elems);            
+    if (it != bs.end())
+        ret     = false;
 
-        auto it1    = true_elems.begin();
-        auto it2    = dbs_elems.begin();
+    // lower_bound
+    for (size_t i = 0; i < n_search; ++i)
+    {
+        size_t n;
 
-        int pos     = 0;
-        for (; it1 != true_elems.end() && it2 != dbs_elems.end(); ++it1, ++it2, ++pos)
+        if (genrand_real1() < 0.5 && v1.size() > 0)
+            n   = v1[rand_elem(v1.size())] + (genrand_real1() < 0.5 ? 0 : 1);
+        else
+            n   = rand_elem(max_elem);
+
+        auto it1    = s.lower_bound(n);
+        auto it2    = bs.lower_bound(n);
+
+        if ((it1 == s.end()) != (it2 == bs.end()))
         {
+            ret     = false;
+            continue;
+        };
+
+        if (it1 == s.end())
+            continue;
+
+        if (*it1 != *it2)
+            ret     = false;
+
+        // move one step back and forth
+        if (it1 != s.begin())
+        {
+            --it1;
+            --it2;
+
             if (*it1 != *it2)
-            {
                 ret = false;
-                //std::cout << pos << " " << *it1 << " " << *it2 << "\n";
-            };
         };
     };
 
+    if (bs.lower_bound(dbs::npos) != bs.end() && bs.test(dbs::npos) == false)
+        ret         = false;
+
+    dbs empty;
+    if (empty.begin() != empty.end() || empty.lower_bound(0) != empty.end())
+        ret         = false;
+
     return ret;
 };
 
-bool test_dbs::test_constructor(size_t max_elem, size_t n_items)
-{        
+bool test_dbs::test_decode(size_t max_elem, size_t n_items)
+{
     std::set<size_t> s          = rand_set(max_elem, n_items);
     std::vector<size_t> v1      = to_vector(s);
-    std::vector<size_t> v2;
 
     dbs bs(v1.size(), v1.data());
+
+    bool ret    = true;
+
+    // get_elements appends elements
+    std::vector<size_t> v2      = {1, 2};
     bs.get_elements(v2);
 
-    auto it1    = v1.begin();
-    auto it2    = v2.begin();
+    if (v2.size() != v1.size() + 2 || std::equal(v1.begin(), v1.end(), v2.begin() + 2) == false)
+        ret     = false;
 
-    bool ret    = true;
+    // decoding in chunks
+    size_t chunk_size           = 1 + rand_elem(200);
+    std::vector<size_t> chunk(chunk_size);
+    std::vector<size_t> v3;
 
-    for (; it1 != v1.end() && it2 != v2.end(); ++it1, ++it2)
+    dbs::const_iterator pos     = bs.begin();
+
+    for (;;)
     {
-        if (*it1 != *it2)
-            ret = false;
+        size_t n    = bs.get_elements(pos, chunk.data(), chunk_size);
+
+        if (n == 0)
+            break;
+
+        if (n > chunk_size)
+            ret     = false;
+
+        v3.insert(v3.end(), chunk.begin(), chunk.begin() + n);
     };
 
+    if (v1 != v3 || pos != bs.end())
+        ret         = false;
+
+    // decoding from a position
+    size_t start                = rand_elem(max_elem);
+    pos                         = bs.lower_bound(start);
+    v3.resize(v1.size());
+
+    size_t n        = bs.get_elements(pos, v3.data(), v3.size());
+    auto it         = s.lower_bound(start);
+
+    if (n != (size_t)std::distance(it, s.end()) || std::equal(it, s.end(), v3.begin()) == false)
+        ret         = false;
+
     return ret;
 };
 
-bool test_dbs::test_find(size_t max_elem, size_t n_items, size_t n_search)
-{        
+bool test_dbs::test_next(size_t max_elem, size_t n_items, size_t n_search)
+{
     std::set<size_t> s          = rand_set(max_elem, n_items);
-    std::vector<size_t> vec     = to_vector(s);
 
-    dbs bs(vec.size(), vec.data());
+    // add a range of consecutive elements
+    size_t range_first          = rand_elem(max_elem);
+    size_t range_size           = rand_elem(1000);
+
+    for (size_t i = 0; i < range_size && range_first + i < max_elem; ++i)
+        s.insert(range_first + i);
+
+    if (max_elem == size_t(-1) && genrand_real1() < 0.5)
+    {
+        s.insert(max_elem);
+        s.insert(max_elem - 1);
+    };
+
+    std::vector<size_t> v1      = to_vector(s);
+    dbs bs(v1.size(), v1.data());
 
     bool ret    = true;
 
-    for(size_t i = 0; i < n_search; ++i)
+    size_t first                = s.empty() ? dbs::npos : *s.begin();
+    size_t last                 = s.empty() ? dbs::npos : *s.rbegin();
+
+    if (bs.first() != first || bs.last() != last)
+        ret     = false;
+
+    for (size_t i = 0; i < n_search; ++i)
     {
-        bool exist = (genrand_real1() < 0.5);
+        size_t n;
 
-        if (exist == true)
-        {
-            size_t elem     = this->rand_elem(max_elem);
-            s.insert(elem);
-            bs = bs.set(elem);
+        double r    = genrand_real1();
 
-            bool val        = bs.test(elem);
-            
-            if (val == false)
-                ret         = false;
-        }
+        if (r < 0.3 && v1.size() > 0)
+            n       = v1[rand_elem(v1.size())];
+        else if (r < 0.6 && range_size > 0)
+            n       = range_first + rand_elem(range_size + 2) - 1;
+        else if (r < 0.7)
+            n       = (genrand_real1() < 0.5) ? 0 : dbs::npos;
         else
+            n       = rand_elem(max_elem);
+
+        // next and prev
+        auto it_next    = s.upper_bound(n);
+        auto it_prev    = s.lower_bound(n);
+
+        size_t next     = (it_next == s.end()) ? dbs::npos : *it_next;
+        size_t prev     = (it_prev == s.begin()) ? dbs::npos : *(--it_prev);
+
+        if (bs.next(n) != next || bs.prev(n) != prev)
+            ret         = false;
+
+        // next_unset and prev_unset
+        size_t next_unset   = n;
+        do
         {
-            size_t elem     = this->rand_elem(max_elem);
-            bool v1         = (s.find(elem) != s.end());
-            bool v2         = bs.test(elem);
+            next_unset      = (next_unset == dbs::npos) ? dbs::npos : next_unset + 1;
+        }
+        while (next_unset != dbs::npos && s.count(next_unset) == 1);
 
-            if (v1 != v2)
-                ret         = false;
-        };
+        size_t prev_unset   = n;
+        do
+        {
+            prev_unset      = (prev_unset == 0) ? dbs::npos : prev_unset - 1;
+        }
+        while (prev_unset != dbs::npos && s.count(prev_unset) == 1);
+
+        if (bs.next_unset(n) != next_unset || bs.prev_unset(n) != prev_unset)
+            ret         = false;
     };
 
     return ret;
 };
 
-bool test_dbs::test_reset(size_t max_elem, size_t n_items, size_t n_search)
-{        
+bool test_dbs::test_visitor(size_t max_elem, size_t n_items)
+{
     std::set<size_t> s          = rand_set(max_elem, n_items);
     std::vector<size_t> v1      = to_vector(s);
+    std::vector<size_t> v2;
+    std::vector<size_t> v3;
 
     dbs bs(v1.size(), v1.data());
 
-    bool ret    = true;
+    bool ret        = true;
+    size_t n_words  = 0;
+    size_t last_off = 0;
 
-    for(size_t i = 0; i < n_search; ++i)
+    bool finished   = bs.for_each_word([&](size_t offset, size_t word)
     {
-        bool exist = (genrand_real1() < 0.5);
+        if (word == 0 || offset % dbs::block_bits != 0)
+            ret     = false;
 
-        if (exist == true)
+        if (n_words > 0 && offset <= last_off)
+            ret     = false;
+
+        for (size_t i = 0; i < dbs::block_bits; ++i)
         {
-            size_t elem     = this->rand_elem(max_elem);
-            s.erase(elem);
+            if (word & (size_t(1) << i))
+                v2.push_back(offset + i);
+        };
 
-            bs = bs.set(elem);
-            bs = bs.reset(elem);
+        last_off    = offset;
+        ++n_words;
+    });
 
-            bool val        = bs.test(elem);
-            
-            if (val == true)
-                ret         = false;
-        }
-        else
+    bs.for_each_block([&](size_t offset, size_t word_0, size_t word_1)
+    {
+        for (size_t i = 0; i < 2 * dbs::block_bits; ++i)
         {
-            size_t elem     = this->rand_elem(max_elem);
-            s.erase(elem);
-
-            bs              = bs.reset(elem);
-            bool v2         = bs.test(elem);
+            size_t word = (i < dbs::block_bits) ? word_0 : word_1;
 
-            if (v2 == true)
-                ret         = false;
+            if (word & (size_t(1) << (i % dbs::block_bits)))
+                v3.push_back(offset + i);
         };
-    };
+    });
 
-    for(auto it = s.begin(); it != s.end(); ++it)
-        bs = bs.reset(*it);
+    if (finished == false || v1 != v2 || v1 != v3)
+        ret         = false;
 
-    if (bs.size() != 0)
-        ret = false;
+    // early termination
+    size_t n_stop   = rand_elem(n_words + 1);
+    size_t n_calls  = 0;
 
-    return ret;
-};
+    finished        = bs.for_each_word([&](size_t, size_t) -> bool
+    {
+        ++n_calls;
+        return n_calls < n_stop;
+    });
 
-bool test_dbs::test_not(size_t max_elem, size_t n_items, size_t n_search)
-{        
-    std::set<size_t> s          = rand_set(max_elem, n_items);
-    std::vector<size_t> vec     = to_vector(s);
+    if (n_stop > 0 && (finished == true || n_calls != n_stop))
+        ret         = false;
 
-    dbs bs(vec.size(), vec.data());
+    return ret;
+};
 
-    bool ret    = true;
+bool test_dbs::test_parallel(size_t max_elem, size_t n_items, size_t n_threads)
+{
+    set_parallel_threads(n_threads);
 
-    for(size_t i = 0; i < n_search; ++i)
-    {
-        bool exist = (genrand_real1() < 0.5);
+    std::set<size_t> s          = rand_set(max_elem, n_items);
+    std::vector<size_t> v1      = to_vector(s);
+    std::vector<size_t> v2      = {size_t(1), size_t(2)};
+    std::vector<size_t> v3;
 
-        if (exist == true)
-        {
-            size_t elem     = this->rand_elem(max_elem);
-            s.erase(elem);
+    dbs bs(v1.size(), v1.data());
 
-            bs = bs.set(elem);
-            bs = bs.flip(elem);
+    bool ret        = true;
 
-            bool val        = bs.test(elem);
-            
-            if (val == true)
-                ret         = false;
-        }
-        else
-        {
-            size_t elem     = this->rand_elem(max_elem);
-            bool v1         = s.find(elem) != s.end();
+    if (get_parallel_threads() != n_threads)
+        ret         = false;
 
-            if (v1)
-                s.erase(elem);
-            else
-                s.insert(elem);
+    if (parallel_size(bs) != v1.size())
+        ret         = false;
 
-            bs              = bs.flip(elem);
-            bool v2         = bs.test(elem);
-            v1              = !v1;
+    // elements are appended
+    parallel_get_elements(bs, v2);
 
-            if (v2 != v1)
-                ret         = false;
-        };
+    if (v2.size() != v1.size() + 2 || v2[0] != 1 || v2[1] != 2 
+            || std::equal(v1.begin(), v1.end(), v2.begin() + 2) == false)
+    {
+        ret         = false;
     };
 
-    for(auto it = s.begin(); it != s.end(); ++it)
-        bs = bs.reset(*it);
-
-    if (bs.size() != 0)
-        ret = false;
+    std::mutex mutex;
 
-    return ret;
-};
+    parallel_for_each(bs, [&](size_t elem)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        v3.push_back(elem);
+    });
 
-bool test_dbs::test_eq(size_t max_elem, size_t n_item)
-{        
-    std::set<size_t> s          = rand_set(max_elem, n_item);
-    std::vector<size_t> vec     = to_vector(s);
+    std::sort(v3.begin(), v3.end());
 
-    dbs bs(vec.size(), vec.data());
+    if (v1 != v3)
+        ret         = false;
 
-    bool exist = (genrand_real1() < 0.5);
+    #ifdef DBS_THREAD_SAFE
+        // set operators; operands share subtrees or have different levels
+        std::set<size_t> s2         = rand_set(max_elem, n_items);
+        std::set<size_t> s3         = rand_set(64*32, n_items);
+        std::vector<size_t> w2      = to_vector(s2);
+        std::vector<size_t> w3      = to_vector(s3);
 
-    if (exist == true)
-    {
-        bool ret        = (bs == bs);
+        dbs others[3];
+        others[0]       = dbs(w2.size(), w2.data());
+        others[1]       = bs.set(rand_elem(max_elem)).reset(v1[rand_elem(v1.size())]);
+        others[2]       = dbs(w3.size(), w3.data());
 
-        if (ret == false)
-            return false;
-        else
-            return true;
-    }
-    else
-    {
-        size_t elem     = this->rand_elem(max_elem);
-        bool v1         = s.find(elem) != s.end();
+        for (const dbs& y : others)
+        {
+            if (parallel_and(bs, y) != dbs(bs & y) || parallel_and(y, bs) != dbs(y & bs))
+                ret     = false;
 
-        s.insert(elem);
+            if (parallel_or(bs, y) != dbs(bs | y) || parallel_or(y, bs) != dbs(y | bs))
+                ret     = false;
 
-        dbs bs2         = bs.set(elem);
-        bool v2         = (bs == bs2);
+            if (parallel_xor(bs, y) != dbs(bs ^ y) || parallel_xor(y, bs) != dbs(y ^ bs))
+                ret     = false;
+        };
+    #endif
 
-        if (v2 != v1)
-            return false;
-        else
-            return true;
-    };
+    return ret;
 };
 
-bool test_dbs::test_neq(size_t max_elem, size_t n_item)
-{        
-    std::set<size_t> s          = rand_set(max_elem, n_item);
-    std::vector<size_t> vec     = to_vector(s);
-
-    dbs bs(vec.size(), vec.data());
-
-    bool exist = (genrand_real1() < 0.5);
+bool test_dbs::test_atom(size_t n_threads, size_t n_items)
+{
+    #ifdef DBS_THREAD_SAFE
+        bool ret        = true;
+        size_t n_nodes  = allocated_nodes();
 
-    if (exist == true)
-    {
-        bool ret        = ((bs != bs) == false);
+        {
+            dbs_atom atom;
 
-        if (ret == false)
-            return false;
-        else
-            return true;
-    }
-    else
-    {
-        size_t elem     = this->rand_elem(max_elem);
-        bool v1         = s.find(elem) != s.end();
+            if (atom.load().any() == true)
+                ret     = false;
 
-        s.insert(elem);
+            atom.store(dbs{1, 2, 1000003});
 
-        dbs bs2         = bs.set(elem);
-        bool v2         = (bs != bs2);
-        v1              = !v1;
+            // value obtained from the variable can be replaced
+            dbs expected    = atom.load();
 
-        if (v2 != v1)
-            return false;
-        else
-            return true;
-    };
-};
-bool test_dbs::test_and(size_t max_elem, size_t n_item)
-{        
-    std::set<size_t> s1         = rand_set(max_elem, n_item);
-    std::set<size_t> s2         = rand_set(max_elem, n_item);
+            if (atom.compare_exchange(expected, expected.set(3)) == false)
+                ret     = false;
 
-    size_t common               = this->rand_elem(max_elem);
-    s1.insert(common);
-    s2.insert(common);
+            // equal set represented by a different tree
+            dbs other{1, 2, 3, 1000003};
 
-    std::vector<size_t> v3;
-    v3.resize(s1.size() + s2.size());
-    auto it = std::set_intersection(s1.begin(), s1.end(), s2.begin(), s2.end(), v3.begin());
-    v3.resize(it-v3.begin());
+            if (atom.compare_exchange(other, dbs{5}) == true || other != dbs{1, 2, 3, 1000003})
+                ret     = false;
 
-    std::vector<size_t> v1      = to_vector(s1);
-    std::vector<size_t> v2      = to_vector(s2);
+            if (atom.exchange(dbs{7}) != dbs{1, 2, 3, 1000003} || atom.load() != dbs{7})
+                ret     = false;
 
-    dbs bs1(v1.size(), v1.data());
-    dbs bs2(v2.size(), v2.data());
-    dbs bs3 = bs1 & bs2;
+            // concurrent updates; thread t sets elements t, t + n_threads, ...
+            // scaled by a large factor; readers observe increasing sets
+            atom.store(dbs());
 
-    std::vector<size_t> vret;
-    bs3.get_elements(vret);
+            std::atomic<bool> increasing(true);
+            std::vector<std::thread> threads;
 
-    auto it1 = v3.begin();
-    auto it2 = vret.begin();
+            for (size_t t = 0; t < n_threads; ++t)
+            {
+                threads.push_back(std::thread([&, t]()
+                {
+                    size_t last     = 0;
 
-    bool ret = true;
-    for (; it1 != v3.end() && it2 != vret.end(); ++it1, ++it2)
-    {
-        if (*it1 != *it2)
-            ret = false;
-    };
+                    for (size_t i = 0; i < n_items; ++i)
+                    {
+                        size_t elem = (i * n_threads + t) * 1000003;
+                        atom.update([elem](const dbs& x) { return x.set(elem); });
 
-    return ret;
-};
+                        size_t size = atom.load().size();
 
-bool test_dbs::test_or(size_t max_elem, size_t n_item)
-{        
-    std::set<size_t> s1         = rand_set(max_elem, n_item);
-    std::set<size_t> s2         = rand_set(max_elem, n_item);
+                        if (size <= last)
+                            increasing  = false;
 
-    std::vector<size_t> v3;
-    v3.resize(s1.size() + s2.size());
-    auto it = std::set_union(s1.begin(), s1.end(), s2.begin(), s2.end(), v3.begin());
-    v3.resize(it-v3.begin());
+                        last        = size;
+                    };
+                }));
+            };
 
-    std::vector<size_t> v1      = to_vector(s1);
-    std::vector<size_t> v2      = to_vector(s2);
+            for (std::thread& th : threads)
+                th.join();
 
-    dbs bs1(v1.size(), v1.data());
-    dbs bs2(v2.size(), v2.data());
-    dbs bs3 = bs1 | bs2;
+            dbs res     = atom.load();
 
-    std::vector<size_t> vret;
-    bs3.get_elements(vret);
+            if (increasing == false || res.size() != n_threads * n_items)
+                ret     = false;
 
-    auto it1 = v3.begin();
-    auto it2 = vret.begin();
+            for (size_t i = 0; i < n_threads * n_items; ++i)
+            {
+                if (res.test(i * 1000003) == false)
+                    ret = false;
+            };
+        };
 
-    bool ret = true;
-    for (; it1 != v3.end() && it2 != vret.end(); ++it1, ++it2)
-    {
-        if (*it1 != *it2)
-            ret = false;
-    };
+        // all nodes are released
+        if (allocated_nodes() != n_nodes)
+            ret         = false;
 
-    return ret;
+        return ret;
+    #else
+        (void)n_threads;
+        (void)n_items;
+        return true;
+    #endif
 };
 
-bool test_dbs::test_xor(size_t max_elem, size_t n_item)
-{        
-    std::set<size_t> s1         = rand_set(max_elem, n_item);
-    std::set<size_t> s2         = rand_set(max_elem, n_item);
+bool test_dbs::test_expr(size_t max_elem, size_t n_items)
+{
+    std::set<size_t> s[4];
+    dbs sets[4];
 
-    size_t common               = this->rand_elem(max_elem);
-    s1.insert(common);
-    s2.insert(common);
+    for (size_t i = 0; i < 4; ++i)
+    {
+        s[i]                    = rand_set(max_elem, n_items);
 
-    std::vector<size_t> v3;
-    v3.resize(s1.size() + s2.size());
-    auto it = std::set_symmetric_difference(s1.begin(), s1.end(), s2.begin(), s2.end(), v3.begin());
-    v3.resize(it-v3.begin());
+        // sets share some elements
+        if (i > 0 && genrand_real1() < 0.5)
+            s[i].insert(s[0].begin(), s[0].end());
 
-    std::vector<size_t> v1      = to_vector(s1);
-    std::vector<size_t> v2      = to_vector(s2);
+        std::vector<size_t> v   = to_vector(s[i]);
+        sets[i]                 = dbs(v.size(), v.data());
+    };
 
-    dbs bs1(v1.size(), v1.data());
-    dbs bs2(v2.size(), v2.data());
-    dbs bs3 = bs1 ^ bs2;
+    auto set_and = [](const std::set<size_t>& x, const std::set<size_t>& y)
+    {
+        std::set<size_t> r;
+        std::set_intersection(x.begin(), x.end(), y.begin(), y.end(), std::inserter(r, r.end()));
+        return r;
+    };
+    auto set_or = [](const std::set<size_t>& x, const std::set<size_t>& y)
+    {
+        std::set<size_t> r;
+        std::set_union(x.begin(), x.end(), y.begin(), y.end(), std::inserter(r, r.end()));
+        return r;
+    };
+    auto set_xor = [](const std::set<size_t>& x, const std::set<size_t>& y)
+    {
+        std::set<size_t> r;
+        std::set_symmetric_difference(x.begin(), x.end(), y.begin(), y.end(), 
+                                      std::inserter(r, r.end()));
+        return r;
+    };
+    auto set_diff = [](const std::set<size_t>& x, const std::set<size_t>& y)
+    {
+        std::set<size_t> r;
+        std::set_difference(x.begin(), x.end(), y.begin(), y.end(), std::inserter(r, r.end()));
+        return r;
+    };
 
-    std::vector<size_t> vret;
-    bs3.get_elements(vret);
+    const dbs& a    = sets[0];
+    const dbs& b    = sets[1];
+    const dbs& c    = sets[2];
+    const dbs& d    = sets[3];
+
+    std::set<size_t> res[7];
+    res[0]          = set_or(set_and(s[0], s[1]), set_diff(s[2], s[3]));
+    res[1]          = set_xor(set_xor(s[0], s[1]), s[2]);
+    res[2]          = set_diff(set_or(s[0], s[1]), set_and(s[2], s[0]));
+    res[3]          = set_diff(s[0], s[1]);
+    res[4]          = s[0];
+    res[5]          = std::set<size_t>();
+    res[6]          = set_and(set_or(s[0], s[1]), set_or(s[0], s[2]));
+
+    dbs r[7];
+    r[0]            = (a & b) | (c - d);
+    r[1]            = a ^ b ^ c;
+    r[2]            = (a | b) - (c & a);
+    r[3]            = a - b;
+    r[4]            = (a & a) | (a - a);
+    r[5]            = (a ^ a) & b;
+    r[6]            = (a | b) & (dbs(a) | c);
+
+    size_t count[7];
+    count[0]        = ((a & b) | (c - d)).count();
+    count[1]        = (a ^ b ^ c).count();
+    count[2]        = ((a | b) - (c & a)).count();
+    count[3]        = (a - b).count();
+    count[4]        = ((a & a) | (a - a)).count();
+    count[5]        = ((a ^ a) & b).count();
+    count[6]        = ((a | b) & (dbs(a) | c)).count();
+
+    bool any[7];
+    any[0]          = ((a & b) | (c - d)).any();
+    any[1]          = (a ^ b ^ c).any();
+    any[2]          = ((a | b) - (c & a)).any();
+    any[3]          = (a - b).any();
+    any[4]          = ((a & a) | (a - a)).any();
+    any[5]          = ((a ^ a) & b).any();
+    any[6]          = ((a | b) & (dbs(a) | c)).any();
+
+    bool ret        = true;
+
+    for (size_t i = 0; i < 7; ++i)
+    {
+        std::vector<size_t> v   = to_vector(res[i]);
 
-    auto it1 = v3.begin();
-    auto it2 = vret.begin();
+        // result must be in the canonical form
+        if (r[i] != dbs(v.size(), v.data()))
+            ret     = false;
 
-    bool ret = true;
-    for (; it1 != v3.end() && it2 != vret.end(); ++it1, ++it2)
-    {
-        if (*it1 != *it2)
-        {
-            std::cout << "error\n";
-            dbs bs4 = bs1 ^ bs2;
-            ret = false;
-        };
+        if (count[i] != v.size() || any[i] != (v.size() > 0))
+            ret     = false;
     };
 
+    // expressions store copies of temporary bitsets
+    auto e          = dbs(a) | b;
+    dbs r1          = e;
+
+    if (r1 != (a | b) || a.test_any(b) != (a & b).any() || a.test_all(b) != (b - a).none())
+        ret         = false;
+
     return ret;
 };
 
@@ -822,6 +4412,18 @@ std::vector<size_t> test_dbs::to_vector(const std::set<size_t>& s)
     return ret;
 };
 
+void test_dbs::add_ranges(std::vector<size_t>& elems, size_t max_elem, size_t n_ranges)
+{
+    for (size_t i = 0; i < n_ranges; ++i)
+    {
+        size_t first    = rand_elem(max_elem);
+        size_t length   = 1 + rand_elem(std::min(max_elem - first, size_t(100000)));
+
+        for (size_t j = 0; j < length; ++j)
+            elems.push_back(first + j);
+    };
+};
+
 void test_dbs::test_pert_set(size_t max_elem, size_t n_items, size_t n_rep)
 {    
     //size_t max_elem = 64*32*32*32*32;
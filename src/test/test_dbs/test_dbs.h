@@ -39,8 +39,36 @@ struct test_dbs
         bool                test_neq(size_t max_elem, size_t n_items);
 
         bool                test_and(size_t max_elem, size_t n_items);
+        bool                test_and_levels(size_t max_elem, size_t n_items);
         bool                test_or(size_t max_elem, size_t n_items);
         bool                test_xor(size_t max_elem, size_t n_items);        
+        bool                test_reclaim(size_t max_elem, size_t n_items);
+        bool                test_resource(size_t max_elem, size_t n_items, bool use_pools);
+        bool                test_resource_threads(size_t max_elem, size_t n_items);
+        bool                test_move(size_t max_elem, size_t n_items);
+        bool                test_iterator(size_t max_elem, size_t n_items, size_t n_search);
+        bool                test_decode(size_t max_elem, size_t n_items);
+        bool                test_next(size_t max_elem, size_t n_items, size_t n_search);
+        bool                test_visitor(size_t max_elem, size_t n_items);
+        bool                test_expr(size_t max_elem, size_t n_items);
+        bool                test_parallel(size_t max_elem, size_t n_items, size_t n_threads);
+        bool                test_atom(size_t n_threads, size_t n_items);
+        bool                test_atom_retire(size_t n_threads, size_t n_items);
+        bool                test_init();
+        bool                test_from_unsorted(size_t max_elem, size_t n_items, size_t n_threads);
+        bool                test_stream_builder(size_t max_elem, size_t n_items);
+        bool                test_history(size_t max_elem, size_t n_items, size_t n_versions);
+        bool                test_serialize(size_t max_elem, size_t n_items);
+        bool                test_serialize_collection(size_t max_elem, size_t n_items, 
+                                size_t n_sets);
+        bool                test_view(size_t max_elem, size_t n_items);
+        bool                test_roaring(size_t max_elem, size_t n_items, size_t n_ranges);
+        bool                test_text(size_t max_elem, size_t n_items, size_t n_ranges);
+        bool                test_diff(size_t max_elem, size_t n_items, size_t n_changes);
+        bool                test_hash(size_t max_elem, size_t n_items);
+        bool                test_compare_elements(size_t max_elem, size_t n_items);
+        bool                test_unordered(size_t max_elem, size_t n_items, size_t n_sets);
+        bool                test_sketch(size_t max_elem, size_t n_items);
 
         bool                test_set_all(size_t n_rep);
         bool                test_constructor_all(size_t n_rep);
@@ -54,6 +82,29 @@ struct test_dbs
         bool                test_and_all(size_t n_rep);
         bool                test_or_all(size_t n_rep);
         bool                test_xor_all(size_t n_rep);
+        bool                test_reclaim_all(size_t n_rep);
+        bool                test_resource_all(size_t n_rep);
+        bool                test_move_all(size_t n_rep);
+        bool                test_iterator_all(size_t n_rep);
+        bool                test_decode_all(size_t n_rep);
+        bool                test_next_all(size_t n_rep);
+        bool                test_visitor_all(size_t n_rep);
+        bool                test_expr_all(size_t n_rep);
+        bool                test_parallel_all(size_t n_rep);
+        bool                test_init_all(size_t n_rep);
+        bool                test_atom_all(size_t n_rep);
+        bool                test_from_unsorted_all(size_t n_rep);
+        bool                test_stream_builder_all(size_t n_rep);
+        bool                test_history_all(size_t n_rep);
+        bool                test_serialize_all(size_t n_rep);
+        bool                test_view_all(size_t n_rep);
+        bool                test_roaring_all(size_t n_rep);
+        bool                test_text_all(size_t n_rep);
+        bool                test_diff_all(size_t n_rep);
+        bool                test_hash_all(size_t n_rep);
+        bool                test_compare_elements_all(size_t n_rep);
+        bool                test_unordered_all(size_t n_rep);
+        bool                test_sketch_all(size_t n_rep);
 
         bool                test_perf_find_set(size_t max_elem, size_t n_items, size_t n_rep, double& t);    
         bool                test_perf_find_dbs(size_t max_elem, size_t n_items, size_t n_rep, double& t); 
@@ -61,6 +112,27 @@ struct test_dbs
         double              test_perf_find_set(size_t max_elem, size_t n_rep, bool& ret);    
         double              test_perf_find_dbs(size_t max_elem, size_t n_rep, bool& ret); 
 
+        double              test_perf_alloc(size_t max_elem, size_t n_items, size_t n_rep);
+        void                test_perf_refcount(size_t max_elem, size_t n_items, size_t n_rep);
+        void                test_perf_iterator(size_t max_elem, size_t n_items, size_t n_rep);
+        void                test_perf_expr(size_t max_elem, size_t n_items, size_t n_rep);
+        void                test_perf_parallel(size_t max_elem, size_t n_items, size_t n_rep);
+        void                test_perf_from_unsorted(size_t max_elem, size_t n_items);
+        void                test_perf_stream_builder(size_t max_elem, size_t n_items);
+        void                test_perf_history(size_t max_elem, size_t n_items, size_t n_versions);
+        void                test_perf_serialize(size_t max_elem, size_t n_items);
+        void                test_perf_serialize_collection(size_t max_elem, size_t n_items, 
+                                size_t n_sets);
+        void                test_perf_view(size_t max_elem, size_t n_items, size_t n_rep);
+        void                test_perf_roaring(size_t max_elem, size_t n_items, size_t n_ranges);
+        void                test_perf_text(size_t max_elem, size_t n_items, size_t n_ranges);
+        void                test_perf_diff(size_t max_elem, size_t n_items, size_t n_changes,
+                                size_t n_rep);
+        void                test_perf_hash(size_t max_elem, size_t n_items, size_t n_sets);
+        void                test_perf_unordered(size_t max_elem, size_t n_items, size_t n_sets);
+        void                test_perf_sketch(size_t max_elem, size_t n_items);
+        double              test_perf_atom(size_t n_threads, size_t n_ops, double write_ratio);
+
         bool                test_all(size_t n_rep);
         void                test_perf_all(size_t n_rep, bool& ret);
         void                test_pert_set(size_t max_elem, size_t n_items, size_t n_rep);
@@ -69,6 +141,11 @@ struct test_dbs
         std::set<size_t>    rand_set(size_t max_elem, size_t n_items);
         std::vector<size_t> to_vector(const std::set<size_t>& );
         size_t              rand_elem(size_t max_elem);
+
+        // append n_ranges random ranges of consecutive elements to elems;
+        // appended elements may be repeated
+        void                add_ranges(std::vector<size_t>& elems, size_t max_elem, 
+                                size_t n_ranges);
 };
 
 }}
\ No newline at end of file